@@ -0,0 +1,765 @@
+// 原生图像内核与采集链路的基准测试。
+//
+// 内核：对合成的 16bit 图像按不同尺寸与线程数反复运行，统计每次调用的耗时分布（min / p50 / p90 / p99 / mean）
+// 与吞吐量（MPix/s，按 p50 计算）。
+// 采集链路：加载模拟相机（qhyccd_simulator），按不同 ROI、传输位数与线程数连续拍摄，
+// 记录每帧 曝光 + 读出、统计、预览图 各阶段与总耗时。
+//
+// 结果以 JSON 写入 --output 指定的文件（默认 bench_results.json），每条结果占一行、字段顺序固定，
+// 便于在不同版本之间直接 diff。
+//
+// 计时之前先校验：分派后的内核与对应的标量参考实现（*Scalar）在同一输入上的输出必须逐字节一致，
+// 否则报告不一致的内核并以非零状态退出（--no-verify 跳过）。
+//
+// 用法：qhy_bench [--quick] [--output file] [--filter name] [--threads 1,2,4] [--sizes 1920x1080,4096x2160]
+//                 [--no-capture] [--no-verify] [--simulator path]
+
+#include "camera_session.h"
+#include "cpu_features.h"
+#include "fits_writer.h"
+#include "image_binning.h"
+#include "image_calibration.h"
+#include "image_debayer.h"
+#include "image_preview.h"
+#include "image_profile.h"
+#include "image_regions.h"
+#include "image_stars.h"
+#include "image_stats.h"
+#include "image_stretch.h"
+#include "live_stacker.h"
+#include "parallel.h"
+#include "qhyccd_dynamic.h"
+#include "tile_pyramid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef QHY_BENCH_SIMULATOR_PATH
+#define QHY_BENCH_SIMULATOR_PATH ""
+#endif
+
+typedef std::chrono::steady_clock Clock;
+typedef std::function<void()> BenchFn;
+
+struct Size {
+  uint32_t width;
+  uint32_t height;
+};
+
+struct BenchOptions {
+  bool quick = false;
+  bool capture = true;
+  bool verify = true;
+  std::string output = "bench_results.json";
+  std::string filter;
+  std::string simulator = QHY_BENCH_SIMULATOR_PATH;
+  std::vector<size_t> threads;
+  std::vector<Size> sizes;
+};
+
+// 耗时分布，单位毫秒
+struct Latency {
+  double min = 0;
+  double p50 = 0;
+  double p90 = 0;
+  double p99 = 0;
+  double mean = 0;
+};
+
+struct KernelResult {
+  std::string name;
+  Size size;
+  size_t threads;
+  size_t iterations;
+  double mpixPerSec;
+  Latency latency;
+};
+
+struct CaptureResult {
+  Size size;
+  uint32_t transferBits;
+  size_t threads;
+  size_t frames;
+  double fps;
+  double mpixPerSec;
+  Latency latency;
+  double captureP50;  // 曝光 + 读出（含模拟器生成图像）
+  double statsP50;
+  double previewP50;
+};
+
+static double ElapsedMs(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static Latency Summarize(std::vector<double> samples) {
+  Latency l;
+  if (samples.empty()) {
+    return l;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double q) {
+    size_t i = (size_t)(q * (double)(samples.size() - 1) + 0.5);
+    return samples[std::min(i, samples.size() - 1)];
+  };
+  l.min = samples.front();
+  l.p50 = at(0.50);
+  l.p90 = at(0.90);
+  l.p99 = at(0.99);
+  double sum = 0;
+  for (double s : samples) {
+    sum += s;
+  }
+  l.mean = sum / (double)samples.size();
+  return l;
+}
+
+// 预热一次后反复运行，至少 minIters 次且累计不少于 minSeconds，最多 maxIters 次
+static std::vector<double> RunTimed(const BenchFn &fn, size_t minIters, size_t maxIters, double minSeconds) {
+  fn();
+  std::vector<double> samples;
+  Clock::time_point begin = Clock::now();
+  while (samples.size() < maxIters) {
+    Clock::time_point start = Clock::now();
+    fn();
+    Clock::time_point end = Clock::now();
+    samples.push_back(ElapsedMs(start, end));
+    if (samples.size() >= minIters && ElapsedMs(begin, end) >= minSeconds * 1000.0) {
+      break;
+    }
+  }
+  return samples;
+}
+
+// ---- 合成输入 ----
+
+// 天光梯度 + 噪声 + 少量饱和点，直方图分布接近真实图像
+struct BenchImage {
+  Size size;
+  std::vector<uint16_t> pixels;
+};
+
+static BenchImage MakeImage(Size size) {
+  BenchImage image;
+  image.size = size;
+  image.pixels.resize((size_t)size.width * size.height);
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+  for (uint32_t y = 0; y < size.height; y++) {
+    uint16_t *row = image.pixels.data() + (size_t)y * size.width;
+    uint32_t base = 1000 + y * 2000 / size.height;
+    for (uint32_t x = 0; x < size.width; x++) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      uint32_t noise = (uint32_t)(state & 0x1FF);
+      row[x] = (state >> 40) % 5000 == 0 ? 65535 : (uint16_t)(base + x * 500 / size.width + noise);
+    }
+  }
+  return image;
+}
+
+// 在合成图像上加 300 颗高斯星点（sigma 1.6 像素），用于星点检测与叠加
+static std::vector<uint16_t> StarField(const BenchImage &image) {
+  std::vector<uint16_t> field(image.pixels);
+  const int width = (int)image.size.width;
+  const int height = (int)image.size.height;
+  uint64_t state = 0x2545F4914F6CDD1Dull;
+  for (int n = 0; n < 300; n++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    const double cx = (double)(state % (uint64_t)width) + 0.3;
+    const double cy = (double)((state >> 20) % (uint64_t)height) + 0.6;
+    const double amp = 500.0 + (double)((state >> 40) % 20000);
+    for (int y = (int)cy - 6; y <= (int)cy + 6; y++) {
+      for (int x = (int)cx - 6; x <= (int)cx + 6; x++) {
+        if (x < 0 || y < 0 || x >= width || y >= height) {
+          continue;
+        }
+        const double d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+        uint16_t &p = field[(size_t)y * width + x];
+        p = (uint16_t)std::min(65535.0, p + amp * std::exp(-d2 / (2.0 * 1.6 * 1.6)));
+      }
+    }
+  }
+  return field;
+}
+
+// ---- 内核 ----
+
+struct Kernel {
+  const char *name;
+  // 为输入图像准备输出缓冲区，返回单次调用
+  std::function<BenchFn(const BenchImage &)> prepare;
+};
+
+static std::vector<Kernel> Kernels() {
+  std::vector<Kernel> kernels;
+  kernels.push_back({"stretch_gray8", [](const BenchImage &image) {
+    auto out = std::make_shared<std::vector<uint8_t>>(image.pixels.size());
+    return BenchFn([&image, out] {
+      StretchLevels16(image.pixels.data(), out->data(), image.pixels.size(), 1000, 4000, STRETCH_GRAY8);
+    });
+  }});
+  kernels.push_back({"stretch_rgba8", [](const BenchImage &image) {
+    auto out = std::make_shared<std::vector<uint8_t>>(image.pixels.size() * 4);
+    return BenchFn([&image, out] {
+      StretchLevels16(image.pixels.data(), out->data(), image.pixels.size(), 1000, 4000, STRETCH_RGBA8);
+    });
+  }});
+  kernels.push_back({"histogram_stats16", [](const BenchImage &image) {
+    auto stats = std::make_shared<ImageStats>();
+    return BenchFn([&image, stats] {
+      ComputeImageStats16(image.pixels.data(), image.pixels.size(), stats.get());
+    });
+  }});
+  kernels.push_back({"downsample_box4", [](const BenchImage &image) {
+    auto out = std::make_shared<std::vector<uint16_t>>(image.pixels.size() / 16 + image.size.width + image.size.height);
+    return BenchFn([&image, out] {
+      DownsampleBox16(image.pixels.data(), image.size.width, image.size.height, 4, out->data());
+    });
+  }});
+  kernels.push_back({"bin2x2_average", [](const BenchImage &image) {
+    auto out = std::make_shared<std::vector<uint16_t>>(image.pixels.size() / 4);
+    return BenchFn([&image, out] {
+      SoftwareBin16(image.pixels.data(), image.size.width, image.size.height, 2, BIN_AVERAGE, false, out->data());
+    });
+  }});
+  kernels.push_back({"bin4x4_sum", [](const BenchImage &image) {
+    auto out = std::make_shared<std::vector<uint16_t>>(image.pixels.size() / 16);
+    return BenchFn([&image, out] {
+      SoftwareBin16(image.pixels.data(), image.size.width, image.size.height, 4, BIN_SUM, false, out->data());
+    });
+  }});
+  kernels.push_back({"bin2x2_bayer", [](const BenchImage &image) {
+    auto out = std::make_shared<std::vector<uint16_t>>(image.pixels.size() / 4);
+    return BenchFn([&image, out] {
+      SoftwareBin16(image.pixels.data(), image.size.width, image.size.height, 2, BIN_AVERAGE, true, out->data());
+    });
+  }});
+  kernels.push_back({"calibrate_dark_flat", [](const BenchImage &image) {
+    auto dark = std::make_shared<std::vector<float>>(image.pixels.size());
+    auto gain = std::make_shared<std::vector<float>>(image.pixels.size());
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+      (*dark)[i] = (float)(200 + i % 37);
+      (*gain)[i] = 0.9f + (float)(i % 101) * 0.002f;
+    }
+    auto out = std::make_shared<std::vector<uint16_t>>(image.pixels.size());
+    return BenchFn([&image, dark, gain, out] {
+      ApplyCalibration16(image.pixels.data(), dark->data(), gain->data(), 100.0f, image.pixels.size(), out->data());
+    });
+  }});
+  kernels.push_back({"combine_median8", [](const BenchImage &image) {
+    // 8 帧错位的同一幅图，按中位数合成
+    auto frames = std::make_shared<std::vector<const uint16_t *>>();
+    size_t pixels = image.pixels.size() - 8;
+    for (size_t i = 0; i < 8; i++) {
+      frames->push_back(image.pixels.data() + i);
+    }
+    auto out = std::make_shared<std::vector<float>>(pixels);
+    return BenchFn([frames, pixels, out] {
+      CombineFrames16(frames->data(), frames->size(), pixels, COMBINE_MEDIAN, kDefaultClipSigma, out->data());
+    });
+  }});
+  kernels.push_back({"star_detect", [](const BenchImage &image) {
+    auto field = std::make_shared<std::vector<uint16_t>>(StarField(image));
+    auto stars = std::make_shared<std::vector<Star>>();
+    return BenchFn([&image, field, stars] {
+      // 与取帧时的对焦指标相同：检测并测量每颗星的 HFR / FWHM
+      StarDetectOptions options;
+      options.measureShape = true;
+      DetectStars16(field->data(), image.size.width, image.size.height, options, stars.get(), nullptr);
+    });
+  }});
+  kernels.push_back({"region_stats_ellipse", [](const BenchImage &image) {
+    // 与整帧内切的椭圆（约 79% 的像素），光栅化结果在 Live 中缓存，只计统计
+    RegionShape shape;
+    shape.type = REGION_ELLIPSE;
+    shape.points = {{0.0, 0.0}, {(double)image.size.width, (double)image.size.height}};
+    auto mask = std::make_shared<RegionMask>();
+    RasterizeRegion(shape, mask.get());
+    auto stats = std::make_shared<RegionStats>();
+    return BenchFn([&image, mask, stats] {
+      ComputeRegionStats16(image.pixels.data(), image.size.width, image.size.height, *mask, stats.get());
+    });
+  }});
+  kernels.push_back({"profile_bicubic_w9", [](const BenchImage &image) {
+    // 整帧对角线的剖面，宽 9 像素：拖动线测量控制点时每次移动的开销（与图像大小基本无关）
+    std::vector<ProfilePoint> path = {{0.5, 0.5}, {image.size.width - 0.5, image.size.height - 0.5}};
+    ProfileOptions options;
+    options.interpolation = PROFILE_BICUBIC;
+    options.width = 9;
+    auto result = std::make_shared<ProfileResult>();
+    return BenchFn([&image, path, options, result] {
+      SampleProfile16(image.pixels.data(), image.size.width, image.size.height, path, options, result.get());
+    });
+  }});
+  kernels.push_back({"stack_sigma", [](const BenchImage &image) {
+    // 每次调用都把同一幅星场与参考帧（第一次调用）配准后叠加
+    auto field = std::make_shared<std::vector<uint16_t>>(StarField(image));
+    auto stacker = std::make_shared<LiveStacker>(StackOptions{STACK_SIGMA_CLIP});
+    auto frame = std::make_shared<std::vector<uint16_t>>(field->size());
+    return BenchFn([&image, field, stacker, frame] {
+      std::copy(field->begin(), field->end(), frame->begin());
+      StackFrameResult result;
+      stacker->Add(frame->data(), image.size.width, image.size.height, 0, &result);
+    });
+  }});
+  kernels.push_back({"debayer_bilinear", [](const BenchImage &image) {
+    auto out = std::make_shared<std::vector<uint16_t>>(image.pixels.size() * 3);
+    return BenchFn([&image, out] {
+      DebayerRgb16(image.pixels.data(), image.size.width, image.size.height, BAYER_RGGB, DEBAYER_BILINEAR,
+                   out->data());
+    });
+  }});
+  kernels.push_back({"debayer_edge_aware", [](const BenchImage &image) {
+    auto out = std::make_shared<std::vector<uint16_t>>(image.pixels.size() * 3);
+    return BenchFn([&image, out] {
+      DebayerRgb16(image.pixels.data(), image.size.width, image.size.height, BAYER_RGGB, DEBAYER_EDGE_AWARE,
+                   out->data());
+    });
+  }});
+  kernels.push_back({"fits_swap16", [](const BenchImage &image) {
+    auto out = std::make_shared<std::vector<uint8_t>>(image.pixels.size() * 2);
+    return BenchFn([&image, out] {
+      SwapToFits16(image.pixels.data(), out->data(), image.pixels.size());
+    });
+  }});
+  kernels.push_back({"tile_pyramid", [](const BenchImage &image) {
+    auto pyramid = std::make_shared<TilePyramid>();
+    return BenchFn([&image, pyramid] {
+      pyramid->Build(image.pixels.data(), image.size.width, image.size.height, kDefaultTileSize, nullptr);
+    });
+  }});
+  return kernels;
+}
+
+static bool Selected(const BenchOptions &options, const char *name) {
+  return options.filter.empty() || std::strstr(name, options.filter.c_str()) != nullptr;
+}
+
+// ---- 校验 ----
+
+// 与 Kernels() 中同名内核的输入相同，比较分派后的实现（SIMD + 多线程）与单线程标量参考实现的输出，
+// 两者按设计逐字节一致。
+struct Check {
+  const char *name;
+  std::function<bool(const BenchImage &)> run;
+};
+
+template <typename T>
+static bool SameBytes(const std::vector<T> &a, const std::vector<T> &b) {
+  return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+static Check StretchCheck(const char *name, StretchFormat format) {
+  return {name, [format](const BenchImage &image) {
+    std::vector<uint8_t> out(image.pixels.size() * StretchBytesPerPixel(format));
+    std::vector<uint8_t> ref(out.size());
+    StretchLevels16(image.pixels.data(), out.data(), image.pixels.size(), 1000, 4000, format);
+    StretchLevels16Scalar(image.pixels.data(), ref.data(), image.pixels.size(), 1000, 4000, format);
+    return SameBytes(out, ref);
+  }};
+}
+
+static Check BinCheck(const char *name, uint32_t factor, BinMode mode, bool bayer) {
+  return {name, [factor, mode, bayer](const BenchImage &image) {
+    std::vector<uint16_t> out((size_t)(image.size.width / factor) * (image.size.height / factor));
+    std::vector<uint16_t> ref(out.size());
+    SoftwareBin16(image.pixels.data(), image.size.width, image.size.height, factor, mode, bayer, out.data());
+    SoftwareBin16Scalar(image.pixels.data(), image.size.width, image.size.height, factor, mode, bayer, ref.data());
+    return SameBytes(out, ref);
+  }};
+}
+
+static std::vector<Check> Checks() {
+  std::vector<Check> checks;
+  checks.push_back(StretchCheck("stretch_gray8", STRETCH_GRAY8));
+  checks.push_back(StretchCheck("stretch_rgba8", STRETCH_RGBA8));
+  checks.push_back(BinCheck("bin2x2_average", 2, BIN_AVERAGE, false));
+  checks.push_back(BinCheck("bin4x4_sum", 4, BIN_SUM, false));
+  checks.push_back(BinCheck("bin2x2_bayer", 2, BIN_AVERAGE, true));
+  checks.push_back({"calibrate_dark_flat", [](const BenchImage &image) {
+    std::vector<float> dark(image.pixels.size());
+    std::vector<float> gain(image.pixels.size());
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+      dark[i] = (float)(200 + i % 37);
+      gain[i] = 0.9f + (float)(i % 101) * 0.002f;
+    }
+    std::vector<uint16_t> out(image.pixels.size());
+    std::vector<uint16_t> ref(out.size());
+    ApplyCalibration16(image.pixels.data(), dark.data(), gain.data(), 100.0f, image.pixels.size(), out.data());
+    ApplyCalibration16Scalar(image.pixels.data(), dark.data(), gain.data(), 100.0f, image.pixels.size(), ref.data());
+    return SameBytes(out, ref);
+  }});
+  checks.push_back({"profile_bicubic_w9", [](const BenchImage &image) {
+    std::vector<ProfilePoint> path = {{0.5, 0.5}, {image.size.width - 0.5, image.size.height - 0.5}};
+    ProfileOptions options;
+    options.interpolation = PROFILE_BICUBIC;
+    options.width = 9;
+    ProfileResult out;
+    ProfileResult ref;
+    bool ok = SampleProfile16(image.pixels.data(), image.size.width, image.size.height, path, options, &out);
+    bool refOk = SampleProfile16Scalar(image.pixels.data(), image.size.width, image.size.height, path, options, &ref);
+    // 按位比较，图像外的采样点（NaN）也必须一致
+    return ok == refOk && out.length == ref.length && out.spacing == ref.spacing && SameBytes(out.values, ref.values) &&
+           SameBytes(out.vertices, ref.vertices);
+  }});
+  checks.push_back({"debayer_bilinear", [](const BenchImage &image) {
+    std::vector<uint16_t> out(image.pixels.size() * 3);
+    std::vector<uint16_t> ref(out.size());
+    DebayerRgb16(image.pixels.data(), image.size.width, image.size.height, BAYER_RGGB, DEBAYER_BILINEAR, out.data());
+    DebayerBilinearRgb16Scalar(image.pixels.data(), image.size.width, image.size.height, BAYER_RGGB, ref.data());
+    return SameBytes(out, ref);
+  }});
+  checks.push_back({"fits_swap16", [](const BenchImage &image) {
+    std::vector<uint8_t> out(image.pixels.size() * 2);
+    std::vector<uint8_t> ref(out.size());
+    SwapToFits16(image.pixels.data(), out.data(), image.pixels.size());
+    SwapToFits16Scalar(image.pixels.data(), ref.data(), image.pixels.size());
+    return SameBytes(out, ref);
+  }});
+  return checks;
+}
+
+// 对每个尺寸与线程数运行全部校验（受 --filter 限制），任何一项不一致返回 false
+static bool RunChecks(const BenchOptions &options) {
+  bool ok = true;
+  for (const Size &size : options.sizes) {
+    BenchImage image = MakeImage(size);
+    for (const Check &check : Checks()) {
+      if (!Selected(options, check.name)) {
+        continue;
+      }
+      for (size_t threads : options.threads) {
+        SetParallelThreadLimit(threads);
+        bool same = check.run(image);
+        if (!same) {
+          std::fprintf(stderr, "校验失败：%s %ux%u %zu threads 与标量参考实现不一致\n", check.name, size.width,
+                       size.height, threads);
+          ok = false;
+        }
+      }
+    }
+  }
+  SetParallelThreadLimit(0);
+  if (ok) {
+    std::printf("校验通过：分派后的内核与标量参考实现一致\n");
+  }
+  return ok;
+}
+
+static void RunKernels(const BenchOptions &options, std::vector<KernelResult> *results) {
+  std::vector<Kernel> kernels = Kernels();
+  size_t minIters = options.quick ? 3 : 10;
+  size_t maxIters = options.quick ? 20 : 200;
+  double minSeconds = options.quick ? 0.1 : 0.5;
+
+  for (const Size &size : options.sizes) {
+    BenchImage image = MakeImage(size);
+    double mpix = (double)size.width * size.height / 1e6;
+    for (const Kernel &kernel : kernels) {
+      if (!Selected(options, kernel.name)) {
+        continue;
+      }
+      BenchFn fn = kernel.prepare(image);
+      for (size_t threads : options.threads) {
+        SetParallelThreadLimit(threads);
+        KernelResult r;
+        r.name = kernel.name;
+        r.size = size;
+        r.threads = threads;
+        std::vector<double> samples = RunTimed(fn, minIters, maxIters, minSeconds);
+        r.iterations = samples.size();
+        r.latency = Summarize(samples);
+        r.mpixPerSec = r.latency.p50 > 0 ? mpix / (r.latency.p50 / 1000.0) : 0;
+        std::printf("%-20s %5ux%-5u %2zu threads  p50 %9.3f ms  p99 %9.3f ms  %9.1f MPix/s\n", r.name.c_str(),
+                    size.width, size.height, threads, r.latency.p50, r.latency.p99, r.mpixPerSec);
+        results->push_back(r);
+      }
+    }
+  }
+  SetParallelThreadLimit(0);
+}
+
+// ---- 采集链路 ----
+
+static void SetEnvDefault(const char *name, const char *value) {
+  if (std::getenv(name) != nullptr) {
+    return;
+  }
+#ifdef _WIN32
+  _putenv_s(name, value);
+#else
+  setenv(name, value, 0);
+#endif
+}
+
+static bool RunCapture(const BenchOptions &options, std::vector<CaptureResult> *results) {
+  // 默认不模拟曝光等待与 USB 传输时间，只测量软件开销（含模拟器生成图像）；可用环境变量覆盖
+  SetEnvDefault("QHYSIM_TIME_SCALE", "0");
+  SetEnvDefault("QHYSIM_READOUT_MS", "0");
+
+  QHYCCDFunctions qhy = {};
+  std::string error;
+  if (!LoadQHYCCDLibrary(&qhy, options.simulator.c_str(), &error)) {
+    std::fprintf(stderr, "无法加载模拟相机 %s: %s\n", options.simulator.c_str(), error.c_str());
+    return false;
+  }
+
+  std::vector<Size> rois = options.quick ? std::vector<Size>{{640, 480}, {1920, 1080}}
+                                         : std::vector<Size>{{640, 480}, {1920, 1080}, {4096, 2160}};
+  const uint32_t bitDepths[] = {8, 16};
+  size_t frames = options.quick ? 5 : 30;
+
+  CameraSession session(&qhy);
+  if (!session.Open()) {
+    std::fprintf(stderr, "打开模拟相机失败: %s\n", session.LastError().c_str());
+    UnloadQHYCCDLibrary(&qhy);
+    return false;
+  }
+
+  bool ok = true;
+  for (const Size &roi : rois) {
+    for (uint32_t bits : bitDepths) {
+      CaptureSettings settings;
+      settings.exposureUs = 1000.0;
+      settings.roiWidth = roi.width;
+      settings.roiHeight = roi.height;
+      settings.transferBits = bits;
+      if (!session.Configure(settings)) {
+        std::fprintf(stderr, "配置模拟相机失败: %s\n", session.LastError().c_str());
+        ok = false;
+        break;
+      }
+      std::vector<uint8_t> buffer(session.FrameBufferSize());
+
+      for (size_t threads : options.threads) {
+        SetParallelThreadLimit(threads);
+        std::vector<double> total, capture, stats, preview;
+        ImageStats imageStats;
+        PreviewImage previewImage;
+        Clock::time_point begin = Clock::now();
+        for (size_t i = 0; i <= frames && ok; i++) {
+          FrameInfo info;
+          Clock::time_point t0 = Clock::now();
+          if (!session.Capture(buffer.data(), buffer.size(), &info)) {
+            std::fprintf(stderr, "拍摄失败: %s\n", session.LastError().c_str());
+            ok = false;
+            break;
+          }
+          Clock::time_point t1 = Clock::now();
+          ComputeFrameStats(buffer.data(), info.bytes, info.bpp, &imageStats);
+          Clock::time_point t2 = Clock::now();
+          if (info.bpp > 8 && info.channels == 1) {
+            MakePreview16(reinterpret_cast<const uint16_t *>(buffer.data()), info.width, info.height, 1920, 1080,
+                          &previewImage);
+          }
+          Clock::time_point t3 = Clock::now();
+          if (i == 0) {
+            begin = t3;  // 第一帧用于预热，不计入结果
+            continue;
+          }
+          capture.push_back(ElapsedMs(t0, t1));
+          stats.push_back(ElapsedMs(t1, t2));
+          preview.push_back(ElapsedMs(t2, t3));
+          total.push_back(ElapsedMs(t0, t3));
+        }
+        if (!ok) {
+          break;
+        }
+        double seconds = ElapsedMs(begin, Clock::now()) / 1000.0;
+
+        CaptureResult r;
+        r.size = roi;
+        r.transferBits = bits;
+        r.threads = threads;
+        r.frames = total.size();
+        r.fps = seconds > 0 ? (double)r.frames / seconds : 0;
+        r.mpixPerSec = r.fps * roi.width * roi.height / 1e6;
+        r.latency = Summarize(total);
+        r.captureP50 = Summarize(capture).p50;
+        r.statsP50 = Summarize(stats).p50;
+        r.previewP50 = Summarize(preview).p50;
+        std::printf("capture %5ux%-5u %2u bit %2zu threads  p50 %9.3f ms (readout %.3f, stats %.3f, preview %.3f)  "
+                    "%7.1f fps\n",
+                    roi.width, roi.height, bits, threads, r.latency.p50, r.captureP50, r.statsP50, r.previewP50,
+                    r.fps);
+        results->push_back(r);
+      }
+    }
+  }
+  SetParallelThreadLimit(0);
+  session.Close();
+  UnloadQHYCCDLibrary(&qhy);
+  return ok;
+}
+
+// ---- 输出 ----
+
+static void WriteLatency(FILE *f, const Latency &l) {
+  std::fprintf(f, "\"latencyMs\": {\"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"mean\": %.4f}", l.min,
+               l.p50, l.p90, l.p99, l.mean);
+}
+
+static bool WriteJson(const BenchOptions &options, const std::vector<KernelResult> &kernels,
+                      const std::vector<CaptureResult> &captures) {
+  FILE *f = std::fopen(options.output.c_str(), "w");
+  if (f == nullptr) {
+    std::fprintf(stderr, "无法写入 %s\n", options.output.c_str());
+    return false;
+  }
+  char timestamp[32] = {0};
+  std::time_t now = std::time(nullptr);
+  std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+  std::fprintf(f, "{\n");
+  std::fprintf(f, "  \"schema\": 1,\n");
+  std::fprintf(f, "  \"timestamp\": \"%s\",\n", timestamp);
+  std::fprintf(f, "  \"simd\": \"%s\",\n", SimdLevelName());
+  std::fprintf(f, "  \"hardwareThreads\": %zu,\n", ParallelThreadCount());
+  std::fprintf(f, "  \"quick\": %s,\n", options.quick ? "true" : "false");
+
+  std::fprintf(f, "  \"kernels\": [\n");
+  for (size_t i = 0; i < kernels.size(); i++) {
+    const KernelResult &r = kernels[i];
+    std::fprintf(f, "    {\"name\": \"%s\", \"width\": %u, \"height\": %u, \"threads\": %zu, \"iterations\": %zu, "
+                 "\"mpixPerSec\": %.2f, ",
+                 r.name.c_str(), r.size.width, r.size.height, r.threads, r.iterations, r.mpixPerSec);
+    WriteLatency(f, r.latency);
+    std::fprintf(f, "}%s\n", i + 1 < kernels.size() ? "," : "");
+  }
+  std::fprintf(f, "  ],\n");
+
+  std::fprintf(f, "  \"capture\": [\n");
+  for (size_t i = 0; i < captures.size(); i++) {
+    const CaptureResult &r = captures[i];
+    std::fprintf(f, "    {\"width\": %u, \"height\": %u, \"transferBits\": %u, \"threads\": %zu, \"frames\": %zu, "
+                 "\"fps\": %.2f, \"mpixPerSec\": %.2f, ",
+                 r.size.width, r.size.height, r.transferBits, r.threads, r.frames, r.fps, r.mpixPerSec);
+    WriteLatency(f, r.latency);
+    std::fprintf(f, ", \"stagesP50Ms\": {\"capture\": %.4f, \"stats\": %.4f, \"preview\": %.4f}}%s\n", r.captureP50,
+                 r.statsP50, r.previewP50, i + 1 < captures.size() ? "," : "");
+  }
+  std::fprintf(f, "  ]\n");
+  std::fprintf(f, "}\n");
+  std::fclose(f);
+  return true;
+}
+
+// ---- 参数 ----
+
+static std::vector<std::string> SplitList(const char *text) {
+  std::vector<std::string> items;
+  std::string item;
+  for (const char *p = text; ; p++) {
+    if (*p == ',' || *p == '\0') {
+      if (!item.empty()) {
+        items.push_back(item);
+      }
+      item.clear();
+      if (*p == '\0') {
+        break;
+      }
+    } else {
+      item += *p;
+    }
+  }
+  return items;
+}
+
+static bool ParseOptions(int argc, char **argv, BenchOptions *options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (arg == "--quick") {
+      options->quick = true;
+    } else if (arg == "--no-capture") {
+      options->capture = false;
+    } else if (arg == "--no-verify") {
+      options->verify = false;
+    } else if (arg == "--output" && value) {
+      options->output = argv[++i];
+    } else if (arg == "--filter" && value) {
+      options->filter = argv[++i];
+    } else if (arg == "--simulator" && value) {
+      options->simulator = argv[++i];
+    } else if (arg == "--threads" && value) {
+      for (const std::string &item : SplitList(argv[++i])) {
+        size_t n = (size_t)std::strtoul(item.c_str(), nullptr, 10);
+        if (n > 0) {
+          options->threads.push_back(n);
+        }
+      }
+    } else if (arg == "--sizes" && value) {
+      for (const std::string &item : SplitList(argv[++i])) {
+        Size size = {0, 0};
+        if (std::sscanf(item.c_str(), "%ux%u", &size.width, &size.height) == 2 && size.width > 0 && size.height > 0) {
+          options->sizes.push_back(size);
+        }
+      }
+    } else {
+      std::fprintf(stderr,
+                   "用法: qhy_bench [--quick] [--output file] [--filter name] [--threads 1,2,4] "
+                   "[--sizes 1920x1080,4096x2160] [--no-capture] [--no-verify] [--simulator path]\n");
+      return false;
+    }
+  }
+
+  if (options->threads.empty()) {
+    // 1, 2, 4, ... 直到全部线程
+    size_t all = ParallelThreadCount();
+    for (size_t n = 1; n < all; n *= 2) {
+      options->threads.push_back(n);
+    }
+    options->threads.push_back(all);
+  }
+  if (options->sizes.empty()) {
+    if (options->quick) {
+      options->sizes = {{1920, 1080}};
+    } else {
+      options->sizes = {{1920, 1080}, {4096, 2160}, {9576, 6388}};
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    return 2;
+  }
+  std::printf("SIMD: %s, threads: %zu\n", SimdLevelName(), ParallelThreadCount());
+
+  bool verified = !options.verify || RunChecks(options);
+
+  std::vector<KernelResult> kernels;
+  RunKernels(options, &kernels);
+
+  std::vector<CaptureResult> captures;
+  bool ok = true;
+  if (options.capture) {
+    if (options.simulator.empty()) {
+      std::fprintf(stderr, "未指定模拟相机（--simulator），跳过采集链路测试\n");
+    } else {
+      ok = RunCapture(options, &captures);
+    }
+  }
+
+  if (!WriteJson(options, kernels, captures)) {
+    return 1;
+  }
+  std::printf("结果已写入 %s\n", options.output.c_str());
+  return ok && verified ? 0 : 1;
+}
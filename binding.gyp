@@ -4,11 +4,35 @@
       "target_name": "qhyccd_addon",
       "sources": [
         "src/qhyccd_addon.cpp",
-        "src/qhyccd_dynamic.cpp"
+        "src/qhyccd_dynamic.cpp",
+        "src/dynamic_library.cpp",
+        "src/camera_session.cpp",
+        "src/live_capture.cpp",
+        "src/frame_pool.cpp",
+        "src/parallel.cpp",
+        "src/cpu_features.cpp",
+        "src/image_stretch.cpp",
+        "src/image_stats.cpp",
+        "src/image_preview.cpp",
+        "src/image_debayer.cpp",
+        "src/image_binning.cpp",
+        "src/image_calibration.cpp",
+        "src/image_stars.cpp",
+        "src/image_regions.cpp",
+        "src/image_profile.cpp",
+        "src/live_stacker.cpp",
+        "src/fits_writer.cpp",
+        "src/ser_writer.cpp",
+        "src/shared_frame_ring.cpp",
+        "src/tile_pyramid.cpp",
+        "src/frame_trace.cpp"
       ],
       "include_dirs": [
         "src"
       ],
+      "defines": [
+        "__CPP_MODE__=1"
+      ],
       "msvs_settings": {
         "VCCLCompilerTool": {
           "AdditionalOptions": [
@@ -16,15 +40,54 @@
           ]
         }
       },
-      "libraries": [
-        "<(module_root_dir)/sdk/x64/qhyccd.lib"
+      "conditions": [
+        ["OS=='win'", {
+          "libraries": [
+            "<(module_root_dir)/sdk/x64/qhyccd.lib"
+          ],
+          "defines": [
+            "_WIN32"
+          ]
+        }],
+        ["OS=='linux'", {
+          "cflags_cc": [
+            "-std=c++17",
+            "-pthread"
+          ],
+          "libraries": [
+            "-ldl",
+            "-lrt",
+            "-pthread"
+          ]
+        }]
+      ]
+    },
+    {
+      "target_name": "qhyccd_simulator",
+      "type": "shared_library",
+      "sources": [
+        "src/qhyccd_simulator.cpp"
       ],
-      "defines": [
-        "_WIN32",
-        "__CPP_MODE__=1"
+      "msvs_settings": {
+        "VCCLCompilerTool": {
+          "AdditionalOptions": [
+            "/utf-8"
+          ]
+        }
+      },
+      "conditions": [
+        ["OS=='linux'", {
+          "product_dir": "<(PRODUCT_DIR)",
+          "cflags_cc": [
+            "-std=c++17",
+            "-pthread",
+            "-fvisibility=hidden"
+          ],
+          "libraries": [
+            "-pthread"
+          ]
+        }]
       ]
     }
   ]
 }
-
-
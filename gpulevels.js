@@ -0,0 +1,209 @@
+/**
+ * GPU 电平拉伸模块
+ * 16bit 原始数据以单通道浮点纹理（r32float）上传一次，由着色器按黑/白电平线性拉伸到灰度。
+ * 所有图像（预览图与各图块）共享同一组电平 uniform，拖动滑块只需更新 uniform，不再逐帧在 CPU 上生成 RGBA 并重新上传纹理。
+ * 浮点纹理不能线性过滤，插值在着色器中用 texelFetch 手动完成，因此需要 WebGL2。
+ * 彩色相机去马赛克后的 RGB16 以 rgba32float 上传，各通道按同一组电平分别拉伸。
+ */
+
+const GPU_LEVELS_VERTEX = `
+in vec2 aPosition;
+in vec2 aUV;
+out vec2 vUV;
+
+uniform mat3 uProjectionMatrix;
+uniform mat3 uWorldTransformMatrix;
+uniform mat3 uTransformMatrix;
+
+void main() {
+  mat3 mvp = uProjectionMatrix * uWorldTransformMatrix * uTransformMatrix;
+  gl_Position = vec4((mvp * vec3(aPosition, 1.0)).xy, 0.0, 1.0);
+  vUV = aUV;
+}
+`;
+
+// 电平单位为 16bit 强度值；与原生拉伸一致：range = max(white - black, 1)。
+// swizzle 为 'rrr'（灰度，r32float）或 'rgb'（彩色，rgba32float）
+const gpuLevelsFragment = (swizzle) => `
+precision highp float;
+
+in vec2 vUV;
+out vec4 finalColor;
+
+uniform highp sampler2D uTexture;
+uniform float uBlack;
+uniform float uWhite;
+uniform float uInterpolate;
+
+vec3 fetchRaw(ivec2 p, ivec2 size) {
+  return texelFetch(uTexture, clamp(p, ivec2(0), size - 1), 0).${swizzle};
+}
+
+vec3 sampleRaw(vec2 uv) {
+  ivec2 size = textureSize(uTexture, 0);
+  vec2 p = uv * vec2(size) - 0.5;
+  if (uInterpolate < 0.5) {
+    return fetchRaw(ivec2(floor(p + 0.5)), size);
+  }
+  ivec2 i = ivec2(floor(p));
+  vec2 f = p - floor(p);
+  vec3 a = fetchRaw(i, size);
+  vec3 b = fetchRaw(i + ivec2(1, 0), size);
+  vec3 c = fetchRaw(i + ivec2(0, 1), size);
+  vec3 d = fetchRaw(i + ivec2(1, 1), size);
+  return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
+}
+
+void main() {
+  float range = max(uWhite - uBlack, 1.0);
+  vec3 v = clamp((sampleRaw(vUV) - uBlack) / range, 0.0, 1.0);
+  finalColor = vec4(v, 1.0);
+}
+`;
+
+/**
+ * 转为纹理数据：灰度直接转为 Float32Array；RGB 补上 alpha 通道（WebGL2 的 RGB32F 不能作为渲染目标，
+ * 各实现对它的支持也不一致，统一使用 RGBA32F）。长度相符时写入 reuse 而不重新分配。
+ */
+function toTextureData(pixels16, channels, reuse = null) {
+  const count = channels === 3 ? Math.floor(pixels16.length / 3) : pixels16.length;
+  const length = channels === 3 ? count * 4 : count;
+  const data = reuse && reuse.length === length ? reuse : new Float32Array(length);
+  if (channels !== 3) {
+    data.set(pixels16);
+    return data;
+  }
+  for (let i = 0; i < count; i += 1) {
+    data[i * 4] = pixels16[i * 3];
+    data[i * 4 + 1] = pixels16[i * 3 + 1];
+    data[i * 4 + 2] = pixels16[i * 3 + 2];
+    data[i * 4 + 3] = 65535;
+  }
+  return data;
+}
+
+class GpuLevels {
+  /**
+   * 当前渲染器是否支持（需要 WebGL2：浮点纹理与 texelFetch）
+   * @param {PIXI.Renderer} renderer
+   */
+  static isSupported(renderer) {
+    return (
+      !!PIXI.GlProgram &&
+      !!PIXI.Mesh &&
+      !!PIXI.MeshGeometry &&
+      !!PIXI.UniformGroup &&
+      renderer.type === PIXI.RendererType.WEBGL &&
+      !!renderer.context &&
+      renderer.context.webGLVersion === 2
+    );
+  }
+
+  constructor() {
+    this.glProgram = PIXI.GlProgram.from({
+      vertex: GPU_LEVELS_VERTEX,
+      fragment: gpuLevelsFragment('rrr'),
+      name: 'gpu-levels',
+    });
+    this.colorGlProgram = PIXI.GlProgram.from({
+      vertex: GPU_LEVELS_VERTEX,
+      fragment: gpuLevelsFragment('rgb'),
+      name: 'gpu-levels-color',
+    });
+    // 所有图像共享，修改后对全部图像生效
+    this.levelsUniforms = new PIXI.UniformGroup({
+      uBlack: { value: 0, type: 'f32' },
+      uWhite: { value: 65535, type: 'f32' },
+      uInterpolate: { value: 1, type: 'f32' },
+    });
+  }
+
+  /**
+   * 设置黑/白电平（16bit 强度值）
+   */
+  setLevels(black, white) {
+    const uniforms = this.levelsUniforms.uniforms;
+    if (uniforms.uBlack === black && uniforms.uWhite === white) return;
+    uniforms.uBlack = black;
+    uniforms.uWhite = white;
+    this.levelsUniforms.update();
+  }
+
+  /**
+   * 插值（双线性）/ 不插值（最近邻）显示
+   * @param {boolean} enabled
+   */
+  setInterpolation(enabled) {
+    this.levelsUniforms.uniforms.uInterpolate = enabled ? 1 : 0;
+    this.levelsUniforms.update();
+  }
+
+  /**
+   * 用 16bit 像素创建一个 width x height 的图像网格（局部坐标为像素坐标）
+   * @param {Uint16Array} pixels16
+   * @param {number} width
+   * @param {number} height
+   * @param {number} channels 1 为灰度，3 为交错 RGB
+   * @returns {PIXI.Mesh}
+   */
+  createImage(pixels16, width, height, channels = 1) {
+    const source = new PIXI.BufferImageSource({
+      resource: toTextureData(pixels16, channels),
+      width,
+      height,
+      format: channels === 3 ? 'rgba32float' : 'r32float',
+      // 浮点纹理只能按最近邻采样，插值在着色器中完成
+      scaleMode: 'nearest',
+    });
+    const geometry = new PIXI.MeshGeometry({
+      positions: new Float32Array([0, 0, width, 0, width, height, 0, height]),
+      uvs: new Float32Array([0, 0, 1, 0, 1, 1, 0, 1]),
+      indices: new Uint32Array([0, 1, 2, 0, 2, 3]),
+    });
+    const shader = new PIXI.Shader({
+      glProgram: channels === 3 ? this.colorGlProgram : this.glProgram,
+      resources: {
+        uTexture: source,
+        levelsUniforms: this.levelsUniforms,
+      },
+    });
+    const mesh = new PIXI.Mesh({ geometry, shader });
+    mesh.levelsSource = source;
+    mesh.levelsChannels = channels;
+    return mesh;
+  }
+
+  /**
+   * 尺寸不变时原地更新图像网格的像素，返回 false 表示需要重新创建
+   * @param {PIXI.Mesh} mesh
+   * @param {Uint16Array} pixels16
+   * @param {number} width
+   * @param {number} height
+   * @param {number} channels
+   */
+  updateImage(mesh, pixels16, width, height, channels = 1) {
+    const source = mesh.levelsSource;
+    if (!source || source.width !== width || source.height !== height || mesh.levelsChannels !== channels) {
+      return false;
+    }
+    source.resource = toTextureData(pixels16, channels, source.resource);
+    source.update();
+    return true;
+  }
+
+  /**
+   * 释放图像网格及其纹理
+   * @param {PIXI.Mesh} mesh
+   */
+  destroyImage(mesh) {
+    const source = mesh.levelsSource;
+    const { geometry, shader } = mesh;
+    mesh.destroy();
+    geometry.destroy();
+    // 共享的 uniform 组不随单个网格销毁
+    shader.destroy(false);
+    if (source) {
+      source.destroy();
+    }
+  }
+}
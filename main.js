@@ -1,8 +1,26 @@
 const { app, BrowserWindow, ipcMain, dialog } = require('electron');
+const fs = require('fs');
 const path = require('path');
 
 let mainWindow = null;
 let qhyAddon = null;
+let cameraSession = null;
+// 最近发送给渲染进程的一帧：保留原生缓冲区，供调整黑/白电平时在主进程中重新拉伸
+let lastFrame = null;
+let frameSeq = 0;
+// 渲染进程请求的预览图最大尺寸（约等于图像在屏幕上的显示尺寸），为 0 时发送整帧
+let previewSize = { width: 0, height: 0 };
+// 共享内存帧通道（SharedFrameRing）：preload 能映射共享内存时，帧数据写入其中，IPC 只发送通知
+let sharedTransport = false;
+let frameRing = null;
+// 共享内存中的帧槽数：渲染进程最多可以落后 FRAME_RING_SLOTS - 1 帧
+const FRAME_RING_SLOTS = 3;
+// 超过该大小的帧（很少见：大靶面相机且不缩小预览）仍走普通 IPC，避免常驻过多共享内存
+const FRAME_RING_MAX_SLOT_BYTES = 128 * 1024 * 1024;
+// 已合成的校正主帧 { bias?, dark?, flat? }，每项为 MasterFrameBuilder.build() 的结果
+const calibrationMasters = {};
+// 渲染进程的测量图形中可统计的区域 [{ id, type, points }]，没有时为 null；创建会话时一并设置
+let regionShapes = null;
 
 function createWindow() {
   mainWindow = new BrowserWindow({
@@ -12,6 +30,8 @@ function createWindow() {
       preload: path.join(__dirname, 'preload.js'),
       contextIsolation: true,
       nodeIntegration: false,
+      // preload 需要加载原生模块来映射共享内存帧通道（页面本身仍无法访问 Node）
+      sandbox: false,
     },
   });
 
@@ -33,33 +53,564 @@ function loadAddon() {
   }
 }
 
+// 渲染进程上报的计时事件使用的线程号（与原生线程编号区分开）
+const RENDERER_TRACE_THREAD = 1000000;
+
+/**
+ * 记录主进程中的一个阶段（从 start 到现在），时间与原生计时同一时钟（微秒）
+ */
+function traceStage(name, frameId, start) {
+  qhyAddon.traceEvent(name, frameId || 0, start, qhyAddon.traceNow());
+}
+
+/**
+ * 把 getTimings() 的事件转换为 Chrome trace-event JSON（about:tracing / Perfetto 可直接打开）
+ */
+function buildChromeTrace(events) {
+  const pid = process.pid;
+  const traceEvents = events.map((e) => ({
+    name: e.name,
+    cat: e.name.split('.')[0],
+    ph: 'X',
+    ts: e.start,
+    dur: e.duration,
+    pid,
+    tid: e.thread,
+    args: { frameId: e.frameId },
+  }));
+  traceEvents.push({ name: 'thread_name', ph: 'M', pid, tid: RENDERER_TRACE_THREAD, args: { name: 'renderer' } });
+  return { traceEvents, displayTimeUnit: 'ms' };
+}
+
+/**
+ * 获取常驻的相机会话：首次调用时打开相机，之后的拍摄复用同一个句柄，
+ * 只需支付曝光和读出的时间。
+ */
+function getCameraSession() {
+  loadAddon();
+  if (!cameraSession) {
+    cameraSession = new qhyAddon.CameraSession();
+    cameraSession.setPreviewSize(previewSize.width, previewSize.height);
+    cameraSession.setRegions(regionShapes);
+  }
+  if (!cameraSession.isOpen()) {
+    cameraSession.open();
+  }
+  return cameraSession;
+}
+
+/**
+ * 用已合成的主帧设置校正：有暗场时减暗场，否则减偏置；平场先减偏置再归一化
+ */
+function applyCalibration(session, pedestal = 0) {
+  const { bias, dark, flat } = calibrationMasters;
+  if (!bias && !dark && !flat) {
+    throw new Error('尚未合成任何校正主帧');
+  }
+  return session.setCalibration({ dark: dark || bias, flat, flatDark: bias, pedestal });
+}
+
+/**
+ * 关闭相机会话（出错或退出时调用），下次拍摄会重新打开相机
+ */
+function closeCameraSession() {
+  if (cameraSession) {
+    try {
+      cameraSession.close();
+    } catch (err) {
+      console.error(err);
+    }
+  }
+}
+
+/**
+ * 保留最近一帧，并把上一帧的缓冲区还给原生缓冲池
+ */
+function retainFrame(session, frame, seq) {
+  if (lastFrame) {
+    lastFrame.session.releaseFrame(lastFrame.frame);
+    // 金字塔持有帧缓冲区，立即释放而不必等垃圾回收
+    if (lastFrame.frame.pyramid) {
+      lastFrame.frame.pyramid.dispose();
+    }
+  }
+  lastFrame = { session, frame, seq, display: null };
+}
+
+/**
+ * 取得用于显示的图像 { data, width, height, scale, channels }：
+ * 未指定尺寸时使用帧自带的预览图；指定的尺寸比整帧小时从整帧重新缩小（结果按尺寸缓存）。
+ * 彩色相机的帧（frame.bayer）总是经原生去马赛克得到 RGB16（channels 为 3）。
+ */
+function getDisplayImage(retained, maxWidth, maxHeight) {
+  const { frame } = retained;
+  if (!maxWidth && !maxHeight && frame.preview) {
+    return { ...frame.preview, scale: frame.preview.factor };
+  }
+  if (frame.bayer || (maxWidth && maxWidth < frame.width) || (maxHeight && maxHeight < frame.height)) {
+    const cached = retained.display;
+    if (cached && cached.maxWidth === maxWidth && cached.maxHeight === maxHeight) {
+      return cached.image;
+    }
+    const preview = qhyAddon.downsample(frame, { maxWidth, maxHeight });
+    const image = { ...preview, scale: preview.factor };
+    retained.display = { maxWidth, maxHeight, image };
+    return image;
+  }
+  return { data: frame, width: frame.width, height: frame.height, scale: 1, channels: 1 };
+}
+
+/**
+ * getDisplayImage 返回的 16bit 像素数据（预览图为 ArrayBuffer，整帧为帧对象）
+ */
+function rawImageBuffer(data) {
+  if (data instanceof ArrayBuffer) {
+    return data;
+  }
+  const { byteLength } = data;
+  return byteLength === undefined || byteLength === data.data.byteLength ? data.data : data.data.slice(0, byteLength);
+}
+
+/**
+ * 把要发送的像素写入共享内存帧通道，返回 { name, sequence, byteLength }；
+ * 未启用共享内存或帧过大时返回 null（改用普通 IPC）。帧变大时重建更大的通道。
+ * source 为 16bit 帧对象或 ArrayBuffer
+ */
+function publishToFrameRing(source, byteLength) {
+  if (!sharedTransport || byteLength > FRAME_RING_MAX_SLOT_BYTES) {
+    return null;
+  }
+  if (!frameRing || frameRing.info().slotBytes < byteLength) {
+    // 旧通道的名称随之删除，渲染进程按新通知中的名称重新映射
+    if (frameRing) {
+      frameRing.close();
+    }
+    frameRing = null;
+    try {
+      frameRing = new qhyAddon.SharedFrameRing({ slots: FRAME_RING_SLOTS, slotBytes: byteLength });
+    } catch (err) {
+      console.error(err);
+      sharedTransport = false;
+      return null;
+    }
+  }
+  const published = frameRing.publish(source);
+  return published ? { name: frameRing.info().name, ...published } : null;
+}
+
+/**
+ * 将一帧图像发送给渲染进程，并作为最近一帧保留下来。
+ * 有预览图时只发送预览图（整帧留在主进程中），payload.previewScale 为预览图 1 像素对应的原图像素数。
+ * payload.seq 用于 render-levels 请求对应到这一帧。
+ */
+function postFrame(session, frame, target, extra = {}) {
+  const { data, byteLength, width, height, bpp, channels, stats, bayer } = frame;
+  // 彩色帧没有预览图时整帧去马赛克后发送
+  const preview = frame.preview || (bayer ? qhyAddon.downsample(frame, {}) : null);
+  const postStart = qhyAddon.traceNow();
+  // 优先写入共享内存（帧对象直接按 byteLength 写入，不必先截取），渲染进程的 preload 按序号读出
+  const shared = preview
+    ? publishToFrameRing(preview.data, preview.data.byteLength)
+    : publishToFrameRing(frame, byteLength === undefined ? data.byteLength : byteLength);
+  let buffer = null;
+  if (!shared) {
+    if (preview) {
+      buffer = preview.data;
+    } else {
+      // data 是原生缓冲池中的 ArrayBuffer，可能比有效数据长，只发送前 byteLength 字节
+      buffer = byteLength === undefined || byteLength === data.byteLength ? data : data.slice(0, byteLength);
+    }
+  }
+
+  // 没有共享内存时直接通过结构化拷贝发送 ArrayBuffer
+  // 某些 Electron 版本不支持在此处传 ArrayBuffer 作为 transfer 列表，会报
+  // “Invalid value for transfer”，因此这里不再传第三个参数。
+  // FITS 录制中（或仍有帧在写盘）时附带写盘计数
+  const recording = session.getRecordingStats();
+  target.postMessage('frame-data', {
+    width,
+    height,
+    bpp,
+    channels,
+    buffer,
+    // 共享内存帧通道中的位置 { name, sequence, byteLength }，此时 buffer 为 null，由 preload 读出
+    shared,
+    previewWidth: preview ? preview.width : width,
+    previewHeight: preview ? preview.height : height,
+    previewScale: preview ? preview.factor : 1,
+    // 1 为灰度，3 为去马赛克后的交错 RGB16
+    previewChannels: preview ? preview.channels : 1,
+    bayer,
+    // 单帧拍摄时原生侧构建的图块金字塔信息，渲染进程按需用 get-tiles 请求可见图块
+    pyramid: frame.pyramid ? frame.pyramid.info() : null,
+    // 原生侧取帧时统计好的 65536 级直方图与 min / max / mean / median / stddev
+    stats,
+    seq: ++frameSeq,
+    // 帧 ID 与发送时刻（毫秒，Unix 纪元），渲染进程据此上报 IPC 传输与显示的耗时
+    frameId: frame.frameId,
+    postedAt: performance.timeOrigin + performance.now(),
+    recording: recording.recording || recording.queued > 0 ? recording : null,
+    // 实时叠加时本帧的配准结果 { accepted, frames, rejectedFrames, matches, residual, ... }
+    stack: frame.stack || null,
+    // 星点检测时的对焦指标 { count, medianHfr, medianFwhm, medianEccentricity, stride, data: Float32Array }
+    stars: frame.stars || null,
+    // 测量图形内的像素统计 [{ id, count, sum, mean, median, stddev, min, max, snr }]
+    regions: frame.regions || null,
+    // 实际进行了的校正 'D' / 'F' / 'DF'，尺寸 / ROI / bin 与主帧不符而未校正时为 null
+    calibration: frame.calibration || null,
+    ...extra,
+  });
+  traceStage('main.post', frame.frameId, postStart);
+  // postMessage 已完成序列化，缓冲区只在主进程中继续用于重新拉伸
+  retainFrame(session, frame, frameSeq);
+}
+
+// 按最近一帧换算 ROI 并下发到会话。rect 为最近一帧上的矩形（整帧像素坐标），按该帧的 roi 与软件 bin
+// 换算到传感器坐标；没有 rect 时为整个传感器。返回实际使用的 { x, y, width, height, bin }
+function setSessionRoi(session, rect, bin) {
+  if (!rect) {
+    return session.setRoi({ x: 0, y: 0, width: 0, height: 0, bin });
+  }
+  if (!lastFrame || !lastFrame.frame.roi) {
+    throw new Error('还没有图像，无法换算 ROI');
+  }
+  const { roi } = lastFrame.frame;
+  // 帧像素 → 未 bin 的传感器像素 → 新 bin 下的像素
+  const scale = roi.softwareBin * roi.bin;
+  const x0 = roi.x * roi.bin + Math.max(0, Math.floor(rect.x)) * scale;
+  const y0 = roi.y * roi.bin + Math.max(0, Math.floor(rect.y)) * scale;
+  const x1 = roi.x * roi.bin + Math.ceil(rect.x + rect.width) * scale;
+  const y1 = roi.y * roi.bin + Math.ceil(rect.y + rect.height) * scale;
+  return session.setRoi({
+    x: Math.floor(x0 / bin),
+    y: Math.floor(y0 / bin),
+    width: Math.max(1, Math.ceil((x1 - x0) / bin)),
+    height: Math.max(1, Math.ceil((y1 - y0) / bin)),
+    bin,
+  });
+}
+
 app.whenReady().then(() => {
   createWindow();
 
   // 渲染进程发起拍摄请求（不通过 invoke 返回，而是通过 postMessage 零拷贝回传）
-  ipcMain.on('capture-single-frame', (event, options) => {
+  // 曝光与读出在原生线程池中完成（captureAsync 返回 Promise），
+  // 长曝光期间主进程仍可正常处理 IPC 与窗口事件
+  ipcMain.on('capture-single-frame', async (event, options) => {
     try {
       loadAddon();
-      const res = qhyAddon.captureSingleFrame(options || {});
-      const { data, width, height, bpp, channels } = res;
-
-      // 直接通过结构化拷贝发送 ArrayBuffer
-      // 某些 Electron 版本不支持在此处传 ArrayBuffer 作为 transfer 列表，会报
-      // “Invalid value for transfer”，因此这里不再传第三个参数。
-      event.senderFrame.postMessage('frame-data', {
-        width,
-        height,
-        bpp,
-        channels,
-        buffer: data,
-      });
+      const start = qhyAddon.traceNow();
+      const session = getCameraSession();
+      // 上一次拍摄尚未完成或 Live 运行中：只是拒绝这次请求，会话与相机状态都正常，不能关闭
+      if (session.isBusy() || session.isLive()) {
+        event.senderFrame.postMessage('frame-error', session.isLive() ? 'Live 运行中，无法单帧拍摄' : '上一帧仍在拍摄中');
+        return;
+      }
+      const res = await session.captureAsync(options || {});
+      traceStage('main.capture', res.frameId, start);
+      postFrame(session, res, event.senderFrame);
     } catch (err) {
       console.error(err);
+      // SDK 出错后关闭会话，避免相机停留在未知状态
+      closeCameraSession();
       dialog.showErrorBox('拍摄失败', String(err.message || err));
       event.senderFrame.postMessage('frame-error', String(err.message || err));
     }
   });
 
+  // 实时预览：原生 Live 线程持续取帧，经 threadsafe function 回调到这里再转发给渲染进程
+  ipcMain.on('start-live', (event, options) => {
+    const target = event.senderFrame;
+    try {
+      const session = getCameraSession();
+      session.startLive(options || {}, (frame) => {
+        try {
+          const stats = session.getLiveStats();
+          postFrame(session, frame, target, { live: true, frameIndex: frame.frameIndex, fps: stats.fps });
+        } catch (err) {
+          // 窗口已关闭等情况下停止推流
+          console.error(err);
+          session.stopLive();
+        }
+      });
+    } catch (err) {
+      console.error(err);
+      target.postMessage('frame-error', String(err.message || err));
+    }
+  });
+
+  // preload 报告能否映射共享内存帧通道（加载原生模块失败或映射出错时为 false，改用普通 IPC）
+  ipcMain.on('frame-transport', (event, { shared = false } = {}) => {
+    try {
+      loadAddon();
+    } catch (err) {
+      // 原生模块尚未构建：拍摄时会再报错，这里只是不启用共享内存
+      console.error(err);
+    }
+    sharedTransport = Boolean(shared) && Boolean(qhyAddon && qhyAddon.SharedFrameRing);
+    if (!sharedTransport && frameRing) {
+      frameRing.close();
+      frameRing = null;
+    }
+  });
+
+  ipcMain.on('stop-live', () => {
+    if (cameraSession) {
+      cameraSession.stopLive();
+    }
+  });
+
+  // Live 期间调整曝光 / 增益 / 偏置
+  ipcMain.on('configure-camera', (event, options) => {
+    try {
+      if (cameraSession && cameraSession.isOpen() && !cameraSession.isBusy()) {
+        cameraSession.configure(options || {});
+      }
+    } catch (err) {
+      console.error(err);
+      event.senderFrame.postMessage('frame-error', String(err.message || err));
+    }
+  });
+
+  // 开始录制：之后拍到的每一帧都由原生写盘线程在后台保存。
+  // FITS 选择目录（每帧一个文件），SER 选择文件（Live 帧连续写入同一文件）。
+  // 返回保存位置，取消时为 null
+  ipcMain.handle('start-recording', async (event, { format = 'fits' } = {}) => {
+    const stamp = new Date().toISOString().replace(/[-:]/g, '').replace('T', '-').slice(0, 15);
+    const session = getCameraSession();
+    if (format === 'ser') {
+      const { canceled, filePath } = await dialog.showSaveDialog(mainWindow, {
+        title: '保存 SER 序列',
+        defaultPath: `capture-${stamp}.ser`,
+        filters: [{ name: 'SER', extensions: ['ser'] }],
+      });
+      if (canceled || !filePath) {
+        return null;
+      }
+      session.startRecording({ format: 'ser', path: filePath });
+      return filePath;
+    }
+    const { canceled, filePaths } = await dialog.showOpenDialog(mainWindow, {
+      title: '选择 FITS 保存目录',
+      properties: ['openDirectory', 'createDirectory'],
+    });
+    if (canceled || !filePaths || !filePaths[0]) {
+      return null;
+    }
+    session.startRecording({ format: 'fits', directory: filePaths[0], prefix: `capture-${stamp}` });
+    return filePaths[0];
+  });
+
+  // 停止录制（已入队的帧继续在后台写完），返回写盘计数
+  ipcMain.handle('stop-recording', () => {
+    if (!cameraSession) {
+      return null;
+    }
+    cameraSession.stopRecording();
+    return cameraSession.getRecordingStats();
+  });
+
+  // 拍摄 count 帧并合成校正主帧（bias / dark 取中位数，flat 做 sigma 截断均值），保存在主进程中。
+  // options 为拍摄参数：暗场应与亮场同曝光，平场按平场光源另设曝光。
+  // 返回 { kind, width, height, frames }
+  ipcMain.handle('build-master', async (event, { kind = 'dark', count = 10, options = {} } = {}) => {
+    if (!['bias', 'dark', 'flat'].includes(kind)) {
+      throw new Error(`未知的主帧类型: ${kind}`);
+    }
+    const session = getCameraSession();
+    if (session.isLive()) {
+      throw new Error('请先停止 Live 再拍摄校正帧');
+    }
+    if (session.isBusy()) {
+      throw new Error('上一帧仍在拍摄中');
+    }
+    const builder = new qhyAddon.MasterFrameBuilder({ method: kind === 'flat' ? 'sigma' : 'median' });
+    // raw：校正帧本身不做校正（当前的校正参数原样保留，新主帧由 set-calibration 显式启用），
+    // 不进入录制与实时叠加，也不生成金字塔等分析结果；软件 bin 固定为 1
+    try {
+      for (let i = 0; i < Math.max(1, count); i++) {
+        const frame = await session.captureAsync({ ...options, softwareBin: 1, raw: true });
+        try {
+          builder.add(frame);
+        } finally {
+          session.releaseFrame(frame);
+          if (frame.pyramid) {
+            frame.pyramid.dispose();
+          }
+        }
+      }
+      calibrationMasters[kind] = await builder.build();
+    } finally {
+      builder.clear();
+    }
+    const { width, height, frames } = calibrationMasters[kind];
+    return { kind, width, height, frames };
+  });
+
+  // 启用 / 关闭取帧时的校正，返回 session.getCalibration()
+  ipcMain.handle('set-calibration', (event, { enabled = false, pedestal = 0 } = {}) => {
+    const session = getCameraSession();
+    if (!enabled) {
+      session.setCalibration(null);
+      return null;
+    }
+    return applyCalibration(session, pedestal);
+  });
+
+  // 启用 / 关闭实时叠加（原生侧配准后累加，之后的帧即为叠加结果；录制仍保存原始帧）。
+  // method 为 'mean' 或 'sigma'，window 为滑动窗口帧数（0 表示累计全部帧）
+  ipcMain.handle('set-stacking', (event, { enabled = false, method = 'mean', sigma = 3, window = 0 } = {}) => {
+    const session = getCameraSession();
+    if (!enabled) {
+      session.stopStacking();
+      return null;
+    }
+    session.startStacking({ method, sigma, window });
+    return session.getStackingStats();
+  });
+
+  // 切换子帧 ROI 与硬件 bin（只下发分辨率，不重新初始化相机；Live 中也可切换，之后的帧即为新 ROI）。
+  // 返回实际使用的 { x, y, width, height, bin }（bin 后的像素）
+  ipcMain.handle('set-roi', (event, { rect = null, bin = 1 } = {}) => {
+    const session = getCameraSession();
+    const wasLive = session.isLive();
+    try {
+      return setSessionRoi(session, rect, bin);
+    } catch (err) {
+      // Live 中切换失败且无法恢复连续曝光时原生侧已停止 Live，按 Live 出错通知渲染进程
+      if (wasLive && !session.isLive()) {
+        event.senderFrame.postMessage('frame-error', String(err.message || err));
+      }
+      throw err;
+    }
+  });
+
+  // 启用 / 关闭每帧的星点检测与 HFR / FWHM（结果随 frame-data 的 stars 送到渲染进程）
+  ipcMain.handle('set-star-detection', (event, { enabled = false, threshold = 5, maxStars = 500 } = {}) => {
+    const session = getCameraSession();
+    session.setStarDetection(enabled ? { threshold, maxStars } : null);
+    return enabled;
+  });
+
+  // 测量图形变化：原生侧重新光栅化变化了的图形，之后每帧随 frame-data 的 regions 带回统计；
+  // 同时立即统计最近一帧并返回，单帧拍摄后编辑图形也能看到结果。还没有相机会话时只记下来，不打开相机
+  ipcMain.handle('set-regions', (event, shapes = []) => {
+    regionShapes = Array.isArray(shapes) && shapes.length > 0 ? shapes : null;
+    if (!cameraSession) {
+      return [];
+    }
+    cameraSession.setRegions(regionShapes);
+    if (!regionShapes || !lastFrame || lastFrame.session !== cameraSession) {
+      return [];
+    }
+    const { frame } = lastFrame;
+    return frame.bpp > 8 && frame.channels === 1 ? cameraSession.measureRegions(frame) : [];
+  });
+
+  // 最近一帧沿线段 / 折线的强度剖面（原生插值取样，只访问路径附近的像素），拖动控制点时逐次请求。
+  // 返回 { length, spacing, lineWidth, values: Float32Array, vertices: Float32Array }，没有可用的帧时为 null
+  ipcMain.handle('get-profile', (event, { points, lineWidth = 1, interpolation = 'bilinear' } = {}) => {
+    if (!lastFrame) {
+      return null;
+    }
+    const { frame } = lastFrame;
+    if (!(frame.bpp > 8 && frame.channels === 1)) {
+      return null;
+    }
+    const start = qhyAddon.traceNow();
+    const profile = qhyAddon.profile(frame, { points, lineWidth, interpolation });
+    traceStage('main.profile', frame.frameId, start);
+    return profile;
+  });
+
+  // 丢弃叠加结果，下一帧成为新的参考帧
+  ipcMain.handle('reset-stacking', () => {
+    const session = getCameraSession();
+    session.resetStacking();
+    return session.getStackingStats();
+  });
+
+  // 渲染进程的显示尺寸变化（窗口大小 / 缩放），之后的帧按该尺寸生成预览图
+  ipcMain.on('set-preview-size', (event, { width = 0, height = 0 } = {}) => {
+    previewSize = { width: Math.max(0, Math.round(width)), height: Math.max(0, Math.round(height)) };
+    if (cameraSession) {
+      cameraSession.setPreviewSize(previewSize.width, previewSize.height);
+    }
+  });
+
+  // 按黑/白电平把最近一帧的显示图像拉伸为 RGBA（原生 SIMD 多线程实现），
+  // 返回 { seq, width, height, scale, channels, buffer }，channels 为 raw 数据的通道数。给出 maxWidth / maxHeight 时按该尺寸重新生成显示图像。
+  // seq 与最近一帧不符（已有新帧）或没有可用帧时返回 null。
+  ipcMain.handle('render-levels', (event, { seq, black, white, maxWidth = 0, maxHeight = 0, format = 'rgba' } = {}) => {
+    if (!lastFrame || lastFrame.seq !== seq) {
+      return null;
+    }
+    const start = qhyAddon.traceNow();
+    const image = getDisplayImage(lastFrame, maxWidth, maxHeight);
+    // raw：返回 16bit 原始数据，由渲染进程在 GPU 上按电平拉伸
+    const channels = image.channels || 1;
+    const buffer =
+      format === 'raw'
+        ? rawImageBuffer(image.data)
+        : qhyAddon.stretch(image.data, { black, white, format: 'rgba', channels });
+    traceStage('main.render-levels', lastFrame.frame.frameId, start);
+    return { seq, width: image.width, height: image.height, scale: image.scale, channels, buffer };
+  });
+
+  // 请求最近一帧的若干图块（按黑/白电平拉伸为 RGBA），tiles 为 [{ level, x, y }]，
+  // 返回 [{ level, x, y, width, height, buffer }]；帧已过期或没有金字塔时返回 null
+  ipcMain.handle('get-tiles', (event, { seq, black, white, format = 'rgba', tiles = [] } = {}) => {
+    if (!lastFrame || lastFrame.seq !== seq || !lastFrame.frame.pyramid) {
+      return null;
+    }
+    const { pyramid } = lastFrame.frame;
+    const start = qhyAddon.traceNow();
+    const result = tiles.map(({ level, x, y }) => {
+      const tile = pyramid.getTile(level, x, y, { black, white, format: format === 'raw' ? 'raw' : 'rgba' });
+      return { level, x, y, width: tile.width, height: tile.height, buffer: tile.data };
+    });
+    traceStage('main.get-tiles', lastFrame.frame.frameId, start);
+    return result;
+  });
+
+  // 渲染进程上报的计时事件：[{ name, frameId, start, end }]，时间为毫秒（Unix 纪元），
+  // 换算到原生计时的时钟后记入同一个缓冲区
+  ipcMain.on('trace-events', (event, events) => {
+    if (!qhyAddon || !Array.isArray(events)) return;
+    const offsetUs = qhyAddon.traceNow() - (performance.timeOrigin + performance.now()) * 1000;
+    for (const { name, frameId, start, end } of events) {
+      qhyAddon.traceEvent(
+        `renderer.${name}`,
+        frameId || 0,
+        start * 1000 + offsetUs,
+        end * 1000 + offsetUs,
+        RENDERER_TRACE_THREAD,
+      );
+    }
+  });
+
+  // 各阶段计时：{ frameId?, clear? } => [{ name, frameId, thread, start, duration }]（微秒）
+  ipcMain.handle('get-timings', (event, options = {}) => {
+    loadAddon();
+    return qhyAddon.getTimings(options);
+  });
+
+  // 导出为 Chrome trace-event JSON，返回保存的路径（取消时为 null）
+  ipcMain.handle('export-trace', async () => {
+    loadAddon();
+    const trace = buildChromeTrace(qhyAddon.getTimings());
+    const { canceled, filePath } = await dialog.showSaveDialog(mainWindow, {
+      title: '导出性能追踪',
+      defaultPath: `webezcap-trace-${Date.now()}.json`,
+      filters: [{ name: 'Chrome Trace', extensions: ['json'] }],
+    });
+    if (canceled || !filePath) {
+      return null;
+    }
+    await fs.promises.writeFile(filePath, JSON.stringify(trace));
+    return filePath;
+  });
+
   app.on('activate', () => {
     if (BrowserWindow.getAllWindows().length === 0) {
       createWindow();
@@ -67,6 +618,14 @@ app.whenReady().then(() => {
   });
 });
 
+app.on('will-quit', () => {
+  closeCameraSession();
+  if (frameRing) {
+    frameRing.close();
+    frameRing = null;
+  }
+});
+
 app.on('window-all-closed', () => {
   if (process.platform !== 'darwin') {
     app.quit();
@@ -12,6 +12,10 @@ class MeasurementManager {
     this.getImageCoordsFromEvent = options.getImageCoordsFromEvent;
     this.getCurrentZoom = options.getCurrentZoom;
     this.imageSprite = options.imageSprite;
+    // 可统计像素的图形（点 / 圆 / 矩形 / 椭圆 / 多边形）变化时回调，参数为 getRegionShapes() 的结果
+    this.onRegionsChanged = options.onRegionsChanged || null;
+    // 剖面路径（getProfilePath()）变化时回调，没有线段 / 折线时参数为 null
+    this.onProfileChanged = options.onProfileChanged || null;
 
     // 测量模式常量
     this.MEASURE_MODES = {
@@ -26,6 +30,14 @@ class MeasurementManager {
       POLYGON: 'polygon',
       SELECT: 'select',
     };
+    // 可以统计区域内像素的图形
+    this.REGION_MODES = [
+      this.MEASURE_MODES.POINT,
+      this.MEASURE_MODES.CIRCLE,
+      this.MEASURE_MODES.RECT,
+      this.MEASURE_MODES.ELLIPSE,
+      this.MEASURE_MODES.POLYGON,
+    ];
 
     // 测量状态
     this.currentMeasureMode = this.MEASURE_MODES.NONE;
@@ -34,6 +46,10 @@ class MeasurementManager {
     this.activeMeasurement = null;
     this.selectedMeasurementId = null;
     this.hoverTarget = null;
+    // 原生侧统计的区域结果（按测量 id），以及最近一次回调的图形，用于跳过未变化的通知
+    this.regionStats = new Map();
+    this.regionSignature = '[]';
+    this.profileSignature = 'null';
 
     // 撤销/重做栈
     this.undoStack = [];
@@ -237,6 +253,13 @@ class MeasurementManager {
       main.appendChild(nameEl);
       main.appendChild(metricsEl);
 
+      if (this.REGION_MODES.includes(m.type)) {
+        const statsEl = document.createElement('div');
+        statsEl.className = 'measurement-item-metrics measurement-item-stats';
+        statsEl.textContent = this.formatRegionStats(this.regionStats.get(m.id));
+        main.appendChild(statsEl);
+      }
+
       const actions = document.createElement('div');
       actions.className = 'measurement-item-actions';
 
@@ -289,6 +312,7 @@ class MeasurementManager {
           const hex = `#${m.color.toString(16).padStart(6, '0')}`;
           this.measurementColorPicker.value = hex;
         }
+        this.notifyShapesChanged();
       });
 
       // 显示/隐藏单个测量
@@ -312,6 +336,8 @@ class MeasurementManager {
         this.refreshMeasurementList();
       });
     });
+
+    this.notifyShapesChanged();
   }
 
   /**
@@ -853,6 +879,7 @@ class MeasurementManager {
         if (measurement && measurement.points && measurement.points[pointIndex]) {
           measurement.points[pointIndex] = imgPos;
           this.updateMeasurementGraphics(measurement);
+          this.notifyShapesChanged();
         }
         return;
       }
@@ -902,6 +929,7 @@ class MeasurementManager {
     }
     this.activeMeasurement.previewPoint = null;
     this.updateMeasurementGraphics(this.activeMeasurement);
+    this.notifyShapesChanged();
   }
 
   /**
@@ -1099,6 +1127,93 @@ class MeasurementManager {
     });
   }
 
+  /**
+   * 取得用于子帧 ROI 的矩形：优先使用列表中选中的矩形测量，否则取最近绘制的一个
+   * @returns {{ x:number, y:number, width:number, height:number } | null} 图像像素坐标（整帧像素，左上角为原点）
+   */
+  getRoiRect() {
+    const rects = this.measurements.filter((m) => m.type === this.MEASURE_MODES.RECT && m.points.length >= 2);
+    if (rects.length === 0) return null;
+    const m = rects.find((mm) => mm.id === this.selectedMeasurementId) || rects[rects.length - 1];
+    const [p0, p1] = m.points;
+    return {
+      x: Math.min(p0.x, p1.x),
+      y: Math.min(p0.y, p1.y),
+      width: Math.abs(p1.x - p0.x),
+      height: Math.abs(p1.y - p0.y),
+    };
+  }
+
+  /**
+   * 取得可统计像素的图形（不含正在绘制中的图形）
+   * @returns {Array<{ id:string, type:string, points:Array<{x:number, y:number}> }>} 整帧像素坐标
+   */
+  getRegionShapes() {
+    return this.measurements
+      .filter((m) => m !== this.activeMeasurement && this.REGION_MODES.includes(m.type) && m.points.length > 0)
+      .map((m) => ({ id: m.id, type: m.type, points: m.points.map((p) => ({ x: p.x, y: p.y })) }));
+  }
+
+  /**
+   * 取得强度剖面的路径：优先使用列表中选中的线段 / 折线，否则取最近的一个（含正在绘制的线段）
+   * @returns {{ id:string, points:Array<{x:number, y:number}> } | null} 整帧像素坐标
+   */
+  getProfilePath() {
+    const lines = this.measurements.filter(
+      (m) =>
+        (m.type === this.MEASURE_MODES.LINE || m.type === this.MEASURE_MODES.POLYLINE) && m.points.length >= 2,
+    );
+    if (lines.length === 0) return null;
+    const m = lines.find((mm) => mm.id === this.selectedMeasurementId) || lines[lines.length - 1];
+    return { id: m.id, points: m.points.map((p) => ({ x: p.x, y: p.y })) };
+  }
+
+  /**
+   * 图形有变化时通知 onRegionsChanged / onProfileChanged（拖动控制点时每次移动都会调用，未变化时不通知）
+   */
+  notifyShapesChanged() {
+    if (this.onRegionsChanged) {
+      const shapes = this.getRegionShapes();
+      const signature = JSON.stringify(shapes);
+      if (signature !== this.regionSignature) {
+        this.regionSignature = signature;
+        this.onRegionsChanged(shapes);
+      }
+    }
+    if (this.onProfileChanged) {
+      const path = this.getProfilePath();
+      const signature = JSON.stringify(path);
+      if (signature !== this.profileSignature) {
+        this.profileSignature = signature;
+        this.onProfileChanged(path);
+      }
+    }
+  }
+
+  /**
+   * 显示原生侧统计的区域结果（frame-data 的 regions 或 setRegions 的返回值），只更新列表中的统计行
+   * @param {Array<Object>} list [{ id, count, sum, mean, median, stddev, min, max, snr }]
+   */
+  setRegionStats(list) {
+    this.regionStats = new Map((list || []).map((r) => [r.id, r]));
+    if (!this.measurementListEl) return;
+    this.measurementListEl.querySelectorAll('.measurement-item').forEach((row) => {
+      const statsEl = row.querySelector('.measurement-item-stats');
+      if (statsEl) {
+        statsEl.textContent = this.formatRegionStats(this.regionStats.get(row.dataset.id));
+      }
+    });
+  }
+
+  formatRegionStats(r) {
+    if (!r) return '';
+    if (!r.count) return '不在图像内';
+    return (
+      `N=${r.count} μ=${r.mean.toFixed(1)} σ=${r.stddev.toFixed(1)} med=${r.median} ` +
+      `min=${r.min} max=${r.max} Σ=${r.sum} SNR=${r.snr.toFixed(2)}`
+    );
+  }
+
   /**
    * 更新 imageSprite 引用（当图像更新时调用）
    */
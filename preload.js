@@ -1,4 +1,34 @@
 const { contextBridge, ipcRenderer } = require('electron');
+const path = require('path');
+
+// 共享内存帧通道：主进程把帧写入共享内存，frame-data 只携带 { name, sequence, byteLength }，
+// 这里按序号读出后再交给页面。加载原生模块失败时（例如窗口启用了 sandbox）退回普通 IPC。
+let SharedFrameRing = null;
+try {
+  // eslint-disable-next-line global-require
+  ({ SharedFrameRing } = require(path.join(__dirname, 'build', 'Release', 'qhyccd_addon.node')));
+} catch (err) {
+  console.warn('共享内存帧通道不可用，改用普通 IPC:', err);
+}
+let frameRing = null;
+let frameRingName = '';
+
+/**
+ * 从共享内存读出一帧，返回 ArrayBuffer；该帧已被后续帧覆盖时返回 null
+ */
+function readSharedFrame({ name, sequence, byteLength }) {
+  if (!frameRing || frameRingName !== name) {
+    if (frameRing) {
+      frameRing.close();
+    }
+    frameRing = null;
+    frameRing = new SharedFrameRing({ name });
+    frameRingName = name;
+  }
+  return frameRing.read(sequence, byteLength);
+}
+
+ipcRenderer.send('frame-transport', { shared: Boolean(SharedFrameRing) });
 
 contextBridge.exposeInMainWorld('qhy', {
   /**
@@ -8,12 +38,180 @@ contextBridge.exposeInMainWorld('qhy', {
   captureSingleFrame(options) {
     ipcRenderer.send('capture-single-frame', options);
   },
+  /**
+   * 开始实时预览（连续模式），帧数据同样通过 onFrameData 回调送达（payload.live 为 true）
+   * @param {Object} options 同 captureSingleFrame
+   */
+  startLive(options) {
+    ipcRenderer.send('start-live', options);
+  },
+  /**
+   * 停止实时预览
+   */
+  stopLive() {
+    ipcRenderer.send('stop-live');
+  },
+  /**
+   * 实时预览期间更新曝光 / 增益 / 偏置
+   * @param {Object} options { exposureUs?, gain?, offset? }
+   */
+  configure(options) {
+    ipcRenderer.send('configure-camera', options);
+  },
+  /**
+   * 开始录制（FITS 弹出目录选择对话框，SER 弹出文件保存对话框），之后拍到的每一帧都在原生后台线程中保存
+   * @param {'fits'|'ser'} [format] 默认 'fits'
+   * @returns {Promise<string|null>} 保存位置，取消时为 null
+   */
+  startRecording(format = 'fits') {
+    return ipcRenderer.invoke('start-recording', { format });
+  },
+  /**
+   * 停止录制，已入队的帧继续在后台写完（SER 随后写入时间戳并完成文件）
+   * @returns {Promise<{ format:'fits'|'ser', recording:boolean, queued:number, maxQueue:number, written:number, failed?:number, waits?:number, dropped?:number, fps?:number, bytesWritten:number, bytesPerSec:number, lastPath:string, lastError:string } | null>}
+   */
+  stopRecording() {
+    return ipcRenderer.invoke('stop-recording');
+  },
+  /**
+   * 连续拍摄 count 帧并在原生侧合成校正主帧（bias / dark 取中位数，flat 做 sigma 截断均值），主帧保存在主进程中
+   * @param {Object} options { kind:'bias'|'dark'|'flat', count, options: 拍摄参数（同 captureSingleFrame） }
+   * @returns {Promise<{ kind:string, width:number, height:number, frames:number }>}
+   */
+  buildMaster(options) {
+    return ipcRenderer.invoke('build-master', options);
+  },
+  /**
+   * 启用 / 关闭取帧时的暗场 / 平场校正（使用已合成的主帧）
+   * @param {Object} options { enabled, pedestal? }
+   * @returns {Promise<{ width:number, height:number, dark:boolean, flat:boolean, pedestal:number, flatMedian:number } | null>}
+   */
+  setCalibration(options) {
+    return ipcRenderer.invoke('set-calibration', options);
+  },
+  /**
+   * 启用 / 关闭实时叠加：之后每帧先与参考帧配准再叠加，frame-data 中的图像即为叠加结果
+   * @param {Object} options { enabled, method:'mean'|'sigma', sigma?, window?: 滑动窗口帧数，0 表示累计全部帧 }
+   * @returns {Promise<{ method:string, width:number, height:number, frames:number, rejectedFrames:number, referenceStars:number } | null>}
+   */
+  setStacking(options) {
+    return ipcRenderer.invoke('set-stacking', options);
+  },
+  /**
+   * 丢弃当前叠加结果，下一帧成为新的参考帧
+   * @returns {Promise<Object | null>} 同 setStacking
+   */
+  resetStacking() {
+    return ipcRenderer.invoke('reset-stacking');
+  },
+  /**
+   * 切换子帧 ROI 与硬件 bin，不重新初始化相机（Live 中也可切换）
+   * @param {Object} options { rect?: 最近一帧上的矩形 { x, y, width, height }（整帧像素坐标），省略时为整个传感器; bin?: 1 ~ 4 }
+   * @returns {Promise<{ x:number, y:number, width:number, height:number, bin:number }>} 实际使用的 ROI（bin 后的像素）
+   */
+  setRoi(options) {
+    return ipcRenderer.invoke('set-roi', options);
+  },
+  /**
+   * 启用 / 关闭每帧的星点检测：之后 frame-data 的 stars 为
+   * { count, saturated, medianHfr, medianFwhm, medianEccentricity, background, noise, stride, data: Float32Array }，
+   * data 中每颗星 stride 个值：x, y, flux, hfr, fwhm, eccentricity（原图像素坐标，像素中心为整数）
+   * @param {Object} options { enabled, threshold?: 背景噪声的倍数, maxStars? }
+   * @returns {Promise<boolean>}
+   */
+  setStarDetection(options) {
+    return ipcRenderer.invoke('set-star-detection', options);
+  },
+  /**
+   * 设置需要统计像素的测量图形，之后 frame-data 的 regions 为各图形内的
+   * [{ id, count, sum, mean, median, stddev, min, max, snr }]（snr 为 mean / stddev）
+   * @param {Array<{ id:string, type:'point'|'rect'|'circle'|'ellipse'|'polygon', points:Array<{x:number, y:number}> }>} shapes
+   *   整帧像素坐标，空数组表示不再统计
+   * @returns {Promise<Array<Object>>} 最近一帧的统计结果（还没有图像时为空数组）
+   */
+  setRegions(shapes) {
+    return ipcRenderer.invoke('set-regions', shapes);
+  },
+  /**
+   * 取得最近一帧沿线段 / 折线的强度剖面
+   * @param {Object} options { points: 至少 2 个 { x, y }（整帧像素坐标）, lineWidth?: 法线方向取平均的像素数,
+   *   interpolation?: 'bilinear' | 'bicubic' }
+   * @returns {Promise<{ length:number, spacing:number, lineWidth:number, values:Float32Array, vertices:Float32Array } | null>}
+   *   values 的第 i 个值距起点 i * spacing 像素（在图像外为 NaN）；vertices 为各顶点距起点的长度；没有图像时为 null
+   */
+  getProfile(options) {
+    return ipcRenderer.invoke('get-profile', options);
+  },
+  /**
+   * 设置预览图的最大尺寸（图像在屏幕上的显示尺寸），之后的帧只发送缩小后的预览图；0 表示发送整帧
+   * @param {Object} size { width, height }
+   */
+  setPreviewSize(size) {
+    ipcRenderer.send('set-preview-size', size);
+  },
+  /**
+   * 在主进程中按黑/白电平把最近一帧拉伸为 RGBA（原生 SIMD 实现）
+   * @param {Object} options { seq, black, white, maxWidth?, maxHeight?, format? }，seq 为 onFrameData 收到的帧序号；
+   *   给出 maxWidth / maxHeight 时按该尺寸从整帧重新生成显示图像；format 为 'raw' 时不拉伸，返回 16bit 原始数据
+   * @returns {Promise<{ seq:number, width:number, height:number, scale:number, buffer:ArrayBuffer } | null>} 帧已过期时为 null
+   */
+  renderLevels(options) {
+    return ipcRenderer.invoke('render-levels', options);
+  },
+  /**
+   * 请求最近一帧图块金字塔中的若干图块（按黑/白电平拉伸为 RGBA）
+   * @param {Object} options { seq, black, white, format?, tiles: [{ level, x, y }] }，format 为 'raw' 时返回 16bit 原始数据
+   * @returns {Promise<Array<{ level:number, x:number, y:number, width:number, height:number, buffer:ArrayBuffer }> | null>}
+   */
+  getTiles(options) {
+    return ipcRenderer.invoke('get-tiles', options);
+  },
+  /**
+   * 上报渲染进程中的阶段计时
+   * @param {Array<{ name:string, frameId:number, start:number, end:number }>} events 时间为毫秒（performance.timeOrigin + performance.now()）
+   */
+  reportTimings(events) {
+    ipcRenderer.send('trace-events', events);
+  },
+  /**
+   * 取得各阶段计时（原生、主进程与渲染进程），用于自动化回归检查
+   * @param {Object} [options] { frameId?, clear? }
+   * @returns {Promise<Array<{ name:string, frameId:number, thread:number, start:number, duration:number }>>} 时间单位为微秒
+   */
+  getTimings(options) {
+    return ipcRenderer.invoke('get-timings', options);
+  },
+  /**
+   * 把计时导出为 Chrome trace-event JSON 文件（弹出保存对话框）
+   * @returns {Promise<string|null>} 保存的路径，取消时为 null
+   */
+  exportTrace() {
+    return ipcRenderer.invoke('export-trace');
+  },
   /**
    * 接收单帧图像数据（ArrayBuffer）
-   * @param {(payload: { width:number, height:number, bpp:number, channels:number, buffer:ArrayBuffer }) => void} cb
+   * @param {(payload: { width:number, height:number, bpp:number, channels:number, buffer:ArrayBuffer, previewWidth:number, previewHeight:number, previewScale:number, pyramid:{ tileSize:number, levels:Array<{ width:number, height:number, scale:number, columns:number, rows:number }> } | null, stats:{ count:number, min:number, max:number, mean:number, median:number, stddev:number, histogram:Uint32Array }, seq:number, frameId:number, postedAt:number, recording:{ format:'fits'|'ser', recording:boolean, queued:number, maxQueue:number, written:number, failed?:number, dropped?:number, fps?:number, bytesPerSec:number, lastError:string } | null, live?:boolean, frameIndex?:number, fps?:number }) => void} cb
    */
   onFrameData(cb) {
-    ipcRenderer.on('frame-data', (_event, payload) => {
+    ipcRenderer.on('frame-data', (event, payload) => {
+      if (payload.shared) {
+        let buffer = null;
+        try {
+          buffer = readSharedFrame(payload.shared);
+        } catch (err) {
+          // 映射失败：之后的帧改用普通 IPC，这一帧按拍摄失败处理
+          SharedFrameRing = null;
+          ipcRenderer.send('frame-transport', { shared: false });
+          ipcRenderer.emit('frame-error', event, `共享内存帧读取失败: ${err.message || err}`);
+          return;
+        }
+        if (!buffer) {
+          // 页面处理太慢，该帧已被之后的帧覆盖（只会发生在 Live 中），直接跳过
+          return;
+        }
+        cb({ ...payload, buffer });
+        return;
+      }
       cb(payload);
     });
   },
@@ -1,10 +1,29 @@
 document.addEventListener('DOMContentLoaded', async () => {
   const btn = document.getElementById('captureBtn');
+  const liveBtn = document.getElementById('liveBtn');
+  const recordBtn = document.getElementById('recordBtn');
+  const recordFormatSelect = document.getElementById('recordFormatSelect');
+  const traceExportBtn = document.getElementById('traceExportBtn');
   const statusEl = document.getElementById('status');
   const resultEl = document.getElementById('result');
   const expInput = document.getElementById('expMs');
   const gainSlider = document.getElementById('gainSlider');
   const offsetSlider = document.getElementById('offsetSlider');
+  const softwareBinSelect = document.getElementById('softwareBinSelect');
+  const hardwareBinSelect = document.getElementById('hardwareBinSelect');
+  const roiFromRectBtn = document.getElementById('roiFromRectBtn');
+  const roiFullBtn = document.getElementById('roiFullBtn');
+  const softwareBinModeSelect = document.getElementById('softwareBinModeSelect');
+  const masterKindSelect = document.getElementById('masterKindSelect');
+  const masterCountSelect = document.getElementById('masterCountSelect');
+  const buildMasterBtn = document.getElementById('buildMasterBtn');
+  const calibrationToggle = document.getElementById('calibrationToggle');
+  const calibrationLabel = document.getElementById('calibrationLabel');
+  const stackingToggle = document.getElementById('stackingToggle');
+  const stackMethodSelect = document.getElementById('stackMethodSelect');
+  const stackWindowSelect = document.getElementById('stackWindowSelect');
+  const stackResetBtn = document.getElementById('stackResetBtn');
+  const starDetectionToggle = document.getElementById('starDetectionToggle');
   const gainValueEl = document.getElementById('gainValue');
   const offsetValueEl = document.getElementById('offsetValue');
   const exposureValueEl = document.getElementById('exposureValue');
@@ -141,6 +160,32 @@ document.addEventListener('DOMContentLoaded', async () => {
   measurementLayer.sortableChildren = true;
   measurementLayer.visible = true;
 
+  // 星点标记：原生侧每帧检测的星点（frame-data 的 stars）画成以 HFR 为尺度的圆，位于测量图元之下
+  const starGraphics = new PIXI.Graphics();
+  starGraphics.eventMode = 'none';
+  starGraphics.zIndex = -1;
+  measurementLayer.addChild(starGraphics);
+
+  // GPU 电平拉伸：16bit 数据只上传一次，拖动电平滑块只更新着色器 uniform；不支持时由主进程原生拉伸为 RGBA
+  let gpuLevels = null;
+  try {
+    if (GpuLevels.isSupported(app.renderer)) {
+      gpuLevels = new GpuLevels();
+    }
+  } catch (e) {
+    console.error('GPU 电平拉伸不可用，改用原生拉伸:', e);
+    gpuLevels = null;
+  }
+
+  // 大幅面单帧的图块视图：按可视区域与缩放只请求可见的图块，叠在预览图之上、测量图层之下
+  const tileView = new TileView({
+    requestTiles: ({ seq, tiles }) =>
+      window.qhy.getTiles({ seq, tiles, black: blackLevel, white: whiteLevel, format: gpuLevels ? 'raw' : 'rgba' }),
+    getScaleMode: () => (useInterpolation ? 'linear' : 'nearest'),
+    gpuLevels,
+  });
+  imageLayer.addChildAt(tileView.container, 0);
+
   let imageSprite = null;             // 当前显示的图像精灵
   
   // 直方图相关元素
@@ -149,6 +194,16 @@ document.addEventListener('DOMContentLoaded', async () => {
   const histMinEl = document.getElementById('histMin');
   const histMaxEl = document.getElementById('histMax');
   const histMeanEl = document.getElementById('histMean');
+  const histMedianEl = document.getElementById('histMedian');
+  const histStddevEl = document.getElementById('histStddev');
+  // 强度剖面相关元素
+  const profileCanvas = document.getElementById('profileCanvas');
+  const profileCtx = profileCanvas ? profileCanvas.getContext('2d') : null;
+  const profileWidthSelect = document.getElementById('profileWidthSelect');
+  const profileInterpolationSelect = document.getElementById('profileInterpolationSelect');
+  const profileLengthEl = document.getElementById('profileLength');
+  const profileMinEl = document.getElementById('profileMin');
+  const profileMaxEl = document.getElementById('profileMax');
   const blackLevelSlider = document.getElementById('blackLevelSlider');
   const whiteLevelSlider = document.getElementById('whiteLevelSlider');
   const blackLevelValueEl = document.getElementById('blackLevelValue');
@@ -173,6 +228,23 @@ document.addEventListener('DOMContentLoaded', async () => {
   let lastPixels16 = null;
   let lastWidth = 0;
   let lastHeight = 0;
+  // lastPixels16 的通道数：1 为灰度，3 为彩色相机去马赛克后的交错 RGB
+  let lastChannels = 1;
+  // 显示图像（预览图）1 像素对应的原图像素数，以及原图尺寸
+  let lastDisplayScale = 1;
+  let lastFrameWidth = 0;
+  let lastFrameHeight = 0;
+  // 最近一次发给主进程的预览图尺寸
+  let sentPreviewSize = null;
+  // 最近一帧的统计信息（原生侧计算），以及折合成 256 个区间的直方图
+  let lastStats = null;
+  let lastHistogramBins = null;
+  // 最近一帧在主进程中的序号，用于原生拉伸请求
+  let lastFrameSeq = null;
+  // 当前图像纹理的底层资源是否专属于该精灵
+  let imageSpriteOwnsSource = false;
+  // 当前图像是否为 GPU 电平拉伸的网格（gpuLevels.createImage 创建）
+  let imageIsGpu = false;
   // 黑电平 / 白电平（单位：16bit 强度值 0-65535）
   let blackLevel = 0;
   let whiteLevel = 65535;
@@ -205,6 +277,21 @@ document.addEventListener('DOMContentLoaded', async () => {
     if (!imageLayer) return;
     imageLayer.position.set(offsetX, offsetY);
     imageLayer.scale.set(currentZoom);
+    updateTiles();
+  }
+
+  /**
+   * 按当前可视区域（原图像素坐标）与缩放更新图块视图
+   */
+  function updateTiles() {
+    if (!tileView.isActive() || !app) return;
+    tileView.update({
+      x: -offsetX / currentZoom,
+      y: -offsetY / currentZoom,
+      width: app.screen.width / currentZoom,
+      height: app.screen.height / currentZoom,
+      pixelsPerImagePixel: currentZoom * (window.devicePixelRatio || 1),
+    });
   }
 
   /**
@@ -232,6 +319,7 @@ document.addEventListener('DOMContentLoaded', async () => {
       currentZoomIndex++;
       currentZoom = zoomLevels[currentZoomIndex];
       applyZoom();
+      onZoomChanged();
     }
   }
 
@@ -243,6 +331,7 @@ document.addEventListener('DOMContentLoaded', async () => {
       currentZoomIndex--;
       currentZoom = zoomLevels[currentZoomIndex];
       applyZoom();
+      onZoomChanged();
     }
   }
 
@@ -253,6 +342,7 @@ document.addEventListener('DOMContentLoaded', async () => {
     currentZoomIndex = zoomLevels.indexOf(1.0);
     currentZoom = 1.0;
     applyZoom();
+    onZoomChanged();
   }
 
   // 绑定缩放按钮事件
@@ -266,6 +356,10 @@ document.addEventListener('DOMContentLoaded', async () => {
       // value: 'on' => 插值缩放；'off' => 不插值缩放
       useInterpolation = interpolationSelect.value === 'on';
       applyInterpolationMode();
+      tileView.applyScaleMode();
+      if (gpuLevels) {
+        gpuLevels.setInterpolation(useInterpolation);
+      }
     });
   }
 
@@ -298,8 +392,60 @@ document.addEventListener('DOMContentLoaded', async () => {
     },
     getCurrentZoom: () => currentZoom,
     imageSprite: null, // 将在 imageSprite 更新时同步
+    onRegionsChanged: (shapes) => updateRegions(shapes),
+    onProfileChanged: (path) => updateProfile(path),
   });
 
+  // 区域统计：图形变化时交给原生侧（只重新光栅化变化了的图形），同一时间只有一个请求在途，
+  // 拖动控制点期间的多次变化合并为最新的一次
+  let pendingRegionShapes = null;
+  let regionRequestActive = false;
+  async function updateRegions(shapes) {
+    pendingRegionShapes = shapes;
+    if (regionRequestActive) return;
+    regionRequestActive = true;
+    while (pendingRegionShapes) {
+      const next = pendingRegionShapes;
+      pendingRegionShapes = null;
+      try {
+        measurementManager.setRegionStats(await window.qhy.setRegions(next));
+      } catch (e) {
+        statusEl.textContent = `区域统计失败: ${e?.message || e}`;
+      }
+    }
+    regionRequestActive = false;
+  }
+
+  // 强度剖面：路径变化（拖动控制点）、新帧到达或选项变化时在主进程中重新取样，
+  // 同一时间只有一个请求在途，期间的变化合并为最新的一次
+  let profilePath = null;
+  let profileDirty = false;
+  let profileRequestActive = false;
+  async function updateProfile(path = profilePath) {
+    profilePath = path;
+    profileDirty = true;
+    if (profileRequestActive) return;
+    profileRequestActive = true;
+    while (profileDirty) {
+      profileDirty = false;
+      if (!profilePath) {
+        drawProfile(null);
+        continue;
+      }
+      try {
+        const profile = await window.qhy.getProfile({
+          points: profilePath.points,
+          lineWidth: profileWidthSelect ? Number(profileWidthSelect.value) || 1 : 1,
+          interpolation: profileInterpolationSelect ? profileInterpolationSelect.value : 'bilinear',
+        });
+        drawProfile(profile);
+      } catch (e) {
+        statusEl.textContent = `剖面取样失败: ${e?.message || e}`;
+      }
+    }
+    profileRequestActive = false;
+  }
+
   // 初始化
   updateZoomDisplay();
   // 初始化黑白电平数值显示（使用默认 0 / 65535）
@@ -434,12 +580,27 @@ document.addEventListener('DOMContentLoaded', async () => {
   }
 
   /**
-   * 绘制直方图
-   * @param {Uint16Array} pixels16 16bit 像素数据
+   * 把 65536 级直方图合并为 bins 个区间（每区间 65536 / bins 个灰度级）
+   * @param {Uint32Array} histogram
+   * @param {number} bins
+   * @returns {Uint32Array}
+   */
+  function foldHistogram(histogram, bins) {
+    const folded = new Uint32Array(bins);
+    const shift = Math.log2(histogram.length / bins);
+    for (let v = 0; v < histogram.length; v++) {
+      folded[v >> shift] += histogram[v];
+    }
+    return folded;
+  }
+
+  /**
+   * 绘制直方图。统计量与直方图由原生侧在取帧时算好，这里只负责绘制，不再扫描像素。
+   * @param {{ min:number, max:number, mean:number, median:number, stddev:number, histogram:Uint32Array }} stats
    * @param {boolean} autoAdjustLevels 是否根据当前帧自动设置黑/白电平为 min/max
    */
-  function drawHistogram(pixels16, autoAdjustLevels = false) {
-    if (!histCtx || !histogramCanvas || !pixels16 || pixels16.length === 0) return;
+  function drawHistogram(stats, autoAdjustLevels = false) {
+    if (!histCtx || !histogramCanvas || !stats || !stats.histogram) return;
 
     // 设置 canvas 大小
     const width = histogramCanvas.clientWidth;
@@ -448,30 +609,21 @@ document.addEventListener('DOMContentLoaded', async () => {
     histogramCanvas.width = width;
     histogramCanvas.height = height;
 
-    // 计算直方图（分成256个区间）
+    // 直方图分成 256 个区间显示，同一帧只合并一次
     const bins = 256;
-    const histogram = new Array(bins).fill(0);
-    let min = 0xffff;
-    let max = 0;
-    let sum = 0;
-
-    for (let i = 0; i < pixels16.length; i++) {
-      const val = pixels16[i];
-      if (val < min) min = val;
-      if (val > max) max = val;
-      sum += val;
-
-      // 将 16bit 值映射到 256 个区间
-      const binIndex = Math.floor((val / 65535) * (bins - 1));
-      histogram[binIndex]++;
+    if (stats !== lastStats || !lastHistogramBins) {
+      lastStats = stats;
+      lastHistogramBins = foldHistogram(stats.histogram, bins);
     }
-
-    const mean = Math.round(sum / pixels16.length);
+    const histogram = lastHistogramBins;
+    const { min, max } = stats;
 
     // 更新统计信息
     if (histMinEl) histMinEl.textContent = `Min: ${min}`;
     if (histMaxEl) histMaxEl.textContent = `Max: ${max}`;
-    if (histMeanEl) histMeanEl.textContent = `Mean: ${mean}`;
+    if (histMeanEl) histMeanEl.textContent = `Mean: ${Math.round(stats.mean)}`;
+    if (histMedianEl) histMedianEl.textContent = `Median: ${stats.median}`;
+    if (histStddevEl) histStddevEl.textContent = `StdDev: ${stats.stddev.toFixed(1)}`;
 
     // 当需要自动设置时，将黑白电平初始化为当前帧的 min/max
     if (autoAdjustLevels) {
@@ -481,7 +633,10 @@ document.addEventListener('DOMContentLoaded', async () => {
     }
 
     // 找到最大频率用于归一化
-    const maxCount = Math.max(...histogram);
+    let maxCount = 0;
+    for (let i = 0; i < bins; i++) {
+      if (histogram[i] > maxCount) maxCount = histogram[i];
+    }
     if (maxCount === 0) return;
 
     // 清空画布
@@ -534,16 +689,90 @@ document.addEventListener('DOMContentLoaded', async () => {
   }
 
   /**
-   * 使用当前黑/白电平，将 16bit 单通道灰度数据拉伸到 8bit，并绘制到 canvas 上
+   * 绘制强度剖面曲线：横轴为距起点的路径长度，纵轴按曲线的最小 / 最大值缩放，
+   * 虚线标出折线的顶点，图像外的采样点（NaN）断开曲线
+   * @param {Object|null} profile getProfile 的结果，为 null 时清空
+   */
+  function drawProfile(profile) {
+    if (!profileCtx) return;
+    const width = profileCanvas.clientWidth;
+    const height = profileCanvas.clientHeight;
+    if (width === 0 || height === 0) return;
+    profileCanvas.width = width;
+    profileCanvas.height = height;
+    profileCtx.fillStyle = '#0d1117';
+    profileCtx.fillRect(0, 0, width, height);
+
+    const values = profile ? profile.values : null;
+    let min = Infinity;
+    let max = -Infinity;
+    if (values) {
+      for (let i = 0; i < values.length; i += 1) {
+        const v = values[i];
+        if (v < min) min = v;
+        if (v > max) max = v;
+      }
+    }
+    if (!values || values.length < 2 || !(max >= min)) {
+      if (profileLengthEl) profileLengthEl.textContent = 'Length: -';
+      if (profileMinEl) profileMinEl.textContent = 'Min: -';
+      if (profileMaxEl) profileMaxEl.textContent = 'Max: -';
+      return;
+    }
+    if (profileLengthEl) profileLengthEl.textContent = `Length: ${profile.length.toFixed(1)} px`;
+    if (profileMinEl) profileMinEl.textContent = `Min: ${min.toFixed(1)}`;
+    if (profileMaxEl) profileMaxEl.textContent = `Max: ${max.toFixed(1)}`;
+
+    const pad = 4;
+    const xScale = (width - 1) / profile.length;
+    const yScale = (height - 2 * pad) / Math.max(max - min, 1);
+
+    profileCtx.strokeStyle = '#30363d';
+    profileCtx.lineWidth = 1;
+    profileCtx.setLineDash([3, 3]);
+    profileCtx.beginPath();
+    for (let i = 1; i < profile.vertices.length - 1; i += 1) {
+      const x = Math.round(profile.vertices[i] * xScale) + 0.5;
+      profileCtx.moveTo(x, 0);
+      profileCtx.lineTo(x, height);
+    }
+    profileCtx.stroke();
+    profileCtx.setLineDash([]);
+
+    profileCtx.strokeStyle = '#58a6ff';
+    profileCtx.beginPath();
+    let drawing = false;
+    for (let i = 0; i < values.length; i += 1) {
+      const v = values[i];
+      if (Number.isNaN(v)) {
+        drawing = false;
+        continue;
+      }
+      const x = i * profile.spacing * xScale;
+      const y = height - pad - (v - min) * yScale;
+      if (drawing) {
+        profileCtx.lineTo(x, y);
+      } else {
+        profileCtx.moveTo(x, y);
+        drawing = true;
+      }
+    }
+    profileCtx.stroke();
+  }
+
+  /**
+   * 使用当前黑/白电平，将 16bit 灰度（或交错 RGB）数据拉伸到 8bit 并显示（JS 实现，
+   * 在原生拉伸不可用时使用）
    * @param {Uint16Array} pixels16 16bit 像素数据
    * @param {number} width
    * @param {number} height
+   * @param {number} channels 1 或 3
    */
-  function renderFrameFromPixels(pixels16, width, height) {
+  function renderFrameFromPixels(pixels16, width, height, channels = 1) {
     if (!pixels16) return;
     const count = width * height;
-    if (pixels16.length < count) {
-      console.warn('像素数据长度不足：', pixels16.length, '预期：', count);
+    if (pixels16.length < count * channels) {
+      console.warn('像素数据长度不足：', pixels16.length, '预期：', count * channels);
       return;
     }
 
@@ -556,44 +785,127 @@ document.addEventListener('DOMContentLoaded', async () => {
     }
     const range = maxLevel - minLevel;
 
-    const rgba = new Uint8Array(count * 4);
-    for (let i = 0; i < count; i += 1) {
-      let v16 = pixels16[i];
+    const stretch = (v16) => {
       if (v16 <= minLevel) {
         v16 = minLevel;
       } else if (v16 >= maxLevel) {
         v16 = maxLevel;
       }
       const norm = (v16 - minLevel) / range;
-      const v8 = Math.max(0, Math.min(255, Math.round(norm * 255)));
+      return Math.max(0, Math.min(255, Math.round(norm * 255)));
+    };
 
+    const rgba = new Uint8Array(count * 4);
+    for (let i = 0; i < count; i += 1) {
       const idx = i * 4;
-      rgba[idx] = v8;       // R
-      rgba[idx + 1] = v8;   // G
-      rgba[idx + 2] = v8;   // B
+      if (channels === 3) {
+        rgba[idx] = stretch(pixels16[i * 3]);         // R
+        rgba[idx + 1] = stretch(pixels16[i * 3 + 1]); // G
+        rgba[idx + 2] = stretch(pixels16[i * 3 + 2]); // B
+      } else {
+        const v8 = stretch(pixels16[i]);
+        rgba[idx] = v8;       // R
+        rgba[idx + 1] = v8;   // G
+        rgba[idx + 2] = v8;   // B
+      }
       rgba[idx + 3] = 255;  // A
     }
 
-    // 将 RGBA 数据绘制到离屏 canvas，再交给 Pixi 生成纹理
-    offscreenCanvas.width = width;
-    offscreenCanvas.height = height;
-    const clamped = new Uint8ClampedArray(rgba);
-    const imageData = new ImageData(clamped, width, height);
-    offscreenCtx.putImageData(imageData, 0, 0);
+    showRgbaImage(rgba, width, height, lastDisplayScale);
+  }
 
-    const texture = PIXI.Texture.from(offscreenCanvas);
+  /**
+   * 把 8bit RGBA 像素显示到图像精灵上。
+   * 直接作为缓冲区纹理上传到 GPU；尺寸不变时复用已有纹理，只更新数据。
+   * 预览图按 scale 放大显示，使 imageLayer 中的坐标始终是原图像素坐标（测量工具依赖这一点）。
+   * @param {Uint8Array} rgba
+   * @param {number} width
+   * @param {number} height
+   * @param {number} scale 图像 1 像素对应的原图像素数
+   */
+  function showRgbaImage(rgba, width, height, scale = 1) {
+    if (!PIXI.BufferImageSource) {
+      // 兼容性保护：旧版 Pixi 没有缓冲区纹理，经离屏 canvas 生成纹理
+      offscreenCanvas.width = width;
+      offscreenCanvas.height = height;
+      const imageData = new ImageData(new Uint8ClampedArray(rgba.buffer, rgba.byteOffset, rgba.byteLength), width, height);
+      offscreenCtx.putImageData(imageData, 0, 0);
+      setImageTexture(PIXI.Texture.from(offscreenCanvas), false);
+      imageSprite.scale.set(scale);
+      return;
+    }
+
+    const source = imageSprite && !imageIsGpu && imageSprite.texture && imageSprite.texture.source;
+    if (source instanceof PIXI.BufferImageSource && source.width === width && source.height === height) {
+      source.resource = rgba;
+      source.update();
+      imageSprite.scale.set(scale);
+      return;
+    }
+
+    const texture = new PIXI.Texture({
+      source: new PIXI.BufferImageSource({
+        resource: rgba,
+        width,
+        height,
+        format: 'rgba8unorm',
+        scaleMode: useInterpolation ? 'linear' : 'nearest',
+      }),
+    });
+    setImageTexture(texture, true);
+    imageSprite.scale.set(scale);
+  }
+
+  /**
+   * 把 16bit 像素上传为 GPU 电平拉伸的图像，尺寸不变时只更新纹理数据。
+   * @param {Uint16Array} pixels16
+   * @param {number} width
+   * @param {number} height
+   * @param {number} scale 图像 1 像素对应的原图像素数
+   * @param {number} channels 1 为灰度，3 为交错 RGB
+   */
+  function showRawImage(pixels16, width, height, scale = 1, channels = 1) {
+    gpuLevels.setLevels(blackLevel, whiteLevel);
+    if (!imageIsGpu || !gpuLevels.updateImage(imageSprite, pixels16, width, height, channels)) {
+      setImageObject(gpuLevels.createImage(pixels16, width, height, channels), true);
+    }
+    imageSprite.scale.set(scale);
+  }
+
+  /**
+   * 用新纹理替换图像精灵
+   * @param {PIXI.Texture} texture
+   * @param {boolean} ownsSource 纹理的底层资源是否专属于该精灵（替换时一并销毁）
+   */
+  function setImageTexture(texture, ownsSource) {
     const scaleMode = getScaleMode();
     if (scaleMode && texture.baseTexture) {
       texture.baseTexture.scaleMode = scaleMode;
     }
 
+    setImageObject(new PIXI.Sprite(texture), false);
+    imageSpriteOwnsSource = ownsSource;
+  }
+
+  /**
+   * 用新的显示对象（纹理精灵或 GPU 电平拉伸网格）替换当前图像
+   * @param {PIXI.Container} object
+   * @param {boolean} isGpu 是否由 gpuLevels.createImage 创建
+   */
+  function setImageObject(object, isGpu) {
     if (imageSprite) {
-      // 释放上一帧的纹理资源（不销毁底层 BaseTexture，以避免影响新纹理）
-      imageSprite.texture.destroy(false);
       imageLayer.removeChild(imageSprite);
+      if (imageIsGpu) {
+        gpuLevels.destroyImage(imageSprite);
+      } else {
+        // 释放上一帧的纹理资源（canvas 纹理不销毁底层 BaseTexture，以避免影响新纹理）
+        imageSprite.texture.destroy(imageSpriteOwnsSource);
+      }
     }
 
-    imageSprite = new PIXI.Sprite(texture);
+    imageSprite = object;
+    imageIsGpu = isGpu;
+    imageSpriteOwnsSource = false;
     imageSprite.interactive = false;
     // 始终将图像精灵放在 imageLayer 最底层，确保 measurementLayer 及其图元渲染在其上方
     imageLayer.addChildAt(imageSprite, 0);
@@ -609,48 +921,275 @@ document.addEventListener('DOMContentLoaded', async () => {
     applyZoom();
   }
 
+  // 原生拉伸：主进程保留最近一帧（lastFrameSeq），按电平拉伸后返回 RGBA；
+  // GPU 电平拉伸时只在缩放变化后请求新尺寸的 16bit 显示图像。
+  // 同一时间只有一个请求在途，期间的变化合并为一次后续请求。
+  let nativeStretchAvailable = typeof window.qhy.renderLevels === 'function';
+  let nativeStretchBusy = false;
+  let nativeStretchPending = false;
+
+  async function requestNativeStretch() {
+    if (nativeStretchBusy) {
+      nativeStretchPending = true;
+      return;
+    }
+    nativeStretchBusy = true;
+    try {
+      do {
+        nativeStretchPending = false;
+        const seq = lastFrameSeq;
+        const size = displayPreviewSize();
+        const raw = imageIsGpu;
+        const result = await window.qhy.renderLevels({
+          seq,
+          black: blackLevel,
+          white: whiteLevel,
+          maxWidth: size.width,
+          maxHeight: size.height,
+          format: raw ? 'raw' : 'rgba',
+        });
+        if (seq !== lastFrameSeq) {
+          // 等待期间已收到新帧，新帧会再发起请求
+          continue;
+        }
+        if (result && raw) {
+          lastPixels16 = new Uint16Array(result.buffer);
+          lastWidth = result.width;
+          lastHeight = result.height;
+          lastChannels = result.channels || 1;
+          lastDisplayScale = result.scale || 1;
+          showRawImage(lastPixels16, lastWidth, lastHeight, lastDisplayScale, lastChannels);
+        } else if (result) {
+          showRgbaImage(new Uint8Array(result.buffer), result.width, result.height, result.scale || 1);
+        } else if (lastPixels16) {
+          // 主进程中已没有这一帧，退回 JS 实现
+          renderFrameFromPixels(lastPixels16, lastWidth, lastHeight, lastChannels);
+        }
+      } while (nativeStretchPending);
+    } catch (e) {
+      console.error('原生拉伸失败，改用 JS 实现:', e);
+      nativeStretchAvailable = false;
+      if (lastPixels16) {
+        renderFrameFromPixels(lastPixels16, lastWidth, lastHeight, lastChannels);
+      }
+    } finally {
+      nativeStretchBusy = false;
+    }
+  }
+
+  /**
+   * 图像在屏幕上的显示尺寸（物理像素），作为预览图的最大尺寸；还没有收到帧时为 0（发送整帧）
+   */
+  function displayPreviewSize() {
+    if (lastFrameWidth <= 0 || lastFrameHeight <= 0) {
+      return { width: 0, height: 0 };
+    }
+    const dpr = window.devicePixelRatio || 1;
+    const scale = currentZoom * dpr;
+    if (tileView.isActive()) {
+      // 细节由图块提供，底图不超过视口即可，缩放时也不必重新生成
+      return {
+        width: Math.ceil(Math.min(lastFrameWidth * scale, app.screen.width * dpr)),
+        height: Math.ceil(Math.min(lastFrameHeight * scale, app.screen.height * dpr)),
+      };
+    }
+    return {
+      width: Math.ceil(lastFrameWidth * scale),
+      height: Math.ceil(lastFrameHeight * scale),
+    };
+  }
+
+  /**
+   * 显示尺寸变化时通知主进程，之后的帧按新尺寸生成预览图
+   */
+  function sendPreviewSize() {
+    const size = displayPreviewSize();
+    if (sentPreviewSize && sentPreviewSize.width === size.width && sentPreviewSize.height === size.height) {
+      return;
+    }
+    sentPreviewSize = size;
+    window.qhy.setPreviewSize(size);
+  }
+
+  /**
+   * 缩放变化后更新预览图尺寸，并按新的显示尺寸重新生成当前帧的显示图像
+   */
+  function onZoomChanged() {
+    if (lastFrameWidth <= 0) return;
+    sendPreviewSize();
+    if (nativeStretchAvailable && lastFrameSeq !== null && !tileView.isActive()) {
+      requestNativeStretch();
+    }
+  }
+
+  /**
+   * 按当前黑/白电平显示最近一帧：优先使用主进程中的原生拉伸
+   */
+  function renderCurrentFrame() {
+    if (!lastPixels16) return;
+    if (imageIsGpu) {
+      // 图像已在 GPU 上，只需更新电平 uniform
+      gpuLevels.setLevels(blackLevel, whiteLevel);
+      return;
+    }
+    if (nativeStretchAvailable && lastFrameSeq !== null) {
+      requestNativeStretch();
+    } else {
+      renderFrameFromPixels(lastPixels16, lastWidth, lastHeight, lastChannels);
+    }
+  }
+
+  // 阶段计时使用的时钟（毫秒，Unix 纪元），主进程据此换算到原生计时的时钟
+  const traceClock = () => performance.timeOrigin + performance.now();
+  // 最近一次点击 Capture 的时刻，用于记录从点击到看到图像的总耗时
+  let captureClickedAt = null;
+
+  // 实时预览状态：Live 期间只在第一帧自动设置黑/白电平，之后保持用户调整
+  let liveActive = false;
+  let liveLevelsInitialized = false;
+  // 单帧拍摄进行中：从点击到收到 frame-data / frame-error 期间禁用拍摄按钮
+  let captureInFlight = false;
+
   // 监听从主进程返回的帧数据（ArrayBuffer）
-  window.qhy.onFrameData(({ width, height, bpp, channels, buffer }) => {
-    statusEl.textContent = '拍摄成功，已收到图像数据';
+  window.qhy.onFrameData(({
+    width,
+    height,
+    bpp,
+    channels,
+    buffer,
+    previewWidth,
+    previewHeight,
+    previewScale,
+    previewChannels,
+    bayer,
+    pyramid,
+    stats,
+    seq,
+    frameId,
+    postedAt,
+    live,
+    frameIndex,
+    fps,
+    recording,
+    stack,
+    stars,
+    regions,
+    calibration,
+  }) => {
+    if (live && !liveActive) {
+      // 停止后队列中残留的帧，直接忽略
+      return;
+    }
+    if (!live && captureInFlight) {
+      captureInFlight = false;
+      btn.disabled = liveActive;
+    }
+    updateCalibrationMismatch(calibrationToggle && calibrationToggle.checked && !calibration);
+    const receivedAt = traceClock();
+    const timings = [];
+    if (postedAt) {
+      timings.push({ name: 'ipc', frameId, start: postedAt, end: receivedAt });
+    }
+    const autoAdjustLevels = !live || !liveLevelsInitialized;
+    if (live) {
+      liveLevelsInitialized = true;
+      statusEl.textContent = `Live: 第 ${frameIndex} 帧, ${Number(fps || 0).toFixed(1)} fps`;
+    } else {
+      statusEl.textContent = '拍摄成功，已收到图像数据';
+    }
     resultEl.textContent =
-      `分辨率: ${width} x ${height}, bpp: ${bpp}, 通道数: ${channels}\n` +
-      `字节长度: ${buffer.byteLength}\n` +
-      `显示方式: 使用黑/白电平对 16bit 灰度进行线性拉伸到 8bit（可在直方图下方调整）`;
+      `分辨率: ${width} x ${height}, bpp: ${bpp}, 通道数: ${channels}` +
+      (bayer ? `, Bayer: ${bayer}` : '') +
+      '\n' +
+      `字节长度: ${buffer.byteLength}` +
+      (previewScale > 1 ? `（预览图 ${previewWidth} x ${previewHeight}，1:${previewScale}）` : '') +
+      '\n' +
+      (bayer
+        ? '显示方式: 双线性去马赛克后，使用黑/白电平对 16bit RGB 各通道线性拉伸到 8bit（可在直方图下方调整）'
+        : '显示方式: 使用黑/白电平对 16bit 灰度进行线性拉伸到 8bit（可在直方图下方调整）') +
+      (recording ? `\n${formatRecordingStats(recording)}` : '') +
+      (stack ? `\n${formatStackResult(stack)}` : '') +
+      (stars ? `\n${formatStarSummary(stars)}` : '');
+    drawStarOverlay(stars);
+    if (regions) {
+      measurementManager.setRegionStats(regions);
+    }
+    if (profilePath) {
+      updateProfile();
+    }
 
     console.log('接收到的像素缓冲区字节长度:', buffer.byteLength);
 
     // 缓存最近一帧数据，供灰度拉伸滑块实时重绘使用
     try {
+      // buffer 为预览图（没有预览图时为整帧）
       lastPixels16 = new Uint16Array(buffer);
-      lastWidth = width;
-      lastHeight = height;
+      lastWidth = previewWidth || width;
+      lastHeight = previewHeight || height;
+      lastChannels = previewChannels || 1;
+      lastDisplayScale = previewScale || 1;
+      lastFrameWidth = width;
+      lastFrameHeight = height;
+      lastFrameSeq = seq === undefined ? null : seq;
+      // 只有主进程保留着这一帧时才能按需请求图块
+      tileView.setPyramid(lastFrameSeq, lastFrameSeq !== null ? pyramid : null);
+      lastStats = stats || null;
+      lastHistogramBins = null;
     } catch (e) {
       console.error('缓存像素数据失败:', e);
       lastPixels16 = null;
       lastWidth = 0;
       lastHeight = 0;
+      lastChannels = 1;
+      lastDisplayScale = 1;
+      lastFrameSeq = null;
+      tileView.setPyramid(null, null);
     }
+    // 之后的帧按当前显示尺寸生成预览图
+    sendPreviewSize();
 
     // 先绘制直方图（即使后续 Pixi 渲染失败，统计信息也能正常显示）
+    let stageStart = traceClock();
     try {
-      if (lastPixels16) {
-        drawHistogram(lastPixels16, true);
-      }
+      drawHistogram(stats, autoAdjustLevels);
     } catch (e) {
       console.error('绘制直方图失败:', e);
     }
+    timings.push({ name: 'histogram', frameId, start: stageStart, end: traceClock() });
 
+    stageStart = traceClock();
     try {
-      if (lastPixels16) {
-        renderFrameFromPixels(lastPixels16, width, height);
+      if (gpuLevels && lastPixels16) {
+        showRawImage(lastPixels16, lastWidth, lastHeight, lastDisplayScale, lastChannels);
+      } else {
+        renderCurrentFrame();
       }
+      updateTiles();
     } catch (e) {
       console.error('渲染图像失败:', e);
       resultEl.textContent += `\n渲染图像失败: ${e?.message || e}`;
     }
+    timings.push({ name: 'display', frameId, start: stageStart, end: traceClock() });
+
+    // 纹理在下一次绘制时上传，到下一帧动画回调为止视为图像已显示
+    const clickedAt = live ? null : captureClickedAt;
+    captureClickedAt = null;
+    requestAnimationFrame(() => {
+      const shownAt = traceClock();
+      timings.push({ name: 'present', frameId, start: receivedAt, end: shownAt });
+      if (clickedAt !== null) {
+        timings.push({ name: 'capture-to-display', frameId, start: clickedAt, end: shownAt });
+      }
+      window.qhy.reportTimings(timings);
+    });
   });
 
   window.qhy.onFrameError((error) => {
+    captureInFlight = false;
+    btn.disabled = liveActive;
+    if (liveActive) {
+      setLiveActive(false);
+    }
     statusEl.textContent = '拍摄失败';
     resultEl.textContent = error || '未知错误';
   });
@@ -662,13 +1201,14 @@ document.addEventListener('DOMContentLoaded', async () => {
     if (!lastPixels16 || lastWidth <= 0 || lastHeight <= 0) return;
 
     try {
-      drawHistogram(lastPixels16, false);
+      drawHistogram(lastStats, false);
     } catch (e) {
       console.error('根据黑白电平重绘直方图失败:', e);
     }
 
     try {
-      renderFrameFromPixels(lastPixels16, lastWidth, lastHeight);
+      renderCurrentFrame();
+      tileView.invalidate();
     } catch (e) {
       console.error('根据黑白电平重绘图像失败:', e);
     }
@@ -691,24 +1231,312 @@ document.addEventListener('DOMContentLoaded', async () => {
     return us;
   }
 
-  btn.addEventListener('click', () => {
-    statusEl.textContent = '正在曝光并获取单帧图像，请稍候……';
-    resultEl.textContent = '';
-
+  /**
+   * 根据当前界面控件生成拍摄参数
+   */
+  function collectCaptureOptions() {
     const exposureUs = computeExposureUs();
     const exposureMs = exposureUs / 1000.0;
     const gain = gainSlider ? Number(gainSlider.value) || 0 : undefined;
     const offset = offsetSlider ? Number(offsetSlider.value) || 0 : undefined;
+    const softwareBin = softwareBinSelect ? Number(softwareBinSelect.value) || 1 : 1;
+    const softwareBinMode = softwareBinModeSelect ? softwareBinModeSelect.value : 'average';
 
-    window.qhy.captureSingleFrame({
+    return {
       exposureMs,
       exposureUs,
       exposureUnit: getCurrentExposureUnit(),
       rawExposure: Number(expInput.value) || 0,
-      width: 1920,
-      height: 1080,
+      // ROI 与硬件 bin 由 setRoi 设置并保存在相机会话中，这里不再指定
       gain,
       offset,
+      softwareBin,
+      softwareBinMode,
+    };
+  }
+
+  btn.addEventListener('click', () => {
+    if (captureInFlight) return;
+    captureInFlight = true;
+    btn.disabled = true;
+    statusEl.textContent = '正在曝光并获取单帧图像，请稍候……';
+    resultEl.textContent = '';
+    captureClickedAt = traceClock();
+
+    window.qhy.captureSingleFrame(collectCaptureOptions());
+  });
+
+  /**
+   * 切换实时预览
+   */
+  function setLiveActive(active) {
+    liveActive = active;
+    btn.disabled = active || captureInFlight;
+    if (liveBtn) {
+      liveBtn.textContent = active ? 'Stop Live' : 'Live';
+      liveBtn.classList.toggle('live-active', active);
+    }
+  }
+
+  if (liveBtn) {
+    liveBtn.addEventListener('click', () => {
+      if (liveActive) {
+        window.qhy.stopLive();
+        setLiveActive(false);
+        statusEl.textContent = 'Live 已停止';
+        return;
+      }
+      liveLevelsInitialized = false;
+      setLiveActive(true);
+      statusEl.textContent = '正在启动 Live……';
+      window.qhy.startLive(collectCaptureOptions());
+    });
+  }
+
+  /**
+   * 录制计数的一行摘要
+   */
+  function formatRecordingStats({ format, written, failed, dropped, fps, queued, maxQueue, bytesPerSec, lastError }) {
+    if (format === 'ser') {
+      return (
+        `SER: 已写入 ${written} 帧, ${(fps || 0).toFixed(1)} fps, 缓冲 ${queued}/${maxQueue}, ` +
+        `${(bytesPerSec / 1048576).toFixed(1)} MB/s` +
+        (dropped ? `, 丢帧 ${dropped}` : '') +
+        (lastError ? `（${lastError}）` : '')
+      );
+    }
+    return (
+      `FITS: 已保存 ${written} 帧, 队列 ${queued}/${maxQueue}, ${(bytesPerSec / 1048576).toFixed(1)} MB/s` +
+      (failed ? `, 失败 ${failed} 帧（${lastError}）` : '')
+    );
+  }
+
+  function formatStarSummary({ count, saturated, medianHfr, medianFwhm, medianEccentricity, noise }) {
+    if (!count) {
+      return `星点: 未检测到（背景噪声 ${noise.toFixed(1)}）`;
+    }
+    return (
+      `星点: ${count} 颗` +
+      (saturated ? `（饱和 ${saturated}）` : '') +
+      `, HFR ${medianHfr.toFixed(2)}px, FWHM ${medianFwhm.toFixed(2)}px, 偏心率 ${medianEccentricity.toFixed(2)}`
+    );
+  }
+
+  /**
+   * 在测量图层上标出星点：圆心为质心（原图像素坐标，像素中心为整数），半径为 2 倍 HFR（至少 3 像素）
+   * @param {Object|null} stars frame-data 的 stars，为 null 时清除
+   */
+  function drawStarOverlay(stars) {
+    starGraphics.clear();
+    if (!stars || !stars.count) {
+      return;
+    }
+    const { data, stride } = stars;
+    for (let i = 0; i + stride <= data.length; i += stride) {
+      starGraphics.circle(data[i] + 0.5, data[i + 1] + 0.5, Math.max(3, 2 * data[i + 3]));
+    }
+    if (typeof starGraphics.stroke === 'function') {
+      starGraphics.stroke({ width: 1, color: 0x3fb950, alpha: 0.9 });
+    }
+  }
+
+  function formatStackResult({ accepted, reference, frames, rejectedFrames, stars, matches, dx, dy, rotation, residual, rejectedPixels }) {
+    if (reference) {
+      return `叠加: 新参考帧（${stars} 颗星）`;
+    }
+    return (
+      `叠加: ${frames} 帧` +
+      (rejectedFrames ? `, 未配准 ${rejectedFrames} 帧` : '') +
+      (accepted
+        ? `, 匹配 ${matches}/${stars} 颗星, 偏移 (${dx.toFixed(1)}, ${dy.toFixed(1)}), 旋转 ${rotation.toFixed(2)}°, 残差 ${residual.toFixed(2)}px` +
+          (rejectedPixels ? `, 剔除 ${rejectedPixels} 像素` : '')
+        : `, 本帧未叠加（匹配 ${matches}/${stars} 颗星）`)
+    );
+  }
+
+  let recordingActive = false;
+  if (recordBtn) {
+    recordBtn.addEventListener('click', async () => {
+      try {
+        if (recordingActive) {
+          const stats = await window.qhy.stopRecording();
+          recordingActive = false;
+          statusEl.textContent = stats ? `录制已停止，${formatRecordingStats(stats)}` : '录制已停止';
+        } else {
+          const format = recordFormatSelect ? recordFormatSelect.value : 'fits';
+          const target = await window.qhy.startRecording(format);
+          if (!target) return;
+          recordingActive = true;
+          statusEl.textContent = `${format.toUpperCase()} 录制中，保存到 ${target}`;
+        }
+        recordBtn.textContent = recordingActive ? 'Stop Recording' : 'Record';
+        recordBtn.classList.toggle('record-active', recordingActive);
+        if (recordFormatSelect) recordFormatSelect.disabled = recordingActive;
+      } catch (e) {
+        statusEl.textContent = `录制失败: ${e?.message || e}`;
+      }
     });
+  }
+
+  // 校正主帧：按当前拍摄参数连续拍摄并在原生侧合成，之后可勾选 Calibrate 启用
+  if (buildMasterBtn) {
+    buildMasterBtn.addEventListener('click', async () => {
+      if (liveActive) {
+        statusEl.textContent = '请先停止 Live 再拍摄校正帧';
+        return;
+      }
+      const kind = masterKindSelect ? masterKindSelect.value : 'dark';
+      const count = masterCountSelect ? Number(masterCountSelect.value) || 10 : 10;
+      buildMasterBtn.disabled = true;
+      btn.disabled = true;
+      statusEl.textContent = `正在拍摄 ${count} 帧并合成 ${kind} 主帧……`;
+      try {
+        const master = await window.qhy.buildMaster({ kind, count, options: collectCaptureOptions() });
+        statusEl.textContent = `${kind} 主帧已合成：${master.width}x${master.height}，${master.frames} 帧`
+          + (calibrationToggle && calibrationToggle.checked ? '（重新勾选 Calibrate 后使用新主帧）' : '');
+      } catch (e) {
+        statusEl.textContent = `合成主帧失败: ${e?.message || e}`;
+      } finally {
+        buildMasterBtn.disabled = false;
+        btn.disabled = liveActive || captureInFlight;
+      }
+    });
+  }
+
+  // 已启用校正但这一帧与主帧的尺寸 / ROI 起点 / bin 不符（主帧拍自传感器的另一块区域）时标出
+  function updateCalibrationMismatch(mismatch) {
+    if (!calibrationLabel) return;
+    calibrationLabel.classList.toggle('calibration-mismatch', Boolean(mismatch));
+    calibrationLabel.title = mismatch
+      ? '当前帧的尺寸、ROI 位置或 bin 与主帧不同，未校正；请在当前 ROI 下重新合成主帧'
+      : '取帧时减暗场（或偏置）并除以平场';
+  }
+
+  if (calibrationToggle) {
+    calibrationToggle.addEventListener('change', async () => {
+      updateCalibrationMismatch(false);
+      try {
+        const info = await window.qhy.setCalibration({ enabled: calibrationToggle.checked });
+        statusEl.textContent = info
+          ? `校正已启用：${info.dark ? '暗场' : ''}${info.dark && info.flat ? ' + ' : ''}${info.flat ? '平场' : ''}（${info.width}x${info.height}）`
+          : '校正已关闭';
+      } catch (e) {
+        calibrationToggle.checked = false;
+        statusEl.textContent = `启用校正失败: ${e?.message || e}`;
+      }
+    });
+  }
+
+  // 实时叠加：方法与窗口在启用时生效，修改后重新启用（重新开始叠加）
+  async function applyStacking() {
+    try {
+      const info = await window.qhy.setStacking({
+        enabled: stackingToggle.checked,
+        method: stackMethodSelect ? stackMethodSelect.value : 'sigma',
+        window: stackWindowSelect ? Number(stackWindowSelect.value) || 0 : 0,
+      });
+      statusEl.textContent = stackingToggle.checked ? `叠加已启用（${info ? info.method : ''}）` : '叠加已关闭';
+    } catch (e) {
+      stackingToggle.checked = false;
+      statusEl.textContent = `启用叠加失败: ${e?.message || e}`;
+    }
+  }
+
+  if (stackingToggle) {
+    stackingToggle.addEventListener('change', applyStacking);
+    [stackMethodSelect, stackWindowSelect].forEach((el) => {
+      if (el) {
+        el.addEventListener('change', () => {
+          if (stackingToggle.checked) {
+            applyStacking();
+          }
+        });
+      }
+    });
+  }
+
+  // 子帧 ROI：rect 为 null 时恢复整个传感器
+  async function applyRoi(rect) {
+    const bin = hardwareBinSelect ? Number(hardwareBinSelect.value) || 1 : 1;
+    try {
+      const roi = await window.qhy.setRoi({ rect, bin });
+      statusEl.textContent = `ROI: (${roi.x}, ${roi.y}) ${roi.width}x${roi.height}, bin ${roi.bin}`;
+    } catch (e) {
+      statusEl.textContent = `设置 ROI 失败: ${e?.message || e}`;
+    }
+  }
+
+  if (roiFromRectBtn) {
+    roiFromRectBtn.addEventListener('click', () => {
+      const rect = measurementManager.getRoiRect();
+      if (!rect || rect.width < 1 || rect.height < 1) {
+        statusEl.textContent = '请先用矩形工具在图像上框出 ROI';
+        return;
+      }
+      applyRoi(rect);
+    });
+  }
+
+  if (roiFullBtn) {
+    roiFullBtn.addEventListener('click', () => applyRoi(null));
+  }
+
+  [profileWidthSelect, profileInterpolationSelect].forEach((el) => {
+    if (el) {
+      el.addEventListener('change', () => updateProfile());
+    }
+  });
+
+  // 星点检测：之后每帧随 frame-data 带回星点与 HFR / FWHM，关闭时清除标记
+  if (starDetectionToggle) {
+    starDetectionToggle.addEventListener('change', async () => {
+      try {
+        await window.qhy.setStarDetection({ enabled: starDetectionToggle.checked });
+        if (!starDetectionToggle.checked) {
+          drawStarOverlay(null);
+        }
+      } catch (e) {
+        starDetectionToggle.checked = false;
+        statusEl.textContent = `启用星点检测失败: ${e?.message || e}`;
+      }
+    });
+  }
+
+  if (stackResetBtn) {
+    stackResetBtn.addEventListener('click', async () => {
+      try {
+        await window.qhy.resetStacking();
+        statusEl.textContent = '叠加已重置，下一帧成为参考帧';
+      } catch (e) {
+        statusEl.textContent = `重置叠加失败: ${e?.message || e}`;
+      }
+    });
+  }
+
+  // 导出各阶段计时（Chrome trace JSON，可在 about:tracing 或 Perfetto 中打开）
+  if (traceExportBtn) {
+    traceExportBtn.addEventListener('click', async () => {
+      try {
+        const filePath = await window.qhy.exportTrace();
+        if (filePath) {
+          statusEl.textContent = `已导出性能追踪: ${filePath}`;
+        }
+      } catch (e) {
+        statusEl.textContent = `导出性能追踪失败: ${e?.message || e}`;
+      }
+    });
+  }
+
+  // Live 期间调整曝光 / 增益 / 偏置 / 软件 bin 时，直接下发给相机
+  const pushLiveSettings = () => {
+    if (!liveActive) return;
+    const { exposureUs, gain, offset, softwareBin, softwareBinMode } = collectCaptureOptions();
+    window.qhy.configure({ exposureUs, gain, offset, softwareBin, softwareBinMode });
+  };
+  [gainSlider, offsetSlider, expInput, softwareBinSelect, softwareBinModeSelect].forEach((el) => {
+    if (el) el.addEventListener('change', pushLiveSettings);
   });
+  if (exposureUnitToggle) {
+    exposureUnitToggle.addEventListener('click', pushLiveSettings);
+  }
 });
@@ -0,0 +1,582 @@
+#include "camera_session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include "frame_trace.h"
+#include "image_debayer.h"
+
+// InitQHYCCDResource / ReleaseQHYCCDResource 是进程级资源，
+// 多个会话共享同一份，用引用计数保证只初始化 / 释放一次。
+static std::mutex g_resourceMutex;
+static int g_resourceRefs = 0;
+
+static uint32_t AcquireSdkResource(const QHYCCDFunctions *qhy) {
+  std::lock_guard<std::mutex> lock(g_resourceMutex);
+  if (g_resourceRefs == 0) {
+    uint32_t ret = qhy->InitQHYCCDResource();
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  g_resourceRefs++;
+  return 0;
+}
+
+// 系统时钟的当前时间（Unix 纪元微秒）
+static int64_t UtcNowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void ReleaseSdkResource(const QHYCCDFunctions *qhy) {
+  std::lock_guard<std::mutex> lock(g_resourceMutex);
+  if (g_resourceRefs > 0 && --g_resourceRefs == 0) {
+    qhy->ReleaseQHYCCDResource();
+  }
+}
+
+CameraSession::CameraSession(const QHYCCDFunctions *qhy) : qhy_(qhy) {
+  ResetApplied();
+}
+
+CameraSession::~CameraSession() {
+  Close();
+}
+
+static RoiRect SettingsRoi(const CaptureSettings &settings) {
+  RoiRect roi;
+  roi.x = settings.roiX;
+  roi.y = settings.roiY;
+  roi.width = settings.roiWidth;
+  roi.height = settings.roiHeight;
+  roi.bin = settings.binX;
+  return roi;
+}
+
+static void SetSettingsRoi(const RoiRect &roi, CaptureSettings *settings) {
+  settings->roiX = roi.x;
+  settings->roiY = roi.y;
+  settings->roiWidth = roi.width;
+  settings->roiHeight = roi.height;
+  settings->binX = roi.bin;
+  settings->binY = roi.bin;
+}
+
+bool CameraSession::Fail(const char *what, uint32_t ret) {
+  char msg[128];
+  std::snprintf(msg, sizeof(msg), "%s failed (ret=%u)", what, ret);
+  lastError_ = msg;
+  return false;
+}
+
+void CameraSession::ResetApplied() {
+  // 用不可能出现的值标记“尚未下发”，保证下一次 Configure 全量设置
+  applied_.exposureUs = -1.0;
+  applied_.gain = -1.0;
+  applied_.offset = -1.0;
+  applied_.roiWidth = 0;
+  applied_.roiHeight = 0;
+  applied_.binX = 0;
+  applied_.binY = 0;
+  applied_.transferBits = 0;
+}
+
+bool CameraSession::Open(const char *cameraId) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (handle_) {
+    return true;
+  }
+  TraceScope trace("sdk.open", 0);
+
+  uint32_t ret = AcquireSdkResource(qhy_);
+  if (ret != 0) {
+    return Fail("InitQHYCCDResource", ret);
+  }
+  holdsResource_ = true;
+
+  uint32_t camCount = qhy_->ScanQHYCCD();
+  if (camCount == 0) {
+    CloseLocked();
+    lastError_ = "No QHYCCD camera found";
+    return false;
+  }
+
+  std::memset(cameraId_, 0, sizeof(cameraId_));
+  if (cameraId && cameraId[0]) {
+    std::strncpy(cameraId_, cameraId, sizeof(cameraId_) - 1);
+  } else {
+    ret = qhy_->GetQHYCCDId(0, cameraId_);
+    if (ret != 0) {
+      CloseLocked();
+      return Fail("GetQHYCCDId", ret);
+    }
+  }
+
+  handle_ = qhy_->OpenQHYCCD(cameraId_);
+  if (handle_ == nullptr) {
+    CloseLocked();
+    lastError_ = "OpenQHYCCD failed";
+    return false;
+  }
+
+  streamMode_ = -1;
+  if (!SwitchStreamModeLocked(0)) {
+    std::string error = lastError_;
+    CloseLocked();
+    lastError_ = error;
+    return false;
+  }
+
+  // 彩色相机返回 BAYER_ID（1 ~ 4），黑白相机返回 QHYCCD_ERROR。
+  // 去马赛克由 image_debayer 完成，不打开 SDK 的 SetQHYCCDDebayerOnOff（只支持 8bit 且较慢）。
+  uint32_t bayer = qhy_->IsQHYCCDControlAvailable(handle_, QHYCCD_CAM_COLOR);
+  bayer_ = BayerPatternName((BayerPattern)bayer) != nullptr ? bayer : 0;
+  hasTemperature_ = qhy_->IsQHYCCDControlAvailable(handle_, QHYCCD_CONTROL_CURTEMP) == 0;
+  temperatureReadUs_ = 0;
+
+  double chipWidth = 0.0;
+  double chipHeight = 0.0;
+  uint32_t chipBpp = 0;
+  sensor_ = SensorInfo();
+  if (qhy_->GetQHYCCDChipInfo(handle_, &chipWidth, &chipHeight, &sensor_.width, &sensor_.height,
+                              &sensor_.pixelWidthUm, &sensor_.pixelHeightUm, &chipBpp) != 0) {
+    sensor_ = SensorInfo();
+  }
+  // 还没有指定过 ROI（仍是 CaptureSettings 的默认值）时默认使用整个传感器
+  const CaptureSettings defaults;
+  if (sensor_.width > 0 && sensor_.height > 0 && settings_.roiX == defaults.roiX &&
+      settings_.roiY == defaults.roiY && settings_.roiWidth == defaults.roiWidth &&
+      settings_.roiHeight == defaults.roiHeight && settings_.binX == 1 && settings_.binY == 1) {
+    settings_.roiWidth = sensor_.width;
+    settings_.roiHeight = sensor_.height;
+    if (!ApplySettingsLocked()) {
+      std::string error = lastError_;
+      CloseLocked();
+      lastError_ = error;
+      return false;
+    }
+  } else if (sensor_.width > 0 && sensor_.height > 0) {
+    // 打开之前 Configure 过的 ROI 同样按传感器尺寸裁剪，第一次拍摄时才下发
+    RoiRect roi = SettingsRoi(settings_);
+    if (ClampRoiLocked(&roi)) {
+      SetSettingsRoi(roi, &settings_);
+    }
+  }
+  return true;
+}
+
+uint32_t CameraSession::FrameBayerLocked(uint32_t channels) const {
+  // bin 后每个像素混合了不同颜色，不再是 Bayer 阵列；ROI 起点为奇数时阵列随之平移
+  if (bayer_ == 0 || channels > 1 || applied_.binX != 1 || applied_.binY != 1) {
+    return 0;
+  }
+  return ShiftBayerPattern((BayerPattern)bayer_, applied_.roiX, applied_.roiY);
+}
+
+void CameraSession::FillCaptureParamsLocked(int64_t startUtcUs, FrameInfo *info) {
+  info->exposureUs = applied_.exposureUs;
+  info->gain = applied_.gain;
+  info->offset = applied_.offset;
+  info->roiX = applied_.roiX;
+  info->roiY = applied_.roiY;
+  info->binX = applied_.binX;
+  info->binY = applied_.binY;
+  info->softwareBin = 1;
+  info->calibration = 0;
+  info->startUtcUs = startUtcUs;
+
+  const int64_t now = TraceNowUs();
+  if (hasTemperature_ && (temperatureReadUs_ == 0 || now - temperatureReadUs_ >= 1000000)) {
+    // 读取失败时 SDK 返回 QHYCCD_ERROR（0xFFFFFFFF）转换成的 double
+    double t = qhy_->GetQHYCCDParam(handle_, QHYCCD_CONTROL_CURTEMP);
+    temperature_ = (t > -273.15 && t < 200.0) ? t : NAN;
+    temperatureReadUs_ = now;
+  }
+  info->temperature = hasTemperature_ ? temperature_ : NAN;
+}
+
+bool CameraSession::SwitchStreamModeLocked(int mode) {
+  if (streamMode_ == mode) {
+    return true;
+  }
+
+  // 流模式必须在 InitQHYCCD 之前设置，切换模式需要重新 InitQHYCCD（无需重新扫描 / 打开）
+  uint32_t ret = qhy_->SetQHYCCDStreamMode(handle_, (uint8_t)mode);
+  if (ret != 0) return Fail("SetQHYCCDStreamMode", ret);
+
+  ret = qhy_->InitQHYCCD(handle_);
+  if (ret != 0) return Fail("InitQHYCCD", ret);
+  streamMode_ = mode;
+
+  memLength_ = qhy_->GetQHYCCDMemLength(handle_);
+
+  // InitQHYCCD 会把参数恢复为默认值，需要重新下发当前参数
+  ResetApplied();
+  return ApplySettingsLocked();
+}
+
+bool CameraSession::Configure(const CaptureSettings &settings) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!handle_) {
+    settings_ = settings;  // 打开相机时再按传感器尺寸裁剪
+    lastError_ = "Camera is not open";
+    return false;
+  }
+  CaptureSettings next = settings;
+  RoiRect roi = SettingsRoi(next);
+  if (!ClampRoiLocked(&roi)) {
+    return false;
+  }
+  SetSettingsRoi(roi, &next);
+  // Live 中改变分辨率需要暂停连续曝光并在失败时回滚，只能通过 SetRoi 进行
+  if (liveRunning_ && (next.roiX != settings_.roiX || next.roiY != settings_.roiY ||
+                       next.roiWidth != settings_.roiWidth || next.roiHeight != settings_.roiHeight ||
+                       next.binX != settings_.binX || next.binY != settings_.binY)) {
+    lastError_ = "ROI / bin cannot be changed by configure() during Live, use setRoi()";
+    return false;
+  }
+  settings_ = next;
+  return ApplySettingsLocked();
+}
+
+bool CameraSession::ClampRoiLocked(RoiRect *roi) {
+  RoiRect &next = *roi;
+  next.bin = std::min(kMaxHardwareBin, std::max(1u, next.bin));
+  if (sensor_.width > 0 && sensor_.height > 0) {
+    const uint32_t maxWidth = sensor_.width / next.bin;
+    const uint32_t maxHeight = sensor_.height / next.bin;
+    if (next.width == 0 || next.height == 0) {
+      next.x = 0;
+      next.y = 0;
+      next.width = maxWidth;
+      next.height = maxHeight;
+    }
+    next.width = std::min(maxWidth, std::max(kMinRoiSize, next.width));
+    next.height = std::min(maxHeight, std::max(kMinRoiSize, next.height));
+    next.x = std::min(next.x, maxWidth - next.width);
+    next.y = std::min(next.y, maxHeight - next.height);
+  } else if (next.width == 0 || next.height == 0) {
+    lastError_ = "Sensor size is unknown, ROI width / height are required";
+    return false;
+  }
+  return true;
+}
+
+bool CameraSession::SetRoi(const RoiRect &roi, RoiRect *applied) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!handle_) {
+    lastError_ = "Camera is not open";
+    return false;
+  }
+  RoiRect next = roi;
+  if (!ClampRoiLocked(&next)) {
+    return false;
+  }
+
+  const CaptureSettings previous = settings_;
+  SetSettingsRoi(next, &settings_);
+  // Live 中 SDK 不接受新的分辨率，暂停连续曝光后再下发（缓冲区按 GetQHYCCDMemLength 的最大值分配，无需重新分配）
+  const bool restart = liveRunning_;
+  if (restart) {
+    StopLiveLocked();
+  }
+  bool ok = ApplySettingsLocked();
+  if (!ok) {
+    // 下发失败：回到原来的 ROI 并重新下发，保留第一次失败的错误信息
+    std::string error = lastError_;
+    settings_ = previous;
+    ApplySettingsLocked();
+    lastError_ = error;
+  }
+  if (restart) {
+    // 重新开始连续曝光失败时 liveRunning_ 保持 false，由调用者停止取帧线程
+    uint32_t ret = qhy_->BeginQHYCCDLive(handle_);
+    if (ret != 0) {
+      return Fail("BeginQHYCCDLive", ret);
+    }
+    liveRunning_ = true;
+  }
+  if (ok && applied) {
+    *applied = next;
+  }
+  return ok;
+}
+
+bool CameraSession::ApplySettingsLocked() {
+  const CaptureSettings &settings = settings_;
+  uint32_t ret;
+  // 传输位数默认 16bit；部分型号在 Live 模式下默认 8bit。
+  // 个别只支持 8bit 的型号会返回失败，此时保持 SDK 默认值。
+  if (settings.transferBits != applied_.transferBits) {
+    qhy_->SetQHYCCDBitsMode(handle_, settings.transferBits);
+    applied_.transferBits = settings.transferBits;
+  }
+
+  if (settings.binX != applied_.binX || settings.binY != applied_.binY) {
+    ret = qhy_->SetQHYCCDBinMode(handle_, settings.binX, settings.binY);
+    if (ret != 0) return Fail("SetQHYCCDBinMode", ret);
+    applied_.binX = settings.binX;
+    applied_.binY = settings.binY;
+    // 改变 bin 后 SDK 会重置分辨率，需要重新下发
+    applied_.roiWidth = 0;
+  }
+
+  if (settings.roiX != applied_.roiX || settings.roiY != applied_.roiY ||
+      settings.roiWidth != applied_.roiWidth || settings.roiHeight != applied_.roiHeight) {
+    ret = qhy_->SetQHYCCDResolution(handle_, settings.roiX, settings.roiY,
+                                    settings.roiWidth, settings.roiHeight);
+    if (ret != 0) return Fail("SetQHYCCDResolution", ret);
+    applied_.roiX = settings.roiX;
+    applied_.roiY = settings.roiY;
+    applied_.roiWidth = settings.roiWidth;
+    applied_.roiHeight = settings.roiHeight;
+  }
+
+  // 曝光时间（单位：微秒）
+  if (settings.exposureUs != applied_.exposureUs) {
+    ret = qhy_->SetQHYCCDParam(handle_, QHYCCD_CONTROL_EXPOSURE, settings.exposureUs);
+    if (ret != 0) return Fail("SetQHYCCDParam(EXPOSURE)", ret);
+    applied_.exposureUs = settings.exposureUs;
+  }
+
+  // 增益和偏置（如果提供）
+  if (settings.gain >= 0.0 && settings.gain != applied_.gain) {
+    ret = qhy_->SetQHYCCDParam(handle_, QHYCCD_CONTROL_GAIN, settings.gain);
+    if (ret != 0) return Fail("SetQHYCCDParam(GAIN)", ret);
+    applied_.gain = settings.gain;
+  }
+  if (settings.offset >= 0.0 && settings.offset != applied_.offset) {
+    ret = qhy_->SetQHYCCDParam(handle_, QHYCCD_CONTROL_OFFSET, settings.offset);
+    if (ret != 0) return Fail("SetQHYCCDParam(OFFSET)", ret);
+    applied_.offset = settings.offset;
+  }
+
+  return true;
+}
+
+size_t CameraSession::FrameBufferSize() const {
+  if (memLength_ > 0) {
+    return (size_t)memLength_;
+  }
+  return (size_t)settings_.roiWidth * settings_.roiHeight * 2;
+}
+
+bool CameraSession::Capture(uint8_t *buffer, size_t bufferSize, FrameInfo *info, bool calibrate) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!handle_) {
+    lastError_ = "Camera is not open";
+    return false;
+  }
+  if (liveRunning_) {
+    lastError_ = "Live mode is running";
+    return false;
+  }
+  if (!SwitchStreamModeLocked(0)) {
+    return false;
+  }
+  if (!buffer || bufferSize < FrameBufferSize()) {
+    lastError_ = "Frame buffer too small";
+    return false;
+  }
+
+  const uint64_t frameId = NextTraceFrameId();
+  const int64_t startUtcUs = UtcNowUs();
+  int64_t start = TraceNowUs();
+  uint32_t ret = qhy_->ExpQHYCCDSingleFrame(handle_);
+  if (ret != 0) return Fail("ExpQHYCCDSingleFrame", ret);
+  int64_t exposed = TraceNowUs();
+  RecordTrace("sdk.expose", frameId, start, exposed);
+
+  uint32_t w = 0;
+  uint32_t h = 0;
+  uint32_t bpp = 0;
+  uint32_t channels = 0;
+  // 多数型号的 ExpQHYCCDSingleFrame 只是启动曝光，等待曝光结束也计入读出阶段
+  ret = qhy_->GetQHYCCDSingleFrame(handle_, &w, &h, &bpp, &channels, buffer);
+  if (ret != 0) return Fail("GetQHYCCDSingleFrame", ret);
+  RecordTrace("sdk.readout", frameId, exposed, TraceNowUs());
+
+  if (w == 0 || h == 0 || bpp == 0) {
+    lastError_ = "GetQHYCCDSingleFrame returned an empty frame";
+    return false;
+  }
+  FillFrameInfo(w, h, bpp, channels, bufferSize, info);
+  info->frameId = frameId;
+  info->bayer = FrameBayerLocked(channels);
+  FillCaptureParamsLocked(startUtcUs, info);
+  if (calibrate) {
+    ApplyCalibrationLocked(buffer, info);
+  }
+  ApplySoftwareBinLocked(buffer, info);
+  return true;
+}
+
+void CameraSession::FillFrameInfo(uint32_t w, uint32_t h, uint32_t bpp, uint32_t channels,
+                                  size_t bufferSize, FrameInfo *info) {
+  size_t bytesPerPixel = (bpp + 7u) / 8u;
+  size_t ch = channels == 0 ? 1u : channels;
+  size_t usedBytes = (size_t)w * (size_t)h * bytesPerPixel * ch;
+  if (usedBytes > bufferSize) {
+    usedBytes = bufferSize;
+  }
+
+  info->width = w;
+  info->height = h;
+  info->bpp = bpp;
+  info->channels = channels;
+  info->bytes = usedBytes;
+}
+
+void CameraSession::SetCalibration(std::shared_ptr<const CalibrationSet> calibration) {
+  std::lock_guard<std::mutex> lock(calibrationMutex_);
+  calibration_ = std::move(calibration);
+  calibrationMismatch_ = false;
+}
+
+std::shared_ptr<const CalibrationSet> CameraSession::Calibration() const {
+  std::lock_guard<std::mutex> lock(calibrationMutex_);
+  return calibration_;
+}
+
+void CameraSession::ApplyCalibrationLocked(uint8_t *buffer, FrameInfo *info) {
+  // 持有一份引用，校正期间 JS 线程替换校正参数也是安全的
+  std::shared_ptr<const CalibrationSet> calibration = Calibration();
+  if (!calibration) {
+    return;
+  }
+  CalibrationRegion region;
+  region.x = info->roiX;
+  region.y = info->roiY;
+  region.binX = info->binX;
+  region.binY = info->binY;
+  if (info->bpp <= 8 || info->channels > 1 || info->width != calibration->width ||
+      info->height != calibration->height || region != calibration->region ||
+      info->bytes < (size_t)info->width * info->height * sizeof(uint16_t)) {
+    calibrationMismatch_ = true;
+    return;
+  }
+  calibrationMismatch_ = false;
+  TraceScope trace("native.calibrate", info->frameId);
+  uint16_t *pixels = reinterpret_cast<uint16_t *>(buffer);
+  const float *dark = calibration->dark.empty() ? nullptr : calibration->dark.data();
+  const float *gain = calibration->gain.empty() ? nullptr : calibration->gain.data();
+  ApplyCalibration16(pixels, dark, gain, calibration->pedestal, (size_t)info->width * info->height, pixels);
+  info->calibration = (dark ? CALIBRATED_DARK : 0) | (gain ? CALIBRATED_FLAT : 0);
+}
+
+void CameraSession::ApplySoftwareBinLocked(uint8_t *buffer, FrameInfo *info) {
+  const uint32_t factor = settings_.softwareBin;
+  if (factor <= 1 || info->bpp <= 8 || info->channels > 1 ||
+      info->bytes < (size_t)info->width * info->height * sizeof(uint16_t)) {
+    return;
+  }
+  const bool bayer = info->bayer != 0;
+  uint32_t outWidth = 0;
+  uint32_t outHeight = 0;
+  SoftwareBinSize(info->width, info->height, factor, bayer, &outWidth, &outHeight);
+  if (outWidth == 0 || outHeight == 0) {
+    return;
+  }
+
+  TraceScope trace("native.software-bin", info->frameId);
+  binScratch_.resize((size_t)outWidth * outHeight);
+  SoftwareBin16(reinterpret_cast<const uint16_t *>(buffer), info->width, info->height, factor,
+                settings_.softwareBinMode, bayer, binScratch_.data());
+  std::memcpy(buffer, binScratch_.data(), binScratch_.size() * sizeof(uint16_t));
+  info->width = outWidth;
+  info->height = outHeight;
+  info->bytes = binScratch_.size() * sizeof(uint16_t);
+  info->softwareBin = factor;
+}
+
+bool CameraSession::BeginLive() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!handle_) {
+    lastError_ = "Camera is not open";
+    return false;
+  }
+  if (liveRunning_) {
+    return true;
+  }
+  if (!SwitchStreamModeLocked(1)) {
+    return false;
+  }
+  uint32_t ret = qhy_->BeginQHYCCDLive(handle_);
+  if (ret != 0) return Fail("BeginQHYCCDLive", ret);
+  liveRunning_ = true;
+  return true;
+}
+
+bool CameraSession::GetLiveFrame(uint8_t *buffer, size_t bufferSize, FrameInfo *info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!handle_ || !liveRunning_ || !buffer || bufferSize < FrameBufferSize()) {
+    return false;
+  }
+
+  uint32_t w = 0;
+  uint32_t h = 0;
+  uint32_t bpp = 0;
+  uint32_t channels = 0;
+  // 尚无新帧时 SDK 返回 QHYCCD_ERROR，这里不区分具体原因，由调用方继续轮询
+  int64_t start = TraceNowUs();
+  uint32_t ret = qhy_->GetQHYCCDLiveFrame(handle_, &w, &h, &bpp, &channels, buffer);
+  if (ret != 0 || w == 0 || h == 0 || bpp == 0) {
+    return false;
+  }
+  FillFrameInfo(w, h, bpp, channels, bufferSize, info);
+  info->frameId = NextTraceFrameId();
+  info->bayer = FrameBayerLocked(channels);
+  // Live 模式下读出的是刚结束曝光的一帧，曝光开始时刻按曝光时间倒推
+  FillCaptureParamsLocked(UtcNowUs() - (int64_t)applied_.exposureUs, info);
+  ApplyCalibrationLocked(buffer, info);
+  ApplySoftwareBinLocked(buffer, info);
+  RecordTrace("sdk.live-readout", info->frameId, start, TraceNowUs());
+  return true;
+}
+
+void CameraSession::StopLive() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!liveRunning_) {
+    return;
+  }
+  StopLiveLocked();
+  // 立即切回单帧模式，使 FrameBufferSize() 与下一次 Capture 一致
+  if (handle_) {
+    SwitchStreamModeLocked(0);
+  }
+}
+
+void CameraSession::StopLiveLocked() {
+  if (handle_ && liveRunning_) {
+    qhy_->StopQHYCCDLive(handle_);
+  }
+  liveRunning_ = false;
+}
+
+void CameraSession::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseLocked();
+}
+
+void CameraSession::CloseLocked() {
+  StopLiveLocked();
+  if (handle_) {
+    qhy_->CloseQHYCCD(handle_);
+    handle_ = nullptr;
+  }
+  if (holdsResource_) {
+    ReleaseSdkResource(qhy_);
+    holdsResource_ = false;
+  }
+  memLength_ = 0;
+  bayer_ = 0;
+  sensor_ = SensorInfo();
+  hasTemperature_ = false;
+  temperature_ = NAN;
+  streamMode_ = -1;
+  ResetApplied();
+}
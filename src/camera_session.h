@@ -0,0 +1,186 @@
+// 相机会话：在多次拍摄之间保持 SDK 资源与 qhyccd_handle 常驻，
+// 避免每一帧都重新执行 InitQHYCCDResource / ScanQHYCCD / OpenQHYCCD / InitQHYCCD。
+// 本文件只依赖 qhyccd_dynamic.h，不包含任何 N-API 代码，便于在其它场景复用。
+
+#ifndef CAMERA_SESSION_H
+#define CAMERA_SESSION_H
+
+#include "image_binning.h"
+#include "image_calibration.h"
+#include "qhyccd_dynamic.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 拍摄参数。gain / offset 小于 0 表示保持相机当前值不变。
+struct CaptureSettings {
+  double exposureUs = 1000000.0;
+  double gain = -1.0;
+  double offset = -1.0;
+  uint32_t roiX = 0;
+  uint32_t roiY = 0;
+  uint32_t roiWidth = 1920;
+  uint32_t roiHeight = 1080;
+  uint32_t binX = 1;
+  uint32_t binY = 1;
+  // 传输位数（8 / 16）。界面只处理 16bit 数据，JS 侧不开放，供原生工具（如基准测试）使用。
+  uint32_t transferBits = 16;
+  // 软件 bin（1 ~ kSoftwareBinMaxFactor，1 为不 bin）：读出后在取帧线程中立即进行，可与 binX / binY 叠加。
+  // 只处理 16bit 单通道帧，彩色相机按同色像素合并（保持 Bayer 阵列）。
+  uint32_t softwareBin = 1;
+  BinMode softwareBinMode = BIN_AVERAGE;
+};
+
+// 传感器信息，打开相机时由 GetQHYCCDChipInfo 取得；取不到时尺寸为 0
+struct SensorInfo {
+  uint32_t width = 0;  // 有效像素数（未 bin）
+  uint32_t height = 0;
+  double pixelWidthUm = 0.0;
+  double pixelHeightUm = 0.0;
+};
+
+// 子帧（ROI）：坐标与尺寸都是硬件 bin 之后的像素，与 SetQHYCCDResolution 一致。
+// width / height 为 0 表示整个传感器。
+struct RoiRect {
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bin = 1;
+};
+
+// ROI 的最小边长（像素），避免误点出的极小矩形
+static const uint32_t kMinRoiSize = 16;
+// 硬件 bin 的最大倍数
+static const uint32_t kMaxHardwareBin = 4;
+
+// 一帧图像的基本信息，bytes 为实际有效数据长度。
+struct FrameInfo {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bpp = 0;
+  uint32_t channels = 0;
+  size_t bytes = 0;
+  uint64_t frameId = 0;  // 取到该帧时分配的帧 ID（NextTraceFrameId），用于按帧归类各阶段计时
+  // 彩色相机未 bin 时的 Bayer 阵列（BayerPattern，已按 ROI 起点的奇偶平移），0 表示黑白或已 bin
+  uint32_t bayer = 0;
+
+  // 拍摄这一帧时已下发给 SDK 的参数与相机状态，用于写入文件头（FITS 等）
+  double exposureUs = 0.0;
+  double gain = -1.0;    // 从未设置过时为 -1（相机默认值，未知）
+  double offset = -1.0;
+  uint32_t roiX = 0;
+  uint32_t roiY = 0;
+  uint32_t binX = 1;     // 硬件 bin
+  uint32_t binY = 1;
+  uint32_t softwareBin = 1;  // 实际进行了的软件 bin，未进行时为 1
+  uint32_t calibration = 0;  // 实际进行了的校正（CalibrationFlags），尺寸与主帧不符时为 0
+  double temperature = NAN;  // 传感器温度（摄氏度），相机不支持时为 NaN
+  int64_t startUtcUs = 0;    // 曝光开始时刻（Unix 纪元微秒，UTC）
+};
+
+class CameraSession {
+ public:
+  explicit CameraSession(const QHYCCDFunctions *qhy);
+  ~CameraSession();
+
+  CameraSession(const CameraSession &) = delete;
+  CameraSession &operator=(const CameraSession &) = delete;
+
+  // 打开相机。cameraId 为空时打开扫描到的第一台相机。
+  bool Open(const char *cameraId = nullptr);
+
+  // 应用拍摄参数，只向 SDK 下发与上一次不同的部分。ROI 与 bin 按传感器范围裁剪（同 SetRoi）；
+  // Live 进行中不能改变 ROI 与 bin（返回 false），需要使用 SetRoi。
+  bool Configure(const CaptureSettings &settings);
+
+  // 切换子帧 ROI 与硬件 bin：按传感器范围裁剪后只下发 SetQHYCCDBinMode / SetQHYCCDResolution，
+  // 不重新 InitQHYCCD。Live 进行中时暂停连续曝光、下发后立即重新开始，取帧线程无需停止。
+  // applied（可以为 NULL）返回裁剪后实际使用的 ROI。
+  bool SetRoi(const RoiRect &roi, RoiRect *applied);
+
+  // 单帧曝光并读出到 buffer，bufferSize 至少为 FrameBufferSize()。
+  // calibrate 为 false 时不做暗场 / 平场校正（拍摄校正帧本身），校正参数保持不变。
+  bool Capture(uint8_t *buffer, size_t bufferSize, FrameInfo *info, bool calibrate = true);
+
+  // 连续（Live）模式：BeginLive 切换到流模式 1 并开始连续曝光；
+  // GetLiveFrame 非阻塞，没有新帧时返回 false；StopLive 结束连续曝光。
+  // 停止后再调用 Capture 会自动切回单帧模式。
+  bool BeginLive();
+  bool GetLiveFrame(uint8_t *buffer, size_t bufferSize, FrameInfo *info);
+  void StopLive();
+
+  // 关闭相机并释放 SDK 资源，可重复调用。
+  void Close();
+
+  bool IsOpen() const { return handle_ != nullptr; }
+  bool IsLive() const { return liveRunning_; }
+  const char *CameraId() const { return cameraId_; }
+  // 传感器的 Bayer 阵列（SDK 的 BAYER_ID），黑白相机为 0
+  uint32_t SensorBayer() const { return bayer_; }
+  const SensorInfo &Sensor() const { return sensor_; }
+  const CaptureSettings &Settings() const { return settings_; }
+  const std::string &LastError() const { return lastError_; }
+
+  // 读出一帧所需的缓冲区大小（字节）。
+  size_t FrameBufferSize() const;
+
+  // 设置暗场 / 平场校正，之后每帧在软件 bin 之前于取帧线程中原地校正；nullptr 表示关闭。
+  // 只校正尺寸、ROI 起点与硬件 bin 都与主帧相同的 16bit 单通道帧。可在拍摄进行中调用，不等待曝光结束。
+  void SetCalibration(std::shared_ptr<const CalibrationSet> calibration);
+  std::shared_ptr<const CalibrationSet> Calibration() const;
+  // 设置校正之后最近的一帧是否因尺寸 / ROI / bin 与主帧不符而没有校正
+  bool CalibrationMismatch() const { return calibrationMismatch_.load(); }
+
+ private:
+  bool Fail(const char *what, uint32_t ret);
+  void ResetApplied();
+  bool ApplySettingsLocked();
+  bool SwitchStreamModeLocked(int mode);
+  // 把 ROI 与 bin 裁剪到传感器范围内（width / height 为 0 表示整个传感器），传感器尺寸未知且没有给出尺寸时返回 false
+  bool ClampRoiLocked(RoiRect *roi);
+  void StopLiveLocked();
+  void CloseLocked();
+  uint32_t FrameBayerLocked(uint32_t channels) const;
+  void FillCaptureParamsLocked(int64_t startUtcUs, FrameInfo *info);
+  void ApplyCalibrationLocked(uint8_t *buffer, FrameInfo *info);
+  void ApplySoftwareBinLocked(uint8_t *buffer, FrameInfo *info);
+  static void FillFrameInfo(uint32_t w, uint32_t h, uint32_t bpp, uint32_t channels,
+                            size_t bufferSize, FrameInfo *info);
+
+  // 串行化所有 SDK 调用：Live 线程取帧的同时 JS 线程可能在调整参数
+  std::mutex mutex_;
+
+  const QHYCCDFunctions *qhy_;
+  qhyccd_handle *handle_ = nullptr;
+  bool holdsResource_ = false;
+  char cameraId_[64] = {0};
+  uint32_t memLength_ = 0;
+  uint32_t bayer_ = 0;
+  SensorInfo sensor_;
+  // 传感器温度：变化缓慢，最多每秒向 SDK 查询一次
+  bool hasTemperature_ = false;
+  double temperature_ = NAN;
+  int64_t temperatureReadUs_ = 0;
+  int streamMode_ = -1;
+  bool liveRunning_ = false;
+  std::string lastError_;
+  // 软件 bin 的输出先写到这里再拷回帧缓冲区（输出比输入小，但并行时不能原地进行）
+  std::vector<uint16_t> binScratch_;
+  // 校正参数单独加锁：mutex_ 在整个曝光期间被持有，设置校正不应等待曝光结束
+  mutable std::mutex calibrationMutex_;
+  std::shared_ptr<const CalibrationSet> calibration_;
+  std::atomic<bool> calibrationMismatch_{false};
+
+  // 当前期望的参数，以及已经成功下发给 SDK 的参数
+  CaptureSettings settings_;
+  CaptureSettings applied_;
+};
+
+#endif // CAMERA_SESSION_H
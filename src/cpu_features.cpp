@@ -0,0 +1,78 @@
+#include "cpu_features.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef QHY_ARCH_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef QHY_ARCH_X86
+static void CpuId(int leaf, int subleaf, int regs[4]) {
+#ifdef _MSC_VER
+  __cpuidex(regs, leaf, subleaf);
+#else
+  unsigned a = 0, b = 0, c = 0, d = 0;
+  __cpuid_count(leaf, subleaf, a, b, c, d);
+  regs[0] = (int)a;
+  regs[1] = (int)b;
+  regs[2] = (int)c;
+  regs[3] = (int)d;
+#endif
+}
+
+// 操作系统是否保存 YMM 寄存器状态（XCR0 的 bit 1 / bit 2）
+static bool OsSupportsAvx() {
+#ifdef _MSC_VER
+  return (_xgetbv(0) & 0x6) == 0x6;
+#else
+  unsigned eax = 0, edx = 0;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (eax & 0x6) == 0x6;
+#endif
+}
+#endif
+
+static CpuFeatures Detect() {
+  CpuFeatures f;
+  const char *disable = std::getenv("QHY_DISABLE_SIMD");
+  if (disable && disable[0] && std::strcmp(disable, "0") != 0 && std::strcmp(disable, "avx2") != 0) {
+    return f;
+  }
+#ifdef QHY_ARCH_X86
+  int regs[4] = {0};
+  CpuId(0, 0, regs);
+  int maxLeaf = regs[0];
+  CpuId(1, 0, regs);
+  f.sse2 = (regs[3] & (1 << 26)) != 0;
+  bool osxsave = (regs[2] & (1 << 27)) != 0;
+  bool avx = (regs[2] & (1 << 28)) != 0;
+  if (maxLeaf >= 7 && osxsave && avx && OsSupportsAvx()) {
+    CpuId(7, 0, regs);
+    f.avx2 = (regs[1] & (1 << 5)) != 0 && !(disable && std::strcmp(disable, "avx2") == 0);
+  }
+#endif
+#ifdef QHY_ARCH_ARM64
+  // AArch64 上 NEON 是必选特性
+  f.neon = true;
+#endif
+  return f;
+}
+
+const CpuFeatures &GetCpuFeatures() {
+  static CpuFeatures features = Detect();
+  return features;
+}
+
+const char *SimdLevelName() {
+  const CpuFeatures &f = GetCpuFeatures();
+  if (f.avx2) return "avx2";
+  if (f.sse2) return "sse2";
+  if (f.neon) return "neon";
+  return "scalar";
+}
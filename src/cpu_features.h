@@ -0,0 +1,34 @@
+// 运行时 CPU 指令集检测，供图像内核选择 SSE2 / AVX2 / NEON 实现。
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define QHY_ARCH_X86 1
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define QHY_ARCH_ARM64 1
+#endif
+
+// GCC / Clang 需要为单个函数开启 AVX2 代码生成；MSVC 可直接使用 AVX2 intrinsics
+#if defined(QHY_ARCH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define QHY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define QHY_TARGET_AVX2
+#endif
+
+struct CpuFeatures {
+  bool sse2 = false;
+  bool avx2 = false;
+  bool neon = false;
+};
+
+// 检测一次并缓存结果。环境变量 QHY_DISABLE_SIMD=1 时全部视为不支持，=avx2 时只禁用 AVX2
+// （用于对比测试）。
+const CpuFeatures &GetCpuFeatures();
+
+// 当前选用的指令集名称，如 "avx2" / "sse2" / "neon" / "scalar"。
+const char *SimdLevelName();
+
+#endif // CPU_FEATURES_H
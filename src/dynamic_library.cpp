@@ -0,0 +1,128 @@
+#include "dynamic_library.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#ifdef _WIN32
+
+static std::wstring Utf8ToWide(const char *s) {
+  int len = MultiByteToWideChar(CP_UTF8, 0, s, -1, NULL, 0);
+  if (len <= 0) {
+    return std::wstring();
+  }
+  std::vector<wchar_t> buf(len);
+  MultiByteToWideChar(CP_UTF8, 0, s, -1, buf.data(), len);
+  return std::wstring(buf.data());
+}
+
+static std::string WideToUtf8(const wchar_t *s) {
+  int len = WideCharToMultiByte(CP_UTF8, 0, s, -1, NULL, 0, NULL, NULL);
+  if (len <= 0) {
+    return std::string();
+  }
+  std::vector<char> buf(len);
+  WideCharToMultiByte(CP_UTF8, 0, s, -1, buf.data(), len, NULL, NULL);
+  return std::string(buf.data());
+}
+
+static DWORD g_lastError = 0;
+
+void *OpenDynamicLibrary(const char *path) {
+  // 使用宽字符版本，支持中文等非 ASCII 路径
+  HMODULE module = LoadLibraryW(Utf8ToWide(path).c_str());
+  g_lastError = module ? 0 : GetLastError();
+  return module;
+}
+
+void *FindDynamicSymbol(void *library, const char *name) {
+  return reinterpret_cast<void *>(GetProcAddress(static_cast<HMODULE>(library), name));
+}
+
+void CloseDynamicLibrary(void *library) {
+  if (library) {
+    FreeLibrary(static_cast<HMODULE>(library));
+  }
+}
+
+std::string DynamicLibraryError() {
+  char msg[64];
+  snprintf(msg, sizeof(msg), "LoadLibrary error %lu", (unsigned long)g_lastError);
+  return msg;
+}
+
+std::string CurrentModuleDirectory() {
+  HMODULE module = NULL;
+  GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                     (LPCWSTR)&CurrentModuleDirectory, &module);
+  wchar_t path[MAX_PATH] = {0};
+  if (!module || GetModuleFileNameW(module, path, MAX_PATH) == 0) {
+    return std::string();
+  }
+  std::string utf8 = WideToUtf8(path);
+  size_t slash = utf8.find_last_of("\\/");
+  return slash == std::string::npos ? std::string() : utf8.substr(0, slash);
+}
+
+std::string GetEnvironmentUtf8(const char *name) {
+  const wchar_t *v = _wgetenv(Utf8ToWide(name).c_str());
+  return v ? WideToUtf8(v) : std::string();
+}
+
+std::string JoinPath(const std::string &dir, const char *name) {
+  return dir.empty() ? std::string(name) : dir + "\\" + name;
+}
+
+#else
+
+static std::string g_lastError;
+
+void *OpenDynamicLibrary(const char *path) {
+  void *library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!library) {
+    const char *err = dlerror();
+    g_lastError = err ? err : "dlopen failed";
+  }
+  return library;
+}
+
+void *FindDynamicSymbol(void *library, const char *name) {
+  return dlsym(library, name);
+}
+
+void CloseDynamicLibrary(void *library) {
+  if (library) {
+    dlclose(library);
+  }
+}
+
+std::string DynamicLibraryError() {
+  return g_lastError;
+}
+
+std::string CurrentModuleDirectory() {
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void *>(&CurrentModuleDirectory), &info) == 0 || !info.dli_fname) {
+    return std::string();
+  }
+  std::string path = info.dli_fname;
+  size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? std::string() : path.substr(0, slash);
+}
+
+std::string GetEnvironmentUtf8(const char *name) {
+  const char *v = std::getenv(name);
+  return v ? std::string(v) : std::string();
+}
+
+std::string JoinPath(const std::string &dir, const char *name) {
+  return dir.empty() ? std::string(name) : dir + "/" + name;
+}
+
+#endif
@@ -0,0 +1,29 @@
+// 跨平台的动态库加载：Windows 下为 LoadLibraryW / GetProcAddress，
+// 其它平台为 dlopen / dlsym。路径统一使用 UTF-8 编码。
+
+#ifndef DYNAMIC_LIBRARY_H
+#define DYNAMIC_LIBRARY_H
+
+#include <string>
+
+// 加载动态库，失败返回 nullptr，错误信息可通过 DynamicLibraryError() 获取。
+void *OpenDynamicLibrary(const char *path);
+
+// 查找导出符号，找不到时返回 nullptr。
+void *FindDynamicSymbol(void *library, const char *name);
+
+void CloseDynamicLibrary(void *library);
+
+// 最近一次加载失败的原因（GetLastError / dlerror）。
+std::string DynamicLibraryError();
+
+// 本模块（qhyccd_addon.node）所在目录，末尾不带分隔符；获取失败时返回空字符串。
+std::string CurrentModuleDirectory();
+
+// 读取环境变量（UTF-8），不存在时返回空字符串。
+std::string GetEnvironmentUtf8(const char *name);
+
+// 拼接路径，使用当前平台的分隔符。
+std::string JoinPath(const std::string &dir, const char *name);
+
+#endif // DYNAMIC_LIBRARY_H
@@ -0,0 +1,552 @@
+#include "fits_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "cpu_features.h"
+#include "frame_trace.h"
+#include "image_debayer.h"
+
+#ifdef QHY_ARCH_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef QHY_ARCH_ARM64
+#include <arm_neon.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace {
+
+// ---- 文件头 ----
+
+const size_t kCardLength = 80;
+
+// 一张卡片：关键字占 8 列，第 9、10 列为 "= "，值为定长格式（数值右对齐到第 30 列），之后是注释
+void AppendCard(std::string *header, const char *key, const std::string &value, const char *comment) {
+  char card[kCardLength + 1];
+  int n = std::snprintf(card, sizeof(card), "%-8.8s= %20s", key, value.c_str());
+  if (value.size() > 0 && value[0] == '\'') {
+    // 字符串值从第 11 列开始，左对齐
+    n = std::snprintf(card, sizeof(card), "%-8.8s= %-20s", key, value.c_str());
+  }
+  if (comment && comment[0] && n > 0 && (size_t)n < kCardLength - 3) {
+    std::snprintf(card + n, sizeof(card) - n, " / %s", comment);
+  }
+  std::string line(card);
+  line.resize(kCardLength, ' ');
+  header->append(line);
+}
+
+std::string FormatInt(int64_t value) {
+  char text[32];
+  std::snprintf(text, sizeof(text), "%lld", (long long)value);
+  return text;
+}
+
+// 实数必须带小数点或指数，否则部分读取程序会当作整数
+std::string FormatReal(double value) {
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.10G", value);
+  if (!std::strpbrk(text, ".E")) {
+    std::strncat(text, ".0", sizeof(text) - std::strlen(text) - 1);
+  }
+  return text;
+}
+
+// 单引号内的字符串，内部的单引号写两次，不足 8 个字符时补空格
+std::string FormatString(const char *value) {
+  std::string text = "'";
+  for (const char *p = value; *p && text.size() < 68; p++) {
+    if (*p == '\'') {
+      text += '\'';
+    }
+    text += (*p >= 0x20 && *p < 0x7f) ? *p : '_';
+  }
+  while (text.size() < 9) {
+    text += ' ';
+  }
+  return text + "'";
+}
+
+std::string FormatUtc(int64_t utcMs) {
+  std::time_t seconds = (std::time_t)(utcMs / 1000);
+  std::tm tm;
+#ifdef _WIN32
+  gmtime_s(&tm, &seconds);
+#else
+  gmtime_r(&seconds, &tm);
+#endif
+  char text[40];
+  std::snprintf(text, sizeof(text), "%04d-%02d-%02dT%02d:%02d:%02d.%03d", tm.tm_year + 1900, tm.tm_mon + 1,
+                tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(utcMs % 1000));
+  return FormatString(text);
+}
+
+// ---- 字节交换：FITS 的 16bit 数据为大端有符号整数，无符号像素按 BZERO = 32768 存为 v - 32768 ----
+
+#ifdef QHY_ARCH_X86
+
+void SwapToFits16Sse2(const uint16_t *src, uint8_t *dst, size_t count) {
+  const __m128i bias = _mm_set1_epi16((short)0x8000);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), bias);
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i), v);
+  }
+  SwapToFits16Scalar(src + i, dst + 2 * i, count - i);
+}
+
+QHY_TARGET_AVX2
+void SwapToFits16Avx2(const uint16_t *src, uint8_t *dst, size_t count) {
+  const __m256i bias = _mm256_set1_epi16((short)0x8000);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)), bias);
+    v = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 2 * i), v);
+  }
+  SwapToFits16Scalar(src + i, dst + 2 * i, count - i);
+}
+
+#endif // QHY_ARCH_X86
+
+#ifdef QHY_ARCH_ARM64
+
+void SwapToFits16Neon(const uint16_t *src, uint8_t *dst, size_t count) {
+  const uint16x8_t bias = vdupq_n_u16(0x8000);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint16x8_t v = veorq_u16(vld1q_u16(src + i), bias);
+    vst1q_u8(dst + 2 * i, vrev16q_u8(vreinterpretq_u8_u16(v)));
+  }
+  SwapToFits16Scalar(src + i, dst + 2 * i, count - i);
+}
+
+#endif // QHY_ARCH_ARM64
+
+typedef void (*SwapFn)(const uint16_t *, uint8_t *, size_t);
+
+SwapFn SelectSwapKernel() {
+  const CpuFeatures &cpu = GetCpuFeatures();
+#ifdef QHY_ARCH_X86
+  if (cpu.avx2) return SwapToFits16Avx2;
+  if (cpu.sse2) return SwapToFits16Sse2;
+#endif
+#ifdef QHY_ARCH_ARM64
+  if (cpu.neon) return SwapToFits16Neon;
+#endif
+  (void)cpu;
+  return SwapToFits16Scalar;
+}
+
+// ---- 写文件 ----
+
+#ifdef _WIN32
+std::FILE *OpenForWrite(const char *path) {
+  // 宽字符版本，支持中文等非 ASCII 路径
+  int len = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+  if (len <= 0) {
+    return NULL;
+  }
+  std::vector<wchar_t> wide(len);
+  MultiByteToWideChar(CP_UTF8, 0, path, -1, wide.data(), len);
+  return _wfopen(wide.data(), L"wb");
+}
+
+void RemoveFile(const char *path) {
+  int len = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+  if (len > 0) {
+    std::vector<wchar_t> wide(len);
+    MultiByteToWideChar(CP_UTF8, 0, path, -1, wide.data(), len);
+    _wremove(wide.data());
+  }
+}
+#else
+std::FILE *OpenForWrite(const char *path) {
+  return std::fopen(path, "wb");
+}
+
+void RemoveFile(const char *path) {
+  std::remove(path);
+}
+#endif
+
+size_t FitsBytesPerPixel(const FrameInfo &frame) {
+  return frame.bpp > 8 ? 2 : 1;
+}
+
+bool IsSupportedFrame(const FrameInfo &frame) {
+  return frame.width > 0 && frame.height > 0 && frame.bpp > 0 && frame.bpp <= 16 && frame.channels <= 1 &&
+         frame.bytes >= (size_t)frame.width * frame.height * FitsBytesPerPixel(frame);
+}
+
+// 文件头、像素与末尾的补零都先填入 chunk（chunkSize 字节），填满后一次写出。
+// 文件头是 2880 字节的整数倍（也是 64 的整数倍），之后的像素在 chunk 中保持对齐。
+bool WriteFits(const char *path, const FrameInfo &frame, const uint8_t *data, const char *camera,
+               uint8_t *chunk, size_t chunkSize, std::string *error) {
+  static const SwapFn swap = SelectSwapKernel();
+  if (!IsSupportedFrame(frame)) {
+    *error = "Unsupported frame format for FITS";
+    return false;
+  }
+  std::FILE *file = OpenForWrite(path);
+  if (!file) {
+    *error = std::string("Failed to create ") + path;
+    return false;
+  }
+  // 已经按块缓冲，关闭 stdio 的缓冲避免再拷贝一次
+  std::setvbuf(file, NULL, _IONBF, 0);
+
+  bool ok = true;
+  size_t fill = 0;
+  auto flush = [&]() {
+    if (ok && fill > 0 && std::fwrite(chunk, 1, fill, file) != fill) {
+      ok = false;
+    }
+    fill = 0;
+  };
+
+  const std::string header = BuildFitsHeader(frame, camera);
+  for (size_t pos = 0; pos < header.size();) {
+    size_t n = std::min(header.size() - pos, chunkSize - fill);
+    std::memcpy(chunk + fill, header.data() + pos, n);
+    fill += n;
+    pos += n;
+    if (fill == chunkSize) {
+      flush();
+    }
+  }
+
+  const size_t pixelCount = (size_t)frame.width * frame.height;
+  const size_t bytesPerPixel = FitsBytesPerPixel(frame);
+  const size_t chunkPixels = chunkSize / bytesPerPixel;
+  for (size_t pos = 0; pos < pixelCount && ok;) {
+    size_t n = std::min(pixelCount - pos, chunkPixels - fill / bytesPerPixel);
+    if (bytesPerPixel == 2) {
+      swap(reinterpret_cast<const uint16_t *>(data) + pos, chunk + fill, n);
+    } else {
+      std::memcpy(chunk + fill, data + pos, n);
+    }
+    fill += n * bytesPerPixel;
+    pos += n;
+    if (fill + bytesPerPixel > chunkSize) {
+      flush();
+    }
+  }
+
+  // 数据区补零到 2880 字节的整数倍
+  const size_t dataBytes = pixelCount * bytesPerPixel;
+  size_t padding = (kFitsBlockSize - dataBytes % kFitsBlockSize) % kFitsBlockSize;
+  while (padding > 0 && ok) {
+    size_t n = std::min(padding, chunkSize - fill);
+    std::memset(chunk + fill, 0, n);
+    fill += n;
+    padding -= n;
+    if (fill == chunkSize) {
+      flush();
+    }
+  }
+  flush();
+
+  if (std::fclose(file) != 0) {
+    ok = false;
+  }
+  if (!ok) {
+    RemoveFile(path);
+    *error = std::string("Failed to write ") + path;
+  }
+  return ok;
+}
+
+}  // namespace
+
+std::string BuildFitsHeader(const FrameInfo &frame, const char *camera) {
+  std::string header;
+  const bool wide = frame.bpp > 8;
+  AppendCard(&header, "SIMPLE", "T", "conforms to FITS standard");
+  AppendCard(&header, "BITPIX", FormatInt(wide ? 16 : 8), "array data type");
+  AppendCard(&header, "NAXIS", "2", "number of array dimensions");
+  AppendCard(&header, "NAXIS1", FormatInt(frame.width), NULL);
+  AppendCard(&header, "NAXIS2", FormatInt(frame.height), NULL);
+  if (wide) {
+    AppendCard(&header, "BZERO", "32768", "offset data range to that of unsigned short");
+    AppendCard(&header, "BSCALE", "1", "default scaling factor");
+  }
+  if (frame.startUtcUs > 0) {
+    AppendCard(&header, "DATE-OBS", FormatUtc(frame.startUtcUs / 1000), "UTC start of exposure");
+  }
+  AppendCard(&header, "EXPTIME", FormatReal(frame.exposureUs / 1e6), "[s] exposure time");
+  if (frame.gain >= 0.0) {
+    AppendCard(&header, "GAIN", FormatReal(frame.gain), "sensor gain setting");
+  }
+  if (frame.offset >= 0.0) {
+    AppendCard(&header, "OFFSET", FormatReal(frame.offset), "sensor offset setting");
+  }
+  AppendCard(&header, "XBINNING", FormatInt((int64_t)frame.binX * frame.softwareBin),
+             "hardware x software binning");
+  AppendCard(&header, "YBINNING", FormatInt((int64_t)frame.binY * frame.softwareBin),
+             "hardware x software binning");
+  if (frame.softwareBin > 1) {
+    AppendCard(&header, "SWBIN", FormatInt(frame.softwareBin), "software binning factor");
+  }
+  if (frame.calibration != 0) {
+    // MaxIm DL 等软件的约定：D 为已减暗场，F 为已除平场
+    std::string calstat = std::string(frame.calibration & CALIBRATED_DARK ? "D" : "") +
+                          (frame.calibration & CALIBRATED_FLAT ? "F" : "");
+    AppendCard(&header, "CALSTAT", FormatString(calstat.c_str()), "calibration applied on capture");
+  }
+  AppendCard(&header, "XORGSUBF", FormatInt(frame.roiX), "subframe origin (binned pixels)");
+  AppendCard(&header, "YORGSUBF", FormatInt(frame.roiY), "subframe origin (binned pixels)");
+  if (!std::isnan(frame.temperature)) {
+    AppendCard(&header, "CCD-TEMP", FormatReal(std::round(frame.temperature * 100.0) / 100.0),
+               "[C] sensor temperature");
+  }
+  const char *bayer = BayerPatternName((BayerPattern)frame.bayer);
+  if (bayer) {
+    // 阵列已按 ROI 起点平移，偏移总是 0
+    AppendCard(&header, "BAYERPAT", FormatString(bayer), "color filter array pattern");
+    AppendCard(&header, "XBAYROFF", "0", NULL);
+    AppendCard(&header, "YBAYROFF", "0", NULL);
+  }
+  if (camera && camera[0]) {
+    AppendCard(&header, "INSTRUME", FormatString(camera), "camera ID");
+  }
+  AppendCard(&header, "SWCREATE", FormatString("webEZCAP"), NULL);
+
+  std::string end("END");
+  end.resize(kCardLength, ' ');
+  header.append(end);
+  header.resize((header.size() + kFitsBlockSize - 1) / kFitsBlockSize * kFitsBlockSize, ' ');
+  return header;
+}
+
+void SwapToFits16(const uint16_t *src, uint8_t *dst, size_t count) {
+  static const SwapFn kernel = SelectSwapKernel();
+  kernel(src, dst, count);
+}
+
+void SwapToFits16Scalar(const uint16_t *src, uint8_t *dst, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    uint16_t v = (uint16_t)(src[i] ^ 0x8000u);
+    dst[2 * i] = (uint8_t)(v >> 8);
+    dst[2 * i + 1] = (uint8_t)(v & 0xff);
+  }
+}
+
+bool WriteFitsFile(const char *path, const FrameInfo &frame, const uint8_t *data, const char *camera,
+                   std::string *error) {
+  std::vector<uint8_t> chunk(kFitsWriteChunk);
+  std::string message;
+  bool ok = WriteFits(path, frame, data, camera, chunk.data(), chunk.size(), &message);
+  if (!ok && error) {
+    *error = message;
+  }
+  return ok;
+}
+
+// ---- FitsWriter ----
+
+FitsWriter::FitsWriter(size_t maxQueue) : maxQueue_(std::max<size_t>(maxQueue, 1)) {
+  thread_ = std::thread(&FitsWriter::Run, this);
+}
+
+FitsWriter::~FitsWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recording_ = false;
+    stopping_ = true;
+  }
+  jobReady_.notify_all();
+  jobDone_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void FitsWriter::Start(const std::string &directory, const std::string &prefix, const std::string &camera,
+                       size_t maxQueue) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  directory_ = directory;
+  prefix_ = prefix;
+  camera_ = camera;
+  sequence_ = 0;
+  if (maxQueue > 0) {
+    maxQueue_ = maxQueue;
+  }
+  lastError_.clear();
+  recording_ = true;
+}
+
+void FitsWriter::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recording_ = false;
+  }
+  // 唤醒因队列已满而等待的入队方，它们会放弃这一帧
+  jobDone_.notify_all();
+}
+
+bool FitsWriter::IsRecording() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return recording_;
+}
+
+bool FitsWriter::Enqueue(const FrameInfo &frame, const uint8_t *data) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!recording_ || !IsSupportedFrame(frame)) {
+    return false;
+  }
+  if (inFlight_ >= maxQueue_) {
+    waits_++;
+    const int64_t waitStart = TraceNowUs();
+    jobDone_.wait(lock, [this] { return inFlight_ < maxQueue_ || !recording_ || stopping_; });
+    RecordTrace("native.fits-queue-wait", frame.frameId, waitStart, TraceNowUs());
+    if (!recording_ || stopping_) {
+      return false;
+    }
+  }
+
+  const size_t bytes = (size_t)frame.width * frame.height * FitsBytesPerPixel(frame);
+  buffers_.SetMaxSlots(maxQueue_);
+  FrameLease pixels;
+  if (buffers_.Reserve(bytes, 1)) {
+    pixels = buffers_.Acquire();
+  }
+  if (!pixels) {
+    failed_++;
+    lastError_ = "Failed to allocate FITS queue buffer";
+    return false;
+  }
+
+  char name[32];
+  std::snprintf(name, sizeof(name), "_%05llu.fits", (unsigned long long)++sequence_);
+  Job job;
+  job.path = directory_;
+  if (!job.path.empty() && job.path.back() != '/' && job.path.back() != '\\') {
+    job.path += '/';
+  }
+  job.path += prefix_ + name;
+  job.camera = camera_;
+  job.frame = frame;
+  job.frame.bytes = bytes;
+  job.pixels = pixels;
+  inFlight_++;
+  queuedBytes_ += bytes;
+  lock.unlock();
+
+  // 在入队方线程中只做一次内存拷贝，格式转换与写盘都留给 I/O 线程
+  {
+    TraceScope trace("native.fits-enqueue", frame.frameId);
+    std::memcpy(pixels->data, data, bytes);
+  }
+
+  lock.lock();
+  queue_.push_back(std::move(job));
+  lock.unlock();
+  jobReady_.notify_one();
+  return true;
+}
+
+void FitsWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  jobDone_.wait(lock, [this] { return inFlight_ == 0; });
+}
+
+FitsWriterStats FitsWriter::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FitsWriterStats stats;
+  stats.recording = recording_;
+  stats.queued = inFlight_;
+  stats.maxQueue = maxQueue_;
+  stats.queuedBytes = queuedBytes_;
+  stats.written = written_;
+  stats.failed = failed_;
+  stats.waits = waits_;
+  stats.bytesWritten = bytesWritten_;
+  // 超过 2 秒没有写盘时速率视为 0
+  stats.bytesPerSec = TraceNowUs() - lastWriteUs_ > 2000000 ? 0.0 : bytesPerSec_;
+  stats.lastPath = lastPath_;
+  stats.lastError = lastError_;
+  return stats;
+}
+
+void FitsWriter::UpdateRateLocked(size_t bytes, int64_t nowUs) {
+  if (rateStartUs_ == 0 || nowUs - lastWriteUs_ > 2000000) {
+    // 空闲一段时间后重新开始计时窗口
+    rateStartUs_ = nowUs;
+    rateBytes_ = 0;
+  }
+  rateBytes_ += bytes;
+  lastWriteUs_ = nowUs;
+  const int64_t elapsed = nowUs - rateStartUs_;
+  if (elapsed >= 1000000) {
+    bytesPerSec_ = (double)rateBytes_ * 1e6 / (double)elapsed;
+    rateStartUs_ = nowUs;
+    rateBytes_ = 0;
+  } else if (bytesPerSec_ == 0.0 && elapsed > 0) {
+    bytesPerSec_ = (double)rateBytes_ * 1e6 / (double)elapsed;
+  }
+}
+
+void FitsWriter::Run() {
+  AlignedFrameAllocator allocator;
+  void *userData = nullptr;
+  uint8_t *chunk = allocator.Allocate(kFitsWriteChunk, &userData);
+
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      jobReady_.wait(lock, [this] { return !queue_.empty() || stopping_; });
+      if (queue_.empty()) {
+        break;
+      }
+      job = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    std::string error;
+    bool ok = false;
+    const int64_t start = TraceNowUs();
+    if (chunk) {
+      ok = WriteFits(job.path.c_str(), job.frame, job.pixels->data, job.camera.c_str(), chunk,
+                     kFitsWriteChunk, &error);
+    } else {
+      error = "Failed to allocate FITS write buffer";
+    }
+    const int64_t end = TraceNowUs();
+    RecordTrace("native.fits-write", job.frame.frameId, start, end);
+    const size_t bytes = job.frame.bytes;
+    job.pixels.reset();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      inFlight_--;
+      queuedBytes_ -= bytes;
+      if (ok) {
+        written_++;
+        bytesWritten_ += bytes;
+        UpdateRateLocked(bytes, end);
+        lastPath_ = job.path;
+      } else {
+        failed_++;
+        lastError_ = error;
+      }
+    }
+    jobDone_.notify_all();
+  }
+
+  if (chunk) {
+    allocator.Free(chunk, userData);
+  }
+}
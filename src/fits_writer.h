@@ -0,0 +1,122 @@
+// FITS 写盘：把帧保存为 FITS（单 HDU，BITPIX 8 / 16），文件头取自拍摄参数
+// （曝光、增益、偏置、ROI、bin、温度、拍摄时刻、Bayer 阵列）。
+//
+// FitsWriter 在独立的 I/O 线程中写盘，前面是一个有界队列：Enqueue 只把像素拷贝进写盘器自己的
+// 缓冲池（不占用相机的帧缓冲池）后立即返回，只有队列已满时才等待 I/O 线程腾出位置。
+// I/O 线程把像素按块转换为 FITS 要求的大端有符号格式（16bit 减 32768，BZERO = 32768，
+// 用 SSE2 / AVX2 / NEON 完成字节交换）后写出，每次写入 kFitsWriteChunk 字节的对齐块。
+// 本文件不包含任何 N-API 代码。
+
+#ifndef FITS_WRITER_H
+#define FITS_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "camera_session.h"
+#include "frame_pool.h"
+
+static const size_t kFitsBlockSize = 2880;
+// 每次 fwrite 的字节数：文件内偏移始终是 4 KiB 的整数倍
+static const size_t kFitsWriteChunk = 1 << 20;
+static const size_t kFitsDefaultQueue = 8;
+
+// 生成主 HDU 的文件头（80 字符的卡片，以 END 结束并补齐到 kFitsBlockSize 的整数倍）。
+// camera 为相机 ID（写入 INSTRUME），可以为空。
+std::string BuildFitsHeader(const FrameInfo &frame, const char *camera);
+
+// 16bit 无符号像素转为 FITS 的大端有符号格式（v ^ 0x8000 后交换字节），dst 为 count * 2 字节。
+void SwapToFits16(const uint16_t *src, uint8_t *dst, size_t count);
+// 标量参考实现，用于校验与基准对比。
+void SwapToFits16Scalar(const uint16_t *src, uint8_t *dst, size_t count);
+
+// 同步写出一个 FITS 文件（只支持单通道、bpp <= 16）。失败时删除不完整的文件，error 返回原因。
+bool WriteFitsFile(const char *path, const FrameInfo &frame, const uint8_t *data, const char *camera,
+                   std::string *error);
+
+struct FitsWriterStats {
+  bool recording = false;
+  size_t queued = 0;        // 已入队但尚未写完的帧数（含正在写的一帧）
+  size_t maxQueue = 0;
+  size_t queuedBytes = 0;
+  uint64_t written = 0;     // 写完的文件数
+  uint64_t failed = 0;
+  uint64_t waits = 0;       // 队列已满、入队方不得不等待的次数
+  uint64_t bytesWritten = 0;
+  double bytesPerSec = 0.0; // 最近约 1 秒的写盘速率
+  std::string lastPath;
+  std::string lastError;
+};
+
+class FitsWriter {
+ public:
+  explicit FitsWriter(size_t maxQueue = kFitsDefaultQueue);
+  // 写完队列中剩余的帧后结束 I/O 线程
+  ~FitsWriter();
+
+  FitsWriter(const FitsWriter &) = delete;
+  FitsWriter &operator=(const FitsWriter &) = delete;
+
+  // 开始录制：之后 Enqueue 的帧保存为 directory/prefix_00001.fits、prefix_00002.fits ...
+  // maxQueue 为 0 时保持原值。
+  void Start(const std::string &directory, const std::string &prefix, const std::string &camera,
+             size_t maxQueue = 0);
+  // 停止录制，已入队的帧仍会写完（不等待）
+  void Stop();
+  bool IsRecording() const;
+
+  // 录制中时把一帧加入写盘队列，可在任意线程中调用。队列已满时阻塞到有空位。
+  // 返回 false 表示未在录制或该帧格式不支持。
+  bool Enqueue(const FrameInfo &frame, const uint8_t *data);
+
+  // 等待队列清空（写完所有已入队的帧）
+  void Flush();
+
+  FitsWriterStats Stats() const;
+
+ private:
+  struct Job {
+    std::string path;
+    std::string camera;
+    FrameInfo frame;
+    FrameLease pixels;
+  };
+
+  void Run();
+  void UpdateRateLocked(size_t bytes, int64_t nowUs);
+
+  mutable std::mutex mutex_;
+  std::condition_variable jobReady_;   // I/O 线程等待新任务
+  std::condition_variable jobDone_;    // 入队方等待空位 / Flush 等待清空
+  std::deque<Job> queue_;
+  size_t inFlight_ = 0;                // 已接受但尚未写完的帧（拷贝中、排队中与正在写的）
+  bool stopping_ = false;
+  std::thread thread_;
+  FramePool buffers_;
+
+  bool recording_ = false;
+  std::string directory_;
+  std::string prefix_;
+  std::string camera_;
+  uint64_t sequence_ = 0;
+  size_t maxQueue_;
+
+  size_t queuedBytes_ = 0;
+  uint64_t written_ = 0;
+  uint64_t failed_ = 0;
+  uint64_t waits_ = 0;
+  uint64_t bytesWritten_ = 0;
+  int64_t rateStartUs_ = 0;
+  uint64_t rateBytes_ = 0;
+  double bytesPerSec_ = 0.0;
+  int64_t lastWriteUs_ = 0;
+  std::string lastPath_;
+  std::string lastError_;
+};
+
+#endif // FITS_WRITER_H
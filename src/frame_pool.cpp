@@ -0,0 +1,172 @@
+#include "frame_pool.h"
+
+#include <cstdlib>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+uint8_t *AlignedFrameAllocator::Allocate(size_t size, void **userData) {
+  *userData = nullptr;
+  // 大小向上取整到对齐粒度，便于 SIMD 处理尾部
+  size_t rounded = (size + kFrameBufferAlignment - 1) & ~(kFrameBufferAlignment - 1);
+#ifdef _WIN32
+  return (uint8_t *)_aligned_malloc(rounded, kFrameBufferAlignment);
+#else
+  void *p = nullptr;
+  if (posix_memalign(&p, kFrameBufferAlignment, rounded) != 0) {
+    return nullptr;
+  }
+  return (uint8_t *)p;
+#endif
+}
+
+void AlignedFrameAllocator::Free(uint8_t *data, void *userData) {
+  (void)userData;
+#ifdef _WIN32
+  _aligned_free(data);
+#else
+  free(data);
+#endif
+}
+
+struct FramePool::State {
+  std::mutex mutex;
+  std::shared_ptr<FrameAllocator> allocator;
+  size_t slotSize = 0;
+  uint64_t generation = 1;
+  size_t slotCount = 0;  // 当前代的缓冲区总数（含使用中的）
+  size_t maxSlots = 8;
+  bool alive = true;
+  std::vector<FrameSlot *> freeSlots;
+
+  void FreeSlot(FrameSlot *slot) {
+    allocator->Free(slot->data, slot->userData);
+    delete slot;
+  }
+
+  FrameSlot *AllocateSlot() {
+    FrameSlot *slot = new FrameSlot();
+    slot->data = allocator->Allocate(slotSize, &slot->userData);
+    if (slot->data == nullptr) {
+      delete slot;
+      return nullptr;
+    }
+    slot->capacity = slotSize;
+    slot->generation = generation;
+    return slot;
+  }
+
+  void ReleaseIdle() {
+    for (FrameSlot *slot : freeSlots) {
+      FreeSlot(slot);
+    }
+    freeSlots.clear();
+  }
+};
+
+FramePool::FramePool(std::shared_ptr<FrameAllocator> allocator) : state_(std::make_shared<State>()) {
+  state_->allocator = allocator ? allocator : std::make_shared<AlignedFrameAllocator>();
+}
+
+FramePool::~FramePool() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->alive = false;
+  state_->ReleaseIdle();
+}
+
+FrameLease FramePool::MakeLease(const std::shared_ptr<State> &state, FrameSlot *slot) {
+  // 删除器持有 State，保证租约晚于池销毁时仍能正确释放
+  return FrameLease(slot, [state](FrameSlot *s) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->alive && s->generation == state->generation) {
+      state->freeSlots.push_back(s);
+    } else {
+      state->FreeSlot(s);
+    }
+  });
+}
+
+bool FramePool::Reserve(size_t slotSize, size_t count) {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  if (slotSize != state_->slotSize) {
+    state_->ReleaseIdle();
+    state_->generation++;
+    state_->slotSize = slotSize;
+    state_->slotCount = 0;
+  }
+  if (count > state_->maxSlots) {
+    state_->maxSlots = count;
+  }
+  while (state_->slotCount < count) {
+    FrameSlot *slot = state_->AllocateSlot();
+    if (slot == nullptr) {
+      return false;
+    }
+    state_->freeSlots.push_back(slot);
+    state_->slotCount++;
+  }
+  return true;
+}
+
+FrameLease FramePool::Acquire() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  FrameSlot *slot = nullptr;
+  if (!state_->freeSlots.empty()) {
+    slot = state_->freeSlots.back();
+    state_->freeSlots.pop_back();
+  } else if (state_->slotSize > 0 && state_->slotCount < state_->maxSlots) {
+    slot = state_->AllocateSlot();
+    if (slot != nullptr) {
+      state_->slotCount++;
+    }
+  }
+  return slot ? MakeLease(state_, slot) : FrameLease();
+}
+
+FrameLease FramePool::TryAcquire() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  if (state_->freeSlots.empty()) {
+    return FrameLease();
+  }
+  FrameSlot *slot = state_->freeSlots.back();
+  state_->freeSlots.pop_back();
+  return MakeLease(state_, slot);
+}
+
+void FramePool::Orphan(const FrameLease &lease) {
+  if (!lease) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  if (lease->generation == state_->generation) {
+    lease->generation = 0;
+    state_->slotCount--;
+  }
+}
+
+void FramePool::Clear() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->ReleaseIdle();
+  state_->generation++;
+  state_->slotCount = 0;
+}
+
+void FramePool::SetMaxSlots(size_t maxSlots) {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->maxSlots = maxSlots;
+}
+
+size_t FramePool::SlotSize() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->slotSize;
+}
+
+size_t FramePool::SlotCount() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->slotCount;
+}
+
+size_t FramePool::FreeCount() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->freeSlots.size();
+}
@@ -0,0 +1,79 @@
+// 帧缓冲池：按 GetQHYCCDMemLength 的大小一次性申请若干块 64 字节对齐的缓冲区，
+// SDK 直接读出到池中的缓冲区，帧被所有使用者释放后自动回收，稳态下不再有逐帧的堆分配。
+//
+// 使用者通过 FrameLease（shared_ptr）持有缓冲区：JS 帧对象、写盘队列等都可以各自持有
+// 一份，最后一个持有者释放时缓冲区回到空闲列表。池本身先于租约销毁也是安全的。
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static const size_t kFrameBufferAlignment = 64;
+
+struct FrameSlot {
+  uint8_t *data = nullptr;
+  size_t capacity = 0;
+  void *userData = nullptr;  // 分配器私有数据
+  uint64_t generation = 0;   // 申请时池的代数，池尺寸变化后旧代缓冲区在归还时释放
+};
+
+typedef std::shared_ptr<FrameSlot> FrameLease;
+
+// 缓冲区分配器，可替换为其它内存来源（默认为 64 字节对齐的堆内存）。
+// Allocate 只会在调用 Reserve / Acquire 的线程中执行；Free 可能在任意线程中执行。
+class FrameAllocator {
+ public:
+  virtual ~FrameAllocator() {}
+  virtual uint8_t *Allocate(size_t size, void **userData) = 0;
+  virtual void Free(uint8_t *data, void *userData) = 0;
+};
+
+class AlignedFrameAllocator : public FrameAllocator {
+ public:
+  uint8_t *Allocate(size_t size, void **userData) override;
+  void Free(uint8_t *data, void *userData) override;
+};
+
+class FramePool {
+ public:
+  explicit FramePool(std::shared_ptr<FrameAllocator> allocator = nullptr);
+  ~FramePool();
+
+  FramePool(const FramePool &) = delete;
+  FramePool &operator=(const FramePool &) = delete;
+
+  // 确保池中至少有 count 块 slotSize 字节的缓冲区。slotSize 变化时丢弃旧缓冲区
+  // （正在使用的旧缓冲区在归还时释放），返回 false 表示分配失败。
+  bool Reserve(size_t slotSize, size_t count);
+
+  // 取一块空闲缓冲区；没有空闲时在 maxSlots 范围内扩容。失败返回空指针。
+  FrameLease Acquire();
+
+  // 只取现有的空闲缓冲区，从不分配，适合在采集线程中调用。
+  FrameLease TryAcquire();
+
+  // 让一块正在使用的缓冲区脱离池：它不再被复用，归还时直接交给分配器释放，
+  // 同时腾出一个名额供池重新分配。用于使用者迟迟不归还缓冲区的情况。
+  void Orphan(const FrameLease &lease);
+
+  // 释放所有空闲缓冲区（正在使用的在归还时释放）。
+  void Clear();
+
+  void SetMaxSlots(size_t maxSlots);
+  size_t SlotSize() const;
+  size_t SlotCount() const;
+  size_t FreeCount() const;
+
+ private:
+  struct State;
+  static FrameLease MakeLease(const std::shared_ptr<State> &state, FrameSlot *slot);
+
+  std::shared_ptr<State> state_;
+};
+
+#endif // FRAME_POOL_H
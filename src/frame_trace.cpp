@@ -0,0 +1,89 @@
+#include "frame_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const Clock::time_point g_epoch = Clock::now();
+std::atomic<uint64_t> g_nextFrameId{1};
+std::atomic<uint32_t> g_nextThreadId{1};
+std::atomic<bool> g_enabled{true};
+
+// 环形缓冲区：next 为下一个写入位置，size 为有效事件数
+std::mutex g_mutex;
+std::vector<TraceEvent> g_events;
+size_t g_next = 0;
+size_t g_size = 0;
+
+}  // namespace
+
+int64_t TraceNowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - g_epoch).count();
+}
+
+uint64_t NextTraceFrameId() {
+  return g_nextFrameId.fetch_add(1);
+}
+
+uint32_t TraceThreadId() {
+  thread_local uint32_t id = g_nextThreadId.fetch_add(1);
+  return id;
+}
+
+void SetTraceEnabled(bool enabled) {
+  g_enabled = enabled;
+}
+
+bool TraceEnabled() {
+  return g_enabled.load();
+}
+
+void RecordTrace(const char *name, uint64_t frameId, int64_t startUs, int64_t endUs, uint32_t thread) {
+  if (!g_enabled.load()) {
+    return;
+  }
+  if (thread == 0) {
+    thread = TraceThreadId();
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if (g_events.empty()) {
+    g_events.resize(kTraceCapacity);
+  }
+  TraceEvent &event = g_events[g_next];
+  event.name = name;
+  event.frameId = frameId;
+  event.thread = thread;
+  event.startUs = startUs;
+  event.durationUs = endUs > startUs ? endUs - startUs : 0;
+  g_next = (g_next + 1) % kTraceCapacity;
+  if (g_size < kTraceCapacity) {
+    g_size++;
+  }
+}
+
+std::vector<TraceEvent> CollectTraces(uint64_t frameId, bool clear) {
+  std::vector<TraceEvent> result;
+  std::lock_guard<std::mutex> lock(g_mutex);
+  size_t first = (g_next + kTraceCapacity - g_size) % kTraceCapacity;
+  for (size_t i = 0; i < g_size; i++) {
+    const TraceEvent &event = g_events[(first + i) % kTraceCapacity];
+    if (frameId == 0 || event.frameId == frameId) {
+      result.push_back(event);
+    }
+  }
+  if (clear) {
+    g_next = 0;
+    g_size = 0;
+  }
+  return result;
+}
+
+void ClearTraces() {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_next = 0;
+  g_size = 0;
+}
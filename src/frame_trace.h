@@ -0,0 +1,61 @@
+// 帧流水线计时：记录每一帧在各阶段（SDK 初始化、曝光、读出、统计、预览图、IPC、拉伸、纹理上传等）
+// 的起止时间，按帧 ID 归类，可导出为 Chrome trace-event JSON（about:tracing / Perfetto）。
+//
+// 事件保存在进程内的环形缓冲区中（最多 kTraceCapacity 条，满后覆盖最旧的事件），
+// 所有函数都是线程安全的。时间为单调时钟自进程启动以来的微秒数。
+
+#ifndef FRAME_TRACE_H
+#define FRAME_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const size_t kTraceCapacity = 16384;
+
+struct TraceEvent {
+  std::string name;
+  uint64_t frameId = 0;  // 0 表示不属于某一帧（如打开相机）
+  uint32_t thread = 0;   // TraceThreadId()，或由 JS 指定
+  int64_t startUs = 0;
+  int64_t durationUs = 0;
+};
+
+// 当前时间（微秒）。
+int64_t TraceNowUs();
+
+// 分配一个新的帧 ID（从 1 开始递增），在取到一帧时调用。
+uint64_t NextTraceFrameId();
+
+// 当前线程的编号（首次调用时按顺序分配，从 1 开始），用于区分各线程的事件。
+uint32_t TraceThreadId();
+
+// 关闭后 RecordTrace 直接返回，默认开启。
+void SetTraceEnabled(bool enabled);
+bool TraceEnabled();
+
+// 记录一个阶段 [startUs, endUs)，thread 为 0 时使用当前线程编号。
+void RecordTrace(const char *name, uint64_t frameId, int64_t startUs, int64_t endUs, uint32_t thread = 0);
+
+// 按记录（阶段结束）的顺序取出缓冲区中的事件；frameId 不为 0 时只取该帧的事件。clear 为 true 时取出后清空。
+std::vector<TraceEvent> CollectTraces(uint64_t frameId, bool clear);
+
+void ClearTraces();
+
+// 在作用域结束时记录从构造到析构的阶段。
+class TraceScope {
+ public:
+  TraceScope(const char *name, uint64_t frameId) : name_(name), frameId_(frameId), start_(TraceNowUs()) {}
+  ~TraceScope() { RecordTrace(name_, frameId_, start_, TraceNowUs()); }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+ private:
+  const char *name_;
+  uint64_t frameId_;
+  int64_t start_;
+};
+
+#endif // FRAME_TRACE_H
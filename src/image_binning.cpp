@@ -0,0 +1,230 @@
+#include "image_binning.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "cpu_features.h"
+#include "parallel.h"
+
+#ifdef QHY_ARCH_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef QHY_ARCH_ARM64
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// 每个线程块至少处理的输出行数
+const size_t kBinMinRows = 8;
+
+// ---- 2x2 黑白 bin 的行求和：sums[o] = 两行中 [2o, 2o + 1] 列共 4 个像素之和 ----
+
+void Sum2x2Scalar(const uint16_t *row0, const uint16_t *row1, uint32_t *sums, size_t count) {
+  for (size_t o = 0; o < count; o++) {
+    sums[o] = (uint32_t)row0[2 * o] + row0[2 * o + 1] + row1[2 * o] + row1[2 * o + 1];
+  }
+}
+
+#ifdef QHY_ARCH_X86
+
+// SSE2 没有无符号 16bit 的相邻求和：先异或 0x8000 转为有符号（v - 32768），用 pmaddwd 与 1 相乘得到
+// 相邻两数之和，4 个数共偏移了 4 * 32768，最后加回。
+void Sum2x2Sse2(const uint16_t *row0, const uint16_t *row1, uint32_t *sums, size_t count) {
+  const __m128i bias = _mm_set1_epi16((short)0x8000);
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i offset = _mm_set1_epi32(4 * 32768);
+  size_t o = 0;
+  for (; o + 4 <= count; o += 4) {
+    __m128i a = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 2 * o)), bias);
+    __m128i b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 2 * o)), bias);
+    __m128i s = _mm_add_epi32(_mm_madd_epi16(a, ones), _mm_madd_epi16(b, ones));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + o), _mm_add_epi32(s, offset));
+  }
+  Sum2x2Scalar(row0 + 2 * o, row1 + 2 * o, sums + o, count - o);
+}
+
+QHY_TARGET_AVX2
+void Sum2x2Avx2(const uint16_t *row0, const uint16_t *row1, uint32_t *sums, size_t count) {
+  const __m256i bias = _mm256_set1_epi16((short)0x8000);
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i offset = _mm256_set1_epi32(4 * 32768);
+  size_t o = 0;
+  for (; o + 8 <= count; o += 8) {
+    __m256i a = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + 2 * o)), bias);
+    __m256i b = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + 2 * o)), bias);
+    __m256i s = _mm256_add_epi32(_mm256_madd_epi16(a, ones), _mm256_madd_epi16(b, ones));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(sums + o), _mm256_add_epi32(s, offset));
+  }
+  Sum2x2Scalar(row0 + 2 * o, row1 + 2 * o, sums + o, count - o);
+}
+
+#endif // QHY_ARCH_X86
+
+#ifdef QHY_ARCH_ARM64
+
+void Sum2x2Neon(const uint16_t *row0, const uint16_t *row1, uint32_t *sums, size_t count) {
+  size_t o = 0;
+  for (; o + 4 <= count; o += 4) {
+    uint32x4_t s = vpaddlq_u16(vld1q_u16(row0 + 2 * o));
+    vst1q_u32(sums + o, vpadalq_u16(s, vld1q_u16(row1 + 2 * o)));
+  }
+  Sum2x2Scalar(row0 + 2 * o, row1 + 2 * o, sums + o, count - o);
+}
+
+#endif // QHY_ARCH_ARM64
+
+typedef void (*Sum2x2Fn)(const uint16_t *, const uint16_t *, uint32_t *, size_t);
+
+Sum2x2Fn SelectSum2x2Kernel() {
+  const CpuFeatures &cpu = GetCpuFeatures();
+#ifdef QHY_ARCH_X86
+  if (cpu.avx2) return Sum2x2Avx2;
+  if (cpu.sse2) return Sum2x2Sse2;
+#endif
+#ifdef QHY_ARCH_ARM64
+  if (cpu.neon) return Sum2x2Neon;
+#endif
+  (void)cpu;
+  return Sum2x2Scalar;
+}
+
+// ---- 通用路径 ----
+
+struct BinGeometry {
+  const uint16_t *src;
+  uint32_t width;
+  uint32_t factor;
+  bool bayer;
+  uint32_t outWidth;
+};
+
+// 第 oy 个输出行的 32bit 和。columns 为 width 个元素的临时缓冲。
+// Bayer 模式下输出 (ox, oy) 属于颜色平面 (ox & 1, oy & 1)，该平面中第 (ox >> 1, oy >> 1) 个 bin 区域
+// 对应原图中 x = 2 * ((ox >> 1) * factor + i) + (ox & 1)（i < factor），y 同理。
+void BinRow(const BinGeometry &g, Sum2x2Fn sum2x2, size_t oy, uint32_t *columns, uint32_t *sums) {
+  const uint32_t f = g.factor;
+  if (!g.bayer && f == 2) {
+    const uint16_t *row0 = g.src + oy * 2 * g.width;
+    sum2x2(row0, row0 + g.width, sums, g.outWidth);
+    return;
+  }
+
+  const size_t rowStep = g.bayer ? 2 : 1;
+  const size_t firstRow = g.bayer ? 2 * (oy >> 1) * f + (oy & 1) : oy * f;
+  std::fill(columns, columns + g.width, 0u);
+  for (uint32_t j = 0; j < f; j++) {
+    const uint16_t *row = g.src + (firstRow + j * rowStep) * g.width;
+    for (uint32_t x = 0; x < g.width; x++) {
+      columns[x] += row[x];
+    }
+  }
+
+  if (!g.bayer) {
+    for (uint32_t ox = 0; ox < g.outWidth; ox++) {
+      const uint32_t *c = columns + (size_t)ox * f;
+      uint32_t sum = 0;
+      for (uint32_t i = 0; i < f; i++) {
+        sum += c[i];
+      }
+      sums[ox] = sum;
+    }
+    return;
+  }
+  // Bayer：每 2 * factor 列得到一对相邻的输出（偶列 / 奇列两种颜色）
+  for (uint32_t ox = 0; ox < g.outWidth; ox += 2) {
+    const uint32_t *c = columns + (size_t)ox * f;
+    uint32_t even = 0;
+    uint32_t odd = 0;
+    for (uint32_t i = 0; i < f; i++) {
+      even += c[2 * i];
+      odd += c[2 * i + 1];
+    }
+    sums[ox] = even;
+    sums[ox + 1] = odd;
+  }
+}
+
+// 逐行求和后交给 store(oy, sums) 写出
+template <typename Store>
+void BinRows(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor, bool bayer,
+             Sum2x2Fn sum2x2, bool parallel, const Store &store) {
+  uint32_t outWidth = 0;
+  uint32_t outHeight = 0;
+  SoftwareBinSize(width, height, factor, bayer, &outWidth, &outHeight);
+  if (outWidth == 0 || outHeight == 0) {
+    return;
+  }
+  const BinGeometry g = {src, width, factor, bayer, outWidth};
+  auto run = [&](size_t begin, size_t end) {
+    std::vector<uint32_t> columns(width);
+    std::vector<uint32_t> sums(outWidth);
+    for (size_t oy = begin; oy < end; oy++) {
+      BinRow(g, sum2x2, oy, columns.data(), sums.data());
+      store(oy, outWidth, sums.data());
+    }
+  };
+  if (parallel) {
+    ParallelFor(outHeight, kBinMinRows, run);
+  } else {
+    run(0, outHeight);
+  }
+}
+
+void Bin16(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor, BinMode mode, bool bayer,
+           uint16_t *dst, Sum2x2Fn sum2x2, bool parallel) {
+  const uint32_t n = factor * factor;
+  BinRows(src, width, height, factor, bayer, sum2x2, parallel,
+          [&](size_t oy, uint32_t outWidth, const uint32_t *sums) {
+            uint16_t *out = dst + oy * outWidth;
+            if (mode == BIN_SUM) {
+              for (uint32_t ox = 0; ox < outWidth; ox++) {
+                out[ox] = (uint16_t)std::min(sums[ox], 65535u);
+              }
+            } else {
+              for (uint32_t ox = 0; ox < outWidth; ox++) {
+                out[ox] = (uint16_t)((sums[ox] + n / 2) / n);
+              }
+            }
+          });
+}
+
+}  // namespace
+
+void SoftwareBinSize(uint32_t width, uint32_t height, uint32_t factor, bool bayer,
+                     uint32_t *outWidth, uint32_t *outHeight) {
+  *outWidth = 0;
+  *outHeight = 0;
+  if (factor < 1 || factor > kSoftwareBinMaxFactor) {
+    return;
+  }
+  if (bayer) {
+    *outWidth = width / (2 * factor) * 2;
+    *outHeight = height / (2 * factor) * 2;
+  } else {
+    *outWidth = width / factor;
+    *outHeight = height / factor;
+  }
+}
+
+void SoftwareBin16(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor,
+                   BinMode mode, bool bayer, uint16_t *dst) {
+  static const Sum2x2Fn kernel = SelectSum2x2Kernel();
+  Bin16(src, width, height, factor, mode, bayer, dst, kernel, true);
+}
+
+void SoftwareBinSum32(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor,
+                      bool bayer, uint32_t *dst) {
+  static const Sum2x2Fn kernel = SelectSum2x2Kernel();
+  BinRows(src, width, height, factor, bayer, kernel, true,
+          [&](size_t oy, uint32_t outWidth, const uint32_t *sums) {
+            std::copy(sums, sums + outWidth, dst + oy * outWidth);
+          });
+}
+
+void SoftwareBin16Scalar(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor,
+                         BinMode mode, bool bayer, uint16_t *dst) {
+  Bin16(src, width, height, factor, mode, bayer, dst, Sum2x2Scalar, false);
+}
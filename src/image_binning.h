@@ -0,0 +1,42 @@
+// 软件 bin：在取帧线程中把 factor x factor 个像素合并为 1 个，用于对焦 / 构图时把送往显示、
+// 保存与分析的数据量减少到 1 / 4 ~ 1 / 16。不少 CMOS 型号的硬件 bin 效果差或不支持，
+// 软件 bin 与 SDK 的 SetQHYCCDBinMode 相互独立，可以叠加使用。
+//
+// 累加使用 32bit（factor <= kSoftwareBinMaxFactor 时不会溢出）；16bit 输出的求和模式在 65535 处饱和，
+// 需要完整动态范围时使用 32bit 输出。2x2 的黑白 bin 用 SSE2 / AVX2 / NEON 的相邻求和指令，
+// 其它情况先纵向累加到列和（编译器可向量化）再横向求和，均按输出行分块并行，各实现结果完全相同。
+//
+// Bayer 模式（彩色相机）只合并同色像素：把阵列看作 4 个半分辨率的颜色平面，分别 bin 后再交错回去，
+// 输出仍是同一种阵列，后续的去马赛克 / 统计照常进行。
+// 右侧与底部不足一个 bin 区域（Bayer 模式下为 2 * factor）的像素丢弃，与硬件 bin 一致。
+
+#ifndef IMAGE_BINNING_H
+#define IMAGE_BINNING_H
+
+#include <cstddef>
+#include <cstdint>
+
+static const uint32_t kSoftwareBinMaxFactor = 4;
+
+enum BinMode {
+  BIN_AVERAGE = 0,  // 四舍五入的平均值，保持亮度不变
+  BIN_SUM = 1,      // 求和，信噪比更高；16bit 输出时饱和到 65535
+};
+
+// 输出尺寸，factor 超出 [1, kSoftwareBinMaxFactor] 或图像小于一个 bin 区域时为 0
+void SoftwareBinSize(uint32_t width, uint32_t height, uint32_t factor, bool bayer,
+                     uint32_t *outWidth, uint32_t *outHeight);
+
+// 16bit 输出。dst 至少能容纳 SoftwareBinSize 给出的像素数，且不能与 src 重叠。
+void SoftwareBin16(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor,
+                   BinMode mode, bool bayer, uint16_t *dst);
+
+// 32bit 求和输出，不会饱和。
+void SoftwareBinSum32(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor,
+                      bool bayer, uint32_t *dst);
+
+// 单线程标量参考实现，用于校验与基准对比。
+void SoftwareBin16Scalar(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor,
+                         BinMode mode, bool bayer, uint16_t *dst);
+
+#endif // IMAGE_BINNING_H
@@ -0,0 +1,432 @@
+#include "image_calibration.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "cpu_features.h"
+#include "parallel.h"
+
+#ifdef QHY_ARCH_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef QHY_ARCH_ARM64
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// 校正每个线程块至少处理的像素数
+const size_t kCalibrateMinChunk = 1 << 16;
+// 合并主帧时每次处理的像素数（count 帧 x kCombineBlock 个 float 放在线程私有缓冲中）
+const size_t kCombineBlock = 64;
+const size_t kCombineMinChunk = 4096;
+// sigma 截断的最大迭代次数
+const int kClipIterations = 8;
+// 计算平场中位数时最多抽取的像素数
+const size_t kFlatMedianSamples = 1 << 20;
+// 不超过该帧数时用排序网络对整块像素同时排序
+const size_t kNetworkSortFrames = 32;
+
+// ---- 校正内核：kDark / kGain 为 false 时跳过对应的一项 ----
+
+template <bool kDark, bool kGain>
+void CalibrateScalar(const uint16_t *src, const float *dark, const float *gain, float pedestal, size_t count,
+                     uint16_t *dst) {
+  for (size_t i = 0; i < count; i++) {
+    float v = (float)src[i];
+    if (kDark) v -= dark[i];
+    if (kGain) v *= gain[i];
+    v += pedestal;
+    v = std::min(std::max(v, 0.0f), 65535.0f);
+    // 与 SIMD 的 cvtps 一致：四舍六入五取偶
+    dst[i] = (uint16_t)std::lrint(v);
+  }
+}
+
+#ifdef QHY_ARCH_X86
+
+// SSE2 没有无符号 32bit → 16bit 的饱和打包：已截断到 [0, 65535] 的值先减 32768 按有符号打包，再异或 0x8000 还原。
+template <bool kDark, bool kGain>
+void CalibrateSse2(const uint16_t *src, const float *dark, const float *gain, float pedestal, size_t count,
+                   uint16_t *dst) {
+  const __m128i zeroi = _mm_setzero_si128();
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 maxValue = _mm_set1_ps(65535.0f);
+  const __m128 ped = _mm_set1_ps(pedestal);
+  const __m128i bias32 = _mm_set1_epi32(32768);
+  const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128 a = _mm_cvtepi32_ps(_mm_unpacklo_epi16(s, zeroi));
+    __m128 b = _mm_cvtepi32_ps(_mm_unpackhi_epi16(s, zeroi));
+    if (kDark) {
+      a = _mm_sub_ps(a, _mm_loadu_ps(dark + i));
+      b = _mm_sub_ps(b, _mm_loadu_ps(dark + i + 4));
+    }
+    if (kGain) {
+      a = _mm_mul_ps(a, _mm_loadu_ps(gain + i));
+      b = _mm_mul_ps(b, _mm_loadu_ps(gain + i + 4));
+    }
+    a = _mm_min_ps(_mm_max_ps(_mm_add_ps(a, ped), zero), maxValue);
+    b = _mm_min_ps(_mm_max_ps(_mm_add_ps(b, ped), zero), maxValue);
+    __m128i ia = _mm_sub_epi32(_mm_cvtps_epi32(a), bias32);
+    __m128i ib = _mm_sub_epi32(_mm_cvtps_epi32(b), bias32);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_xor_si128(_mm_packs_epi32(ia, ib), bias16));
+  }
+  CalibrateScalar<kDark, kGain>(src + i, dark ? dark + i : nullptr, gain ? gain + i : nullptr, pedestal, count - i,
+                                dst + i);
+}
+
+template <bool kDark, bool kGain>
+QHY_TARGET_AVX2 void CalibrateAvx2(const uint16_t *src, const float *dark, const float *gain, float pedestal,
+                                   size_t count, uint16_t *dst) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 maxValue = _mm256_set1_ps(65535.0f);
+  const __m256 ped = _mm256_set1_ps(pedestal);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+    __m256 b =
+        _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8))));
+    if (kDark) {
+      a = _mm256_sub_ps(a, _mm256_loadu_ps(dark + i));
+      b = _mm256_sub_ps(b, _mm256_loadu_ps(dark + i + 8));
+    }
+    if (kGain) {
+      a = _mm256_mul_ps(a, _mm256_loadu_ps(gain + i));
+      b = _mm256_mul_ps(b, _mm256_loadu_ps(gain + i + 8));
+    }
+    a = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(a, ped), zero), maxValue);
+    b = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(b, ped), zero), maxValue);
+    // packus 按 128bit 通道交错，再按 64bit 重排回原顺序
+    __m256i packed = _mm256_packus_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+  }
+  CalibrateScalar<kDark, kGain>(src + i, dark ? dark + i : nullptr, gain ? gain + i : nullptr, pedestal, count - i,
+                                dst + i);
+}
+
+#endif // QHY_ARCH_X86
+
+#ifdef QHY_ARCH_ARM64
+
+template <bool kDark, bool kGain>
+void CalibrateNeon(const uint16_t *src, const float *dark, const float *gain, float pedestal, size_t count,
+                   uint16_t *dst) {
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t maxValue = vdupq_n_f32(65535.0f);
+  const float32x4_t ped = vdupq_n_f32(pedestal);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint16x8_t s = vld1q_u16(src + i);
+    float32x4_t a = vcvtq_f32_u32(vmovl_u16(vget_low_u16(s)));
+    float32x4_t b = vcvtq_f32_u32(vmovl_u16(vget_high_u16(s)));
+    if (kDark) {
+      a = vsubq_f32(a, vld1q_f32(dark + i));
+      b = vsubq_f32(b, vld1q_f32(dark + i + 4));
+    }
+    if (kGain) {
+      a = vmulq_f32(a, vld1q_f32(gain + i));
+      b = vmulq_f32(b, vld1q_f32(gain + i + 4));
+    }
+    a = vminq_f32(vmaxq_f32(vaddq_f32(a, ped), zero), maxValue);
+    b = vminq_f32(vmaxq_f32(vaddq_f32(b, ped), zero), maxValue);
+    vst1q_u16(dst + i, vcombine_u16(vqmovn_u32(vcvtnq_u32_f32(a)), vqmovn_u32(vcvtnq_u32_f32(b))));
+  }
+  CalibrateScalar<kDark, kGain>(src + i, dark ? dark + i : nullptr, gain ? gain + i : nullptr, pedestal, count - i,
+                                dst + i);
+}
+
+#endif // QHY_ARCH_ARM64
+
+typedef void (*CalibrateFn)(const uint16_t *, const float *, const float *, float, size_t, uint16_t *);
+
+// 按 [kDark * 2 + kGain] 索引；[0] 只加 pedestal
+struct CalibrateKernels {
+  CalibrateFn fn[4];
+};
+
+CalibrateKernels SelectCalibrateKernels() {
+  const CpuFeatures &cpu = GetCpuFeatures();
+#ifdef QHY_ARCH_X86
+  if (cpu.avx2) {
+    return {{CalibrateAvx2<false, false>, CalibrateAvx2<false, true>, CalibrateAvx2<true, false>,
+             CalibrateAvx2<true, true>}};
+  }
+  if (cpu.sse2) {
+    return {{CalibrateSse2<false, false>, CalibrateSse2<false, true>, CalibrateSse2<true, false>,
+             CalibrateSse2<true, true>}};
+  }
+#endif
+#ifdef QHY_ARCH_ARM64
+  if (cpu.neon) {
+    return {{CalibrateNeon<false, false>, CalibrateNeon<false, true>, CalibrateNeon<true, false>,
+             CalibrateNeon<true, true>}};
+  }
+#endif
+  (void)cpu;
+  return {{CalibrateScalar<false, false>, CalibrateScalar<false, true>, CalibrateScalar<true, false>,
+           CalibrateScalar<true, true>}};
+}
+
+CalibrateFn ScalarCalibrateKernel(bool hasDark, bool hasGain) {
+  static const CalibrateFn kernels[4] = {CalibrateScalar<false, false>, CalibrateScalar<false, true>,
+                                         CalibrateScalar<true, false>, CalibrateScalar<true, true>};
+  return kernels[(hasDark ? 2 : 0) + (hasGain ? 1 : 0)];
+}
+
+// ---- 主帧合并 ----
+
+// values 的中位数（会打乱顺序）
+float Median(float *values, size_t n) {
+  float *mid = values + n / 2;
+  std::nth_element(values, mid, values + n);
+  if (n % 2 == 1) {
+    return *mid;
+  }
+  return 0.5f * (*mid + *std::max_element(values, mid));
+}
+
+// 已升序排列的 n 个值：中位数，或以中位数为中心、按 sigma 倍标准差迭代截断后保留值的均值。
+// 保留的总是排序后连续的一段 [first, last)，截断只需移动两端。
+float CombineSorted(const float *sorted, size_t n, CombineMethod method, float sigma) {
+  auto median = [sorted](size_t first, size_t last) {
+    const size_t k = last - first;
+    return k % 2 == 1 ? sorted[first + k / 2] : 0.5f * (sorted[first + k / 2 - 1] + sorted[first + k / 2]);
+  };
+  if (method != COMBINE_SIGMA_CLIP || n <= 2) {
+    return median(0, n);
+  }
+  size_t first = 0;
+  size_t last = n;
+  for (int iter = 0; iter < kClipIterations && last - first > 2; iter++) {
+    double sum = 0.0;
+    double sumSq = 0.0;
+    for (size_t i = first; i < last; i++) {
+      sum += sorted[i];
+      sumSq += (double)sorted[i] * sorted[i];
+    }
+    const double k = (double)(last - first);
+    const double mean = sum / k;
+    const double stddev = std::sqrt(std::max(0.0, sumSq / k - mean * mean));
+    if (stddev <= 0.0) {
+      break;
+    }
+    const double center = median(first, last);
+    const float lo = (float)(center - sigma * stddev);
+    const float hi = (float)(center + sigma * stddev);
+    size_t nextFirst = first;
+    size_t nextLast = last;
+    while (nextFirst < nextLast && sorted[nextFirst] < lo) nextFirst++;
+    while (nextLast > nextFirst && sorted[nextLast - 1] > hi) nextLast--;
+    if ((nextFirst == first && nextLast == last) || nextLast - nextFirst < 2) {
+      break;
+    }
+    first = nextFirst;
+    last = nextLast;
+  }
+  double sum = 0.0;
+  for (size_t i = first; i < last; i++) {
+    sum += sorted[i];
+  }
+  return (float)(sum / (double)(last - first));
+}
+
+// block[f * kCombineBlock + p]：每个像素的 count 个值按帧分行存放，对每一列（像素）做奇偶换位排序。
+// 比较交换只是整行的 min / max，行长固定为 kCombineBlock，编译器在 -O2 下即可向量化，
+// 没有逐像素排序那样难以预测的分支。
+void SortColumns(float *block, size_t count) {
+  for (size_t pass = 0; pass < count; pass++) {
+    for (size_t f = pass & 1; f + 1 < count; f += 2) {
+      float *a = block + f * kCombineBlock;
+      float *b = a + kCombineBlock;
+      for (size_t p = 0; p < kCombineBlock; p++) {
+        const float lo = std::min(a[p], b[p]);
+        const float hi = std::max(a[p], b[p]);
+        a[p] = lo;
+        b[p] = hi;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void CombineFrames16(const uint16_t *const *frames, size_t count, size_t pixels, CombineMethod method,
+                     float sigma, float *dst) {
+  if (count == 0) {
+    std::fill(dst, dst + pixels, 0.0f);
+    return;
+  }
+  const bool network = count <= kNetworkSortFrames;
+  ParallelFor(pixels, kCombineMinChunk, [&](size_t begin, size_t end) {
+    std::vector<float> block(count * kCombineBlock);
+    std::vector<float> column(count);
+    for (size_t base = begin; base < end; base += kCombineBlock) {
+      const size_t n = std::min(kCombineBlock, end - base);
+      for (size_t f = 0; f < count; f++) {
+        const uint16_t *row = frames[f] + base;
+        float *out = block.data() + f * kCombineBlock;
+        for (size_t p = 0; p < n; p++) {
+          out[p] = (float)row[p];
+        }
+        // 最后一块不足 kCombineBlock 时补零，排序仍按整行进行
+        std::fill(out + n, out + kCombineBlock, 0.0f);
+      }
+      if (network) {
+        SortColumns(block.data(), count);
+        if (method != COMBINE_SIGMA_CLIP || count <= 2) {
+          // 排序后中间一行（或两行的均值）就是各像素的中位数
+          const float *hi = block.data() + (count / 2) * kCombineBlock;
+          const float *lo = count % 2 == 1 ? hi : hi - kCombineBlock;
+          for (size_t p = 0; p < n; p++) {
+            dst[base + p] = 0.5f * (lo[p] + hi[p]);
+          }
+          continue;
+        }
+      }
+      for (size_t p = 0; p < n; p++) {
+        for (size_t f = 0; f < count; f++) {
+          column[f] = block[f * kCombineBlock + p];
+        }
+        if (!network) {
+          // 帧数多时换位排序的 O(count^2) 不再划算，逐像素处理
+          if (method != COMBINE_SIGMA_CLIP) {
+            dst[base + p] = Median(column.data(), count);
+            continue;
+          }
+          std::sort(column.begin(), column.end());
+        }
+        dst[base + p] = CombineSorted(column.data(), count, method, sigma);
+      }
+    }
+  });
+}
+
+MasterFrameBuilder::MasterFrameBuilder(CombineMethod method, float sigma) : method_(method), sigma_(sigma) {}
+
+bool CalibrationRegion::operator==(const CalibrationRegion &other) const {
+  return x == other.x && y == other.y && binX == other.binX && binY == other.binY;
+}
+
+bool MasterFrameBuilder::Add(const uint16_t *pixels, uint32_t width, uint32_t height,
+                             const CalibrationRegion &region, std::string *error) {
+  if (width == 0 || height == 0) {
+    *error = "empty frame";
+    return false;
+  }
+  if (!frames_.empty() && (width != width_ || height != height_)) {
+    *error = "frame size differs from the first frame of the master";
+    return false;
+  }
+  if (!frames_.empty() && region != region_) {
+    *error = "frame ROI / bin differs from the first frame of the master";
+    return false;
+  }
+  if (frames_.size() >= kCalibrationMaxFrames) {
+    *error = "too many frames for one master";
+    return false;
+  }
+  width_ = width;
+  height_ = height;
+  region_ = region;
+  frames_.emplace_back(pixels, pixels + (size_t)width * height);
+  return true;
+}
+
+void MasterFrameBuilder::Clear() {
+  frames_.clear();
+  width_ = 0;
+  height_ = 0;
+  region_ = CalibrationRegion();
+}
+
+bool MasterFrameBuilder::Build(float *dst, std::string *error) const {
+  if (frames_.empty()) {
+    *error = "no frames added";
+    return false;
+  }
+  std::vector<const uint16_t *> frames;
+  frames.reserve(frames_.size());
+  for (const std::vector<uint16_t> &frame : frames_) {
+    frames.push_back(frame.data());
+  }
+  CombineFrames16(frames.data(), frames.size(), (size_t)width_ * height_, method_, sigma_, dst);
+  return true;
+}
+
+bool BuildCalibrationSet(const float *dark, const float *flat, const float *flatDark, uint32_t width,
+                         uint32_t height, const CalibrationRegion &region, float pedestal, CalibrationSet *out,
+                         std::string *error) {
+  if (dark == NULL && flat == NULL) {
+    *error = "calibration requires a dark (or bias) or a flat master";
+    return false;
+  }
+  const size_t pixels = (size_t)width * height;
+  if (pixels == 0) {
+    *error = "empty calibration master";
+    return false;
+  }
+  out->width = width;
+  out->height = height;
+  out->region = region;
+  out->pedestal = pedestal;
+  out->dark.clear();
+  out->gain.clear();
+  out->flatMedian = 0.0f;
+  if (dark != NULL) {
+    out->dark.assign(dark, dark + pixels);
+  }
+  if (flat == NULL) {
+    return true;
+  }
+
+  // 减去平场暗场后按中位数归一化，中位数按固定步长抽样计算
+  std::vector<float> level(flat, flat + pixels);
+  if (flatDark != NULL) {
+    ParallelFor(pixels, kCalibrateMinChunk, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        level[i] -= flatDark[i];
+      }
+    });
+  }
+  const size_t step = std::max<size_t>(1, pixels / kFlatMedianSamples);
+  std::vector<float> samples;
+  samples.reserve(pixels / step + 1);
+  for (size_t i = 0; i < pixels; i += step) {
+    samples.push_back(level[i]);
+  }
+  const float median = Median(samples.data(), samples.size());
+  if (!(median > 0.0f)) {
+    *error = "flat master has no signal above its dark";
+    return false;
+  }
+  out->flatMedian = median;
+  out->gain.resize(pixels);
+  float *gain = out->gain.data();
+  const float minLevel = kMinFlatLevel * median;
+  ParallelFor(pixels, kCalibrateMinChunk, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      gain[i] = level[i] >= minLevel ? median / level[i] : 1.0f;
+    }
+  });
+  return true;
+}
+
+void ApplyCalibration16(const uint16_t *src, const float *dark, const float *gain, float pedestal,
+                        size_t count, uint16_t *dst) {
+  static const CalibrateKernels kernels = SelectCalibrateKernels();
+  const CalibrateFn fn = kernels.fn[(dark ? 2 : 0) + (gain ? 1 : 0)];
+  ParallelFor(count, kCalibrateMinChunk, [&](size_t begin, size_t end) {
+    fn(src + begin, dark ? dark + begin : nullptr, gain ? gain + begin : nullptr, pedestal, end - begin,
+       dst + begin);
+  });
+}
+
+void ApplyCalibration16Scalar(const uint16_t *src, const float *dark, const float *gain, float pedestal,
+                              size_t count, uint16_t *dst) {
+  ScalarCalibrateKernel(dark != nullptr, gain != nullptr)(src, dark, gain, pedestal, count, dst);
+}
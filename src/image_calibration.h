@@ -0,0 +1,103 @@
+// 暗场 / 平场 / 偏置校正：由拍到的序列合成主帧（master），之后在取帧线程中对每一帧做
+//   out = (light - dark) * gain + pedestal，gain = 1 / 归一化平场
+// 一次遍历完成（SSE2 / AVX2 / NEON，按块多线程），Live 预览、录制与分析看到的都是校正后的数据。
+//
+// 主帧合成：逐像素对 N 帧取中位数，或以中位数为中心做迭代的 sigma 截断后取均值（默认 3σ），
+// 按像素块多线程进行，输出 32bit 浮点。暗场应与亮场同曝光、同温度拍摄（已包含偏置），
+// 没有暗场时可以只用偏置主帧。平场先减去平场暗场（或偏置）再按中位数归一化，
+// 预先取倒数存为 gain，校正时只需乘法。
+//
+// 不使用 SDK 的 SetQHYCCDLoadCalibrationFrames：它只能按路径加载文件，过程不透明。
+// 本文件不包含任何 N-API 代码。
+
+#ifndef IMAGE_CALIBRATION_H
+#define IMAGE_CALIBRATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const size_t kCalibrationMaxFrames = 256;
+static const float kDefaultClipSigma = 3.0f;
+// 归一化平场低于该值的像素（死像素、暗角最深处）不做放大，gain 取 1
+static const float kMinFlatLevel = 0.05f;
+
+// FrameInfo::calibration 的位
+enum CalibrationFlags {
+  CALIBRATED_DARK = 1,  // 已减去暗场（或偏置）
+  CALIBRATED_FLAT = 2,  // 已除以平场
+};
+
+enum CombineMethod {
+  COMBINE_MEDIAN = 0,
+  COMBINE_SIGMA_CLIP = 1,  // 以中位数为中心、按标准差迭代截断后取均值
+};
+
+// 主帧所在的传感器区域：ROI 起点（bin 后的像素）与硬件 bin。尺寸相同而区域不同的帧（另一块同样大小的 ROI、
+// 另一种 bin）上热像素与暗角的位置都不同，不能用这组主帧校正。
+struct CalibrationRegion {
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t binX = 1;
+  uint32_t binY = 1;
+
+  bool operator==(const CalibrationRegion &other) const;
+  bool operator!=(const CalibrationRegion &other) const { return !(*this == other); }
+};
+
+// 逐像素合并 count 帧（各 pixels 个像素）为 dst（pixels 个 float）。sigma 只用于 COMBINE_SIGMA_CLIP。
+void CombineFrames16(const uint16_t *const *frames, size_t count, size_t pixels, CombineMethod method,
+                     float sigma, float *dst);
+
+// 收集一组同尺寸的 16bit 帧（拷贝保存，调用方可以立即释放原帧），再合成为主帧。
+class MasterFrameBuilder {
+ public:
+  explicit MasterFrameBuilder(CombineMethod method = COMBINE_MEDIAN, float sigma = kDefaultClipSigma);
+
+  // 尺寸或区域与第一帧不同、或已达 kCalibrationMaxFrames 时返回 false
+  bool Add(const uint16_t *pixels, uint32_t width, uint32_t height, const CalibrationRegion &region,
+           std::string *error);
+  size_t Count() const { return frames_.size(); }
+  uint32_t Width() const { return width_; }
+  uint32_t Height() const { return height_; }
+  const CalibrationRegion &Region() const { return region_; }
+  void Clear();
+  // 合成主帧到 dst（Width() * Height() 个 float），尚未加入任何帧时返回 false
+  bool Build(float *dst, std::string *error) const;
+
+ private:
+  CombineMethod method_;
+  float sigma_;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  CalibrationRegion region_;
+  std::vector<std::vector<uint16_t>> frames_;
+};
+
+// 校正参数，创建后只读，可在多个线程之间共享
+struct CalibrationSet {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  CalibrationRegion region;  // 只校正尺寸与区域都与主帧相同的帧
+  std::vector<float> dark;  // 暗场（或偏置），为空时不减
+  std::vector<float> gain;  // 1 / 归一化平场，为空时不除
+  float pedestal = 0.0f;    // 校正后加上的常数，避免噪声在 0 处被截断
+  float flatMedian = 0.0f;  // 减去平场暗场后的平场中位数
+};
+
+// 由 width x height、拍摄于 region 的主帧生成校正参数。dark / flat / flatDark 都可以为 NULL，
+// 但 dark 与 flat 不能同时为空；flatDark 为平场的暗场（或偏置），为 NULL 时平场不减暗。
+bool BuildCalibrationSet(const float *dark, const float *flat, const float *flatDark, uint32_t width,
+                         uint32_t height, const CalibrationRegion &region, float pedestal, CalibrationSet *out,
+                         std::string *error);
+
+// dst[i] = clamp(round((src[i] - dark[i]) * gain[i] + pedestal), 0, 65535)，dark / gain 为 NULL 时跳过该项。
+// src 与 dst 可以相同（原地校正）。
+void ApplyCalibration16(const uint16_t *src, const float *dark, const float *gain, float pedestal,
+                        size_t count, uint16_t *dst);
+// 单线程标量参考实现，用于校验与基准对比。
+void ApplyCalibration16Scalar(const uint16_t *src, const float *dark, const float *gain, float pedestal,
+                              size_t count, uint16_t *dst);
+
+#endif // IMAGE_CALIBRATION_H
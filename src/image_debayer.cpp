@@ -0,0 +1,351 @@
+#include "image_debayer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+
+#include "cpu_features.h"
+#include "parallel.h"
+
+#ifdef QHY_ARCH_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef QHY_ARCH_ARM64
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// 每个线程块至少处理的行数
+const size_t kDebayerMinRows = 16;
+
+// 各阵列左上角 2x2 像素的颜色，下标为 ((y & 1) << 1) | (x & 1)；0 = R，1 = G，2 = B
+const int kBayerColors[5][4] = {
+    {1, 1, 1, 1},  // 黑白
+    {1, 2, 0, 1},  // GBRG
+    {1, 0, 2, 1},  // GRBG
+    {2, 1, 1, 0},  // BGGR
+    {0, 1, 1, 2},  // RGGB
+};
+
+const char *const kBayerNames[5] = {NULL, "GBRG", "GRBG", "BGGR", "RGGB"};
+
+// 镜像边界：-1 -> 1，n -> n - 2，保持奇偶；n 太小时退化为钳位
+inline int64_t Reflect(int64_t i, int64_t n) {
+  if (i < 0) i = -i;
+  if (i >= n) i = 2 * (n - 1) - i;
+  return std::min(std::max(i, (int64_t)0), n - 1);
+}
+
+inline uint16_t Clamp16(int32_t v) {
+  return (uint16_t)std::min(std::max(v, 0), 65535);
+}
+
+// 向零舍入到最近整数的除法（对称处理负的色差）
+inline int32_t RoundDiv(int32_t v, int32_t d) {
+  return v >= 0 ? (v + d / 2) / d : -((-v + d / 2) / d);
+}
+
+// ---- 舍入平均：out[i] = (a[i] + b[i] + 1) >> 1，即 SSE2 pavgw / NEON vrhadd 的语义 ----
+
+void AverageScalar(const uint16_t *a, const uint16_t *b, uint16_t *out, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    out[i] = (uint16_t)(((uint32_t)a[i] + b[i] + 1) >> 1);
+  }
+}
+
+#ifdef QHY_ARCH_X86
+
+void AverageSse2(const uint16_t *a, const uint16_t *b, uint16_t *out, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_avg_epu16(va, vb));
+  }
+  AverageScalar(a + i, b + i, out + i, count - i);
+}
+
+QHY_TARGET_AVX2
+void AverageAvx2(const uint16_t *a, const uint16_t *b, uint16_t *out, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_avg_epu16(va, vb));
+  }
+  AverageScalar(a + i, b + i, out + i, count - i);
+}
+
+#endif // QHY_ARCH_X86
+
+#ifdef QHY_ARCH_ARM64
+
+void AverageNeon(const uint16_t *a, const uint16_t *b, uint16_t *out, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    vst1q_u16(out + i, vrhaddq_u16(vld1q_u16(a + i), vld1q_u16(b + i)));
+  }
+  AverageScalar(a + i, b + i, out + i, count - i);
+}
+
+#endif // QHY_ARCH_ARM64
+
+typedef void (*AverageFn)(const uint16_t *, const uint16_t *, uint16_t *, size_t);
+
+AverageFn SelectAverageKernel() {
+  const CpuFeatures &cpu = GetCpuFeatures();
+#ifdef QHY_ARCH_X86
+  if (cpu.avx2) return AverageAvx2;
+  if (cpu.sse2) return AverageSse2;
+#endif
+#ifdef QHY_ARCH_ARM64
+  if (cpu.neon) return AverageNeon;
+#endif
+  (void)cpu;
+  return AverageScalar;
+}
+
+void GrayToRgb(const uint16_t *src, uint32_t width, uint32_t height, uint16_t *dst) {
+  ParallelFor(height, kDebayerMinRows, [&](size_t begin, size_t end) {
+    for (size_t i = begin * width; i < end * width; i++) {
+      dst[i * 3] = dst[i * 3 + 1] = dst[i * 3 + 2] = src[i];
+    }
+  });
+}
+
+// ---- 双线性 ----
+// 每个输出行先用舍入平均算出 4 种邻域均值（整行向量化），再按像素在阵列中的位置为 R / G / B 各选一种：
+//   R / B 位置：自身；G = 十字 4 邻均值；另一色 = 对角 4 邻均值
+//   G 位置：G = 自身；左右邻的颜色 = 左右均值；上下邻的颜色 = 上下均值
+// 4 邻均值按“均值的均值”计算，与精确的 (a + b + c + d + 2) >> 2 最多相差 1。
+
+// 读取第 y 行到 out[1 .. width]，两端各镜像补 1 个像素
+void LoadPaddedRow(const uint16_t *src, uint32_t width, uint32_t height, int64_t y, uint16_t *out) {
+  const uint16_t *row = src + (size_t)Reflect(y, height) * width;
+  std::copy(row, row + width, out + 1);
+  out[0] = row[Reflect(-1, width)];
+  out[width + 1] = row[Reflect(width, width)];
+}
+
+void BilinearRows(const uint16_t *src, uint32_t width, uint32_t height, BayerPattern pattern,
+                  AverageFn average, size_t y0, size_t y1, uint16_t *dst) {
+  const size_t padded = (size_t)width + 2;
+  std::vector<uint16_t> buffer(padded * 3 + (size_t)width * 6);
+  uint16_t *up = buffer.data();
+  uint16_t *cur = up + padded;
+  uint16_t *down = cur + padded;
+  uint16_t *horizontal = down + padded;
+  uint16_t *vertical = horizontal + width;
+  uint16_t *cross = vertical + width;
+  uint16_t *diagonal = cross + width;
+  uint16_t *diagUp = diagonal + width;
+  uint16_t *diagDown = diagUp + width;
+
+  for (size_t y = y0; y < y1; y++) {
+    LoadPaddedRow(src, width, height, (int64_t)y - 1, up);
+    LoadPaddedRow(src, width, height, (int64_t)y, cur);
+    LoadPaddedRow(src, width, height, (int64_t)y + 1, down);
+    average(cur, cur + 2, horizontal, width);
+    average(up + 1, down + 1, vertical, width);
+    average(horizontal, vertical, cross, width);
+    average(up, up + 2, diagUp, width);
+    average(down, down + 2, diagDown, width);
+    average(diagUp, diagDown, diagonal, width);
+
+    // sources[px][c]：偶数 / 奇数列上通道 c 取自哪一行缓冲
+    const uint16_t *sources[2][3];
+    for (uint32_t px = 0; px < 2; px++) {
+      int color = BayerColorAt(pattern, px, (uint32_t)y);
+      if (color == 1) {
+        int sideColor = BayerColorAt(pattern, px + 1, (uint32_t)y);
+        sources[px][1] = cur + 1;
+        sources[px][sideColor] = horizontal;
+        sources[px][2 - sideColor] = vertical;
+      } else {
+        sources[px][color] = cur + 1;
+        sources[px][1] = cross;
+        sources[px][2 - color] = diagonal;
+      }
+    }
+
+    // 按偶 / 奇列成对交错写出，通道来源在行内固定
+    const uint16_t *r0 = sources[0][0], *g0 = sources[0][1], *b0 = sources[0][2];
+    const uint16_t *r1 = sources[1][0], *g1 = sources[1][1], *b1 = sources[1][2];
+    uint16_t *out = dst + y * width * 3;
+    uint32_t x = 0;
+    for (; x + 2 <= width; x += 2) {
+      out[x * 3] = r0[x];
+      out[x * 3 + 1] = g0[x];
+      out[x * 3 + 2] = b0[x];
+      out[x * 3 + 3] = r1[x + 1];
+      out[x * 3 + 4] = g1[x + 1];
+      out[x * 3 + 5] = b1[x + 1];
+    }
+    if (x < width) {
+      out[x * 3] = r0[x];
+      out[x * 3 + 1] = g0[x];
+      out[x * 3 + 2] = b0[x];
+    }
+  }
+}
+
+// ---- 边缘自适应（Hamilton-Adams）----
+
+// 第一步：绿色平面。R / B 位置比较水平与垂直方向的梯度（一阶差 + 同色二阶差），
+// 沿梯度较小的方向取绿色均值并用同色二阶差做校正，两方向相同时取平均。
+void EdgeAwareGreenRows(const uint16_t *src, uint32_t width, uint32_t height, BayerPattern pattern,
+                        size_t y0, size_t y1, uint16_t *green) {
+  auto at = [&](int64_t x, int64_t y) -> int32_t {
+    return src[(size_t)Reflect(y, height) * width + (size_t)Reflect(x, width)];
+  };
+  for (size_t y = y0; y < y1; y++) {
+    const int64_t iy = (int64_t)y;
+    for (uint32_t x = 0; x < width; x++) {
+      const int64_t ix = (int64_t)x;
+      const int32_t c = at(ix, iy);
+      if (BayerColorAt(pattern, x, (uint32_t)y) == 1) {
+        green[y * width + x] = (uint16_t)c;
+        continue;
+      }
+      const int32_t left = at(ix - 1, iy);
+      const int32_t right = at(ix + 1, iy);
+      const int32_t top = at(ix, iy - 1);
+      const int32_t bottom = at(ix, iy + 1);
+      const int32_t lapH = 2 * c - at(ix - 2, iy) - at(ix + 2, iy);
+      const int32_t lapV = 2 * c - at(ix, iy - 2) - at(ix, iy + 2);
+      const int32_t gradH = std::abs(left - right) + std::abs(lapH);
+      const int32_t gradV = std::abs(top - bottom) + std::abs(lapV);
+      // 乘 4 后的插值结果
+      const int32_t gH = 2 * (left + right) + lapH;
+      const int32_t gV = 2 * (top + bottom) + lapV;
+      int32_t g;
+      if (gradH < gradV) {
+        g = RoundDiv(gH, 4);
+      } else if (gradV < gradH) {
+        g = RoundDiv(gV, 4);
+      } else {
+        g = RoundDiv(gH + gV, 8);
+      }
+      green[y * width + x] = Clamp16(g);
+    }
+  }
+}
+
+// 第二步：红 / 蓝。在已有的绿色平面上插值色差（R - G、B - G），色差比颜色本身平滑得多，伪色更少。
+void EdgeAwareColorRows(const uint16_t *src, const uint16_t *green, uint32_t width, uint32_t height,
+                        BayerPattern pattern, size_t y0, size_t y1, uint16_t *dst) {
+  auto diff = [&](int64_t x, int64_t y) -> int32_t {
+    size_t i = (size_t)Reflect(y, height) * width + (size_t)Reflect(x, width);
+    return (int32_t)src[i] - (int32_t)green[i];
+  };
+  for (size_t y = y0; y < y1; y++) {
+    const int64_t iy = (int64_t)y;
+    uint16_t *out = dst + y * width * 3;
+    for (uint32_t x = 0; x < width; x++) {
+      const int64_t ix = (int64_t)x;
+      const int32_t g = green[y * width + x];
+      int32_t rgb[3];
+      rgb[1] = g;
+      int color = BayerColorAt(pattern, x, (uint32_t)y);
+      if (color == 1) {
+        int sideColor = BayerColorAt(pattern, x + 1, (uint32_t)y);
+        rgb[sideColor] = g + RoundDiv(diff(ix - 1, iy) + diff(ix + 1, iy), 2);
+        rgb[2 - sideColor] = g + RoundDiv(diff(ix, iy - 1) + diff(ix, iy + 1), 2);
+      } else {
+        rgb[color] = src[y * width + x];
+        rgb[2 - color] = g + RoundDiv(diff(ix - 1, iy - 1) + diff(ix + 1, iy - 1) +
+                                      diff(ix - 1, iy + 1) + diff(ix + 1, iy + 1), 4);
+      }
+      out[x * 3] = Clamp16(rgb[0]);
+      out[x * 3 + 1] = Clamp16(rgb[1]);
+      out[x * 3 + 2] = Clamp16(rgb[2]);
+    }
+  }
+}
+
+}  // namespace
+
+const char *BayerPatternName(BayerPattern pattern) {
+  return pattern >= BAYER_GBRG && pattern <= BAYER_RGGB ? kBayerNames[pattern] : NULL;
+}
+
+BayerPattern ParseBayerPattern(const char *name) {
+  if (name == NULL) {
+    return BAYER_NONE;
+  }
+  for (int p = BAYER_GBRG; p <= BAYER_RGGB; p++) {
+    const char *expected = kBayerNames[p];
+    size_t i = 0;
+    while (name[i] && expected[i] && std::toupper((unsigned char)name[i]) == expected[i]) {
+      i++;
+    }
+    if (name[i] == '\0' && expected[i] == '\0') {
+      return (BayerPattern)p;
+    }
+  }
+  return BAYER_NONE;
+}
+
+BayerPattern ShiftBayerPattern(BayerPattern pattern, uint32_t dx, uint32_t dy) {
+  if (pattern < BAYER_GBRG || pattern > BAYER_RGGB) {
+    return BAYER_NONE;
+  }
+  for (int p = BAYER_GBRG; p <= BAYER_RGGB; p++) {
+    bool same = true;
+    for (uint32_t i = 0; i < 4 && same; i++) {
+      same = kBayerColors[p][i] == BayerColorAt(pattern, dx + (i & 1), dy + (i >> 1));
+    }
+    if (same) {
+      return (BayerPattern)p;
+    }
+  }
+  return pattern;
+}
+
+int BayerColorAt(BayerPattern pattern, uint32_t x, uint32_t y) {
+  int p = pattern >= BAYER_GBRG && pattern <= BAYER_RGGB ? (int)pattern : 0;
+  return kBayerColors[p][((y & 1) << 1) | (x & 1)];
+}
+
+void DebayerRgb16(const uint16_t *src, uint32_t width, uint32_t height, BayerPattern pattern,
+                  DebayerMethod method, uint16_t *dst) {
+  if (width == 0 || height == 0) {
+    return;
+  }
+  if (BayerPatternName(pattern) == NULL) {
+    GrayToRgb(src, width, height, dst);
+    return;
+  }
+  if (method == DEBAYER_EDGE_AWARE) {
+    std::vector<uint16_t> green((size_t)width * height);
+    ParallelFor(height, kDebayerMinRows, [&](size_t begin, size_t end) {
+      EdgeAwareGreenRows(src, width, height, pattern, begin, end, green.data());
+    });
+    ParallelFor(height, kDebayerMinRows, [&](size_t begin, size_t end) {
+      EdgeAwareColorRows(src, green.data(), width, height, pattern, begin, end, dst);
+    });
+    return;
+  }
+  static const AverageFn kernel = SelectAverageKernel();
+  ParallelFor(height, kDebayerMinRows, [&](size_t begin, size_t end) {
+    BilinearRows(src, width, height, pattern, kernel, begin, end, dst);
+  });
+}
+
+void DebayerBilinearRgb16Scalar(const uint16_t *src, uint32_t width, uint32_t height,
+                                BayerPattern pattern, uint16_t *dst) {
+  if (width == 0 || height == 0) {
+    return;
+  }
+  if (BayerPatternName(pattern) == NULL) {
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+      dst[i * 3] = dst[i * 3 + 1] = dst[i * 3 + 2] = src[i];
+    }
+    return;
+  }
+  BilinearRows(src, width, height, pattern, AverageScalar, 0, height, dst);
+}
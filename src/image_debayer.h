@@ -0,0 +1,52 @@
+// 彩色（单次拍摄彩色，OSC）相机的去马赛克：把 16bit Bayer 阵列插值为交错的 RGB16（R, G, B, R, G, B, ...）。
+//
+// 与 SDK 的 SetQHYCCDDebayerOnOff 不同，这里始终保留 16bit 精度，阵列类型取自相机
+// （IsQHYCCDControlAvailable(CAM_COLOR) 返回的 BAYER_ID），不依赖 SDK 在读出时做插值。
+//   DEBAYER_BILINEAR    双线性插值，用于实时预览。邻域平均用 SSE2 / AVX2 / NEON 的舍入平均指令计算，
+//                       各实现与标量版本逐像素结果完全相同。
+//   DEBAYER_EDGE_AWARE  边缘自适应（Hamilton-Adams：先沿梯度较小的方向插值绿色，再用色差插值红 / 蓝），
+//                       锯齿与伪色明显少于双线性，用于保存。
+// 两种方法都按行分块并行，图像边缘按镜像（不重复边缘像素）处理，保持阵列奇偶不变。
+
+#ifndef IMAGE_DEBAYER_H
+#define IMAGE_DEBAYER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 取值与 SDK 的 BAYER_ID 相同，名称为左上角 2x2 像素的颜色顺序
+enum BayerPattern {
+  BAYER_NONE = 0,  // 黑白
+  BAYER_GBRG = 1,  // BAYER_GB
+  BAYER_GRBG = 2,  // BAYER_GR
+  BAYER_BGGR = 3,  // BAYER_BG
+  BAYER_RGGB = 4,  // BAYER_RG
+};
+
+enum DebayerMethod {
+  DEBAYER_BILINEAR = 0,
+  DEBAYER_EDGE_AWARE = 1,
+};
+
+// 名称（"RGGB" 等），BAYER_NONE 时为 NULL
+const char *BayerPatternName(BayerPattern pattern);
+
+// 解析名称（不区分大小写），无法识别时返回 BAYER_NONE
+BayerPattern ParseBayerPattern(const char *name);
+
+// 从阵列中 (dx, dy) 处开始裁剪（或 ROI 起点为 (dx, dy)）后的阵列类型，只取决于 dx / dy 的奇偶
+BayerPattern ShiftBayerPattern(BayerPattern pattern, uint32_t dx, uint32_t dy);
+
+// (x, y) 处像素的颜色：0 = R，1 = G，2 = B
+int BayerColorAt(BayerPattern pattern, uint32_t x, uint32_t y);
+
+// 把 width x height 的 Bayer 图像插值为 RGB16，dst 至少为 width * height * 3 个元素。
+// pattern 为 BAYER_NONE 时把灰度复制到三个通道。
+void DebayerRgb16(const uint16_t *src, uint32_t width, uint32_t height, BayerPattern pattern,
+                  DebayerMethod method, uint16_t *dst);
+
+// 双线性插值的单线程标量参考实现，用于校验与基准对比。
+void DebayerBilinearRgb16Scalar(const uint16_t *src, uint32_t width, uint32_t height,
+                                BayerPattern pattern, uint16_t *dst);
+
+#endif // IMAGE_DEBAYER_H
@@ -0,0 +1,100 @@
+#include "image_preview.h"
+
+#include <algorithm>
+
+#include "parallel.h"
+
+static uint32_t CeilDiv(uint32_t a, uint32_t b) {
+  return (a + b - 1) / b;
+}
+
+uint32_t PreviewFactor(uint32_t width, uint32_t height, uint32_t maxWidth, uint32_t maxHeight) {
+  uint32_t factor = 1;
+  if (maxWidth > 0 && width > maxWidth) {
+    factor = std::max(factor, CeilDiv(width, maxWidth));
+  }
+  if (maxHeight > 0 && height > maxHeight) {
+    factor = std::max(factor, CeilDiv(height, maxHeight));
+  }
+  // 向上取整后可能仍略超出（如 1001 / 2 = 501 > 500），逐步增大直到满足
+  while ((maxWidth > 0 && CeilDiv(width, factor) > maxWidth) ||
+         (maxHeight > 0 && CeilDiv(height, factor) > maxHeight)) {
+    factor++;
+  }
+  return std::min(factor, kPreviewMaxFactor);
+}
+
+void DownsampleBox16(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor, uint16_t *dst,
+                     uint32_t channels) {
+  if (factor <= 1) {
+    std::copy(src, src + (size_t)width * height * channels, dst);
+    return;
+  }
+  const uint32_t outWidth = CeilDiv(width, factor);
+  const uint32_t outHeight = CeilDiv(height, factor);
+
+  const size_t rowValues = (size_t)width * channels;
+
+  // 按输出行并行：先把 factor 行纵向累加到列和（可向量化），再按 factor 列横向求和
+  ParallelFor(outHeight, 8, [&](size_t begin, size_t end) {
+    std::vector<uint32_t> columns(rowValues);
+    for (size_t oy = begin; oy < end; oy++) {
+      uint32_t y0 = (uint32_t)oy * factor;
+      uint32_t y1 = std::min(height, y0 + factor);
+      std::fill(columns.begin(), columns.end(), 0u);
+      for (uint32_t y = y0; y < y1; y++) {
+        const uint16_t *row = src + (size_t)y * rowValues;
+        for (size_t i = 0; i < rowValues; i++) {
+          columns[i] += row[i];
+        }
+      }
+
+      uint16_t *out = dst + oy * outWidth * channels;
+      uint32_t rows = y1 - y0;
+      for (uint32_t ox = 0; ox < outWidth; ox++) {
+        uint32_t x0 = ox * factor;
+        uint32_t x1 = std::min(width, x0 + factor);
+        uint32_t n = rows * (x1 - x0);
+        for (uint32_t c = 0; c < channels; c++) {
+          uint32_t sum = 0;
+          for (uint32_t x = x0; x < x1; x++) {
+            sum += columns[(size_t)x * channels + c];
+          }
+          out[(size_t)ox * channels + c] = (uint16_t)((sum + n / 2) / n);
+        }
+      }
+    }
+  });
+}
+
+void MakePreview16(const uint16_t *src, uint32_t width, uint32_t height,
+                   uint32_t maxWidth, uint32_t maxHeight, PreviewImage *preview) {
+  uint32_t factor = PreviewFactor(width, height, maxWidth, maxHeight);
+  preview->factor = factor;
+  preview->width = CeilDiv(width, factor);
+  preview->height = CeilDiv(height, factor);
+  preview->channels = 1;
+  preview->pixels.resize((size_t)preview->width * preview->height);
+  DownsampleBox16(src, width, height, factor, preview->pixels.data());
+}
+
+void MakeColorPreview16(const uint16_t *src, uint32_t width, uint32_t height, BayerPattern pattern,
+                        uint32_t maxWidth, uint32_t maxHeight, PreviewImage *preview) {
+  if (BayerPatternName(pattern) == NULL) {
+    MakePreview16(src, width, height, maxWidth, maxHeight, preview);
+    return;
+  }
+  uint32_t factor = PreviewFactor(width, height, maxWidth, maxHeight);
+  preview->factor = factor;
+  preview->width = CeilDiv(width, factor);
+  preview->height = CeilDiv(height, factor);
+  preview->channels = 3;
+  preview->pixels.resize((size_t)preview->width * preview->height * 3);
+  if (factor == 1) {
+    DebayerRgb16(src, width, height, pattern, DEBAYER_BILINEAR, preview->pixels.data());
+    return;
+  }
+  std::vector<uint16_t> rgb((size_t)width * height * 3);
+  DebayerRgb16(src, width, height, pattern, DEBAYER_BILINEAR, rgb.data());
+  DownsampleBox16(rgb.data(), width, height, factor, preview->pixels.data(), 3);
+}
@@ -0,0 +1,43 @@
+// 预览图：把整帧按整数倍区域平均（box binning）缩小到不超过给定尺寸，用于界面显示。
+// 整帧留在主进程 / 原生内存中用于保存与分析，跨 IPC 发送的只有预览图。
+// 彩色相机的帧先用双线性去马赛克为 RGB16，再按通道区域平均。
+
+#ifndef IMAGE_PREVIEW_H
+#define IMAGE_PREVIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "image_debayer.h"
+
+// 缩小倍数上限，保证 factor * factor * 65535 不超出 32bit 累加器
+static const uint32_t kPreviewMaxFactor = 256;
+
+struct PreviewImage {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t factor = 0;  // 预览图 1 个像素对应原图 factor x factor 个像素，0 表示没有预览
+  uint32_t channels = 1;  // 1 为灰度，3 为交错的 RGB
+  std::vector<uint16_t> pixels;
+};
+
+// 选取最小的整数倍数 factor，使 ceil(width / factor) <= maxWidth 且 ceil(height / factor) <= maxHeight。
+// maxWidth / maxHeight 为 0 时不限制该方向。
+uint32_t PreviewFactor(uint32_t width, uint32_t height, uint32_t maxWidth, uint32_t maxHeight);
+
+// 把 width x height 的 16bit 图像按 factor 做区域平均，输出 ceil(width / factor) x ceil(height / factor)，
+// 右侧与底部不满一个区域的像素按实际数量平均。channels 大于 1 时像素为交错存储，各通道分别平均。
+// dst 至少能容纳输出像素数 * channels。
+void DownsampleBox16(const uint16_t *src, uint32_t width, uint32_t height, uint32_t factor, uint16_t *dst,
+                     uint32_t channels = 1);
+
+// 组合以上两步生成预览图。
+void MakePreview16(const uint16_t *src, uint32_t width, uint32_t height,
+                   uint32_t maxWidth, uint32_t maxHeight, PreviewImage *preview);
+
+// 彩色预览图：先双线性去马赛克，再按通道缩小，输出 RGB16。pattern 为 BAYER_NONE 时同 MakePreview16。
+void MakeColorPreview16(const uint16_t *src, uint32_t width, uint32_t height, BayerPattern pattern,
+                        uint32_t maxWidth, uint32_t maxHeight, PreviewImage *preview);
+
+#endif // IMAGE_PREVIEW_H
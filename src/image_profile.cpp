@@ -0,0 +1,326 @@
+#include "image_profile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "cpu_features.h"
+#include "parallel.h"
+
+#ifdef QHY_ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 每个线程块至少处理的插值点数
+const size_t kProfileMinTaps = 1 << 14;
+
+// 路径上长度不为 0 的线段：起点、单位方向与起点处的路径长度
+struct ProfileSegment {
+  double x = 0.0;
+  double y = 0.0;
+  double dx = 0.0;
+  double dy = 0.0;
+  double start = 0.0;
+};
+
+// 插值内核：u / v 为以像素中心为整数的坐标，超出 [-0.5, size - 0.5] 的点输出 NaN
+typedef void (*ProfileKernelFn)(const uint16_t *, uint32_t, uint32_t, const float *, const float *, size_t,
+                                ProfileInterpolation, float *);
+
+inline float ClampCoord(float v, float hi) {
+  return std::min(std::max(v, 0.0f), hi);
+}
+
+// Catmull-Rom（a = -0.5）的 4 个权重，t 为到左侧像素的距离
+inline void CubicWeights(float t, float *w) {
+  const float t2 = t * t;
+  w[0] = ((-0.5f * t + 1.0f) * t - 0.5f) * t;
+  w[1] = (1.5f * t - 2.5f) * t2 + 1.0f;
+  w[2] = ((-1.5f * t + 2.0f) * t + 0.5f) * t;
+  w[3] = (0.5f * t - 0.5f) * t2;
+}
+
+float BilinearAt(const uint16_t *pixels, uint32_t width, uint32_t height, float u, float v) {
+  float uc = ClampCoord(u, (float)(width - 1));
+  float vc = ClampCoord(v, (float)(height - 1));
+  // x0 不超过 width - 2，右侧像素总是存在（边缘处 fx 为 1）
+  int32_t x0 = std::min((int32_t)uc, (int32_t)width - 2);
+  int32_t y0 = std::min((int32_t)vc, (int32_t)height - 2);
+  float fx = uc - (float)x0;
+  float fy = vc - (float)y0;
+  const uint16_t *r0 = pixels + (size_t)y0 * width + x0;
+  const uint16_t *r1 = r0 + width;
+  float top = (float)r0[0] + ((float)r0[1] - (float)r0[0]) * fx;
+  float bottom = (float)r1[0] + ((float)r1[1] - (float)r1[0]) * fx;
+  return top + (bottom - top) * fy;
+}
+
+float BicubicAt(const uint16_t *pixels, uint32_t width, uint32_t height, float u, float v) {
+  float uc = ClampCoord(u, (float)(width - 1));
+  float vc = ClampCoord(v, (float)(height - 1));
+  int32_t x0 = (int32_t)uc;
+  int32_t y0 = (int32_t)vc;
+  float wx[4];
+  float wy[4];
+  CubicWeights(uc - (float)x0, wx);
+  CubicWeights(vc - (float)y0, wy);
+  int32_t xs[4];
+  for (int c = 0; c < 4; c++) {
+    xs[c] = std::min(std::max(x0 - 1 + c, 0), (int32_t)width - 1);
+  }
+  float sum = 0.0f;
+  for (int r = 0; r < 4; r++) {
+    int32_t y = std::min(std::max(y0 - 1 + r, 0), (int32_t)height - 1);
+    const uint16_t *row = pixels + (size_t)y * width;
+    float value = wx[0] * (float)row[xs[0]];
+    value = value + wx[1] * (float)row[xs[1]];
+    value = value + wx[2] * (float)row[xs[2]];
+    value = value + wx[3] * (float)row[xs[3]];
+    sum = r == 0 ? wy[0] * value : sum + wy[r] * value;
+  }
+  return sum;
+}
+
+void ProfileScalarRange(const uint16_t *pixels, uint32_t width, uint32_t height, const float *u, const float *v,
+                        size_t count, ProfileInterpolation mode, float *out) {
+  const float hiU = (float)width - 0.5f;
+  const float hiV = (float)height - 0.5f;
+  for (size_t i = 0; i < count; i++) {
+    if (!(u[i] >= -0.5f && u[i] <= hiU && v[i] >= -0.5f && v[i] <= hiV)) {
+      out[i] = std::numeric_limits<float>::quiet_NaN();
+    } else if (mode == PROFILE_BICUBIC) {
+      out[i] = BicubicAt(pixels, width, height, u[i], v[i]);
+    } else {
+      out[i] = BilinearAt(pixels, width, height, u[i], v[i]);
+    }
+  }
+}
+
+#ifdef QHY_ARCH_X86
+
+// 一次 gather 取回 idx 与 idx + 1 两个相邻像素（32bit 的低 / 高 16 位），转为 float
+QHY_TARGET_AVX2 inline void GatherPair(const uint16_t *pixels, __m256i idx, __m256 *left, __m256 *right) {
+  __m256i pair = _mm256_i32gather_epi32(reinterpret_cast<const int *>(pixels), idx, 2);
+  *left = _mm256_cvtepi32_ps(_mm256_and_si256(pair, _mm256_set1_epi32(0xffff)));
+  *right = _mm256_cvtepi32_ps(_mm256_srli_epi32(pair, 16));
+}
+
+QHY_TARGET_AVX2 inline void CubicWeightsAvx2(__m256 t, __m256 *w) {
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 t2 = _mm256_mul_ps(t, t);
+  w[0] = _mm256_mul_ps(
+      _mm256_sub_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-0.5f), t), _mm256_set1_ps(1.0f)), t),
+                    half),
+      t);
+  w[1] = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(1.5f), t), _mm256_set1_ps(2.5f)), t2),
+                       _mm256_set1_ps(1.0f));
+  w[2] = _mm256_mul_ps(
+      _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-1.5f), t), _mm256_set1_ps(2.0f)), t),
+                    half),
+      t);
+  w[3] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(half, t), half), t2);
+}
+
+// 8 个点一组；与标量版本的运算顺序相同，结果逐点一致。
+// 双三次时 4x4 邻域碰到图像边缘（需要延拓）的组整组按标量处理。
+QHY_TARGET_AVX2 void ProfileAvx2Range(const uint16_t *pixels, uint32_t width, uint32_t height, const float *u,
+                                      const float *v, size_t count, ProfileInterpolation mode, float *out) {
+  const __m256 lo = _mm256_set1_ps(-0.5f);
+  const __m256 hiU = _mm256_set1_ps((float)width - 0.5f);
+  const __m256 hiV = _mm256_set1_ps((float)height - 0.5f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 maxU = _mm256_set1_ps((float)(width - 1));
+  const __m256 maxV = _mm256_set1_ps((float)(height - 1));
+  const __m256 nan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+  const __m256i stride = _mm256_set1_epi32((int)width);
+  const __m256i one = _mm256_set1_epi32(1);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 uu = _mm256_loadu_ps(u + i);
+    __m256 vv = _mm256_loadu_ps(v + i);
+    __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(uu, lo, _CMP_GE_OQ), _mm256_cmp_ps(uu, hiU, _CMP_LE_OQ)),
+                                  _mm256_and_ps(_mm256_cmp_ps(vv, lo, _CMP_GE_OQ), _mm256_cmp_ps(vv, hiV, _CMP_LE_OQ)));
+    __m256 uc = _mm256_min_ps(_mm256_max_ps(uu, zero), maxU);
+    __m256 vc = _mm256_min_ps(_mm256_max_ps(vv, zero), maxV);
+    __m256 result;
+    if (mode == PROFILE_BICUBIC) {
+      __m256i x0 = _mm256_cvttps_epi32(uc);
+      __m256i y0 = _mm256_cvttps_epi32(vc);
+      __m256i edge = _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpgt_epi32(one, x0), _mm256_cmpgt_epi32(x0, _mm256_set1_epi32((int)width - 3))),
+          _mm256_or_si256(_mm256_cmpgt_epi32(one, y0), _mm256_cmpgt_epi32(y0, _mm256_set1_epi32((int)height - 3))));
+      if (!_mm256_testz_si256(edge, edge)) {
+        ProfileScalarRange(pixels, width, height, u + i, v + i, 8, mode, out + i);
+        continue;
+      }
+      __m256 wx[4];
+      __m256 wy[4];
+      CubicWeightsAvx2(_mm256_sub_ps(uc, _mm256_cvtepi32_ps(x0)), wx);
+      CubicWeightsAvx2(_mm256_sub_ps(vc, _mm256_cvtepi32_ps(y0)), wy);
+      // 左上角 (x0 - 1, y0 - 1)，每行两次 gather 取回 4 个像素
+      __m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(y0, one), stride), _mm256_sub_epi32(x0, one));
+      const __m256i two = _mm256_set1_epi32(2);
+      result = zero;
+      for (int r = 0; r < 4; r++) {
+        __m256 p0, p1, p2, p3;
+        GatherPair(pixels, idx, &p0, &p1);
+        GatherPair(pixels, _mm256_add_epi32(idx, two), &p2, &p3);
+        __m256 value = _mm256_mul_ps(wx[0], p0);
+        value = _mm256_add_ps(value, _mm256_mul_ps(wx[1], p1));
+        value = _mm256_add_ps(value, _mm256_mul_ps(wx[2], p2));
+        value = _mm256_add_ps(value, _mm256_mul_ps(wx[3], p3));
+        result = r == 0 ? _mm256_mul_ps(wy[0], value) : _mm256_add_ps(result, _mm256_mul_ps(wy[r], value));
+        idx = _mm256_add_epi32(idx, stride);
+      }
+    } else {
+      __m256i x0 = _mm256_min_epi32(_mm256_cvttps_epi32(uc), _mm256_set1_epi32((int)width - 2));
+      __m256i y0 = _mm256_min_epi32(_mm256_cvttps_epi32(vc), _mm256_set1_epi32((int)height - 2));
+      __m256 fx = _mm256_sub_ps(uc, _mm256_cvtepi32_ps(x0));
+      __m256 fy = _mm256_sub_ps(vc, _mm256_cvtepi32_ps(y0));
+      __m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(y0, stride), x0);
+      __m256 p00, p01, p10, p11;
+      GatherPair(pixels, idx, &p00, &p01);
+      GatherPair(pixels, _mm256_add_epi32(idx, stride), &p10, &p11);
+      __m256 top = _mm256_add_ps(p00, _mm256_mul_ps(_mm256_sub_ps(p01, p00), fx));
+      __m256 bottom = _mm256_add_ps(p10, _mm256_mul_ps(_mm256_sub_ps(p11, p10), fx));
+      result = _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), fy));
+    }
+    _mm256_storeu_ps(out + i, _mm256_blendv_ps(nan, result, inside));
+  }
+  ProfileScalarRange(pixels, width, height, u + i, v + i, count - i, mode, out + i);
+}
+
+#endif // QHY_ARCH_X86
+
+ProfileKernelFn SelectProfileKernel() {
+  const CpuFeatures &cpu = GetCpuFeatures();
+#ifdef QHY_ARCH_X86
+  if (cpu.avx2) return ProfileAvx2Range;
+#endif
+  (void)cpu;
+  return ProfileScalarRange;
+}
+
+// 展开路径：去掉长度为 0 的线段，得到总长、实际采样间距与各顶点的路径长度
+bool BuildSegments(const std::vector<ProfilePoint> &path, const ProfileOptions &options,
+                   std::vector<ProfileSegment> *segments, ProfileResult *result) {
+  segments->clear();
+  result->values.clear();
+  result->vertices.clear();
+  result->length = 0.0;
+  if (path.size() < 2 || !(options.spacing > 0.0) || options.width < 1 || options.width > kProfileMaxWidth) {
+    return false;
+  }
+  double length = 0.0;
+  result->vertices.push_back(0.0f);
+  for (size_t i = 0; i + 1 < path.size(); i++) {
+    const ProfilePoint &a = path[i];
+    const ProfilePoint &b = path[i + 1];
+    double d = std::hypot(b.x - a.x, b.y - a.y);
+    if (!std::isfinite(d)) {
+      return false;
+    }
+    if (d > 0.0) {
+      ProfileSegment s;
+      s.x = a.x;
+      s.y = a.y;
+      s.dx = (b.x - a.x) / d;
+      s.dy = (b.y - a.y) / d;
+      s.start = length;
+      segments->push_back(s);
+      length += d;
+    }
+    result->vertices.push_back((float)length);
+  }
+  if (segments->empty()) {
+    return false;
+  }
+  result->length = length;
+  result->spacing = std::max(options.spacing, length / (double)(kProfileMaxSamples - 1));
+  size_t samples = (size_t)std::floor(length / result->spacing + 1e-9) + 1;
+  result->values.resize(samples);
+  return true;
+}
+
+// 采样点 [begin, end) 的插值坐标，每个采样点 width 个（法线方向从一侧到另一侧）
+void FillTaps(const std::vector<ProfileSegment> &segments, const ProfileResult &result, uint32_t width, size_t begin,
+              size_t end, float *u, float *v) {
+  size_t seg = 0;
+  const double center = (double)(width - 1) / 2.0;
+  for (size_t i = begin; i < end; i++) {
+    double d = (double)i * result.spacing;
+    while (seg + 1 < segments.size() && d >= segments[seg + 1].start) {
+      seg++;
+    }
+    const ProfileSegment &s = segments[seg];
+    double t = d - s.start;
+    // 像素中心为 (i + 0.5, j + 0.5)，内核使用以像素中心为整数的坐标
+    double x = s.x + s.dx * t - 0.5;
+    double y = s.y + s.dy * t - 0.5;
+    for (uint32_t k = 0; k < width; k++) {
+      double o = (double)k - center;
+      *u++ = (float)(x - s.dy * o);
+      *v++ = (float)(y + s.dx * o);
+    }
+  }
+}
+
+// 每个采样点在图像内的插值结果取平均，全部在图像外时为 NaN
+void AverageTaps(const float *taps, size_t samples, uint32_t width, float *out) {
+  for (size_t i = 0; i < samples; i++) {
+    float sum = 0.0f;
+    uint32_t n = 0;
+    for (uint32_t k = 0; k < width; k++) {
+      float t = taps[k];
+      if (t == t) {
+        sum += t;
+        n++;
+      }
+    }
+    out[i] = n > 0 ? sum / (float)n : std::numeric_limits<float>::quiet_NaN();
+    taps += width;
+  }
+}
+
+bool SampleWith(ProfileKernelFn kernel, bool parallel, const uint16_t *pixels, uint32_t width, uint32_t height,
+                const std::vector<ProfilePoint> &path, const ProfileOptions &options, ProfileResult *result) {
+  std::vector<ProfileSegment> segments;
+  if (pixels == nullptr || width < 4 || height < 4 || !BuildSegments(path, options, &segments, result)) {
+    return false;
+  }
+  const uint32_t taps = options.width;
+  const size_t samples = result->values.size();
+  auto run = [&](size_t begin, size_t end) {
+    size_t count = (end - begin) * taps;
+    std::vector<float> u(count);
+    std::vector<float> v(count);
+    std::vector<float> values(count);
+    FillTaps(segments, *result, taps, begin, end, u.data(), v.data());
+    kernel(pixels, width, height, u.data(), v.data(), count, options.interpolation, values.data());
+    AverageTaps(values.data(), end - begin, taps, result->values.data() + begin);
+  };
+  if (parallel) {
+    ParallelFor(samples, std::max<size_t>(1, kProfileMinTaps / taps), run);
+  } else {
+    run(0, samples);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool SampleProfile16(const uint16_t *pixels, uint32_t width, uint32_t height, const std::vector<ProfilePoint> &path,
+                     const ProfileOptions &options, ProfileResult *result) {
+  static const ProfileKernelFn kernel = SelectProfileKernel();
+  // gather 的下标为 32bit
+  ProfileKernelFn selected = (size_t)width * height < (size_t)INT32_MAX ? kernel : ProfileScalarRange;
+  return SampleWith(selected, true, pixels, width, height, path, options, result);
+}
+
+bool SampleProfile16Scalar(const uint16_t *pixels, uint32_t width, uint32_t height,
+                           const std::vector<ProfilePoint> &path, const ProfileOptions &options,
+                           ProfileResult *result) {
+  return SampleWith(ProfileScalarRange, false, pixels, width, height, path, options, result);
+}
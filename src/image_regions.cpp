@@ -0,0 +1,289 @@
+#include "image_regions.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "image_stats.h"
+#include "parallel.h"
+
+namespace {
+
+// 像素数不超过该值时逐个收集后用 nth_element 求中位数，比清零与扫描 65536 级直方图便宜
+const uint64_t kRegionSelectLimit = 1 << 16;
+// 建立直方图时每个线程至少分到的像素数（同 image_stats）
+const uint64_t kRegionMinPixelsPerThread = 1 << 20;
+
+int32_t ClampCoordinate(double v) {
+  if (!(v > 0.0)) {
+    return 0;  // 含 NaN
+  }
+  if (v >= (double)kRegionMaxCoordinate) {
+    return kRegionMaxCoordinate;
+  }
+  return (int32_t)v;
+}
+
+// 中心 (c + 0.5) 落在 [lo, hi) 内的像素为 [ceil(lo - 0.5), ceil(hi - 0.5))
+void PixelRange(double lo, double hi, int32_t *first, int32_t *last) {
+  *first = ClampCoordinate(std::ceil(lo - 0.5));
+  *last = ClampCoordinate(std::ceil(hi - 0.5));
+}
+
+void AddSpan(int32_t y, double left, double right, RegionMask *mask) {
+  RegionSpan span;
+  span.y = y;
+  PixelRange(left, right, &span.x0, &span.x1);
+  if (span.x1 > span.x0) {
+    mask->spans.push_back(span);
+    mask->pixels += (uint64_t)(span.x1 - span.x0);
+  }
+}
+
+// 中心在 (cx, cy)、半轴为 rx / ry 的轴对齐椭圆（圆为 rx == ry）
+void RasterizeEllipse(double cx, double cy, double rx, double ry, RegionMask *mask) {
+  int32_t y0, y1;
+  PixelRange(cy - ry, cy + ry, &y0, &y1);
+  for (int32_t y = y0; y < y1; y++) {
+    double dy = (y + 0.5 - cy) / ry;
+    double half = rx * std::sqrt(std::max(0.0, 1.0 - dy * dy));
+    AddSpan(y, cx - half, cx + half, mask);
+  }
+}
+
+// 扫描线填充：每行求像素中心所在水平线与各边的交点，排序后两两配对
+void RasterizePolygon(const std::vector<RegionPoint> &points, RegionMask *mask) {
+  double top = points[0].y;
+  double bottom = points[0].y;
+  for (const RegionPoint &p : points) {
+    top = std::min(top, p.y);
+    bottom = std::max(bottom, p.y);
+  }
+  int32_t y0, y1;
+  PixelRange(top, bottom, &y0, &y1);
+  std::vector<double> crossings;
+  size_t n = points.size();
+  for (int32_t y = y0; y < y1; y++) {
+    double yc = y + 0.5;
+    crossings.clear();
+    for (size_t i = 0; i < n; i++) {
+      const RegionPoint &a = points[i];
+      const RegionPoint &b = points[(i + 1) % n];
+      // 半开区间判断，顶点恰好落在扫描线上时只计一次
+      if ((a.y <= yc) != (b.y <= yc)) {
+        crossings.push_back(a.x + (yc - a.y) * (b.x - a.x) / (b.y - a.y));
+      }
+    }
+    std::sort(crossings.begin(), crossings.end());
+    for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+      AddSpan(y, crossings[i], crossings[i + 1], mask);
+    }
+  }
+}
+
+// 按图像尺寸裁剪，返回落在图像内的像素数
+uint64_t ClipSpans(const RegionMask &mask, uint32_t width, uint32_t height, std::vector<RegionSpan> *clipped) {
+  clipped->clear();
+  clipped->reserve(mask.spans.size());
+  uint64_t count = 0;
+  for (const RegionSpan &span : mask.spans) {
+    if ((uint32_t)span.y >= height) {
+      break;  // 按 y 升序
+    }
+    RegionSpan s = span;
+    s.x1 = (int32_t)std::min<uint32_t>((uint32_t)s.x1, width);
+    if (s.x1 > s.x0) {
+      clipped->push_back(s);
+      count += (uint64_t)(s.x1 - s.x0);
+    }
+  }
+  return count;
+}
+
+void FinishStats(uint64_t count, uint64_t sum, uint64_t sumSq, RegionStats *stats) {
+  stats->count = count;
+  stats->sum = (double)sum;
+  stats->mean = (double)sum / (double)count;
+  double variance = (double)sumSq / (double)count - stats->mean * stats->mean;
+  stats->stddev = variance > 0.0 ? std::sqrt(variance) : 0.0;
+  stats->snr = stats->stddev > 0.0 ? stats->mean / stats->stddev : 0.0;
+}
+
+// 小区域：收集像素值，sum / min / max 顺带累加
+void SelectStats(const uint16_t *pixels, uint32_t width, const std::vector<RegionSpan> &spans, uint64_t count,
+                 RegionStats *stats) {
+  std::vector<uint16_t> values;
+  values.reserve(count);
+  uint64_t sum = 0;
+  uint64_t sumSq = 0;
+  uint32_t lo = 65535;
+  uint32_t hi = 0;
+  for (const RegionSpan &span : spans) {
+    const uint16_t *row = pixels + (size_t)span.y * width;
+    for (int32_t x = span.x0; x < span.x1; x++) {
+      uint32_t v = row[x];
+      values.push_back((uint16_t)v);
+      sum += v;
+      sumSq += (uint64_t)v * v;
+      lo = std::min(lo, v);
+      hi = std::max(hi, v);
+    }
+  }
+  std::vector<uint16_t>::iterator mid = values.begin() + (count - 1) / 2;
+  std::nth_element(values.begin(), mid, values.end());
+  stats->min = lo;
+  stats->max = hi;
+  stats->median = *mid;
+  FinishStats(count, sum, sumSq, stats);
+}
+
+// 大区域：按像素数把段分给各线程，各自建立私有直方图后合并，再由直方图得到全部统计量
+void HistogramStats(const uint16_t *pixels, uint32_t width, const std::vector<RegionSpan> &spans, uint64_t count,
+                    RegionStats *stats) {
+  size_t parts = (size_t)std::max<uint64_t>(
+      1, std::min<uint64_t>(ParallelThreadCount(), count / kRegionMinPixelsPerThread));
+  // bounds[p] 为第 p 段的起始下标，每段约 count / parts 个像素
+  std::vector<size_t> bounds(parts + 1, spans.size());
+  bounds[0] = 0;
+  uint64_t accumulated = 0;
+  size_t next = 1;
+  for (size_t i = 0; i < spans.size() && next < parts; i++) {
+    accumulated += (uint64_t)(spans[i].x1 - spans[i].x0);
+    if (accumulated >= count * next / parts) {
+      bounds[next++] = i + 1;
+    }
+  }
+
+  std::vector<std::vector<uint32_t>> partial(parts);
+  ParallelFor(parts, 1, [&](size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      partial[p].assign(kHistogramBins, 0);
+      uint32_t *bins = partial[p].data();
+      for (size_t i = bounds[p]; i < bounds[p + 1]; i++) {
+        const RegionSpan &span = spans[i];
+        const uint16_t *row = pixels + (size_t)span.y * width;
+        for (int32_t x = span.x0; x < span.x1; x++) {
+          bins[row[x]]++;
+        }
+      }
+    }
+  });
+  uint32_t *bins = partial[0].data();
+  for (size_t p = 1; p < parts; p++) {
+    const uint32_t *other = partial[p].data();
+    for (size_t v = 0; v < kHistogramBins; v++) {
+      bins[v] += other[v];
+    }
+  }
+
+  uint64_t sum = 0;
+  uint64_t sumSq = 0;  // 最大 65535^2 * count，count < 4e9 时不会溢出
+  uint64_t cumulative = 0;
+  uint64_t half = (count + 1) / 2;
+  bool first = true;
+  bool medianFound = false;
+  for (uint32_t v = 0; v < kHistogramBins; v++) {
+    uint64_t n = bins[v];
+    if (n == 0) {
+      continue;
+    }
+    if (first) {
+      stats->min = v;
+      first = false;
+    }
+    stats->max = v;
+    sum += n * v;
+    sumSq += n * v * v;
+    cumulative += n;
+    if (!medianFound && cumulative >= half) {
+      stats->median = v;
+      medianFound = true;
+    }
+  }
+  FinishStats(count, sum, sumSq, stats);
+}
+
+}  // namespace
+
+bool RegionShape::operator==(const RegionShape &other) const {
+  if (type != other.type || points.size() != other.points.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < points.size(); i++) {
+    if (points[i].x != other.points[i].x || points[i].y != other.points[i].y) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RasterizeRegion(const RegionShape &shape, RegionMask *mask) {
+  mask->spans.clear();
+  mask->pixels = 0;
+  const std::vector<RegionPoint> &pts = shape.points;
+  for (const RegionPoint &p : pts) {
+    if (!std::isfinite(p.x) || !std::isfinite(p.y)) {
+      return false;
+    }
+  }
+
+  switch (shape.type) {
+    case REGION_POINT:
+      if (pts.size() >= 1 && pts[0].x >= 0.0 && pts[0].y >= 0.0) {
+        int32_t x = ClampCoordinate(std::floor(pts[0].x));
+        int32_t y = ClampCoordinate(std::floor(pts[0].y));
+        if (x < kRegionMaxCoordinate && y < kRegionMaxCoordinate) {
+          AddSpan(y, x, x + 1, mask);
+        }
+      }
+      break;
+    case REGION_RECT:
+      if (pts.size() >= 2) {
+        double left = std::min(pts[0].x, pts[1].x);
+        double right = std::max(pts[0].x, pts[1].x);
+        int32_t y0, y1;
+        PixelRange(std::min(pts[0].y, pts[1].y), std::max(pts[0].y, pts[1].y), &y0, &y1);
+        for (int32_t y = y0; y < y1; y++) {
+          AddSpan(y, left, right, mask);
+        }
+      }
+      break;
+    case REGION_CIRCLE:
+      if (pts.size() >= 2) {
+        double r = std::hypot(pts[1].x - pts[0].x, pts[1].y - pts[0].y);
+        if (r > 0.0) {
+          RasterizeEllipse(pts[0].x, pts[0].y, r, r, mask);
+        }
+      }
+      break;
+    case REGION_ELLIPSE:
+      if (pts.size() >= 2) {
+        double rx = std::fabs(pts[1].x - pts[0].x) / 2.0;
+        double ry = std::fabs(pts[1].y - pts[0].y) / 2.0;
+        if (rx > 0.0 && ry > 0.0) {
+          RasterizeEllipse((pts[0].x + pts[1].x) / 2.0, (pts[0].y + pts[1].y) / 2.0, rx, ry, mask);
+        }
+      }
+      break;
+    case REGION_POLYGON:
+      if (pts.size() >= 3) {
+        RasterizePolygon(pts, mask);
+      }
+      break;
+  }
+  return !mask->spans.empty();
+}
+
+void ComputeRegionStats16(const uint16_t *pixels, uint32_t width, uint32_t height, const RegionMask &mask,
+                          RegionStats *stats) {
+  *stats = RegionStats();
+  std::vector<RegionSpan> spans;
+  uint64_t count = ClipSpans(mask, width, height, &spans);
+  if (count == 0) {
+    return;
+  }
+  if (count <= kRegionSelectLimit) {
+    SelectStats(pixels, width, spans, count, stats);
+  } else {
+    HistogramStats(pixels, width, spans, count, stats);
+  }
+}
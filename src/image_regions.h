@@ -0,0 +1,72 @@
+// 区域统计：把测量图形（点、矩形、圆、椭圆、多边形）光栅化为按行的像素段（span），
+// 再在段上统计像素的 count / sum / mean / median / stddev / min / max / SNR。
+//
+// 坐标为整帧像素坐标，像素 (i, j) 占据 [i, i + 1) x [j, j + 1)，像素中心落在图形内即属于该区域。
+// 光栅化只依赖图形本身（不裁剪到图像尺寸），结果可以缓存到图形被编辑为止；统计时再按图像尺寸裁剪，
+// 因此 ROI / bin 变化后同一份缓存仍然可用。
+// 统计只访问段内的像素：小区域逐个收集后用 nth_element 求中位数，大区域按段并行建立私有直方图再合并。
+//
+// 本文件不包含任何 N-API 代码。
+
+#ifndef IMAGE_REGIONS_H
+#define IMAGE_REGIONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum RegionShapeType {
+  REGION_POINT = 0,    // 1 个点：所在的像素
+  REGION_RECT = 1,     // 2 个点：轴对齐矩形的对角
+  REGION_CIRCLE = 2,   // 2 个点：圆心与圆上一点
+  REGION_ELLIPSE = 3,  // 2 个点：轴对齐外接矩形的对角
+  REGION_POLYGON = 4,  // 至少 3 个点：任意多边形（奇偶规则，自交部分按奇偶计）
+};
+
+// 光栅化时坐标裁剪到 [0, kRegionMaxCoordinate)，图形远超出图像时不至于生成海量的段
+static const int32_t kRegionMaxCoordinate = 65536;
+
+struct RegionPoint {
+  double x = 0.0;
+  double y = 0.0;
+};
+
+struct RegionShape {
+  RegionShapeType type = REGION_POINT;
+  std::vector<RegionPoint> points;
+
+  bool operator==(const RegionShape &other) const;
+};
+
+// 一行中的连续像素 [x0, x1)
+struct RegionSpan {
+  int32_t y = 0;
+  int32_t x0 = 0;
+  int32_t x1 = 0;
+};
+
+// 按 y 升序排列的像素段；pixels 为段内像素总数（未按图像尺寸裁剪）
+struct RegionMask {
+  std::vector<RegionSpan> spans;
+  uint64_t pixels = 0;
+};
+
+struct RegionStats {
+  uint64_t count = 0;  // 落在图像内的像素数，为 0 时其余字段都为 0
+  uint32_t min = 0;
+  uint32_t max = 0;
+  uint32_t median = 0;  // 下中位数，与 ImageStats 相同
+  double sum = 0.0;
+  double mean = 0.0;
+  double stddev = 0.0;  // 总体标准差
+  double snr = 0.0;     // mean / stddev，区域内像素完全相同时为 0
+};
+
+// 光栅化一个图形，点数不足或参数退化（半径为 0 等）时返回 false，mask 为空。
+bool RasterizeRegion(const RegionShape &shape, RegionMask *mask);
+
+// 统计 16bit 单通道图像中 mask 覆盖的像素，超出 width x height 的部分忽略。
+void ComputeRegionStats16(const uint16_t *pixels, uint32_t width, uint32_t height, const RegionMask &mask,
+                          RegionStats *stats);
+
+#endif // IMAGE_REGIONS_H
@@ -0,0 +1,449 @@
+#include "image_stars.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "image_binning.h"
+#include "parallel.h"
+
+namespace {
+
+// 每个背景格子在每个方向上最多抽样的像素数
+const uint32_t kBackgroundSamples = 16;
+// 连通区域扫描的条带高度（行）
+const uint32_t kStarStripRows = 64;
+// MAD 换算为正态分布 sigma 的系数
+const float kMadToSigma = 1.4826f;
+// 噪声下限（ADU），避免完全平坦的图像把所有像素都当作星点
+const float kMinNoise = 1.0f;
+// 形状测量的孔径半径范围（像素）
+const float kMinAperture = 3.0f;
+const float kMaxAperture = 32.0f;
+// 高斯星像 FWHM 与 sigma 之比 2 * sqrt(2 * ln 2)
+const float kSigmaToFwhm = 2.35482f;
+// 形状测量的高斯窗宽度（星像 sigma 估计值的倍数）
+const float kShapeWindow = 1.5f;
+
+// 一行中连续高于阈值的像素段，以及段内减去背景后的亮度累加值
+struct Run {
+  uint32_t y;
+  uint32_t x0;
+  uint32_t x1;  // 不含
+  uint32_t parent;
+  double sum;
+  double sumX;
+  double sumY;
+  double bgSum;
+  float peak;
+  uint16_t peakRaw;
+};
+
+struct Strip {
+  std::vector<Run> runs;
+  size_t firstRowEnd = 0;    // runs[0, firstRowEnd) 在条带第一行
+  size_t lastRowBegin = 0;   // runs[lastRowBegin, size) 在条带最后一行
+};
+
+uint32_t FindRoot(std::vector<Run> &runs, uint32_t i) {
+  while (runs[i].parent != i) {
+    runs[i].parent = runs[runs[i].parent].parent;
+    i = runs[i].parent;
+  }
+  return i;
+}
+
+void Union(std::vector<Run> &runs, uint32_t a, uint32_t b) {
+  a = FindRoot(runs, a);
+  b = FindRoot(runs, b);
+  if (a != b) {
+    // 总是挂到较小的下标上，结果与扫描顺序无关
+    runs[std::max(a, b)].parent = std::min(a, b);
+  }
+}
+
+// 两行中的段按 8 连通合并：x 范围相交或相邻即连通。两组段都按 x 升序排列。
+void UnionRows(std::vector<Run> &runs, size_t aBegin, size_t aEnd, size_t bBegin, size_t bEnd) {
+  size_t i = aBegin;
+  size_t j = bBegin;
+  while (i < aEnd && j < bEnd) {
+    const Run &a = runs[i];
+    const Run &b = runs[j];
+    if (a.x0 <= b.x1 && b.x0 <= a.x1) {
+      Union(runs, (uint32_t)i, (uint32_t)j);
+    }
+    if (a.x1 < b.x1) {
+      i++;
+    } else {
+      j++;
+    }
+  }
+}
+
+float MedianOf(std::vector<float> &values) {
+  if (values.empty()) {
+    return 0.0f;
+  }
+  auto mid = values.begin() + values.size() / 2;
+  std::nth_element(values.begin(), mid, values.end());
+  return *mid;
+}
+
+// 逐格背景（中位数）与噪声（MAD），背景再做 3x3 中值滤波，去掉被亮星或星云占据的格子
+struct BackgroundGrid {
+  uint32_t cols = 0;
+  uint32_t rows = 0;
+  std::vector<float> level;
+  float noise = 0.0f;
+  float median = 0.0f;
+
+  void Build(const uint16_t *pixels, uint32_t width, uint32_t height) {
+    cols = (width + kStarBackgroundCell - 1) / kStarBackgroundCell;
+    rows = (height + kStarBackgroundCell - 1) / kStarBackgroundCell;
+    std::vector<float> raw((size_t)cols * rows);
+    std::vector<float> mad((size_t)cols * rows);
+    ParallelFor((size_t)cols * rows, 16, [&](size_t begin, size_t end) {
+      std::vector<float> samples;
+      samples.reserve(kBackgroundSamples * kBackgroundSamples);
+      for (size_t c = begin; c < end; c++) {
+        const uint32_t x0 = (uint32_t)(c % cols) * kStarBackgroundCell;
+        const uint32_t y0 = (uint32_t)(c / cols) * kStarBackgroundCell;
+        const uint32_t x1 = std::min(width, x0 + kStarBackgroundCell);
+        const uint32_t y1 = std::min(height, y0 + kStarBackgroundCell);
+        const uint32_t stepX = std::max(1u, (x1 - x0) / kBackgroundSamples);
+        const uint32_t stepY = std::max(1u, (y1 - y0) / kBackgroundSamples);
+        samples.clear();
+        for (uint32_t y = y0 + stepY / 2; y < y1; y += stepY) {
+          const uint16_t *row = pixels + (size_t)y * width;
+          for (uint32_t x = x0 + stepX / 2; x < x1; x += stepX) {
+            samples.push_back((float)row[x]);
+          }
+        }
+        const float med = MedianOf(samples);
+        for (float &v : samples) {
+          v = std::fabs(v - med);
+        }
+        raw[c] = med;
+        mad[c] = MedianOf(samples);
+      }
+    });
+
+    level.resize(raw.size());
+    for (uint32_t gy = 0; gy < rows; gy++) {
+      for (uint32_t gx = 0; gx < cols; gx++) {
+        float window[9];
+        size_t n = 0;
+        for (uint32_t y = gy > 0 ? gy - 1 : 0; y <= std::min(rows - 1, gy + 1); y++) {
+          for (uint32_t x = gx > 0 ? gx - 1 : 0; x <= std::min(cols - 1, gx + 1); x++) {
+            window[n++] = raw[(size_t)y * cols + x];
+          }
+        }
+        std::nth_element(window, window + n / 2, window + n);
+        level[(size_t)gy * cols + gx] = window[n / 2];
+      }
+    }
+    noise = std::max(kMinNoise, kMadToSigma * MedianOf(mad));
+    median = MedianOf(raw);
+  }
+
+  // 第 y 行各格子列的背景（纵向插值），之后按列横向插值
+  void Row(uint32_t y, float *out) const {
+    const float fy = ((float)y + 0.5f) / (float)kStarBackgroundCell - 0.5f;
+    const uint32_t y0 = fy <= 0.0f ? 0 : std::min(rows - 1, (uint32_t)fy);
+    const uint32_t y1 = std::min(rows - 1, y0 + 1);
+    const float t = std::min(1.0f, std::max(0.0f, fy - (float)y0));
+    for (uint32_t x = 0; x < cols; x++) {
+      out[x] = level[(size_t)y0 * cols + x] * (1.0f - t) + level[(size_t)y1 * cols + x] * t;
+    }
+  }
+
+  float At(const float *row, uint32_t x) const {
+    const float fx = ((float)x + 0.5f) / (float)kStarBackgroundCell - 0.5f;
+    const uint32_t x0 = fx <= 0.0f ? 0 : std::min(cols - 1, (uint32_t)fx);
+    const uint32_t x1 = std::min(cols - 1, x0 + 1);
+    const float t = std::min(1.0f, std::max(0.0f, fx - (float)x0));
+    return row[x0] * (1.0f - t) + row[x1] * t;
+  }
+};
+
+// 扫描 [y0, y1) 行，记录高于阈值的段并在条带内合并
+void ScanStrip(const uint16_t *pixels, uint32_t width, uint32_t y0, uint32_t y1, const BackgroundGrid &grid,
+               float threshold, Strip *strip) {
+  std::vector<float> rowLevel(grid.cols);
+  size_t prevBegin = 0;
+  size_t prevEnd = 0;
+  for (uint32_t y = y0; y < y1; y++) {
+    grid.Row(y, rowLevel.data());
+    const float minLevel = *std::min_element(rowLevel.begin(), rowLevel.end());
+    // 先与本行最低阈值做整数比较，只对候选像素插值背景
+    const float quick = minLevel + threshold;
+    const uint16_t quickLimit = quick >= 65535.0f ? 65535 : (uint16_t)quick;
+    const uint16_t *row = pixels + (size_t)y * width;
+    const size_t rowBegin = strip->runs.size();
+    bool open = false;
+    for (uint32_t x = 0; x < width; x++) {
+      const uint16_t raw = row[x];
+      float value = 0.0f;
+      float level = 0.0f;
+      bool above = false;
+      if (raw > quickLimit) {
+        level = grid.At(rowLevel.data(), x);
+        value = (float)raw - level;
+        above = value > threshold;
+      }
+      if (!above) {
+        if (open) {
+          strip->runs.back().x1 = x;
+          open = false;
+        }
+        continue;
+      }
+      if (!open) {
+        Run run = {};
+        run.y = y;
+        run.x0 = x;
+        run.parent = (uint32_t)strip->runs.size();
+        strip->runs.push_back(run);
+        open = true;
+      }
+      Run &run = strip->runs.back();
+      run.sum += value;
+      run.sumX += (double)value * x;
+      run.sumY += (double)value * y;
+      run.bgSum += level;
+      run.peak = std::max(run.peak, value);
+      run.peakRaw = std::max(run.peakRaw, raw);
+    }
+    if (open) {
+      strip->runs.back().x1 = width;
+    }
+    const size_t rowEnd = strip->runs.size();
+    if (y == y0) {
+      strip->firstRowEnd = rowEnd;
+    } else {
+      UnionRows(strip->runs, prevBegin, prevEnd, rowBegin, rowEnd);
+    }
+    strip->lastRowBegin = rowBegin;
+    prevBegin = rowBegin;
+    prevEnd = rowEnd;
+  }
+}
+
+// 在孔径内测量一颗星的 HFR / FWHM / 偏心率。孔径半径按高斯星像 flux = 2 * pi * sigma^2 * peak 估计的
+// 4 sigma 取（截断后二阶矩只偏小约 0.1%）。权重是减去背景后的有符号亮度：噪声只增加方差，不引入偏差。
+void MeasureShape(const uint16_t *pixels, uint32_t width, uint32_t height, Star *star) {
+  const float sigma = star->peak > 0.0f ? std::sqrt(star->flux / (2.0f * 3.14159265f * star->peak)) : 1.0f;
+  const float radius = std::min(kMaxAperture, std::max(kMinAperture, 4.0f * sigma + 1.0f));
+  const float radius2 = radius * radius;
+  const int x0 = std::max(0, (int)std::floor(star->x - radius));
+  const int x1 = std::min((int)width - 1, (int)std::ceil(star->x + radius));
+  const int y0 = std::max(0, (int)std::floor(star->y - radius));
+  const int y1 = std::min((int)height - 1, (int)std::ceil(star->y + radius));
+  // 偏心率与 FWHM 用高斯窗加权的二阶矩（降低孔径边缘噪声的影响），再按高斯星像扣除窗函数：
+  // 星像协方差 C 与窗 W 相乘后测得 (C^-1 + W^-1)^-1，因此 C = (M^-1 - W^-1)^-1
+  const float window2 = std::max(1.0f, sigma * sigma) * kShapeWindow * kShapeWindow;
+  const float windowScale = -0.5f / window2;
+  double sum = 0.0;
+  double sumR = 0.0;
+  double sumW = 0.0;
+  double sumX = 0.0;
+  double sumY = 0.0;
+  double sumXX = 0.0;
+  double sumYY = 0.0;
+  double sumXY = 0.0;
+  for (int y = y0; y <= y1; y++) {
+    const uint16_t *row = pixels + (size_t)y * width;
+    const float dy = (float)y - star->y;
+    for (int x = x0; x <= x1; x++) {
+      const float dx = (float)x - star->x;
+      const float r2 = dx * dx + dy * dy;
+      if (r2 > radius2) {
+        continue;
+      }
+      const float v = (float)row[x] - star->background;
+      const float vw = v * std::exp(r2 * windowScale);
+      sum += v;
+      sumR += v * std::sqrt(r2);
+      sumW += vw;
+      sumX += vw * dx;
+      sumY += vw * dy;
+      sumXX += vw * dx * dx;
+      sumYY += vw * dy * dy;
+      sumXY += vw * dx * dy;
+    }
+  }
+  if (sum <= 0.0 || sumW <= 0.0) {
+    return;
+  }
+  star->hfr = (float)std::max(0.0, sumR / sum);
+  const double mx = sumX / sumW;
+  const double my = sumY / sumW;
+  double xx = sumXX / sumW - mx * mx;
+  double yy = sumYY / sumW - my * my;
+  double xy = sumXY / sumW - mx * my;
+  // M^-1 - W^-1，再求逆
+  double det = xx * yy - xy * xy;
+  if (det <= 0.0) {
+    return;
+  }
+  const double ixx = yy / det - 1.0 / window2;
+  const double iyy = xx / det - 1.0 / window2;
+  const double ixy = -xy / det;
+  det = ixx * iyy - ixy * ixy;
+  if (ixx <= 0.0 || det <= 0.0) {
+    return;
+  }
+  // 像素积分使每个方向的方差多出 1 / 12
+  xx = iyy / det - 1.0 / 12.0;
+  yy = ixx / det - 1.0 / 12.0;
+  xy = -ixy / det;
+  const double half = 0.5 * (xx + yy);
+  const double diff = std::sqrt(0.25 * (xx - yy) * (xx - yy) + xy * xy);
+  const double major = half + diff;
+  const double minor = std::max(0.0, half - diff);
+  star->fwhm = half > 0.0 ? kSigmaToFwhm * (float)std::sqrt(half) : 0.0f;
+  star->eccentricity = major > 0.0 ? (float)std::sqrt(std::max(0.0, 1.0 - minor / major)) : 0.0f;
+}
+
+float MedianOfStars(const std::vector<Star> &stars, float Star::*field) {
+  std::vector<float> values;
+  values.reserve(stars.size());
+  for (const Star &s : stars) {
+    if (!s.saturated && s.hfr > 0.0f) {
+      values.push_back(s.*field);
+    }
+  }
+  return MedianOf(values);
+}
+
+}  // namespace
+
+void DetectStars16(const uint16_t *pixels, uint32_t width, uint32_t height, const StarDetectOptions &options,
+                   std::vector<Star> *stars, StarBackground *background) {
+  stars->clear();
+  if (width == 0 || height == 0) {
+    if (background) {
+      *background = StarBackground();
+    }
+    return;
+  }
+  BackgroundGrid grid;
+  grid.Build(pixels, width, height);
+  if (background) {
+    background->level = grid.median;
+    background->noise = grid.noise;
+  }
+  const float threshold = options.threshold * grid.noise;
+
+  const uint32_t stripCount = (height + kStarStripRows - 1) / kStarStripRows;
+  std::vector<Strip> strips(stripCount);
+  ParallelFor(stripCount, 1, [&](size_t begin, size_t end) {
+    for (size_t s = begin; s < end; s++) {
+      const uint32_t y0 = (uint32_t)s * kStarStripRows;
+      ScanStrip(pixels, width, y0, std::min(height, y0 + kStarStripRows), grid, threshold, &strips[s]);
+    }
+  });
+
+  // 拼接各条带的段（下标整体平移），再合并相邻条带的首末行
+  std::vector<Run> runs;
+  std::vector<size_t> offsets(stripCount + 1, 0);
+  for (uint32_t s = 0; s < stripCount; s++) {
+    offsets[s + 1] = offsets[s] + strips[s].runs.size();
+  }
+  runs.reserve(offsets[stripCount]);
+  for (uint32_t s = 0; s < stripCount; s++) {
+    for (Run run : strips[s].runs) {
+      run.parent += (uint32_t)offsets[s];
+      runs.push_back(run);
+    }
+  }
+  for (uint32_t s = 0; s + 1 < stripCount; s++) {
+    const Strip &upper = strips[s];
+    const Strip &lower = strips[s + 1];
+    const uint32_t boundary = (s + 1) * kStarStripRows;
+    if (upper.runs.empty() || lower.runs.empty() || upper.runs.back().y != boundary - 1 ||
+        lower.runs.front().y != boundary) {
+      continue;
+    }
+    UnionRows(runs, offsets[s] + upper.lastRowBegin, offsets[s + 1], offsets[s + 1],
+              offsets[s + 1] + lower.firstRowEnd);
+  }
+
+  // 按根节点汇总为连通区域
+  std::vector<uint32_t> component(runs.size(), UINT32_MAX);
+  std::vector<Run> merged;
+  std::vector<uint32_t> area;
+  for (size_t i = 0; i < runs.size(); i++) {
+    const uint32_t root = FindRoot(runs, (uint32_t)i);
+    if (component[root] == UINT32_MAX) {
+      component[root] = (uint32_t)merged.size();
+      Run empty = {};
+      merged.push_back(empty);
+      area.push_back(0);
+    }
+    const uint32_t c = component[root];
+    const Run &r = runs[i];
+    Run &m = merged[c];
+    m.sum += r.sum;
+    m.sumX += r.sumX;
+    m.sumY += r.sumY;
+    m.bgSum += r.bgSum;
+    m.peak = std::max(m.peak, r.peak);
+    m.peakRaw = std::max(m.peakRaw, r.peakRaw);
+    area[c] += r.x1 - r.x0;
+  }
+
+  for (size_t c = 0; c < merged.size(); c++) {
+    const Run &m = merged[c];
+    if (area[c] < options.minArea || area[c] > options.maxArea || m.sum <= 0.0) {
+      continue;
+    }
+    Star star;
+    star.x = (float)(m.sumX / m.sum);
+    star.y = (float)(m.sumY / m.sum);
+    star.flux = (float)m.sum;
+    star.peak = m.peak;
+    star.background = (float)(m.bgSum / area[c]);
+    star.area = area[c];
+    star.saturated = m.peakRaw >= options.saturation;
+    stars->push_back(star);
+  }
+  std::sort(stars->begin(), stars->end(), [](const Star &a, const Star &b) { return a.flux > b.flux; });
+  if (options.maxStars > 0 && stars->size() > options.maxStars) {
+    stars->resize(options.maxStars);
+  }
+  if (options.measureShape) {
+    ParallelFor(stars->size(), 16, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        MeasureShape(pixels, width, height, &(*stars)[i]);
+      }
+    });
+  }
+}
+
+void DetectStarsBayer16(const uint16_t *pixels, uint32_t width, uint32_t height, const StarDetectOptions &options,
+                        std::vector<uint16_t> *luminance, std::vector<Star> *stars, StarBackground *background) {
+  uint32_t lw = 0;
+  uint32_t lh = 0;
+  SoftwareBinSize(width, height, 2, false, &lw, &lh);
+  luminance->resize((size_t)lw * lh);
+  SoftwareBin16(pixels, width, height, 2, BIN_AVERAGE, false, luminance->data());
+  DetectStars16(luminance->data(), lw, lh, options, stars, background);
+  // 合并像素 (x, y) 的中心在原图的 (2x + 0.5, 2y + 0.5)
+  for (Star &s : *stars) {
+    s.x = s.x * 2.0f + 0.5f;
+    s.y = s.y * 2.0f + 0.5f;
+    s.hfr *= 2.0f;
+    s.fwhm *= 2.0f;
+  }
+}
+
+void SummarizeStars(const std::vector<Star> &stars, StarFieldSummary *summary) {
+  *summary = StarFieldSummary();
+  summary->count = (uint32_t)stars.size();
+  for (const Star &s : stars) {
+    summary->saturated += s.saturated ? 1 : 0;
+  }
+  summary->medianHfr = MedianOfStars(stars, &Star::hfr);
+  summary->medianFwhm = MedianOfStars(stars, &Star::fwhm);
+  summary->medianEccentricity = MedianOfStars(stars, &Star::eccentricity);
+}
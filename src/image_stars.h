@@ -0,0 +1,72 @@
+// 星点检测：估计背景与噪声，阈值以上的连通区域即为候选星点，按亮度加权求亚像素质心。
+//
+// 背景：把图像分成 kStarBackgroundCell 见方的格子，每格抽样求中位数与 MAD（稳健，不受格内少量星点影响），
+// 格子之间双线性插值得到逐像素背景；噪声取各格 MAD 的中位数（换算为 sigma）。
+// 连通区域：按行条带并行扫描，每行把高于 背景 + threshold * 噪声 的连续像素记为一段（run），
+// 与上一行重叠（8 连通）的段用并查集合并；条带之间只需合并相邻的首末行。每段在扫描时就累加好
+// 减去背景后的亮度与一阶矩，合并后直接得到质心，不再回头访问像素。
+// 形状（measureShape）：阈值以内的像素只是星像的核心，HFR / FWHM 会被低估，因此对保留下来的每颗星
+// 以质心为圆心、按 flux / peak 估计的 4 sigma 为半径再访问一次孔径内的像素（各星并行）：
+// HFR 为按亮度加权的平均半径（与 N.I.N.A. / PHD2 等对焦软件的定义相同），FWHM 与偏心率取自二阶中心矩。
+//
+// 本文件不包含任何 N-API 代码。
+
+#ifndef IMAGE_STARS_H
+#define IMAGE_STARS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static const uint32_t kStarBackgroundCell = 64;
+
+struct StarDetectOptions {
+  float threshold = 5.0f;       // 检测阈值，背景噪声的倍数
+  uint32_t minArea = 3;         // 小于该像素数的区域视为噪声或热像素
+  uint32_t maxArea = 4096;      // 大于该像素数的区域（星云、亮星光晕、卫星轨迹）丢弃
+  uint16_t saturation = 65000;  // 峰值达到该值的星点标记为饱和
+  size_t maxStars = 0;          // 按亮度保留最亮的若干颗，0 表示全部保留
+  bool measureShape = false;    // 计算每颗星的 HFR / FWHM / 偏心率
+};
+
+// 坐标以像素中心为整数，(0, 0) 为左上角像素的中心
+struct Star {
+  float x = 0.0f;
+  float y = 0.0f;
+  float flux = 0.0f;        // 减去背景后的总亮度（ADU）
+  float peak = 0.0f;        // 减去背景后的峰值
+  float background = 0.0f;  // 质心处的背景
+  uint32_t area = 0;        // 阈值以上的像素数
+  bool saturated = false;
+  // 以下仅在 measureShape 时计算，单位为像素；孔径内亮度之和不为正时为 0
+  float hfr = 0.0f;
+  float fwhm = 0.0f;
+  float eccentricity = 0.0f;  // 0 为正圆，越接近 1 越扁（拖线、跟踪误差、像差）
+};
+
+struct StarBackground {
+  float level = 0.0f;  // 背景中位数
+  float noise = 0.0f;  // 背景噪声（sigma）
+};
+
+// 检测 16bit 单通道图像中的星点，按 flux 从大到小排列。background 可以为 NULL。
+void DetectStars16(const uint16_t *pixels, uint32_t width, uint32_t height, const StarDetectOptions &options,
+                   std::vector<Star> *stars, StarBackground *background);
+
+// 彩色相机的 Bayer 帧：先 2x2 合并为亮度图（luminance 为调用方保留的缓冲区）再检测，
+// 坐标与 HFR / FWHM 换算回原图像素。
+void DetectStarsBayer16(const uint16_t *pixels, uint32_t width, uint32_t height, const StarDetectOptions &options,
+                        std::vector<uint16_t> *luminance, std::vector<Star> *stars, StarBackground *background);
+
+// 一帧星点的汇总：中位数只统计未饱和且形状有效的星（饱和星的星像是平顶，HFR 偏大）
+struct StarFieldSummary {
+  uint32_t count = 0;
+  uint32_t saturated = 0;
+  float medianHfr = 0.0f;
+  float medianFwhm = 0.0f;
+  float medianEccentricity = 0.0f;
+};
+
+void SummarizeStars(const std::vector<Star> &stars, StarFieldSummary *summary);
+
+#endif // IMAGE_STARS_H
@@ -0,0 +1,114 @@
+#include "image_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+
+namespace {
+
+// 每个线程至少分到的像素数；像素太少时私有直方图的清零与合并比统计本身还贵
+const size_t kStatsMinPixelsPerThread = 1 << 20;
+
+template <typename T>
+void CountPixels(const T *pixels, size_t count, uint32_t *bins) {
+  // 两组计数交替累加，连续相同像素值（暗场、饱和区域）时不会串行等待同一个计数器
+  size_t i = 0;
+  uint32_t *odd = bins + kHistogramBins;
+  for (; i + 2 <= count; i += 2) {
+    bins[pixels[i]]++;
+    odd[pixels[i + 1]]++;
+  }
+  if (i < count) {
+    bins[pixels[i]]++;
+  }
+}
+
+template <typename T>
+void BuildHistogram(const T *pixels, size_t count, std::vector<uint32_t> *histogram) {
+  size_t parts = std::max<size_t>(1, std::min(ParallelThreadCount(), count / kStatsMinPixelsPerThread));
+
+  // 每段两张私有直方图（见 CountPixels），合并到第 0 张
+  std::vector<std::vector<uint32_t>> partial(parts);
+  ParallelFor(parts, 1, [&](size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      partial[p].assign(kHistogramBins * 2, 0);
+      size_t first = count * p / parts;
+      size_t last = count * (p + 1) / parts;
+      CountPixels(pixels + first, last - first, partial[p].data());
+    }
+  });
+
+  histogram->assign(kHistogramBins, 0);
+  uint32_t *out = histogram->data();
+  ParallelFor(kHistogramBins, 4096, [&](size_t begin, size_t end) {
+    for (const std::vector<uint32_t> &bins : partial) {
+      const uint32_t *even = bins.data();
+      const uint32_t *odd = even + kHistogramBins;
+      for (size_t v = begin; v < end; v++) {
+        out[v] += even[v] + odd[v];
+      }
+    }
+  });
+}
+
+// 由直方图得到其余统计量，全部为整数累加，结果与逐像素计算完全一致
+void SummarizeHistogram(uint64_t count, ImageStats *stats) {
+  stats->count = count;
+  stats->min = stats->max = stats->median = 0;
+  stats->mean = stats->stddev = 0.0;
+  if (count == 0) {
+    return;
+  }
+
+  const uint32_t *bins = stats->histogram.data();
+  uint64_t sum = 0;
+  uint64_t sumSq = 0;  // 最大 65535^2 * count，count < 4e9 时不会溢出
+  uint64_t cumulative = 0;
+  uint64_t half = (count + 1) / 2;
+  bool first = true;
+  bool medianFound = false;
+  for (uint32_t v = 0; v < kHistogramBins; v++) {
+    uint64_t n = bins[v];
+    if (n == 0) {
+      continue;
+    }
+    if (first) {
+      stats->min = v;
+      first = false;
+    }
+    stats->max = v;
+    sum += n * v;
+    sumSq += n * v * v;
+    cumulative += n;
+    if (!medianFound && cumulative >= half) {
+      stats->median = v;
+      medianFound = true;
+    }
+  }
+
+  double mean = (double)sum / (double)count;
+  double variance = (double)sumSq / (double)count - mean * mean;
+  stats->mean = mean;
+  stats->stddev = variance > 0.0 ? std::sqrt(variance) : 0.0;
+}
+
+}  // namespace
+
+void ComputeImageStats16(const uint16_t *pixels, size_t count, ImageStats *stats) {
+  BuildHistogram(pixels, count, &stats->histogram);
+  SummarizeHistogram(count, stats);
+}
+
+void ComputeImageStats8(const uint8_t *pixels, size_t count, ImageStats *stats) {
+  BuildHistogram(pixels, count, &stats->histogram);
+  SummarizeHistogram(count, stats);
+}
+
+void ComputeFrameStats(const uint8_t *data, size_t bytes, uint32_t bpp, ImageStats *stats) {
+  if (bpp <= 8) {
+    ComputeImageStats8(data, bytes, stats);
+  } else {
+    ComputeImageStats16(reinterpret_cast<const uint16_t *>(data), bytes / sizeof(uint16_t), stats);
+  }
+}
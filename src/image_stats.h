@@ -0,0 +1,32 @@
+// 图像统计：完整的 65536 级直方图，以及由直方图精确得到的 min / max / mean / median / stddev。
+// 像素按线程分段，各线程写入自己的私有直方图，最后再合并，线程之间没有共享写入。
+
+#ifndef IMAGE_STATS_H
+#define IMAGE_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static const size_t kHistogramBins = 65536;
+
+struct ImageStats {
+  uint64_t count = 0;
+  uint32_t min = 0;
+  uint32_t max = 0;
+  uint32_t median = 0;  // 下中位数：累计数首次达到 (count + 1) / 2 的像素值
+  double mean = 0.0;
+  double stddev = 0.0;  // 总体标准差
+  std::vector<uint32_t> histogram;  // kHistogramBins 项，8bit 数据只用到前 256 项
+};
+
+// 统计 count 个 16bit 像素。
+void ComputeImageStats16(const uint16_t *pixels, size_t count, ImageStats *stats);
+
+// 统计 count 个 8bit 像素。
+void ComputeImageStats8(const uint8_t *pixels, size_t count, ImageStats *stats);
+
+// 按位深统计一帧数据：bpp <= 8 时按字节，否则按 16bit 像素。bytes 为有效数据长度。
+void ComputeFrameStats(const uint8_t *data, size_t bytes, uint32_t bpp, ImageStats *stats);
+
+#endif // IMAGE_STATS_H
@@ -0,0 +1,236 @@
+#include "image_stretch.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "cpu_features.h"
+#include "parallel.h"
+
+#ifdef QHY_ARCH_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef QHY_ARCH_ARM64
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// 每个线程块至少处理的像素数，太小时调度开销大于计算本身
+const size_t kStretchMinChunk = 1 << 16;
+
+// 定点参数：d = min(max(v - black, 0), range) << shift，out = (d * mul + 0x8000) >> 16。
+// range < 256 时先左移 8 位，保证 mul = round(255 * 65536 / (range << shift)) 能放进 16bit。
+struct StretchParams {
+  uint16_t black;
+  uint16_t range;
+  int shift;
+  uint16_t mul;
+};
+
+StretchParams MakeParams(uint16_t black, uint16_t white) {
+  StretchParams p;
+  p.black = black;
+  uint32_t range = white > black ? (uint32_t)(white - black) : 1u;
+  p.range = (uint16_t)range;
+  p.shift = range < 256 ? 8 : 0;
+  uint32_t scaled = range << p.shift;
+  p.mul = (uint16_t)((255u * 65536u + scaled / 2) / scaled);
+  return p;
+}
+
+inline uint8_t StretchPixel(uint16_t v, const StretchParams &p) {
+  uint32_t d = v > p.black ? (uint32_t)(v - p.black) : 0u;
+  d = std::min<uint32_t>(d, p.range) << p.shift;
+  return (uint8_t)((d * p.mul + 0x8000u) >> 16);
+}
+
+void StretchScalarRange(const uint16_t *src, uint8_t *dst, size_t count,
+                        const StretchParams &p, StretchFormat format) {
+  if (format == STRETCH_RGBA8) {
+    for (size_t i = 0; i < count; i++) {
+      uint8_t g = StretchPixel(src[i], p);
+      dst[i * 4 + 0] = g;
+      dst[i * 4 + 1] = g;
+      dst[i * 4 + 2] = g;
+      dst[i * 4 + 3] = 255;
+    }
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      dst[i] = StretchPixel(src[i], p);
+    }
+  }
+}
+
+#ifdef QHY_ARCH_X86
+
+// 8 个像素的定点映射，结果为 0-255 的 16bit 值
+inline __m128i StretchSse2(__m128i v, __m128i black, __m128i range, __m128i shift, __m128i mul) {
+  __m128i d = _mm_subs_epu16(v, black);
+  d = _mm_sub_epi16(d, _mm_subs_epu16(d, range));  // min(d, range)，SSE2 没有 min_epu16
+  d = _mm_sll_epi16(d, shift);
+  __m128i hi = _mm_mulhi_epu16(d, mul);
+  __m128i lo = _mm_mullo_epi16(d, mul);
+  return _mm_add_epi16(hi, _mm_srli_epi16(lo, 15));
+}
+
+void StretchSse2Range(const uint16_t *src, uint8_t *dst, size_t count,
+                      const StretchParams &p, StretchFormat format) {
+  const __m128i black = _mm_set1_epi16((short)p.black);
+  const __m128i range = _mm_set1_epi16((short)p.range);
+  const __m128i shift = _mm_cvtsi32_si128(p.shift);
+  const __m128i mul = _mm_set1_epi16((short)p.mul);
+  const __m128i alpha = _mm_set1_epi16((short)0xFF00);
+  size_t i = 0;
+  if (format == STRETCH_RGBA8) {
+    for (; i + 8 <= count; i += 8) {
+      __m128i g = StretchSse2(_mm_loadu_si128((const __m128i *)(src + i)), black, range, shift, mul);
+      __m128i gg = _mm_or_si128(g, _mm_slli_epi16(g, 8));  // 低 16bit：R G
+      __m128i ga = _mm_or_si128(g, alpha);                 // 高 16bit：B A
+      _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_unpacklo_epi16(gg, ga));
+      _mm_storeu_si128((__m128i *)(dst + i * 4 + 16), _mm_unpackhi_epi16(gg, ga));
+    }
+  } else {
+    for (; i + 16 <= count; i += 16) {
+      __m128i a = StretchSse2(_mm_loadu_si128((const __m128i *)(src + i)), black, range, shift, mul);
+      __m128i b = StretchSse2(_mm_loadu_si128((const __m128i *)(src + i + 8)), black, range, shift, mul);
+      _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+    }
+  }
+  StretchScalarRange(src + i, dst + i * StretchBytesPerPixel(format), count - i, p, format);
+}
+
+QHY_TARGET_AVX2
+inline __m256i StretchAvx2(__m256i v, __m256i black, __m256i range, __m128i shift, __m256i mul) {
+  __m256i d = _mm256_min_epu16(_mm256_subs_epu16(v, black), range);
+  d = _mm256_sll_epi16(d, shift);
+  __m256i hi = _mm256_mulhi_epu16(d, mul);
+  __m256i lo = _mm256_mullo_epi16(d, mul);
+  return _mm256_add_epi16(hi, _mm256_srli_epi16(lo, 15));
+}
+
+QHY_TARGET_AVX2
+void StretchAvx2Range(const uint16_t *src, uint8_t *dst, size_t count,
+                      const StretchParams &p, StretchFormat format) {
+  const __m256i black = _mm256_set1_epi16((short)p.black);
+  const __m256i range = _mm256_set1_epi16((short)p.range);
+  const __m128i shift = _mm_cvtsi32_si128(p.shift);
+  const __m256i mul = _mm256_set1_epi16((short)p.mul);
+  const __m256i alpha = _mm256_set1_epi16((short)0xFF00);
+  size_t i = 0;
+  if (format == STRETCH_RGBA8) {
+    for (; i + 16 <= count; i += 16) {
+      __m256i g = StretchAvx2(_mm256_loadu_si256((const __m256i *)(src + i)), black, range, shift, mul);
+      __m256i gg = _mm256_or_si256(g, _mm256_slli_epi16(g, 8));
+      __m256i ga = _mm256_or_si256(g, alpha);
+      // unpack 在每个 128bit 通道内进行：lo = 像素 0-3 / 8-11，hi = 像素 4-7 / 12-15
+      __m256i lo = _mm256_unpacklo_epi16(gg, ga);
+      __m256i hi = _mm256_unpackhi_epi16(gg, ga);
+      _mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+      _mm256_storeu_si256((__m256i *)(dst + i * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+  } else {
+    for (; i + 32 <= count; i += 32) {
+      __m256i a = StretchAvx2(_mm256_loadu_si256((const __m256i *)(src + i)), black, range, shift, mul);
+      __m256i b = StretchAvx2(_mm256_loadu_si256((const __m256i *)(src + i + 16)), black, range, shift, mul);
+      // packus 同样按 128bit 通道交错，需要重排 64bit 块恢复顺序
+      __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+      _mm256_storeu_si256((__m256i *)(dst + i), packed);
+    }
+  }
+  StretchSse2Range(src + i, dst + i * StretchBytesPerPixel(format), count - i, p, format);
+}
+
+#endif // QHY_ARCH_X86
+
+#ifdef QHY_ARCH_ARM64
+
+inline uint8x8_t StretchNeon(uint16x8_t v, uint16x8_t black, uint16x8_t range, int16x8_t shift, uint16x4_t mul) {
+  uint16x8_t d = vminq_u16(vqsubq_u16(v, black), range);
+  d = vshlq_u16(d, shift);
+  // vrshrn 即 (x + 0x8000) >> 16，与标量版本的舍入一致
+  uint16x4_t lo = vrshrn_n_u32(vmull_u16(vget_low_u16(d), mul), 16);
+  uint16x4_t hi = vrshrn_n_u32(vmull_u16(vget_high_u16(d), mul), 16);
+  return vmovn_u16(vcombine_u16(lo, hi));
+}
+
+void StretchNeonRange(const uint16_t *src, uint8_t *dst, size_t count,
+                      const StretchParams &p, StretchFormat format) {
+  const uint16x8_t black = vdupq_n_u16(p.black);
+  const uint16x8_t range = vdupq_n_u16(p.range);
+  const int16x8_t shift = vdupq_n_s16((int16_t)p.shift);
+  const uint16x4_t mul = vdup_n_u16(p.mul);
+  const uint8x8_t alpha = vdup_n_u8(255);
+  size_t i = 0;
+  if (format == STRETCH_RGBA8) {
+    for (; i + 8 <= count; i += 8) {
+      uint8x8_t g = StretchNeon(vld1q_u16(src + i), black, range, shift, mul);
+      uint8x8x4_t rgba = {{g, g, g, alpha}};
+      vst4_u8(dst + i * 4, rgba);
+    }
+  } else {
+    for (; i + 16 <= count; i += 16) {
+      uint8x8_t a = StretchNeon(vld1q_u16(src + i), black, range, shift, mul);
+      uint8x8_t b = StretchNeon(vld1q_u16(src + i + 8), black, range, shift, mul);
+      vst1q_u8(dst + i, vcombine_u8(a, b));
+    }
+  }
+  StretchScalarRange(src + i, dst + i * StretchBytesPerPixel(format), count - i, p, format);
+}
+
+#endif // QHY_ARCH_ARM64
+
+typedef void (*StretchRangeFn)(const uint16_t *, uint8_t *, size_t, const StretchParams &, StretchFormat);
+
+StretchRangeFn SelectStretchKernel() {
+  const CpuFeatures &cpu = GetCpuFeatures();
+#ifdef QHY_ARCH_X86
+  if (cpu.avx2) return StretchAvx2Range;
+  if (cpu.sse2) return StretchSse2Range;
+#endif
+#ifdef QHY_ARCH_ARM64
+  if (cpu.neon) return StretchNeonRange;
+#endif
+  (void)cpu;
+  return StretchScalarRange;
+}
+
+}  // namespace
+
+size_t StretchBytesPerPixel(StretchFormat format) {
+  return format == STRETCH_RGBA8 ? 4 : 1;
+}
+
+void StretchLevels16(const uint16_t *src, uint8_t *dst, size_t count,
+                     uint16_t black, uint16_t white, StretchFormat format) {
+  static const StretchRangeFn kernel = SelectStretchKernel();
+  const StretchParams params = MakeParams(black, white);
+  const size_t bpp = StretchBytesPerPixel(format);
+  ParallelFor(count, kStretchMinChunk, [&](size_t begin, size_t end) {
+    kernel(src + begin, dst + begin * bpp, end - begin, params, format);
+  });
+}
+
+void StretchLevelsRgb16(const uint16_t *src, uint8_t *dst, size_t pixelCount,
+                        uint16_t black, uint16_t white) {
+  static const StretchRangeFn kernel = SelectStretchKernel();
+  const StretchParams params = MakeParams(black, white);
+  // 先把各通道当作灰度拉伸（复用 SIMD 内核），再补上 alpha 展开为 RGBA
+  ParallelFor(pixelCount, kStretchMinChunk / 4, [&](size_t begin, size_t end) {
+    std::vector<uint8_t> rgb((end - begin) * 3);
+    kernel(src + begin * 3, rgb.data(), rgb.size(), params, STRETCH_GRAY8);
+    uint8_t *out = dst + begin * 4;
+    for (size_t i = 0; i < end - begin; i++) {
+      out[i * 4] = rgb[i * 3];
+      out[i * 4 + 1] = rgb[i * 3 + 1];
+      out[i * 4 + 2] = rgb[i * 3 + 2];
+      out[i * 4 + 3] = 255;
+    }
+  });
+}
+
+void StretchLevels16Scalar(const uint16_t *src, uint8_t *dst, size_t count,
+                           uint16_t black, uint16_t white, StretchFormat format) {
+  StretchScalarRange(src, dst, count, MakeParams(black, white), format);
+}
@@ -0,0 +1,36 @@
+// 显示拉伸：用黑 / 白电平把 16bit 像素线性映射到 8bit 灰度或 RGBA。
+//
+// 映射规则与渲染进程原来的 JS 实现相同：
+//   out = round((clamp(v, black, white) - black) / max(white - black, 1) * 255)
+// 内部使用 16bit 定点运算（与浮点结果最多相差 1），按 CPU 在运行时选择 AVX2 / SSE2 / NEON
+// 实现，并用线程池分块并行。各实现与标量版本逐像素结果完全相同。
+
+#ifndef IMAGE_STRETCH_H
+#define IMAGE_STRETCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum StretchFormat {
+  STRETCH_GRAY8 = 0,  // 每像素 1 字节
+  STRETCH_RGBA8 = 1,  // 每像素 4 字节，R = G = B，A = 255
+};
+
+// 每像素输出字节数
+size_t StretchBytesPerPixel(StretchFormat format);
+
+// 把 count 个 16bit 像素拉伸到 dst（至少 count * StretchBytesPerPixel(format) 字节）。
+// white < black 时按 white = black 处理。
+void StretchLevels16(const uint16_t *src, uint8_t *dst, size_t count,
+                     uint16_t black, uint16_t white, StretchFormat format);
+
+// 交错 RGB16（pixelCount 个像素，每像素 3 个值）按同一组电平分别拉伸各通道，输出 RGBA（A = 255），
+// dst 至少 pixelCount * 4 字节。
+void StretchLevelsRgb16(const uint16_t *src, uint8_t *dst, size_t pixelCount,
+                        uint16_t black, uint16_t white);
+
+// 单线程标量参考实现，用于校验与基准对比。
+void StretchLevels16Scalar(const uint16_t *src, uint8_t *dst, size_t count,
+                           uint16_t black, uint16_t white, StretchFormat format);
+
+#endif // IMAGE_STRETCH_H
@@ -0,0 +1,62 @@
+// Live 取帧线程：在独立线程中轮询 GetQHYCCDLiveFrame，并把每一帧交给 LiveFrameSink。
+// 缓冲区的申请与交付都由 sink 决定，本类不关心帧最终送往 JS 还是其它地方。
+
+#ifndef LIVE_CAPTURE_H
+#define LIVE_CAPTURE_H
+
+#include "camera_session.h"
+#include "frame_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// 以下方法全部在 Live 线程中调用
+class LiveFrameSink {
+ public:
+  virtual ~LiveFrameSink() {}
+
+  // 申请一块至少 size 字节的缓冲区，返回空租约表示暂时没有可用缓冲区（本帧跳过）
+  virtual FrameLease AcquireBuffer(size_t size) = 0;
+
+  // 交付一帧。返回 true 表示 sink 接管了该缓冲区；返回 false 表示丢弃该帧，
+  // 缓冲区仍由 Live 线程持有，用于读取下一帧。
+  virtual bool Deliver(const FrameLease &buffer, const FrameInfo &info, uint64_t frameIndex) = 0;
+};
+
+struct LiveStats {
+  uint64_t frames = 0;   // 从 SDK 取到的帧数
+  uint64_t dropped = 0;  // sink 来不及处理而丢弃的帧数
+  double fps = 0.0;      // 最近约 1 秒的取帧速率
+};
+
+class LiveCapture {
+ public:
+  LiveCapture() {}
+  ~LiveCapture();
+
+  LiveCapture(const LiveCapture &) = delete;
+  LiveCapture &operator=(const LiveCapture &) = delete;
+
+  // 开始连续曝光并启动取帧线程。session 与 sink 在 Stop() 返回前必须保持有效。
+  bool Start(CameraSession *session, LiveFrameSink *sink);
+
+  // 停止取帧线程并结束连续曝光，可重复调用。
+  void Stop();
+
+  bool IsRunning() const { return running_.load(); }
+  LiveStats Stats() const;
+
+ private:
+  void Run();
+
+  CameraSession *session_ = nullptr;
+  LiveFrameSink *sink_ = nullptr;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<uint64_t> frames_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<double> fps_{0.0};
+};
+
+#endif // LIVE_CAPTURE_H
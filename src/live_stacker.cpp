@@ -0,0 +1,429 @@
+#include "live_stacker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "parallel.h"
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+// 三角形不变量（边长比）的匹配容差
+const float kTriangleTolerance = 0.01f;
+// 最长边短于该值（像素）的三角形对位置误差太敏感，不参与匹配
+const float kMinTriangleSide = 8.0f;
+// 补充匹配时的搜索半径（像素）
+const double kRefineRadius = 3.0;
+// 迭代剔除离群点时残差阈值的下限（像素）
+const double kMinClipResidual = 0.75;
+const int kFitIterations = 5;
+// 仿射变换的面积比（行列式）超出该范围时认为配准错误
+const double kMinDeterminant = 0.8;
+const double kMaxDeterminant = 1.25;
+// 叠加时每个线程块至少处理的行数
+const size_t kStackMinRows = 8;
+
+struct PointPair {
+  double x;  // 参考帧
+  double y;
+  double u;  // 目标帧
+  double v;
+};
+
+struct Triangle {
+  float u;  // b / c
+  float v;  // a / c
+  uint8_t vertex[3];  // 依次为最短边、中间边、最长边所对的顶点
+};
+
+void BuildTriangles(const std::vector<Star> &stars, size_t count, std::vector<Triangle> *triangles) {
+  triangles->clear();
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = i + 1; j < count; j++) {
+      for (size_t k = j + 1; k < count; k++) {
+        // 边长与所对的顶点
+        std::pair<float, uint8_t> sides[3] = {
+            {std::hypot(stars[j].x - stars[k].x, stars[j].y - stars[k].y), (uint8_t)i},
+            {std::hypot(stars[i].x - stars[k].x, stars[i].y - stars[k].y), (uint8_t)j},
+            {std::hypot(stars[i].x - stars[j].x, stars[i].y - stars[j].y), (uint8_t)k},
+        };
+        std::sort(sides, sides + 3);
+        if (sides[2].first < kMinTriangleSide) {
+          continue;
+        }
+        Triangle t;
+        t.u = sides[1].first / sides[2].first;
+        t.v = sides[0].first / sides[2].first;
+        t.vertex[0] = sides[0].second;
+        t.vertex[1] = sides[1].second;
+        t.vertex[2] = sides[2].second;
+        triangles->push_back(t);
+      }
+    }
+  }
+}
+
+// 最小二乘拟合仿射变换（先减去重心，数值更稳定），点共线时返回 false
+bool FitAffine(const std::vector<PointPair> &pairs, AffineTransform *t) {
+  if (pairs.size() < 3) {
+    return false;
+  }
+  double mx = 0, my = 0, mu = 0, mv = 0;
+  for (const PointPair &p : pairs) {
+    mx += p.x;
+    my += p.y;
+    mu += p.u;
+    mv += p.v;
+  }
+  const double n = (double)pairs.size();
+  mx /= n;
+  my /= n;
+  mu /= n;
+  mv /= n;
+  double sxx = 0, sxy = 0, syy = 0, sxu = 0, syu = 0, sxv = 0, syv = 0;
+  for (const PointPair &p : pairs) {
+    const double x = p.x - mx;
+    const double y = p.y - my;
+    const double u = p.u - mu;
+    const double v = p.v - mv;
+    sxx += x * x;
+    sxy += x * y;
+    syy += y * y;
+    sxu += x * u;
+    syu += y * u;
+    sxv += x * v;
+    syv += y * v;
+  }
+  const double det = sxx * syy - sxy * sxy;
+  if (std::fabs(det) < 1e-6 * std::max(1.0, sxx * syy)) {
+    return false;
+  }
+  t->a = (sxu * syy - syu * sxy) / det;
+  t->b = (syu * sxx - sxu * sxy) / det;
+  t->d = (sxv * syy - syv * sxy) / det;
+  t->e = (syv * sxx - sxv * sxy) / det;
+  t->c = mu - t->a * mx - t->b * my;
+  t->f = mv - t->d * mx - t->e * my;
+  return true;
+}
+
+double Residual(const AffineTransform &t, const PointPair &p) {
+  return std::hypot(t.a * p.x + t.b * p.y + t.c - p.u, t.d * p.x + t.e * p.y + t.f - p.v);
+}
+
+// 拟合后剔除残差大于 max(3 * 中位残差, kMinClipResidual) 的点并重新拟合，直到没有可剔除的点
+bool RobustFit(std::vector<PointPair> *pairs, AffineTransform *t, double *rms) {
+  std::vector<double> residuals;
+  for (int iter = 0; iter < kFitIterations; iter++) {
+    if (!FitAffine(*pairs, t)) {
+      return false;
+    }
+    residuals.clear();
+    for (const PointPair &p : *pairs) {
+      residuals.push_back(Residual(*t, p));
+    }
+    std::vector<double> sorted(residuals);
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    const double limit = std::max(kMinClipResidual, 3.0 * sorted[sorted.size() / 2]);
+    std::vector<PointPair> kept;
+    for (size_t i = 0; i < pairs->size(); i++) {
+      if (residuals[i] <= limit) {
+        kept.push_back((*pairs)[i]);
+      }
+    }
+    if (kept.size() == pairs->size() || kept.size() < 3) {
+      break;
+    }
+    pairs->swap(kept);
+  }
+  double sum = 0.0;
+  for (const PointPair &p : *pairs) {
+    const double r = Residual(*t, p);
+    sum += r * r;
+  }
+  *rms = std::sqrt(sum / (double)pairs->size());
+  return true;
+}
+
+// 1 / n（n = 1 ~ 65535），叠加时按帧数取权重，避免逐像素除法
+const std::vector<float> &Reciprocals() {
+  static const std::vector<float> table = [] {
+    std::vector<float> values(UINT16_MAX + 1, 0.0f);
+    for (size_t n = 1; n < values.size(); n++) {
+      values[n] = 1.0f / (float)n;
+    }
+    return values;
+  }();
+  return table;
+}
+
+// 第 y 行叠加：(x, y) 为参考帧（累加器）坐标，按 refToFrame 在本帧中取样
+template <bool kSigma, bool kBayer>
+uint64_t AccumulateRows(const uint16_t *src, uint32_t width, uint32_t height, const AffineTransform &t,
+                        float sigma2, float noise2, uint32_t window, size_t y0, size_t y1, float *mean,
+                        float *variance, uint16_t *count) {
+  const float *reciprocal = Reciprocals().data();
+  const uint32_t maxCount = window > 0 ? std::min<uint32_t>(window, UINT16_MAX) : UINT16_MAX;
+  uint64_t rejected = 0;
+  const double maxX = (double)width - 1.0;
+  const double maxY = (double)height - 1.0;
+  for (size_t y = y0; y < y1; y++) {
+    double sx = t.b * (double)y + t.c;
+    double sy = t.e * (double)y + t.f;
+    const size_t row = y * width;
+    for (uint32_t x = 0; x < width; x++, sx += t.a, sy += t.d) {
+      float value;
+      if (kBayer) {
+        // 取与 (x, y) 同色（坐标奇偶相同）的最近像素
+        const int px = (int)(x & 1);
+        const int py = (int)(y & 1);
+        const int ix = px + 2 * (int)std::floor((sx - px) * 0.5 + 0.5);
+        const int iy = py + 2 * (int)std::floor((sy - py) * 0.5 + 0.5);
+        if (ix < 0 || iy < 0 || ix >= (int)width || iy >= (int)height) {
+          continue;
+        }
+        value = (float)src[(size_t)iy * width + ix];
+      } else {
+        if (sx < 0.0 || sy < 0.0 || sx > maxX || sy > maxY) {
+          continue;
+        }
+        const uint32_t ix = (uint32_t)sx;
+        const uint32_t iy = (uint32_t)sy;
+        const float fx = (float)(sx - ix);
+        const float fy = (float)(sy - iy);
+        const uint32_t ix1 = std::min(ix + 1, width - 1);
+        const size_t r0 = (size_t)iy * width;
+        const size_t r1 = (size_t)std::min(iy + 1, height - 1) * width;
+        const float top = src[r0 + ix] + (src[r0 + ix1] - (float)src[r0 + ix]) * fx;
+        const float bottom = src[r1 + ix] + (src[r1 + ix1] - (float)src[r1 + ix]) * fx;
+        value = top + (bottom - top) * fy;
+      }
+      const size_t i = row + x;
+      const uint32_t n = count[i];
+      const float delta = value - mean[i];
+      if (kSigma && n >= kStackSigmaWarmup && delta * delta > sigma2 * std::max(variance[i], noise2)) {
+        rejected++;
+        continue;
+      }
+      // 达到窗口大小后不再增加，权重固定为 1 / window
+      const uint32_t next = std::min(n + 1, maxCount);
+      const float alpha = reciprocal[next];
+      mean[i] += alpha * delta;
+      if (kSigma) {
+        variance[i] = (1.0f - alpha) * (variance[i] + alpha * delta * delta);
+      }
+      count[i] = (uint16_t)next;
+    }
+  }
+  return rejected;
+}
+
+}  // namespace
+
+bool MatchStarFields(const std::vector<Star> &reference, const std::vector<Star> &target,
+                     AffineTransform *refToTarget, size_t *matches, double *residual) {
+  if (reference.size() < 3 || target.size() < 3) {
+    return false;
+  }
+  const size_t nr = std::min(kStackTriangleStars, reference.size());
+  const size_t nt = std::min(kStackTriangleStars, target.size());
+  std::vector<Triangle> refTriangles;
+  std::vector<Triangle> targetTriangles;
+  BuildTriangles(reference, nr, &refTriangles);
+  BuildTriangles(target, nt, &targetTriangles);
+  std::sort(refTriangles.begin(), refTriangles.end(), [](const Triangle &a, const Triangle &b) { return a.u < b.u; });
+
+  // 不变量相近的三角形，按顶点对应关系投票
+  std::vector<uint16_t> votes(nt * nr, 0);
+  for (const Triangle &t : targetTriangles) {
+    auto it = std::lower_bound(refTriangles.begin(), refTriangles.end(), t.u - kTriangleTolerance,
+                               [](const Triangle &a, float u) { return a.u < u; });
+    for (; it != refTriangles.end() && it->u <= t.u + kTriangleTolerance; ++it) {
+      if (std::fabs(it->v - t.v) > kTriangleTolerance) {
+        continue;
+      }
+      for (int k = 0; k < 3; k++) {
+        uint16_t &vote = votes[(size_t)t.vertex[k] * nr + it->vertex[k]];
+        vote = (uint16_t)std::min<uint32_t>(vote + 1u, UINT16_MAX);
+      }
+    }
+  }
+
+  // 互为最佳且至少两票的星点对
+  std::vector<PointPair> pairs;
+  for (size_t i = 0; i < nt; i++) {
+    const uint16_t *row = votes.data() + i * nr;
+    const size_t j = (size_t)(std::max_element(row, row + nr) - row);
+    if (row[j] < 2) {
+      continue;
+    }
+    bool best = true;
+    for (size_t k = 0; k < nt && best; k++) {
+      best = k == i || votes[k * nr + j] < row[j];
+    }
+    if (best) {
+      pairs.push_back({reference[j].x, reference[j].y, target[i].x, target[i].y});
+    }
+  }
+  AffineTransform t;
+  double rms = 0.0;
+  if (pairs.size() < 3 || !RobustFit(&pairs, &t, &rms)) {
+    return false;
+  }
+
+  // 用初始变换把参考帧全部星点映射到目标帧，按最近邻补充匹配（每颗目标星只保留最近的一颗）
+  const double radius = std::max(kRefineRadius, 3.0 * rms);
+  std::vector<int> nearest(target.size(), -1);
+  std::vector<double> distance(target.size(), radius);
+  for (size_t j = 0; j < reference.size(); j++) {
+    const double u = t.a * reference[j].x + t.b * reference[j].y + t.c;
+    const double v = t.d * reference[j].x + t.e * reference[j].y + t.f;
+    for (size_t i = 0; i < target.size(); i++) {
+      const double dist = std::hypot(target[i].x - u, target[i].y - v);
+      if (dist < distance[i]) {
+        distance[i] = dist;
+        nearest[i] = (int)j;
+      }
+    }
+  }
+  pairs.clear();
+  for (size_t i = 0; i < target.size(); i++) {
+    if (nearest[i] >= 0) {
+      const Star &r = reference[(size_t)nearest[i]];
+      pairs.push_back({r.x, r.y, target[i].x, target[i].y});
+    }
+  }
+  if (pairs.size() < kStackMinMatches || !RobustFit(&pairs, &t, &rms) || pairs.size() < kStackMinMatches) {
+    return false;
+  }
+  const double det = t.a * t.e - t.b * t.d;
+  if (det < kMinDeterminant || det > kMaxDeterminant) {
+    return false;
+  }
+  *refToTarget = t;
+  if (matches) {
+    *matches = pairs.size();
+  }
+  if (residual) {
+    *residual = rms;
+  }
+  return true;
+}
+
+LiveStacker::LiveStacker(const StackOptions &options) : options_(options) {}
+
+void LiveStacker::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  frames_ = 0;
+  rejectedFrames_ = 0;
+  referenceStars_.clear();
+}
+
+StackStats LiveStacker::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  StackStats stats;
+  stats.width = width_;
+  stats.height = height_;
+  stats.frames = frames_;
+  stats.rejectedFrames = rejectedFrames_;
+  stats.referenceStars = (uint32_t)referenceStars_.size();
+  return stats;
+}
+
+void LiveStacker::DetectLocked(const uint16_t *pixels, std::vector<Star> *stars, StarBackground *background) {
+  StarDetectOptions detect;
+  detect.threshold = options_.threshold;
+  detect.maxStars = kStackMaxStars;
+  if (bayer_ == 0) {
+    DetectStars16(pixels, width_, height_, detect, stars, background);
+  } else {
+    DetectStarsBayer16(pixels, width_, height_, detect, &luminance_, stars, background);
+  }
+}
+
+uint64_t LiveStacker::AccumulateLocked(const uint16_t *pixels, const AffineTransform &refToFrame, float noise) {
+  const bool sigma = options_.method == STACK_SIGMA_CLIP;
+  const bool bayer = bayer_ != 0;
+  const float sigma2 = options_.sigma * options_.sigma;
+  const float noise2 = noise * noise;
+  auto kernel = sigma ? (bayer ? AccumulateRows<true, true> : AccumulateRows<true, false>)
+                      : (bayer ? AccumulateRows<false, true> : AccumulateRows<false, false>);
+  std::atomic<uint64_t> rejected(0);
+  ParallelFor(height_, kStackMinRows, [&](size_t begin, size_t end) {
+    rejected += kernel(pixels, width_, height_, refToFrame, sigma2, noise2, options_.window, begin, end,
+                       mean_.data(), sigma ? variance_.data() : nullptr, count_.data());
+  });
+  return rejected.load();
+}
+
+void LiveStacker::RenderLocked(uint16_t *pixels) const {
+  ParallelFor(mean_.size(), 1 << 16, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      // 均值不会小于 0，加 0.5 截断即四舍五入
+      pixels[i] = (uint16_t)(std::min(mean_[i], 65535.0f) + 0.5f);
+    }
+  });
+}
+
+bool LiveStacker::Add(uint16_t *pixels, uint32_t width, uint32_t height, uint32_t bayer, StackFrameResult *result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *result = StackFrameResult();
+  if (width != width_ || height != height_ || bayer != bayer_) {
+    width_ = width;
+    height_ = height;
+    bayer_ = bayer;
+    frames_ = 0;
+    rejectedFrames_ = 0;
+    referenceStars_.clear();
+  }
+
+  std::vector<Star> stars;
+  StarBackground background;
+  DetectLocked(pixels, &stars, &background);
+  result->stars = (uint32_t)stars.size();
+
+  if (frames_ == 0) {
+    if (stars.size() < kStackMinMatches) {
+      // 星点太少，无法作为参考帧
+      rejectedFrames_++;
+      result->rejectedFrames = rejectedFrames_;
+      return false;
+    }
+    const size_t pixelCount = (size_t)width * height;
+    mean_.assign(pixelCount, 0.0f);
+    count_.assign(pixelCount, 0);
+    if (options_.method == STACK_SIGMA_CLIP) {
+      variance_.assign(pixelCount, 0.0f);
+    }
+    referenceStars_.swap(stars);
+    AccumulateLocked(pixels, AffineTransform(), background.noise);
+    frames_ = 1;
+    result->accepted = true;
+    result->reference = true;
+    result->matches = (uint32_t)referenceStars_.size();
+  } else {
+    AffineTransform t;
+    size_t matches = 0;
+    double residual = 0.0;
+    if (MatchStarFields(referenceStars_, stars, &t, &matches, &residual) && residual <= options_.maxResidual) {
+      result->rejectedPixels = AccumulateLocked(pixels, t, background.noise);
+      frames_++;
+      result->accepted = true;
+      const double cx = 0.5 * ((double)width - 1.0);
+      const double cy = 0.5 * ((double)height - 1.0);
+      result->dx = (float)(t.a * cx + t.b * cy + t.c - cx);
+      result->dy = (float)(t.d * cx + t.e * cy + t.f - cy);
+      result->rotation = (float)(std::atan2(t.d, t.a) * 180.0 / kPi);
+      result->scale = (float)std::sqrt(std::fabs(t.a * t.e - t.b * t.d));
+    } else {
+      rejectedFrames_++;
+    }
+    result->matches = (uint32_t)matches;
+    result->residual = (float)residual;
+  }
+  result->frames = frames_;
+  result->rejectedFrames = rejectedFrames_;
+  RenderLocked(pixels);
+  return true;
+}
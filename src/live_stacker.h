@@ -0,0 +1,122 @@
+// 实时叠加（EAA）：每一帧检测星点，与参考帧（第一帧）做三角形匹配，求出仿射变换后
+// 重采样并叠加到 32bit 浮点累加器，叠加结果写回帧缓冲区，之后的统计、预览与显示看到的都是叠加图像。
+//
+// 配准：取两帧最亮的 kStackTriangleStars 颗星，所有三颗星组成的三角形按边长比 (b / c, a / c) 建立不变量，
+// 不变量相近的三角形按顶点（按对边长度排序）投票，互为最佳的星点对用最小二乘拟合仿射变换并迭代剔除离群点；
+// 再用初始变换把参考帧的全部星点映射过来按最近邻补充匹配后重新拟合。匹配星数不足或残差过大的帧不叠加。
+//
+// 叠加：累加器保存每个像素的均值与（sigma 截断时）方差，按 Welford 方式逐帧更新，不保存历史帧。
+// window > 0 时权重固定为 1 / window（指数滑动窗口），天光变化、云层等会逐渐被新帧替代；
+// sigma 截断时，偏离均值超过 sigma 倍标准差（不低于本帧背景噪声）的像素不参与更新，
+// 可去掉卫星、飞机轨迹与宇宙线。逐行并行，黑白帧双线性插值；彩色相机的 Bayer 帧取同色的最近像素，
+// 输出仍是原来的阵列。
+//
+// 本文件不包含任何 N-API 代码。
+
+#ifndef LIVE_STACKER_H
+#define LIVE_STACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "image_stars.h"
+
+// 参与三角形匹配的最亮星数（三角形数为 C(n, 3)）
+static const size_t kStackTriangleStars = 20;
+// 每帧检测的最多星数，用于补充匹配
+static const size_t kStackMaxStars = 200;
+// 接受一帧所需的最少匹配星数
+static const size_t kStackMinMatches = 4;
+// sigma 截断前至少叠加的帧数
+static const uint32_t kStackSigmaWarmup = 5;
+
+enum StackMethod {
+  STACK_MEAN = 0,        // 滑动 / 累计均值
+  STACK_SIGMA_CLIP = 1,  // 按累计方差截断离群像素后的均值
+};
+
+struct StackOptions {
+  StackMethod method = STACK_MEAN;
+  float sigma = 3.0f;
+  uint32_t window = 0;        // 0 表示累计全部帧
+  float maxResidual = 2.0f;   // 配准残差（RMS，像素）上限
+  float threshold = 5.0f;     // 星点检测阈值（背景噪声的倍数）
+};
+
+// x' = a * x + b * y + c，y' = d * x + e * y + f
+struct AffineTransform {
+  double a = 1.0;
+  double b = 0.0;
+  double c = 0.0;
+  double d = 0.0;
+  double e = 1.0;
+  double f = 0.0;
+};
+
+// 把 reference 中的星点配准到 target：成功时 refToTarget 把参考帧坐标映射为目标帧坐标。
+// matches / residual（RMS，像素）可以为 NULL。
+bool MatchStarFields(const std::vector<Star> &reference, const std::vector<Star> &target,
+                     AffineTransform *refToTarget, size_t *matches, double *residual);
+
+struct StackFrameResult {
+  bool accepted = false;   // 本帧已叠加
+  bool reference = false;  // 本帧成为新的参考帧
+  uint32_t frames = 0;     // 已叠加的帧数
+  uint32_t rejectedFrames = 0;
+  uint32_t stars = 0;      // 本帧检测到的星数
+  uint32_t matches = 0;    // 与参考帧匹配的星数
+  float dx = 0.0f;         // 图像中心相对参考帧的平移（像素）
+  float dy = 0.0f;
+  float rotation = 0.0f;   // 度
+  float scale = 1.0f;
+  float residual = 0.0f;   // 配准残差（RMS，像素）
+  uint64_t rejectedPixels = 0;  // sigma 截断剔除的像素数
+};
+
+struct StackStats {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t frames = 0;
+  uint32_t rejectedFrames = 0;
+  uint32_t referenceStars = 0;
+};
+
+class LiveStacker {
+ public:
+  explicit LiveStacker(const StackOptions &options);
+
+  LiveStacker(const LiveStacker &) = delete;
+  LiveStacker &operator=(const LiveStacker &) = delete;
+
+  // 叠加一帧 16bit 单通道图像（bayer 为 BayerPattern），并把当前叠加结果写回 pixels。
+  // 尺寸或阵列与之前不同时自动重新开始，本帧成为参考帧。
+  // 没有叠加结果（参考帧星点太少）时 pixels 保持不变并返回 false。可在任意线程中调用。
+  bool Add(uint16_t *pixels, uint32_t width, uint32_t height, uint32_t bayer, StackFrameResult *result);
+
+  // 丢弃累加器，下一帧成为新的参考帧
+  void Reset();
+  StackStats Stats() const;
+  const StackOptions &Options() const { return options_; }
+
+ private:
+  void DetectLocked(const uint16_t *pixels, std::vector<Star> *stars, StarBackground *background);
+  uint64_t AccumulateLocked(const uint16_t *pixels, const AffineTransform &refToFrame, float noise);
+  void RenderLocked(uint16_t *pixels) const;
+
+  const StackOptions options_;
+  mutable std::mutex mutex_;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  uint32_t bayer_ = 0;
+  uint32_t frames_ = 0;
+  uint32_t rejectedFrames_ = 0;
+  std::vector<Star> referenceStars_;
+  std::vector<float> mean_;
+  std::vector<float> variance_;  // 仅 sigma 截断时使用
+  std::vector<uint16_t> count_;
+  std::vector<uint16_t> luminance_;  // Bayer 帧 2x2 合并后的亮度图，用于检测星点
+};
+
+#endif // LIVE_STACKER_H
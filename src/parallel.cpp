@@ -0,0 +1,178 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 当前线程是否正在执行某个 ParallelFor 的任务块（用于避免嵌套调用死锁）
+thread_local bool t_insideParallel = false;
+
+class ThreadPool {
+ public:
+  ThreadPool() {
+    unsigned hw = std::thread::hardware_concurrency();
+    size_t workers = hw > 1 ? hw - 1 : 0;
+    for (size_t i = 0; i < workers; i++) {
+      threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+    const char *env = std::getenv("QHY_THREADS");
+    if (env != nullptr) {
+      limit_ = (size_t)std::strtoul(env, nullptr, 10);
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &t : threads_) {
+      t.join();
+    }
+  }
+
+  size_t ThreadCount() const {
+    size_t all = threads_.size() + 1;
+    size_t limit = limit_.load();
+    return limit > 0 && limit < all ? limit : all;
+  }
+
+  void SetLimit(size_t threads) { limit_ = threads; }
+
+  void Run(size_t count, size_t chunk, const std::function<void(size_t, size_t)> &fn) {
+    // 同一时间只运行一个任务，其它调用者排队
+    std::lock_guard<std::mutex> runLock(runMutex_);
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->fn = &fn;
+    job->count = count;
+    job->chunk = chunk;
+    job->chunks = (count + chunk - 1) / chunk;
+    job->pending = job->chunks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = job;
+      generation_++;
+    }
+    wake_.notify_all();
+
+    RunChunks(*job);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&] { return job->pending == 0; });
+    job_.reset();
+  }
+
+ private:
+  // 一次 Run 的任务描述。工作线程在 mutex_ 下取得 shared_ptr 后只从这份描述中领取任务块，
+  // 醒得晚的线程拿到的是已经领取完毕的旧任务，不会领走下一个任务的块，也不会多减 pending
+  struct Job {
+    const std::function<void(size_t, size_t)> *fn = nullptr;
+    size_t count = 0;
+    size_t chunk = 1;
+    size_t chunks = 0;
+    size_t pending = 0;  // 尚未完成的块数，持有 mutex_ 时修改
+    std::atomic<size_t> next{0};
+  };
+
+  // 领取并执行任务块，直到全部领取完毕
+  void RunChunks(Job &job) {
+    bool wasInside = t_insideParallel;
+    t_insideParallel = true;
+    size_t finished = 0;
+    for (;;) {
+      size_t index = job.next.fetch_add(1);
+      if (index >= job.chunks) {
+        break;
+      }
+      size_t begin = index * job.chunk;
+      size_t end = std::min(job.count, begin + job.chunk);
+      (*job.fn)(begin, end);
+      finished++;
+    }
+    t_insideParallel = wasInside;
+
+    if (finished > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job.pending -= finished;
+      if (job.pending == 0) {
+        done_.notify_all();
+      }
+    }
+  }
+
+  // index 为工作线程序号，线程数受限时序号靠后的线程不领取任务块
+  void WorkerLoop(size_t index) {
+    uint64_t seen = 0;
+    for (;;) {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || (generation_ != seen && job_ != nullptr); });
+        if (stop_) {
+          return;
+        }
+        seen = generation_;
+        job = job_;
+      }
+      if (index + 1 < ThreadCount()) {
+        RunChunks(*job);
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex runMutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  bool stop_ = false;
+  uint64_t generation_ = 0;
+  std::atomic<size_t> limit_{0};
+
+  // 当前任务，修改时持有 mutex_
+  std::shared_ptr<Job> job_;
+};
+
+ThreadPool &Pool() {
+  static ThreadPool pool;
+  return pool;
+}
+
+}  // namespace
+
+void ParallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)> &fn) {
+  if (count == 0) {
+    return;
+  }
+  minChunk = std::max<size_t>(minChunk, 1);
+  if (t_insideParallel || count < minChunk * 2) {
+    fn(0, count);
+    return;
+  }
+
+  ThreadPool &pool = Pool();
+  size_t threads = pool.ThreadCount();
+  if (threads <= 1) {
+    fn(0, count);
+    return;
+  }
+  // 每个线程约 4 块，兼顾负载均衡与调度开销
+  size_t chunk = std::max(minChunk, (count + threads * 4 - 1) / (threads * 4));
+  pool.Run(count, chunk, fn);
+}
+
+size_t ParallelThreadCount() {
+  return Pool().ThreadCount();
+}
+
+void SetParallelThreadLimit(size_t threads) {
+  Pool().SetLimit(threads);
+}
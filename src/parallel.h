@@ -0,0 +1,22 @@
+// 简单的数据并行工具：进程内共享一个常驻线程池，按块切分 [0, count) 并行执行。
+// 图像处理内核（拉伸、直方图、缩略图等）都通过它使用多核，避免每次调用都创建线程。
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// 把 [0, count) 切成若干块，在线程池中并行执行 fn(begin, end)，调用线程也参与计算，
+// 全部完成后返回。count 不足 2 * minChunk 时直接在调用线程中执行。
+// 在 fn 内部再次调用 ParallelFor 时退化为串行执行。
+void ParallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)> &fn);
+
+// 参与计算的线程数（含调用线程）。
+size_t ParallelThreadCount();
+
+// 限制参与计算的线程数（含调用线程），0 表示使用线程池中的全部线程。
+// 用于基准测试不同线程数下的扩展性，也可用环境变量 QHY_THREADS 在启动时设置。
+void SetParallelThreadLimit(size_t threads);
+
+#endif // PARALLEL_H
@@ -1,14 +1,37 @@
 // 使用动态加载方式调用 QHYCCD SDK，避免直接依赖 qhyccd.h
 #include "qhyccd_dynamic.h"
+#include "dynamic_library.h"
+#include "camera_session.h"
+#include "frame_pool.h"
+#include "live_capture.h"
+#include "image_stretch.h"
+#include "image_stats.h"
+#include "image_preview.h"
+#include "image_debayer.h"
+#include "image_binning.h"
+#include "image_calibration.h"
+#include "live_stacker.h"
+#include "image_regions.h"
+#include "image_profile.h"
+#include "fits_writer.h"
+#include "ser_writer.h"
+#include "shared_frame_ring.h"
+#include "tile_pyramid.h"
+#include "cpu_features.h"
+#include "frame_trace.h"
 
 #include <node_api.h>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
-#include <windows.h>
-#include <shlwapi.h>
-
-#pragma comment(lib, "shlwapi.lib")
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 // 简单的 N-API 宏包装，方便断言
 #define NAPI_CALL(env, call)                                      \
@@ -25,211 +48,879 @@
     }                                                             \
   } while (0)
 
-static void finalize_buffer(napi_env env, void* finalize_data, void* finalize_hint) {
-  (void)env;
-  (void)finalize_hint;
-  if (finalize_data) {
-    free(finalize_data);
+#ifdef _WIN32
+#define QHYCCD_SIMULATOR_NAME "qhyccd_simulator.dll"
+#else
+#define QHYCCD_SIMULATOR_NAME "qhyccd_simulator.so"
+#endif
+
+// 默认的 SDK 库路径：Windows 下为项目自带的 sdk/x64/qhyccd.dll，
+// Linux 下从系统搜索路径（QHY 安装包默认装到 /usr/local/lib）加载 libqhyccd.so
+static std::string DefaultLibraryPath() {
+  std::string dir = CurrentModuleDirectory();  // build/Release
+#ifdef _WIN32
+  if (dir.empty()) {
+    // 如果获取模块路径失败，使用相对路径
+    return "sdk\\x64\\qhyccd.dll";
+  }
+  // 上两级为项目根目录
+  for (int i = 0; i < 2; i++) {
+    size_t slash = dir.find_last_of("\\/");
+    dir = slash == std::string::npos ? std::string() : dir.substr(0, slash);
   }
+  return JoinPath(JoinPath(JoinPath(dir, "sdk"), "x64"), QHYCCD_LIBRARY_NAME);
+#else
+  (void)dir;
+  return QHYCCD_LIBRARY_NAME;
+#endif
 }
 
-// captureSingleFrame(options)
-static napi_value CaptureSingleFrame(napi_env env, napi_callback_info info) {
-  napi_status status;
-  size_t argc = 1;
-  napi_value args[1];
-  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+// 加载 SDK 动态库（只加载一次），失败时抛出 JS 异常并返回 NULL。
+// 环境变量 QHYCCD_SDK_PATH 可指定库的完整路径；QHYCCD_SIMULATOR 非空且不为 "0" 时加载
+// 与本模块一同构建的模拟器（见 qhyccd_simulator.cpp）。
+static const QHYCCDFunctions* LoadQHYCCD(napi_env env) {
+  static QHYCCDFunctions qhy = {};
+  static bool qhy_loaded = false;
+  if (qhy_loaded) {
+    return &qhy;
+  }
 
-  uint32_t exposureMs = 1000;
-  double gain = -1.0;
-  double offset = -1.0;
-  uint32_t roiWidth = 1920;
-  uint32_t roiHeight = 1080;
+  std::string path = GetEnvironmentUtf8("QHYCCD_SDK_PATH");
+  if (path.empty()) {
+    std::string simulator = GetEnvironmentUtf8("QHYCCD_SIMULATOR");
+    if (!simulator.empty() && simulator != "0") {
+      path = JoinPath(CurrentModuleDirectory(), QHYCCD_SIMULATOR_NAME);
+    } else {
+      path = DefaultLibraryPath();
+    }
+  }
 
-  if (argc >= 1) {
-    napi_valuetype type;
-    NAPI_CALL(env, napi_typeof(env, args[0], &type));
-    if (type == napi_object) {
-      napi_value v;
-      if (napi_get_named_property(env, args[0], "exposureMs", &v) == napi_ok) {
-        napi_get_value_uint32(env, v, &exposureMs);
-      }
-      if (napi_get_named_property(env, args[0], "exposureUs", &v) == napi_ok) {
-        napi_get_value_double(env, v, &exposureUs);
-      }
-      if (napi_get_named_property(env, args[0], "gain", &v) == napi_ok) {
-        napi_get_value_double(env, v, &gain);
-      }
-      if (napi_get_named_property(env, args[0], "offset", &v) == napi_ok) {
-        napi_get_value_double(env, v, &offset);
-      }
-      if (napi_get_named_property(env, args[0], "width", &v) == napi_ok) {
-        napi_get_value_uint32(env, v, &roiWidth);
+  std::string error;
+  if (!LoadQHYCCDLibrary(&qhy, path.c_str(), &error)) {
+    napi_throw_error(env, NULL, error.c_str());
+    return NULL;
+  }
+  qhy_loaded = true;
+  return &qhy;
+}
+
+static bool HasProperty(napi_env env, napi_value obj, const char* name) {
+  bool has = false;
+  return napi_has_named_property(env, obj, name, &has) == napi_ok && has;
+}
+
+// 读取任意长度的字符串属性（如文件路径），属性不存在或不是字符串时返回 false
+static bool ReadStringProperty(napi_env env, napi_value obj, const char* name, std::string* out) {
+  napi_value v;
+  napi_valuetype type;
+  size_t len = 0;
+  if (!HasProperty(env, obj, name) || napi_get_named_property(env, obj, name, &v) != napi_ok ||
+      napi_typeof(env, v, &type) != napi_ok || type != napi_string ||
+      napi_get_value_string_utf8(env, v, NULL, 0, &len) != napi_ok) {
+    return false;
+  }
+  std::vector<char> text(len + 1);
+  if (napi_get_value_string_utf8(env, v, text.data(), text.size(), &len) != napi_ok) {
+    return false;
+  }
+  out->assign(text.data(), len);
+  return true;
+}
+
+// 从 JS 参数对象中读取拍摄参数，只覆盖对象里出现的字段
+static napi_status ReadCaptureSettings(napi_env env, napi_value obj, CaptureSettings* settings) {
+  napi_valuetype type;
+  napi_status status = napi_typeof(env, obj, &type);
+  if (status != napi_ok || type != napi_object) {
+    return status;
+  }
+
+  napi_value v;
+  // exposureUs 优先，其次 exposureMs
+  if (HasProperty(env, obj, "exposureUs")) {
+    double exposureUs = 0.0;
+    if (napi_get_named_property(env, obj, "exposureUs", &v) == napi_ok &&
+        napi_get_value_double(env, v, &exposureUs) == napi_ok && exposureUs > 0.0) {
+      settings->exposureUs = exposureUs;
+    }
+  } else if (HasProperty(env, obj, "exposureMs")) {
+    uint32_t exposureMs = 0;
+    if (napi_get_named_property(env, obj, "exposureMs", &v) == napi_ok &&
+        napi_get_value_uint32(env, v, &exposureMs) == napi_ok) {
+      settings->exposureUs = (double)exposureMs * 1000.0;
+    }
+  }
+  if (napi_get_named_property(env, obj, "gain", &v) == napi_ok) {
+    napi_get_value_double(env, v, &settings->gain);
+  }
+  if (napi_get_named_property(env, obj, "offset", &v) == napi_ok) {
+    napi_get_value_double(env, v, &settings->offset);
+  }
+  if (napi_get_named_property(env, obj, "width", &v) == napi_ok) {
+    napi_get_value_uint32(env, v, &settings->roiWidth);
+  }
+  if (napi_get_named_property(env, obj, "height", &v) == napi_ok) {
+    napi_get_value_uint32(env, v, &settings->roiHeight);
+  }
+  // ROI 起点与硬件 bin（x / y 为 bin 后的像素）；与 setRoi 一样按传感器范围裁剪，Live 中只能用 setRoi 切换
+  if (napi_get_named_property(env, obj, "x", &v) == napi_ok) {
+    napi_get_value_uint32(env, v, &settings->roiX);
+  }
+  if (napi_get_named_property(env, obj, "y", &v) == napi_ok) {
+    napi_get_value_uint32(env, v, &settings->roiY);
+  }
+  if (HasProperty(env, obj, "bin")) {
+    uint32_t bin = 1;
+    if (napi_get_named_property(env, obj, "bin", &v) != napi_ok || napi_get_value_uint32(env, v, &bin) != napi_ok ||
+        bin < 1 || bin > kMaxHardwareBin) {
+      return napi_invalid_arg;
+    }
+    settings->binX = bin;
+    settings->binY = bin;
+  }
+  // 软件 bin：softwareBin 为 1 ~ 4，softwareBinMode 为 'average'（默认）或 'sum'
+  if (HasProperty(env, obj, "softwareBin")) {
+    uint32_t factor = 1;
+    if (napi_get_named_property(env, obj, "softwareBin", &v) != napi_ok ||
+        napi_get_value_uint32(env, v, &factor) != napi_ok || factor < 1 || factor > kSoftwareBinMaxFactor) {
+      return napi_invalid_arg;
+    }
+    settings->softwareBin = factor;
+  }
+  if (HasProperty(env, obj, "softwareBinMode")) {
+    char mode[12] = {0};
+    size_t len = 0;
+    if (napi_get_named_property(env, obj, "softwareBinMode", &v) != napi_ok ||
+        napi_get_value_string_utf8(env, v, mode, sizeof(mode), &len) != napi_ok) {
+      return napi_invalid_arg;
+    }
+    if (strcmp(mode, "sum") == 0) {
+      settings->softwareBinMode = BIN_SUM;
+    } else if (strcmp(mode, "average") == 0) {
+      settings->softwareBinMode = BIN_AVERAGE;
+    } else {
+      return napi_invalid_arg;
+    }
+  }
+  return napi_ok;
+}
+
+// 取得 16bit 像素源：接受 ArrayBuffer、Uint16Array 或带 data 字段的帧对象（此时按 byteLength 截取）
+static bool GetPixelSource16(napi_env env, napi_value value, const uint16_t** pixels, size_t* count) {
+  napi_valuetype type;
+  if (napi_typeof(env, value, &type) != napi_ok || type != napi_object) {
+    return false;
+  }
+
+  bool isTypedArray = false;
+  napi_is_typedarray(env, value, &isTypedArray);
+  if (isTypedArray) {
+    napi_typedarray_type arrayType;
+    size_t length = 0;
+    void* data = NULL;
+    if (napi_get_typedarray_info(env, value, &arrayType, &length, &data, NULL, NULL) != napi_ok ||
+        arrayType != napi_uint16_array) {
+      return false;
+    }
+    *pixels = static_cast<const uint16_t*>(data);
+    *count = length;
+    return true;
+  }
+
+  size_t limit = SIZE_MAX;
+  bool isArrayBuffer = false;
+  napi_is_arraybuffer(env, value, &isArrayBuffer);
+  if (!isArrayBuffer) {
+    napi_value v;
+    double byteLength = 0.0;
+    if (napi_get_named_property(env, value, "byteLength", &v) == napi_ok &&
+        napi_get_value_double(env, v, &byteLength) == napi_ok && byteLength >= 0.0) {
+      limit = (size_t)byteLength;
+    }
+    if (napi_get_named_property(env, value, "data", &value) != napi_ok ||
+        napi_is_arraybuffer(env, value, &isArrayBuffer) != napi_ok || !isArrayBuffer) {
+      return false;
+    }
+  }
+
+  void* data = NULL;
+  size_t length = 0;
+  if (napi_get_arraybuffer_info(env, value, &data, &length) != napi_ok) {
+    return false;
+  }
+  *pixels = static_cast<const uint16_t*>(data);
+  *count = std::min(length, limit) / sizeof(uint16_t);
+  return true;
+}
+
+// 读取 Bayer 阵列名称（"RGGB" 等）。属性不存在、为 null 或 false 时保持 pattern 不变并返回 true，
+// 无法识别时返回 false。
+static bool ReadBayerPattern(napi_env env, napi_value obj, const char* name, BayerPattern* pattern) {
+  napi_value v;
+  napi_valuetype type;
+  if (!HasProperty(env, obj, name) || napi_get_named_property(env, obj, name, &v) != napi_ok ||
+      napi_typeof(env, v, &type) != napi_ok) {
+    return true;
+  }
+  if (type == napi_null || type == napi_undefined || type == napi_boolean) {
+    return true;
+  }
+  char text[8] = {0};
+  size_t len = 0;
+  if (type != napi_string || napi_get_value_string_utf8(env, v, text, sizeof(text), &len) != napi_ok) {
+    return false;
+  }
+  *pattern = ParseBayerPattern(text);
+  return *pattern != BAYER_NONE;
+}
+
+static void ReadLevel(napi_env env, napi_value obj, const char* name, uint16_t* level) {
+  napi_value v;
+  double value = 0.0;
+  if (HasProperty(env, obj, name) && napi_get_named_property(env, obj, name, &v) == napi_ok &&
+      napi_get_value_double(env, v, &value) == napi_ok) {
+    *level = (uint16_t)std::min(std::max(value, 0.0), 65535.0);
+  }
+}
+
+// 池中缓冲区的数量：单帧拍摄只需 1 块，Live 需要覆盖“SDK 正在读出 + 队列中 2 帧 + JS 正在处理”。
+static const size_t kFramePoolSlots = 4;
+static const size_t kFramePoolMaxSlots = 8;
+
+// 交给 JS 后仍未 releaseFrame 的帧超过这个数量时，最早的一帧脱离缓冲池，
+// 其 ArrayBuffer 从此完全归 JS 所有，池中再补充一块新的缓冲区。
+static const size_t kMaxOutstandingFrames = 2;
+
+// 每帧随帧对象送到 JS 的星点数上限（按亮度保留最亮的），中位数 HFR / FWHM 也只统计这些星
+static const uint32_t kFrameStarLimit = 500;
+// frame.stars.data 中每颗星的 float 个数：x, y, flux, hfr, fwhm, eccentricity
+static const uint32_t kFrameStarStride = 6;
+
+// 以 JS ArrayBuffer 作为存储的帧缓冲区分配器。
+// SDK 直接读出到 ArrayBuffer 的底层内存中，交给 JS 时既不需要拷贝，也不依赖
+// external ArrayBuffer（Electron 的内存沙箱不允许 external ArrayBuffer）。
+// 池持有期间由 napi_ref 保证 ArrayBuffer 不被回收。
+// 注意：V8 分配的 ArrayBuffer 只保证 16 字节对齐，达不到 kFrameBufferAlignment。
+class ArrayBufferFrameAllocator : public FrameAllocator {
+ public:
+  explicit ArrayBufferFrameAllocator(napi_env env) : env_(env) {}
+
+  // 只在 JS 线程中调用（FramePool::Reserve / Acquire）
+  uint8_t* Allocate(size_t size, void** userData) override {
+    void* data = NULL;
+    napi_value arraybuffer;
+    napi_ref ref = NULL;
+    if (napi_create_arraybuffer(env_, size, &data, &arraybuffer) != napi_ok ||
+        napi_create_reference(env_, arraybuffer, 1, &ref) != napi_ok) {
+      return NULL;
+    }
+    *userData = ref;
+    return (uint8_t*)data;
+  }
+
+  // 可能在取帧线程中调用，引用留到 JS 线程中再删除
+  void Free(uint8_t* data, void* userData) override {
+    (void)data;
+    std::lock_guard<std::mutex> lock(mutex_);
+    released_.push_back(static_cast<napi_ref>(userData));
+  }
+
+  // 在 JS 线程中删除已释放缓冲区的引用
+  void DeleteReleased() {
+    std::vector<napi_ref> refs;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      refs.swap(released_);
+    }
+    for (napi_ref ref : refs) {
+      napi_delete_reference(env_, ref);
+    }
+  }
+
+  static napi_status GetArrayBuffer(napi_env env, const FrameLease& lease, napi_value* result) {
+    return napi_get_reference_value(env, static_cast<napi_ref>(lease->userData), result);
+  }
+
+ private:
+  napi_env env_;
+  std::mutex mutex_;
+  std::vector<napi_ref> released_;
+};
+
+// 一个测量图形及其光栅化结果（setRegions）。mask 在图形未变化时沿用上一次的结果
+struct FrameRegion {
+  std::string id;
+  RegionShape shape;
+  std::shared_ptr<const RegionMask> mask;
+};
+typedef std::vector<FrameRegion> FrameRegionSet;
+
+// 取帧后在原生线程中完成的分析，随帧对象交给 JS
+struct FrameAnalysis {
+  ImageStats stats;
+  PreviewImage preview;  // preview.factor 为 0 表示未生成预览图
+  std::shared_ptr<TilePyramid> pyramid;  // 单帧拍摄且图像大于一个图块时生成（仅黑白帧）
+  bool stacked = false;  // 帧缓冲区已替换为实时叠加的结果
+  StackFrameResult stack;
+  bool starsDetected = false;  // 已检测星点（setStarDetection）
+  std::vector<Star> stars;
+  StarBackground starBackground;
+  StarFieldSummary starSummary;
+  std::shared_ptr<const FrameRegionSet> regions;  // 已统计的区域（setRegions），与 regionStats 一一对应
+  std::vector<RegionStats> regionStats;
+};
+
+// 统计每个区域覆盖的像素
+static void MeasureRegions(const FrameRegionSet& regions, const uint16_t* pixels, uint32_t width, uint32_t height,
+                           std::vector<RegionStats>* stats) {
+  stats->resize(regions.size());
+  for (size_t i = 0; i < regions.size(); i++) {
+    ComputeRegionStats16(pixels, width, height, *regions[i].mask, &(*stats)[i]);
+  }
+}
+
+// 一个会话的帧缓冲池，以及已交给 JS 但尚未归还的帧。outstanding 只在 JS 线程中访问。
+struct FrameRegistry {
+  std::shared_ptr<ArrayBufferFrameAllocator> allocator;
+  FramePool pool;
+  std::deque<FrameLease> outstanding;
+  // 交给 JS 的其它对象（图块金字塔）仍持有的缓冲区，缓冲区不够用时同样可以让它们脱离缓冲池
+  std::deque<std::weak_ptr<FrameSlot>> pinned;
+  // 预览图的最大尺寸（setPreviewSize），为 0 时不生成预览图；Live 线程中读取
+  std::atomic<uint32_t> previewMaxWidth{0};
+  std::atomic<uint32_t> previewMaxHeight{0};
+  // 每帧星点检测与对焦指标（setStarDetection），同样在 Live 线程中读取
+  std::atomic<bool> starDetection{false};
+  std::atomic<float> starThreshold{5.0f};
+  std::atomic<uint32_t> starLimit{kFrameStarLimit};
+  // 每帧统计的区域（setRegions），在 JS 线程中整体替换，取帧线程持有自己的引用
+  mutable std::mutex regionMutex;
+  std::shared_ptr<const FrameRegionSet> regions;
+
+  explicit FrameRegistry(napi_env env)
+      : allocator(std::make_shared<ArrayBufferFrameAllocator>(env)), pool(allocator) {
+    pool.SetMaxSlots(kFramePoolMaxSlots);
+  }
+
+  ~FrameRegistry() {
+    outstanding.clear();
+    pool.Clear();
+    allocator->DeleteReleased();
+  }
+
+  // 让最早交出的一帧脱离缓冲池（先找 JS 尚未归还的帧，再找被金字塔持有的帧），
+  // 返回 false 表示没有可脱离的帧
+  bool OrphanOldest() {
+    if (!outstanding.empty()) {
+      pool.Orphan(outstanding.front());
+      outstanding.pop_front();
+      return true;
+    }
+    while (!pinned.empty()) {
+      FrameLease lease = pinned.front().lock();
+      pinned.pop_front();
+      if (lease) {
+        pool.Orphan(lease);
+        return true;
       }
-      if (napi_get_named_property(env, args[0], "height", &v) == napi_ok) {
-        napi_get_value_uint32(env, v, &roiHeight);
+    }
+    return false;
+  }
+
+  // 记录被金字塔等对象持有的缓冲区，顺带清理已经释放的记录
+  void Pin(const FrameLease& lease) {
+    while (!pinned.empty() && pinned.front().expired()) {
+      pinned.pop_front();
+    }
+    pinned.push_back(lease);
+  }
+
+  // 记录交给 JS 的帧。脱离缓冲池的帧在这里（JS 线程中）补上新的缓冲区，
+  // 否则只用 TryAcquire 的 Live 线程会因为池中缓冲区越来越少而停止取帧。
+  void Hand(const FrameLease& lease) {
+    outstanding.push_back(lease);
+    if (outstanding.size() > kMaxOutstandingFrames) {
+      size_t slots = pool.SlotCount();
+      while (outstanding.size() > kMaxOutstandingFrames) {
+        OrphanOldest();
       }
+      pool.Reserve(pool.SlotSize(), slots);
     }
+    allocator->DeleteReleased();
   }
 
-  static QHYCCDFunctions qhy = {};
-  static bool qhy_loaded = false;
-  if (!qhy_loaded) {
-    // 获取当前模块路径，构建 sdk/x64/qhyccd.dll 的完整路径
-    wchar_t modulePath[MAX_PATH] = {0};
-    HMODULE hModule = NULL;
-    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-                       (LPCWSTR)&CaptureSingleFrame, &hModule);
-    if (hModule) {
-      if (GetModuleFileNameW(hModule, modulePath, MAX_PATH) > 0) {
-        // 移除文件名 (qhyccd_addon.node)，得到 build/Release 目录
-        PathRemoveFileSpecW(modulePath);
-        // 移除 Release，得到 build 目录
-        PathRemoveFileSpecW(modulePath);
-        // 移除 build，得到项目根目录
-        PathRemoveFileSpecW(modulePath);
-        // 构建 sdk/x64/qhyccd.dll 路径
-        PathAppendW(modulePath, L"sdk");
-        PathAppendW(modulePath, L"x64");
-        PathAppendW(modulePath, L"qhyccd.dll");
+  // 统计直方图并按需生成预览图、图块金字塔、星点与区域统计（16bit 单通道帧），可在任意线程中调用。
+  // 彩色相机的帧（frame.bayer）生成去马赛克后的 RGB 预览图；金字塔只支持灰度，彩色帧不生成。
+  // 金字塔持有帧缓冲区的租约，释放之前该缓冲区不会被后续帧复用。
+  void Analyze(const FrameLease& lease, const FrameInfo& frame, bool buildPyramid, FrameAnalysis* analysis) const {
+    {
+      TraceScope trace("native.stats", frame.frameId);
+      ComputeFrameStats(lease->data, frame.bytes, frame.bpp, &analysis->stats);
+    }
+    if (frame.bpp <= 8 || frame.channels != 1 ||
+        frame.bytes < (size_t)frame.width * frame.height * sizeof(uint16_t)) {
+      return;
+    }
+    const uint16_t* pixels = reinterpret_cast<const uint16_t*>(lease->data);
+    uint32_t maxWidth = previewMaxWidth.load();
+    uint32_t maxHeight = previewMaxHeight.load();
+    if (maxWidth > 0 || maxHeight > 0) {
+      TraceScope trace("native.preview", frame.frameId);
+      MakeColorPreview16(pixels, frame.width, frame.height, (BayerPattern)frame.bayer, maxWidth, maxHeight,
+                         &analysis->preview);
+    }
+    if (buildPyramid && frame.bayer == BAYER_NONE &&
+        (frame.width > kDefaultTileSize || frame.height > kDefaultTileSize)) {
+      TraceScope trace("native.pyramid", frame.frameId);
+      analysis->pyramid = std::make_shared<TilePyramid>();
+      analysis->pyramid->Build(pixels, frame.width, frame.height, kDefaultTileSize, lease);
+    }
+    if (starDetection.load()) {
+      TraceScope trace("native.stars", frame.frameId);
+      StarDetectOptions options;
+      options.threshold = starThreshold.load();
+      options.maxStars = starLimit.load();
+      options.measureShape = true;
+      options.saturation = (uint16_t)std::min(65000u, (1u << std::min(frame.bpp, 16u)) - 1u);
+      if (frame.bayer == BAYER_NONE) {
+        DetectStars16(pixels, frame.width, frame.height, options, &analysis->stars, &analysis->starBackground);
       } else {
-        // 如果获取模块路径失败，使用相对路径
-        wcscpy_s(modulePath, MAX_PATH, L"sdk\\x64\\qhyccd.dll");
+        std::vector<uint16_t> luminance;
+        DetectStarsBayer16(pixels, frame.width, frame.height, options, &luminance, &analysis->stars,
+                           &analysis->starBackground);
       }
-    } else {
-      // 如果获取模块句柄失败，使用相对路径
-      wcscpy_s(modulePath, MAX_PATH, L"sdk\\x64\\qhyccd.dll");
+      SummarizeStars(analysis->stars, &analysis->starSummary);
+      analysis->starsDetected = true;
     }
-    
-    if (!LoadQHYCCDLibrary(&qhy, modulePath)) {
-      napi_throw_error(env, NULL, "Failed to load qhyccd.dll or resolve QHYCCD functions");
-      return NULL;
+    std::shared_ptr<const FrameRegionSet> regionSet = Regions();
+    if (regionSet && !regionSet->empty()) {
+      TraceScope trace("native.regions", frame.frameId);
+      MeasureRegions(*regionSet, pixels, frame.width, frame.height, &analysis->regionStats);
+      analysis->regions = regionSet;
     }
-    qhy_loaded = true;
   }
 
-  uint32_t ret = qhy.InitQHYCCDResource();
-  if (ret != 0) {
-    napi_throw_error(env, NULL, "InitQHYCCDResource failed");
-    return NULL;
+  std::shared_ptr<const FrameRegionSet> Regions() const {
+    std::lock_guard<std::mutex> lock(regionMutex);
+    return regions;
+  }
+
+  void SetRegions(std::shared_ptr<const FrameRegionSet> next) {
+    std::lock_guard<std::mutex> lock(regionMutex);
+    regions = std::move(next);
+  }
+
+  // JS 归还帧：按 ArrayBuffer 的底层地址查找
+  bool Release(const void* data) {
+    for (auto it = outstanding.begin(); it != outstanding.end(); ++it) {
+      if ((*it)->data == data) {
+        outstanding.erase(it);
+        allocator->DeleteReleased();
+        return true;
+      }
+    }
+    return false;
   }
+};
 
-  qhyccd_handle* handle = NULL;
+// 组装成 { count, min, max, mean, median, stddev, histogram: Uint32Array(65536) }
+static napi_value CreateStatsObject(napi_env env, const ImageStats& stats) {
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
 
-  // 为了避免 MSVC 关于 goto 跳过初始化的编译错误（C2362），
-  // 将后面需要在 fail/fail_no_free 标签后仍然在作用域中的变量
-  // 统一提前声明。
-  double exposureUs = 0.0;
+  napi_value v;
+  NAPI_CALL(env, napi_create_double(env, (double)stats.count, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "count", v));
+  NAPI_CALL(env, napi_create_uint32(env, stats.min, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "min", v));
+  NAPI_CALL(env, napi_create_uint32(env, stats.max, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "max", v));
+  NAPI_CALL(env, napi_create_double(env, stats.mean, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "mean", v));
+  NAPI_CALL(env, napi_create_uint32(env, stats.median, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "median", v));
+  NAPI_CALL(env, napi_create_double(env, stats.stddev, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "stddev", v));
 
-  uint32_t w = 0;
-  uint32_t h = 0;
-  uint32_t bpp = 0;
-  uint32_t channels = 0;
-  uint32_t memLength = 0;
-  size_t bufferSize = 0;
-  uint8_t* buf = NULL;
-  size_t bytesPerPixel = 0;
-  uint32_t ch = 0;
-  size_t usedBytes = 0;
-  void* array_data = NULL;
+  size_t bytes = stats.histogram.size() * sizeof(uint32_t);
+  void* data = NULL;
   napi_value arraybuffer;
+  NAPI_CALL(env, napi_create_arraybuffer(env, bytes, &data, &arraybuffer));
+  if (bytes > 0) {
+    memcpy(data, stats.histogram.data(), bytes);
+  }
+  NAPI_CALL(env, napi_create_typedarray(env, napi_uint32_array, stats.histogram.size(), arraybuffer, 0, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "histogram", v));
+  return result;
+}
 
-  uint32_t camCount = qhy.ScanQHYCCD();
-  if (camCount == 0) {
-    qhy.ReleaseQHYCCDResource();
-    napi_throw_error(env, NULL, "No QHYCCD camera found");
-    return NULL;
+// 组装成 { width, height, factor, channels, data: ArrayBuffer(16bit) }，channels 为 3 时 data 为交错的 RGB
+static napi_value CreatePreviewObject(napi_env env, const PreviewImage& preview) {
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+
+  napi_value v;
+  NAPI_CALL(env, napi_create_uint32(env, preview.width, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "width", v));
+  NAPI_CALL(env, napi_create_uint32(env, preview.height, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "height", v));
+  NAPI_CALL(env, napi_create_uint32(env, preview.factor, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "factor", v));
+  NAPI_CALL(env, napi_create_uint32(env, preview.channels, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "channels", v));
+
+  size_t bytes = preview.pixels.size() * sizeof(uint16_t);
+  void* data = NULL;
+  NAPI_CALL(env, napi_create_arraybuffer(env, bytes, &data, &v));
+  if (bytes > 0) {
+    memcpy(data, preview.pixels.data(), bytes);
   }
+  NAPI_CALL(env, napi_set_named_property(env, result, "data", v));
+  return result;
+}
 
-  char camId[64];
-  memset(camId, 0, sizeof(camId));
-  ret = qhy.GetQHYCCDId(0, camId);
-  if (ret != 0) {
-    qhy.ReleaseQHYCCDResource();
-    napi_throw_error(env, NULL, "GetQHYCCDId failed");
-    return NULL;
+// ---- TilePyramid JS 类 ----
+// const pyramid = frame.pyramid;                 // 单帧拍摄时在后台线程中构建
+// const pyramid = new TilePyramid(frame, { tileSize? }); // 或从任意 16bit 帧同步构建
+// pyramid.info();  // { tileSize, levels: [{ width, height, scale, columns, rows }] }
+// pyramid.getTile(level, x, y, { black, white, format: 'rgba' | 'gray' | 'raw' });
+// pyramid.dispose(); // 立即释放（否则在垃圾回收时释放）
+
+struct TilePyramidWrap {
+  std::shared_ptr<TilePyramid> pyramid;
+  napi_ref source = NULL;  // 从 JS 数据构建时持有源 ArrayBuffer
+};
+
+static napi_ref g_tilePyramidConstructor = NULL;
+
+static void TilePyramidFinalize(napi_env env, void* data, void* hint) {
+  (void)hint;
+  TilePyramidWrap* wrap = static_cast<TilePyramidWrap*>(data);
+  if (wrap->source != NULL) {
+    napi_delete_reference(env, wrap->source);
   }
+  delete wrap;
+}
 
-  handle = qhy.OpenQHYCCD(camId);
-  if (handle == NULL) {
-    qhy.ReleaseQHYCCDResource();
-    napi_throw_error(env, NULL, "OpenQHYCCD failed");
+static TilePyramidWrap* UnwrapTilePyramid(napi_env env, napi_callback_info info, size_t* argc, napi_value* args) {
+  napi_value thisArg;
+  TilePyramidWrap* wrap = NULL;
+  if (napi_get_cb_info(env, info, argc, args, &thisArg, NULL) != napi_ok ||
+      napi_unwrap(env, thisArg, (void**)&wrap) != napi_ok || wrap == NULL) {
+    napi_throw_error(env, NULL, "Invalid TilePyramid object");
     return NULL;
   }
+  return wrap;
+}
+
+// new TilePyramid(source, { width?, height?, tileSize? })；原生代码内部以 external 参数创建
+static napi_value TilePyramidConstructor(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  napi_value thisArg;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, &thisArg, NULL));
 
-  ret = qhy.SetQHYCCDStreamMode(handle, 0);
-  if (ret != 0) goto fail;
+  TilePyramidWrap* wrap = new TilePyramidWrap();
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    napi_typeof(env, args[0], &type);
+  }
+  if (type == napi_external) {
+    void* external = NULL;
+    napi_get_value_external(env, args[0], &external);
+    wrap->pyramid = *static_cast<std::shared_ptr<TilePyramid>*>(external);
+  } else {
+    const uint16_t* pixels = NULL;
+    size_t count = 0;
+    if (argc < 1 || !GetPixelSource16(env, args[0], &pixels, &count)) {
+      delete wrap;
+      napi_throw_type_error(env, NULL, "TilePyramid 需要 16bit 帧对象、ArrayBuffer 或 Uint16Array");
+      return NULL;
+    }
+    uint32_t values[3] = {0, 0, kDefaultTileSize};  // width, height, tileSize
+    const char* names[3] = {"width", "height", "tileSize"};
+    for (int i = 0; i < 3; i++) {
+      napi_value v;
+      napi_value from = i < 2 && HasProperty(env, args[0], names[i]) ? args[0] : (argc >= 2 ? args[1] : NULL);
+      if (from != NULL && HasProperty(env, from, names[i]) &&
+          napi_get_named_property(env, from, names[i], &v) == napi_ok) {
+        napi_get_value_uint32(env, v, &values[i]);
+      }
+    }
+    if (values[0] == 0 || values[1] == 0 || (size_t)values[0] * values[1] > count) {
+      delete wrap;
+      napi_throw_range_error(env, NULL, "TilePyramid: width / height 与像素数据长度不符");
+      return NULL;
+    }
+    if (napi_create_reference(env, args[0], 1, &wrap->source) != napi_ok) {
+      delete wrap;
+      napi_throw_error(env, NULL, "TilePyramid: 无法引用源数据");
+      return NULL;
+    }
+    wrap->pyramid = std::make_shared<TilePyramid>();
+    wrap->pyramid->Build(pixels, values[0], values[1], values[2], nullptr);
+  }
 
-  ret = qhy.InitQHYCCD(handle);
-  if (ret != 0) goto fail;
+  napi_status status = napi_wrap(env, thisArg, wrap, TilePyramidFinalize, NULL, NULL);
+  if (status != napi_ok) {
+    TilePyramidFinalize(env, wrap, NULL);
+    napi_throw_error(env, NULL, "Failed to wrap TilePyramid");
+    return NULL;
+  }
+  return thisArg;
+}
 
-  ret = qhy.SetQHYCCDBinMode(handle, 1, 1);
-  if (ret != 0) goto fail;
+// info()：{ tileSize, levels: [{ width, height, scale, columns, rows }] }，已释放时 levels 为空
+static napi_value TilePyramidInfo(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  TilePyramidWrap* wrap = UnwrapTilePyramid(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  const TilePyramid* pyramid = wrap->pyramid.get();
+  size_t levelCount = pyramid ? pyramid->LevelCount() : 0;
 
-  ret = qhy.SetQHYCCDResolution(handle, 0, 0, roiWidth, roiHeight);
-  if (ret != 0) goto fail;
+  napi_value result;
+  napi_value v;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  NAPI_CALL(env, napi_create_uint32(env, pyramid ? pyramid->TileSize() : 0, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "tileSize", v));
 
-  // 曝光时间（单位：微秒）
-  if (exposureUs <= 0.0) {
-    exposureUs = (double)exposureMs * 1000.0;
+  napi_value levels;
+  NAPI_CALL(env, napi_create_array_with_length(env, levelCount, &levels));
+  for (size_t i = 0; i < levelCount; i++) {
+    const PyramidLevel& l = pyramid->Level(i);
+    napi_value level;
+    NAPI_CALL(env, napi_create_object(env, &level));
+    NAPI_CALL(env, napi_create_uint32(env, l.width, &v));
+    NAPI_CALL(env, napi_set_named_property(env, level, "width", v));
+    NAPI_CALL(env, napi_create_uint32(env, l.height, &v));
+    NAPI_CALL(env, napi_set_named_property(env, level, "height", v));
+    NAPI_CALL(env, napi_create_uint32(env, l.scale, &v));
+    NAPI_CALL(env, napi_set_named_property(env, level, "scale", v));
+    NAPI_CALL(env, napi_create_uint32(env, l.columns, &v));
+    NAPI_CALL(env, napi_set_named_property(env, level, "columns", v));
+    NAPI_CALL(env, napi_create_uint32(env, l.rows, &v));
+    NAPI_CALL(env, napi_set_named_property(env, level, "rows", v));
+    NAPI_CALL(env, napi_set_element(env, levels, (uint32_t)i, level));
   }
-  ret = qhy.SetQHYCCDParam(handle, QHYCCD_CONTROL_EXPOSURE, exposureUs);
-  if (ret != 0) goto fail;
+  NAPI_CALL(env, napi_set_named_property(env, result, "levels", levels));
+  return result;
+}
 
-  // 增益和偏置（如果提供）
-  if (gain >= 0.0) {
-    ret = qhy.SetQHYCCDParam(handle, QHYCCD_CONTROL_GAIN, gain);
-    if (ret != 0) goto fail;
+// getTile(level, x, y, { black?, white?, format?: 'rgba' | 'gray' | 'raw' })：
+// 返回 { width, height, data: ArrayBuffer }。raw 为 16bit 原始数据，其余为按电平拉伸后的 8bit 数据。
+static napi_value TilePyramidGetTile(napi_env env, napi_callback_info info) {
+  size_t argc = 4;
+  napi_value args[4];
+  TilePyramidWrap* wrap = UnwrapTilePyramid(env, info, &argc, args);
+  if (wrap == NULL) {
+    return NULL;
   }
-  if (offset >= 0.0) {
-    ret = qhy.SetQHYCCDParam(handle, QHYCCD_CONTROL_OFFSET, offset);
-    if (ret != 0) goto fail;
+  uint32_t coords[3] = {0, 0, 0};
+  for (size_t i = 0; i < 3; i++) {
+    if (i >= argc || napi_get_value_uint32(env, args[i], &coords[i]) != napi_ok) {
+      napi_throw_type_error(env, NULL, "getTile(level, x, y, options) 需要整数参数");
+      return NULL;
+    }
   }
 
-  ret = qhy.ExpQHYCCDSingleFrame(handle);
-  if (ret != 0) goto fail;
+  uint16_t black = 0;
+  uint16_t white = 65535;
+  bool raw = false;
+  StretchFormat format = STRETCH_RGBA8;
+  if (argc >= 4) {
+    napi_valuetype type;
+    NAPI_CALL(env, napi_typeof(env, args[3], &type));
+    if (type == napi_object) {
+      ReadLevel(env, args[3], "black", &black);
+      ReadLevel(env, args[3], "white", &white);
+      napi_value v;
+      if (HasProperty(env, args[3], "format") && napi_get_named_property(env, args[3], "format", &v) == napi_ok) {
+        char name[8] = {0};
+        size_t len = 0;
+        napi_get_value_string_utf8(env, v, name, sizeof(name), &len);
+        raw = strcmp(name, "raw") == 0;
+        if (strcmp(name, "gray") == 0) {
+          format = STRETCH_GRAY8;
+        }
+      }
+    }
+  }
 
-  w = 0;
-  h = 0;
-  bpp = 0;
-  channels = 0;
+  const TilePyramid* pyramid = wrap->pyramid.get();
+  uint32_t width = 0;
+  uint32_t height = 0;
+  if (pyramid == NULL || !pyramid->TileExtent(coords[0], coords[1], coords[2], &width, &height)) {
+    napi_throw_range_error(env, NULL, "getTile: 图块不存在");
+    return NULL;
+  }
 
-  memLength = qhy.GetQHYCCDMemLength(handle);
-  bufferSize = memLength > 0 ? (size_t)memLength : (size_t)roiWidth * roiHeight * 2;
-  buf = (uint8_t*)malloc(bufferSize);
-  if (buf == NULL) {
-    goto fail;
+  size_t bytes = (size_t)width * height * (raw ? sizeof(uint16_t) : StretchBytesPerPixel(format));
+  void* data = NULL;
+  napi_value arraybuffer;
+  NAPI_CALL(env, napi_create_arraybuffer(env, bytes, &data, &arraybuffer));
+  if (raw) {
+    pyramid->CopyTile(coords[0], coords[1], coords[2], static_cast<uint16_t*>(data));
+  } else {
+    pyramid->StretchTile(coords[0], coords[1], coords[2], black, white, format, static_cast<uint8_t*>(data));
   }
 
-  ret = qhy.GetQHYCCDSingleFrame(handle, &w, &h, &bpp, &channels, buf);
-  if (ret != 0) {
-    free(buf);
-    goto fail;
+  napi_value result;
+  napi_value v;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  NAPI_CALL(env, napi_create_uint32(env, width, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "width", v));
+  NAPI_CALL(env, napi_create_uint32(env, height, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "height", v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "data", arraybuffer));
+  return result;
+}
+
+// dispose()：释放金字塔数据以及它持有的帧缓冲区
+static napi_value TilePyramidDispose(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  TilePyramidWrap* wrap = UnwrapTilePyramid(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
   }
+  wrap->pyramid.reset();
+  if (wrap->source != NULL) {
+    napi_delete_reference(env, wrap->source);
+    wrap->source = NULL;
+  }
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// 把原生线程中构建好的金字塔包装为 TilePyramid 对象
+static napi_value CreateTilePyramidObject(napi_env env, const std::shared_ptr<TilePyramid>& pyramid) {
+  napi_value constructor;
+  napi_value external;
+  napi_value result;
+  std::shared_ptr<TilePyramid> copy = pyramid;
+  NAPI_CALL(env, napi_get_reference_value(env, g_tilePyramidConstructor, &constructor));
+  NAPI_CALL(env, napi_create_external(env, &copy, NULL, NULL, &external));
+  NAPI_CALL(env, napi_new_instance(env, constructor, 1, &external, &result));
+  return result;
+}
 
-  if (w == 0 || h == 0 || bpp == 0) {
-    free(buf);
-    goto fail;
+// 组装成 { frames, rejectedFrames, accepted, reference, stars, matches, dx, dy, rotation, scale, residual, rejectedPixels }
+static napi_value CreateStackObject(napi_env env, const StackFrameResult& stack) {
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  napi_value v;
+  const struct {
+    const char* name;
+    double value;
+  } numbers[] = {
+      {"frames", (double)stack.frames},       {"rejectedFrames", (double)stack.rejectedFrames},
+      {"stars", (double)stack.stars},         {"matches", (double)stack.matches},
+      {"dx", stack.dx},                       {"dy", stack.dy},
+      {"rotation", stack.rotation},           {"scale", stack.scale},
+      {"residual", stack.residual},           {"rejectedPixels", (double)stack.rejectedPixels},
+  };
+  for (const auto& number : numbers) {
+    NAPI_CALL(env, napi_create_double(env, number.value, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, number.name, v));
   }
+  NAPI_CALL(env, napi_get_boolean(env, stack.accepted, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "accepted", v));
+  NAPI_CALL(env, napi_get_boolean(env, stack.reference, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "reference", v));
+  return result;
+}
 
-  bytesPerPixel = (bpp + 7u) / 8u;
-  if (bytesPerPixel == 0) {
-    bytesPerPixel = 1;
+// 组装成 { count, saturated, medianHfr, medianFwhm, medianEccentricity, background, noise, stride, data }，
+// data 为 Float32Array，每颗星 stride 个值：x, y, flux, hfr, fwhm, eccentricity（按 flux 从大到小）。
+// 坐标以像素中心为整数，单位为原图像素；中位数不含饱和星。
+static napi_value CreateStarsObject(napi_env env, const FrameAnalysis& analysis) {
+  const std::vector<Star>& stars = analysis.stars;
+  const StarFieldSummary& summary = analysis.starSummary;
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  napi_value v;
+  const struct {
+    const char* name;
+    double value;
+  } numbers[] = {
+      {"count", (double)summary.count},
+      {"saturated", (double)summary.saturated},
+      {"medianHfr", summary.medianHfr},
+      {"medianFwhm", summary.medianFwhm},
+      {"medianEccentricity", summary.medianEccentricity},
+      {"background", analysis.starBackground.level},
+      {"noise", analysis.starBackground.noise},
+      {"stride", (double)kFrameStarStride},
+  };
+  for (const auto& number : numbers) {
+    NAPI_CALL(env, napi_create_double(env, number.value, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, number.name, v));
   }
-  ch = channels == 0 ? 1u : channels;
-  usedBytes = (size_t)w * (size_t)h * bytesPerPixel * (size_t)ch;
-  if (usedBytes > bufferSize) {
-    usedBytes = bufferSize;
+
+  void* data = NULL;
+  napi_value arraybuffer;
+  NAPI_CALL(env, napi_create_arraybuffer(env, stars.size() * kFrameStarStride * sizeof(float), &data, &arraybuffer));
+  float* out = static_cast<float*>(data);
+  for (const Star& star : stars) {
+    out[0] = star.x;
+    out[1] = star.y;
+    out[2] = star.flux;
+    out[3] = star.hfr;
+    out[4] = star.fwhm;
+    out[5] = star.eccentricity;
+    out += kFrameStarStride;
   }
+  NAPI_CALL(env, napi_create_typedarray(env, napi_float32_array, stars.size() * kFrameStarStride, arraybuffer, 0, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "data", v));
+  return result;
+}
 
-  // 改用普通 ArrayBuffer，避免 external arraybuffer 在部分 Node/Electron
-  // 版本或 ABI 组合下出现兼容性问题（报 napi_create_external_arraybuffer failed）
-  NAPI_CALL(env, napi_create_arraybuffer(env, usedBytes, &array_data, &arraybuffer));
-  std::memcpy(array_data, buf, usedBytes);
-  free(buf);
+// 组装成 [{ id, count, sum, mean, median, stddev, min, max, snr }]，与 regions 的顺序相同
+static napi_value CreateRegionStatsArray(napi_env env, const FrameRegionSet& regions,
+                                         const std::vector<RegionStats>& stats) {
+  napi_value result;
+  NAPI_CALL(env, napi_create_array_with_length(env, regions.size(), &result));
+  for (size_t i = 0; i < regions.size() && i < stats.size(); i++) {
+    const RegionStats& s = stats[i];
+    napi_value item;
+    napi_value v;
+    NAPI_CALL(env, napi_create_object(env, &item));
+    NAPI_CALL(env, napi_create_string_utf8(env, regions[i].id.c_str(), NAPI_AUTO_LENGTH, &v));
+    NAPI_CALL(env, napi_set_named_property(env, item, "id", v));
+    const struct {
+      const char* name;
+      double value;
+    } numbers[] = {
+        {"count", (double)s.count}, {"sum", s.sum},           {"mean", s.mean},
+        {"median", (double)s.median}, {"stddev", s.stddev},   {"min", (double)s.min},
+        {"max", (double)s.max},       {"snr", s.snr},
+    };
+    for (const auto& number : numbers) {
+      NAPI_CALL(env, napi_create_double(env, number.value, &v));
+      NAPI_CALL(env, napi_set_named_property(env, item, number.name, v));
+    }
+    NAPI_CALL(env, napi_set_element(env, result, (uint32_t)i, item));
+  }
+  return result;
+}
 
-  qhy.CloseQHYCCD(handle);
-  qhy.ReleaseQHYCCDResource();
+// 组装成 { data, byteLength, width, height, bpp, channels, bayer, stats, preview?, pyramid?, stack?, stars?, regions? }。
+// bayer 为彩色相机原始帧的阵列名称（"RGGB" 等），黑白或已 bin 时为 null。
+// data 是缓冲池中的 ArrayBuffer，长度为读出缓冲区大小，前 byteLength 字节为有效数据。
+// 调用 releaseFrame 之后该 ArrayBuffer 会被后续帧覆盖，不应再访问。
+// analysis 为取帧线程中完成的统计与预览图，为 NULL 时在这里（JS 线程中）计算。
+// 实时叠加时 data 为叠加结果，stack 为本帧的配准与叠加信息；setStarDetection 之后 stars 为星点与对焦指标，
+// setRegions 之后 regions 为各区域的统计。
+static napi_value CreateFrameObject(napi_env env,
+                                    const FrameLease& lease,
+                                    const FrameInfo& frame,
+                                    const FrameAnalysis* analysis,
+                                    const std::shared_ptr<FrameRegistry>& registry) {
+  TraceScope trace("native.frame-object", frame.frameId);
+  napi_value arraybuffer;
+  NAPI_CALL(env, ArrayBufferFrameAllocator::GetArrayBuffer(env, lease, &arraybuffer));
 
   napi_value result;
   NAPI_CALL(env, napi_create_object(env, &result));
@@ -237,46 +928,2686 @@ static napi_value CaptureSingleFrame(napi_env env, napi_callback_info info) {
   NAPI_CALL(env, napi_set_named_property(env, result, "data", arraybuffer));
 
   napi_value v;
-  NAPI_CALL(env, napi_create_uint32(env, w, &v));
+  NAPI_CALL(env, napi_create_double(env, (double)frame.bytes, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "byteLength", v));
+
+  NAPI_CALL(env, napi_create_uint32(env, frame.width, &v));
   NAPI_CALL(env, napi_set_named_property(env, result, "width", v));
 
-  NAPI_CALL(env, napi_create_uint32(env, h, &v));
+  NAPI_CALL(env, napi_create_uint32(env, frame.height, &v));
   NAPI_CALL(env, napi_set_named_property(env, result, "height", v));
 
-  NAPI_CALL(env, napi_create_uint32(env, bpp, &v));
+  NAPI_CALL(env, napi_create_uint32(env, frame.bpp, &v));
   NAPI_CALL(env, napi_set_named_property(env, result, "bpp", v));
 
-  NAPI_CALL(env, napi_create_uint32(env, channels, &v));
+  NAPI_CALL(env, napi_create_uint32(env, frame.channels, &v));
   NAPI_CALL(env, napi_set_named_property(env, result, "channels", v));
 
-  return result;
+  const char* bayerName = BayerPatternName((BayerPattern)frame.bayer);
+  if (bayerName) {
+    NAPI_CALL(env, napi_create_string_utf8(env, bayerName, NAPI_AUTO_LENGTH, &v));
+  } else {
+    NAPI_CALL(env, napi_get_null(env, &v));
+  }
+  NAPI_CALL(env, napi_set_named_property(env, result, "bayer", v));
+
+  // 这一帧在传感器上的位置：x / y 为硬件 bin 后的 ROI 起点，帧像素 (i, j) 对应 bin 后的
+  // (x + i * softwareBin, y + j * softwareBin)，渲染进程据此把图上的矩形换算为新的 ROI
+  {
+    napi_value roi;
+    NAPI_CALL(env, napi_create_object(env, &roi));
+    const struct {
+      const char* name;
+      uint32_t value;
+    } fields[] = {{"x", frame.roiX}, {"y", frame.roiY}, {"bin", frame.binX}, {"softwareBin", frame.softwareBin}};
+    for (const auto& field : fields) {
+      NAPI_CALL(env, napi_create_uint32(env, field.value, &v));
+      NAPI_CALL(env, napi_set_named_property(env, roi, field.name, v));
+    }
+    NAPI_CALL(env, napi_set_named_property(env, result, "roi", roi));
+  }
 
-fail:
-  if (handle) {
-    qhy.CloseQHYCCD(handle);
+  // 帧 ID：getTimings({ frameId }) 按它取出这一帧各阶段的计时
+  NAPI_CALL(env, napi_create_double(env, (double)frame.frameId, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "frameId", v));
+
+  // 曝光开始时刻（Unix 纪元毫秒）与传感器温度（摄氏度，不支持时为 null）
+  NAPI_CALL(env, napi_create_double(env, (double)frame.startUtcUs / 1000.0, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "timestamp", v));
+  if (std::isnan(frame.temperature)) {
+    NAPI_CALL(env, napi_get_null(env, &v));
+  } else {
+    NAPI_CALL(env, napi_create_double(env, frame.temperature, &v));
   }
-  qhy.ReleaseQHYCCDResource();
-  napi_throw_error(env, NULL, "QHYCCD capture failed");
-  return NULL;
+  NAPI_CALL(env, napi_set_named_property(env, result, "temperature", v));
 
-fail_no_free:
-  if (handle) {
-    qhy.CloseQHYCCD(handle);
+  // 取帧时已进行的校正：'D'（减暗场）、'F'（除平场）、'DF'，未校正时为 null
+  if (frame.calibration != 0) {
+    std::string calibration = std::string(frame.calibration & CALIBRATED_DARK ? "D" : "") +
+                              (frame.calibration & CALIBRATED_FLAT ? "F" : "");
+    NAPI_CALL(env, napi_create_string_utf8(env, calibration.c_str(), NAPI_AUTO_LENGTH, &v));
+  } else {
+    NAPI_CALL(env, napi_get_null(env, &v));
   }
-  qhy.ReleaseQHYCCDResource();
-  return NULL;
+  NAPI_CALL(env, napi_set_named_property(env, result, "calibration", v));
+
+  FrameAnalysis localAnalysis;
+  if (analysis == NULL) {
+    registry->Analyze(lease, frame, true, &localAnalysis);
+    analysis = &localAnalysis;
+  }
+  v = CreateStatsObject(env, analysis->stats);
+  if (v == NULL) {
+    return NULL;
+  }
+  NAPI_CALL(env, napi_set_named_property(env, result, "stats", v));
+  if (analysis->preview.factor > 0) {
+    v = CreatePreviewObject(env, analysis->preview);
+    if (v == NULL) {
+      return NULL;
+    }
+    NAPI_CALL(env, napi_set_named_property(env, result, "preview", v));
+  }
+  if (analysis->pyramid) {
+    v = CreateTilePyramidObject(env, analysis->pyramid);
+    if (v == NULL) {
+      return NULL;
+    }
+    NAPI_CALL(env, napi_set_named_property(env, result, "pyramid", v));
+    registry->Pin(lease);
+  }
+  if (analysis->stacked) {
+    v = CreateStackObject(env, analysis->stack);
+    if (v == NULL) {
+      return NULL;
+    }
+    NAPI_CALL(env, napi_set_named_property(env, result, "stack", v));
+  }
+  if (analysis->starsDetected) {
+    v = CreateStarsObject(env, *analysis);
+    if (v == NULL) {
+      return NULL;
+    }
+    NAPI_CALL(env, napi_set_named_property(env, result, "stars", v));
+  }
+  if (analysis->regions) {
+    v = CreateRegionStatsArray(env, *analysis->regions, analysis->regionStats);
+    if (v == NULL) {
+      return NULL;
+    }
+    NAPI_CALL(env, napi_set_named_property(env, result, "regions", v));
+  }
+
+  registry->Hand(lease);
+  return result;
 }
 
-static napi_value Init(napi_env env, napi_value exports) {
-  napi_value fn;
-  NAPI_CALL(env,
-            napi_create_function(env,
-                                 "captureSingleFrame",
-                                 NAPI_AUTO_LENGTH,
+// 按会话当前的读出大小准备缓冲池并取出一块（在 JS 线程中），失败时抛出异常
+static FrameLease AcquireFrameBuffer(napi_env env, CameraSession* session, FrameRegistry* registry) {
+  FrameLease lease;
+  if (registry->pool.Reserve(session->FrameBufferSize(), 1)) {
+    lease = registry->pool.Acquire();
+    // 缓冲区全部在 JS 手中时，让最早的一帧脱离缓冲池后重试
+    while (!lease && registry->OrphanOldest()) {
+      lease = registry->pool.Acquire();
+    }
+  }
+  registry->allocator->DeleteReleased();
+  if (!lease) {
+    napi_throw_error(env, NULL, "Failed to allocate frame buffer");
+  }
+  return lease;
+}
+
+// 会话的录制器：FITS（每帧一个文件）与 SER（单文件序列），同一时间只有一个在录制。
+// Enqueue 在取到帧的线程中直接调用，帧数据不经过 JS；未在录制的一方直接返回。
+struct SessionRecorders {
+  FitsWriter fits;
+  SerWriter ser;
+  bool serActive = false;  // 最近一次 startRecording 的格式，只在 JS 线程中访问
+
+  void Enqueue(const FrameInfo& frame, const uint8_t* data) {
+    fits.Enqueue(frame, data);
+    ser.Enqueue(frame, data);
+  }
+};
+
+// 会话的实时叠加：startStacking 之后，取到的每一帧（录制器拷贝之后、统计与预览图之前）在取帧线程中
+// 叠加，帧缓冲区被替换为叠加结果。stacker 在 JS 线程中替换，取帧线程持有自己的引用。
+struct SessionStacking {
+  std::mutex mutex;
+  std::shared_ptr<LiveStacker> stacker;
+
+  std::shared_ptr<LiveStacker> Get() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stacker;
+  }
+
+  void Set(std::shared_ptr<LiveStacker> next) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stacker = std::move(next);
+  }
+
+  // 只叠加 16bit 单通道帧
+  void Apply(const FrameLease& lease, const FrameInfo& frame, FrameAnalysis* analysis) {
+    std::shared_ptr<LiveStacker> current = Get();
+    if (!current || frame.bpp <= 8 || frame.channels != 1 ||
+        frame.bytes < (size_t)frame.width * frame.height * sizeof(uint16_t)) {
+      return;
+    }
+    TraceScope trace("native.stack", frame.frameId);
+    analysis->stacked = current->Add(reinterpret_cast<uint16_t*>(lease->data), frame.width, frame.height,
+                                     frame.bayer, &analysis->stack);
+  }
+};
+
+// 用已打开并配置好的会话拍摄一帧，返回帧对象；失败时抛出异常。
+// recorders 非空且正在录制时，这一帧同时交给录制器；stacking 非空且已开始叠加时，返回叠加结果。
+// buildPyramid 为 false 时不生成图块金字塔（registry 活不过这次调用时，金字塔持有的租约无人回收）。
+static napi_value CaptureWithSession(napi_env env,
+                                     CameraSession* session,
+                                     const std::shared_ptr<FrameRegistry>& registry,
+                                     SessionRecorders* recorders = NULL,
+                                     SessionStacking* stacking = NULL,
+                                     bool buildPyramid = true) {
+  FrameLease lease = AcquireFrameBuffer(env, session, registry.get());
+  if (!lease) {
+    return NULL;
+  }
+
+  FrameInfo frame;
+  if (!session->Capture(lease->data, lease->capacity, &frame)) {
+    napi_throw_error(env, NULL, session->LastError().c_str());
+    return NULL;
+  }
+  if (recorders) {
+    recorders->Enqueue(frame, lease->data);
+  }
+  FrameAnalysis analysis;
+  if (stacking) {
+    stacking->Apply(lease, frame, &analysis);
+  }
+  registry->Analyze(lease, frame, buildPyramid, &analysis);
+  return CreateFrameObject(env, lease, frame, &analysis, registry);
+}
+
+// captureSingleFrame(options)
+// 兼容旧接口：每次调用都完整地打开 / 关闭相机。连续拍摄请使用 CameraSession。
+static napi_value CaptureSingleFrame(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  CaptureSettings settings;
+  if (argc >= 1 && ReadCaptureSettings(env, args[0], &settings) != napi_ok) {
+    napi_throw_error(env, NULL, "Invalid capture options");
+    return NULL;
+  }
+
+  const QHYCCDFunctions* qhy = LoadQHYCCD(env);
+  if (qhy == NULL) {
+    return NULL;
+  }
+
+  CameraSession session(qhy);
+  if (!session.Open() || !session.Configure(settings)) {
+    napi_throw_error(env, NULL, session.LastError().c_str());
+    return NULL;
+  }
+  // 临时的 registry 在返回后即销毁，之后释放的缓冲区引用再也不会被删除，因此这里不生成金字塔
+  return CaptureWithSession(env, &session, std::make_shared<FrameRegistry>(env), NULL, NULL, false);
+}
+
+// ---- CameraSession JS 类 ----
+// const session = new CameraSession();
+// session.open({ cameraId? }); session.configure(options);
+// const frame = session.capture();            // 同步，阻塞调用线程
+// const frame = await session.captureAsync(); // 在 libuv 线程池中曝光 / 读出
+// session.startLive(options, (frame) => {});   // 连续模式，独立线程取帧
+// session.stopLive();
+// session.setPreviewSize(maxWidth, maxHeight); // 之后的帧附带缩小的预览图
+// session.startRecording({ directory });       // 之后拍到的每一帧在后台写为 FITS（或 { format: 'ser', path }）
+// session.stopRecording();
+// session.startStacking({ method: 'mean' });    // 之后的帧配准后叠加，帧数据替换为叠加结果
+// session.stopStacking();
+// session.setRegions([{ id, type: 'rect', points }]); // 之后的帧附带区域统计 frame.regions
+// session.close();
+
+// Live 帧通过 napi_threadsafe_function 从取帧线程送回 JS 线程
+struct LiveFrameMessage {
+  FrameLease buffer;
+  FrameInfo frame;
+  uint64_t frameIndex;
+  std::shared_ptr<FrameRegistry> registry;
+  FrameAnalysis analysis;
+  int64_t postedUs;  // 投递到 JS 线程的时间，用于记录排队耗时
+};
+
+class ThreadsafeLiveSink : public LiveFrameSink {
+ public:
+  napi_threadsafe_function tsfn = NULL;
+  std::shared_ptr<FrameRegistry> registry;
+  SessionRecorders* recorders = NULL;
+  SessionStacking* stacking = NULL;
+
+  FrameLease AcquireBuffer(size_t size) override {
+    (void)size;
+    // 取帧线程中不分配内存，池中缓冲区都在使用时跳过本帧
+    return registry->pool.TryAcquire();
+  }
+
+  bool Deliver(const FrameLease& buffer, const FrameInfo& info, uint64_t frameIndex) override {
+    // 录制器先拷贝一份：即使 JS 线程来不及处理而丢帧，录制也不会缺帧
+    recorders->Enqueue(info, buffer->data);
+    LiveFrameMessage* msg = new LiveFrameMessage{buffer, info, frameIndex, registry, FrameAnalysis(), 0};
+    stacking->Apply(buffer, info, &msg->analysis);
+    // 统计与预览图在取帧线程中完成，JS 线程只负责组装对象
+    registry->Analyze(buffer, info, false, &msg->analysis);
+    msg->postedUs = TraceNowUs();
+    // 非阻塞投递：JS 线程处理不过来（队列已满）时直接丢帧，保证取帧线程不被拖慢
+    if (napi_call_threadsafe_function(tsfn, msg, napi_tsfn_nonblocking) != napi_ok) {
+      delete msg;
+      return false;
+    }
+    return true;
+  }
+};
+
+// JS 对象上包装的本地状态。busy 为 true 时有后台拍摄任务正在使用 session，
+// 期间拒绝其它会修改相机状态的调用；close() 会被推迟到任务结束后执行。
+struct SessionWrap {
+  CameraSession* session;
+  bool busy;
+  bool closePending;
+  LiveCapture live;
+  ThreadsafeLiveSink liveSink;
+  std::shared_ptr<FrameRegistry> registry;
+  // 析构时写完队列中剩余的帧
+  SessionRecorders recorders;
+  SessionStacking stacking;
+};
+
+// 停止 Live 线程并释放 threadsafe function，队列中剩余的帧仍会被送达
+static void StopLiveStream(SessionWrap* wrap) {
+  wrap->live.Stop();
+  if (wrap->liveSink.tsfn) {
+    napi_release_threadsafe_function(wrap->liveSink.tsfn, napi_tsfn_release);
+    wrap->liveSink.tsfn = NULL;
+  }
+}
+
+static SessionWrap* UnwrapSession(napi_env env, napi_callback_info info,
+                                  size_t* argc, napi_value* args, napi_value* thisOut = NULL) {
+  napi_value thisArg;
+  if (napi_get_cb_info(env, info, argc, args, &thisArg, NULL) != napi_ok) {
+    napi_throw_error(env, NULL, "Invalid CameraSession call");
+    return NULL;
+  }
+  SessionWrap* wrap = NULL;
+  if (napi_unwrap(env, thisArg, (void**)&wrap) != napi_ok || wrap == NULL) {
+    napi_throw_error(env, NULL, "Invalid CameraSession object");
+    return NULL;
+  }
+  if (thisOut) {
+    *thisOut = thisArg;
+  }
+  return wrap;
+}
+
+// 后台任务进行中时抛出异常并返回 true
+static bool ThrowIfBusy(napi_env env, SessionWrap* wrap) {
+  if (wrap->busy) {
+    napi_throw_error(env, NULL, "Camera is busy with another capture");
+    return true;
+  }
+  return false;
+}
+
+// Live 模式运行中时抛出异常并返回 true（单帧拍摄与 Live 互斥）
+static bool ThrowIfLive(napi_env env, SessionWrap* wrap) {
+  if (wrap->live.IsRunning()) {
+    napi_throw_error(env, NULL, "Live mode is running");
+    return true;
+  }
+  return false;
+}
+
+static void SessionFinalize(napi_env env, void* data, void* hint) {
+  (void)env;
+  (void)hint;
+  SessionWrap* wrap = static_cast<SessionWrap*>(data);
+  StopLiveStream(wrap);
+  delete wrap->session;
+  delete wrap;
+}
+
+static napi_value SessionConstructor(napi_env env, napi_callback_info info) {
+  napi_value thisArg;
+  NAPI_CALL(env, napi_get_cb_info(env, info, NULL, NULL, &thisArg, NULL));
+
+  const QHYCCDFunctions* qhy = LoadQHYCCD(env);
+  if (qhy == NULL) {
+    return NULL;
+  }
+
+  SessionWrap* wrap = new SessionWrap();
+  wrap->session = new CameraSession(qhy);
+  wrap->busy = false;
+  wrap->closePending = false;
+  wrap->registry = std::make_shared<FrameRegistry>(env);
+  wrap->liveSink.registry = wrap->registry;
+  wrap->liveSink.recorders = &wrap->recorders;
+  wrap->liveSink.stacking = &wrap->stacking;
+  napi_status status = napi_wrap(env, thisArg, wrap, SessionFinalize, NULL, NULL);
+  if (status != napi_ok) {
+    delete wrap->session;
+    delete wrap;
+    napi_throw_error(env, NULL, "Failed to create CameraSession");
+    return NULL;
+  }
+  return thisArg;
+}
+
+// open(options?)：打开相机，可通过 options.cameraId 指定相机
+static napi_value SessionOpen(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL || ThrowIfBusy(env, wrap)) {
+    return NULL;
+  }
+
+  char cameraId[64] = {0};
+  if (argc >= 1) {
+    napi_valuetype type;
+    NAPI_CALL(env, napi_typeof(env, args[0], &type));
+    napi_value v;
+    if (type == napi_object && HasProperty(env, args[0], "cameraId") &&
+        napi_get_named_property(env, args[0], "cameraId", &v) == napi_ok) {
+      size_t len = 0;
+      napi_get_value_string_utf8(env, v, cameraId, sizeof(cameraId), &len);
+    }
+  }
+
+  if (!wrap->session->Open(cameraId)) {
+    napi_throw_error(env, NULL, wrap->session->LastError().c_str());
+    return NULL;
+  }
+
+  napi_value result;
+  NAPI_CALL(env, napi_create_string_utf8(env, wrap->session->CameraId(), NAPI_AUTO_LENGTH, &result));
+  return result;
+}
+
+// 把 options 合并进当前参数并下发，失败时抛出异常并返回 false
+static bool ConfigureFromArgs(napi_env env, SessionWrap* wrap, size_t argc, napi_value* args) {
+  CaptureSettings settings = wrap->session->Settings();
+  if (argc >= 1 && ReadCaptureSettings(env, args[0], &settings) != napi_ok) {
+    napi_throw_error(env, NULL, "Invalid capture options");
+    return false;
+  }
+  if (!wrap->session->Configure(settings)) {
+    napi_throw_error(env, NULL, wrap->session->LastError().c_str());
+    return false;
+  }
+  return true;
+}
+
+// configure(options)：更新曝光 / 增益 / 偏置 / ROI，未出现的字段保持上一次的值
+static napi_value SessionConfigure(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL || ThrowIfBusy(env, wrap)) {
+    return NULL;
+  }
+  if (!ConfigureFromArgs(env, wrap, argc, args)) {
+    return NULL;
+  }
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// 组装成 { x, y, width, height, bin }
+static napi_value CreateRoiObject(napi_env env, const RoiRect& roi) {
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  napi_value v;
+  const struct {
+    const char* name;
+    uint32_t value;
+  } fields[] = {{"x", roi.x}, {"y", roi.y}, {"width", roi.width}, {"height", roi.height}, {"bin", roi.bin}};
+  for (const auto& field : fields) {
+    NAPI_CALL(env, napi_create_uint32(env, field.value, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, field.name, v));
+  }
+  return result;
+}
+
+// setRoi({ x, y, width, height, bin? } | null)：切换子帧 ROI 与硬件 bin（坐标为 bin 后的像素），
+// 按传感器范围裁剪后下发，不重新初始化相机；Live 进行中也可调用，之后的帧即为新的 ROI。
+// null 或 width / height 为 0 表示整个传感器。返回实际使用的 { x, y, width, height, bin }。
+static napi_value SessionSetRoi(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL || ThrowIfBusy(env, wrap)) {
+    return NULL;
+  }
+  RoiRect roi;
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    NAPI_CALL(env, napi_typeof(env, args[0], &type));
+  }
+  if (type == napi_object) {
+    const char* names[5] = {"x", "y", "width", "height", "bin"};
+    uint32_t* fields[5] = {&roi.x, &roi.y, &roi.width, &roi.height, &roi.bin};
+    for (int i = 0; i < 5; i++) {
+      if (!HasProperty(env, args[0], names[i])) {
+        continue;
+      }
+      napi_value v;
+      double value = 0.0;
+      NAPI_CALL(env, napi_get_named_property(env, args[0], names[i], &v));
+      if (napi_get_value_double(env, v, &value) != napi_ok || !(value >= 0.0)) {
+        napi_throw_type_error(env, NULL, "setRoi: x / y / width / height / bin 必须是非负数");
+        return NULL;
+      }
+      *fields[i] = (uint32_t)std::min(value, 65535.0);
+    }
+  } else if (type != napi_null && type != napi_undefined) {
+    napi_throw_type_error(env, NULL, "setRoi(roi) 需要对象或 null");
+    return NULL;
+  }
+
+  RoiRect applied;
+  if (!wrap->session->SetRoi(roi, &applied)) {
+    std::string error = wrap->session->LastError();
+    // Live 中切换后未能重新开始连续曝光：停止取帧线程，不让它对着已停止的数据流空转
+    if (wrap->live.IsRunning() && !wrap->session->IsLive()) {
+      StopLiveStream(wrap);
+      wrap->registry->allocator->DeleteReleased();
+      error += ", Live stopped";
+    }
+    napi_throw_error(env, NULL, error.c_str());
+    return NULL;
+  }
+  return CreateRoiObject(env, applied);
+}
+
+// getSensorInfo()：{ width, height, pixelWidth, pixelHeight, roi }，尺寸为未 bin 的有效像素数（未知时为 0），
+// 像元尺寸单位为微米，roi 为当前的 { x, y, width, height, bin }
+static napi_value SessionGetSensorInfo(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  const SensorInfo& sensor = wrap->session->Sensor();
+  const CaptureSettings& settings = wrap->session->Settings();
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  napi_value v;
+  NAPI_CALL(env, napi_create_uint32(env, sensor.width, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "width", v));
+  NAPI_CALL(env, napi_create_uint32(env, sensor.height, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "height", v));
+  NAPI_CALL(env, napi_create_double(env, sensor.pixelWidthUm, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "pixelWidth", v));
+  NAPI_CALL(env, napi_create_double(env, sensor.pixelHeightUm, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "pixelHeight", v));
+  RoiRect roi;
+  roi.x = settings.roiX;
+  roi.y = settings.roiY;
+  roi.width = settings.roiWidth;
+  roi.height = settings.roiHeight;
+  roi.bin = settings.binX;
+  v = CreateRoiObject(env, roi);
+  if (v == NULL) {
+    return NULL;
+  }
+  NAPI_CALL(env, napi_set_named_property(env, result, "roi", v));
+  return result;
+}
+
+// capture()：使用当前参数同步拍摄一帧
+static napi_value SessionCapture(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL || ThrowIfBusy(env, wrap) || ThrowIfLive(env, wrap)) {
+    return NULL;
+  }
+  return CaptureWithSession(env, wrap->session, wrap->registry, &wrap->recorders, &wrap->stacking);
+}
+
+// ---- captureAsync：napi_async_work + Promise ----
+
+struct CaptureWork {
+  napi_async_work work;
+  napi_deferred deferred;
+  napi_ref sessionRef;  // 任务期间保持 JS 对象存活
+  SessionWrap* wrap;
+  FrameLease buffer;
+  FrameInfo frame;
+  FrameAnalysis analysis;
+  bool raw;  // 拍摄校正帧：不校正、不录制、不叠加，只统计直方图
+  bool ok;
+  std::string error;
+  int64_t queuedUs;  // 提交到线程池的时间
+  int64_t doneUs;    // 工作线程完成的时间
+};
+
+// 在线程池中执行：曝光 + 读出，不允许调用任何 N-API
+static void CaptureWorkExecute(napi_env env, void* data) {
+  (void)env;
+  CaptureWork* cw = static_cast<CaptureWork*>(data);
+  int64_t startUs = TraceNowUs();
+  cw->ok = cw->wrap->session->Capture(cw->buffer->data, cw->buffer->capacity, &cw->frame, !cw->raw);
+  if (cw->ok) {
+    // 帧 ID 在 Capture 中分配，排队阶段在这里补记
+    RecordTrace("native.capture-queue", cw->frame.frameId, cw->queuedUs, startUs);
+    if (cw->raw) {
+      // 校正帧只用于合成主帧：不生成预览图、金字塔，不检测星点、不统计区域
+      TraceScope trace("native.stats", cw->frame.frameId);
+      ComputeFrameStats(cw->buffer->data, cw->frame.bytes, cw->frame.bpp, &cw->analysis.stats);
+    } else {
+      cw->wrap->recorders.Enqueue(cw->frame, cw->buffer->data);
+      cw->wrap->stacking.Apply(cw->buffer, cw->frame, &cw->analysis);
+      cw->wrap->registry->Analyze(cw->buffer, cw->frame, true, &cw->analysis);
+    }
+  } else {
+    cw->error = cw->wrap->session->LastError();
+  }
+  cw->doneUs = TraceNowUs();
+}
+
+// 回到 JS 线程：生成帧对象并 resolve / reject Promise
+static void CaptureWorkComplete(napi_env env, napi_status status, void* data) {
+  CaptureWork* cw = static_cast<CaptureWork*>(data);
+  SessionWrap* wrap = cw->wrap;
+  wrap->busy = false;
+
+  napi_value result = NULL;
+  if (status == napi_ok && cw->ok) {
+    RecordTrace("native.capture-complete", cw->frame.frameId, cw->doneUs, TraceNowUs());
+    result = CreateFrameObject(env, cw->buffer, cw->frame, &cw->analysis, wrap->registry);
+  }
+
+  if (result != NULL) {
+    napi_resolve_deferred(env, cw->deferred, result);
+  } else {
+    // CreateFrameObject 失败时会留下一个待处理异常，取出来作为 reject 的原因
+    bool pending = false;
+    napi_value err = NULL;
+    if (napi_is_exception_pending(env, &pending) == napi_ok && pending) {
+      napi_get_and_clear_last_exception(env, &err);
+    } else {
+      const char* msg = status == napi_cancelled ? "Capture cancelled" : cw->error.c_str();
+      napi_value msgValue;
+      napi_create_string_utf8(env, msg, NAPI_AUTO_LENGTH, &msgValue);
+      napi_create_error(env, NULL, msgValue, &err);
+    }
+    napi_reject_deferred(env, cw->deferred, err);
+  }
+
+  if (wrap->closePending) {
+    wrap->closePending = false;
+    wrap->session->Close();
+  }
+
+  napi_delete_reference(env, cw->sessionRef);
+  napi_delete_async_work(env, cw->work);
+  delete cw;
+}
+
+// captureAsync(options?)：返回 Promise<frame>，曝光与读出期间不阻塞 JS 线程。
+// options.raw 为 true 时（拍摄 bias / dark / flat 等校正帧）这一帧不校正、不进入录制与实时叠加，
+// 帧对象只带 stats（没有预览图、金字塔、星点与区域统计）
+static napi_value SessionCaptureAsync(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisArg;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args, &thisArg);
+  if (wrap == NULL || ThrowIfBusy(env, wrap) || ThrowIfLive(env, wrap)) {
+    return NULL;
+  }
+  bool raw = false;
+  if (argc >= 1 && HasProperty(env, args[0], "raw")) {
+    napi_value v;
+    if (napi_get_named_property(env, args[0], "raw", &v) != napi_ok || napi_get_value_bool(env, v, &raw) != napi_ok) {
+      napi_throw_type_error(env, NULL, "captureAsync: raw 必须是布尔值");
+      return NULL;
+    }
+  }
+  if (argc >= 1 && !ConfigureFromArgs(env, wrap, argc, args)) {
+    return NULL;
+  }
+  if (!wrap->session->IsOpen()) {
+    napi_throw_error(env, NULL, "Camera is not open");
+    return NULL;
+  }
+
+  // 缓冲区在 JS 线程中从池里取出，工作线程只负责读出
+  FrameLease buffer = AcquireFrameBuffer(env, wrap->session, wrap->registry.get());
+  if (!buffer) {
+    return NULL;
+  }
+
+  CaptureWork* cw = new CaptureWork();
+  cw->wrap = wrap;
+  cw->buffer = buffer;
+  cw->raw = raw;
+  cw->ok = false;
+  cw->queuedUs = TraceNowUs();
+  cw->doneUs = 0;
+
+  napi_value promise;
+  napi_value resourceName;
+  napi_status status = napi_create_promise(env, &cw->deferred, &promise);
+  if (status == napi_ok) {
+    status = napi_create_string_utf8(env, "qhyccd:captureAsync", NAPI_AUTO_LENGTH, &resourceName);
+  }
+  if (status == napi_ok) {
+    status = napi_create_async_work(env, NULL, resourceName, CaptureWorkExecute,
+                                    CaptureWorkComplete, cw, &cw->work);
+  }
+  if (status != napi_ok) {
+    delete cw;
+    napi_throw_error(env, NULL, "Failed to create capture task");
+    return NULL;
+  }
+
+  NAPI_CALL(env, napi_create_reference(env, thisArg, 1, &cw->sessionRef));
+  NAPI_CALL(env, napi_queue_async_work(env, cw->work));
+  wrap->busy = true;
+  return promise;
+}
+
+// ---- Live 模式：startLive / stopLive ----
+
+// 在 JS 线程中执行：把 Live 帧包装成帧对象并调用 onFrame(frame)
+static void CallLiveFrameCallback(napi_env env, napi_value jsCallback, void* context, void* data) {
+  (void)context;
+  LiveFrameMessage* msg = static_cast<LiveFrameMessage*>(data);
+  // env 为 NULL 表示环境正在销毁，只需释放内存
+  if (env != NULL && jsCallback != NULL) {
+    RecordTrace("native.live-queue", msg->frame.frameId, msg->postedUs, TraceNowUs());
+    napi_value frame = CreateFrameObject(env, msg->buffer, msg->frame, &msg->analysis, msg->registry);
+    if (frame != NULL) {
+      napi_value v;
+      if (napi_create_int64(env, (int64_t)msg->frameIndex, &v) == napi_ok) {
+        napi_set_named_property(env, frame, "frameIndex", v);
+      }
+      napi_value undefined;
+      napi_get_undefined(env, &undefined);
+      napi_call_function(env, undefined, jsCallback, 1, &frame, NULL);
+    }
+  }
+  delete msg;
+}
+
+// startLive(options, onFrame)：切换到连续模式，在独立线程中取帧并回调 onFrame(frame)
+static napi_value SessionStartLive(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL || ThrowIfBusy(env, wrap) || ThrowIfLive(env, wrap)) {
+    return NULL;
+  }
+
+  napi_valuetype cbType = napi_undefined;
+  if (argc >= 2) {
+    NAPI_CALL(env, napi_typeof(env, args[1], &cbType));
+  }
+  if (cbType != napi_function) {
+    napi_throw_type_error(env, NULL, "startLive(options, onFrame) requires a callback");
+    return NULL;
+  }
+  if (!ConfigureFromArgs(env, wrap, 1, args)) {
+    return NULL;
+  }
+
+  napi_value resourceName;
+  NAPI_CALL(env, napi_create_string_utf8(env, "qhyccd:live", NAPI_AUTO_LENGTH, &resourceName));
+  // 队列上限 2 帧：JS 侧落后时由取帧线程丢帧，而不是无限堆积内存
+  if (!wrap->registry->pool.Reserve(wrap->session->FrameBufferSize(), kFramePoolSlots)) {
+    napi_throw_error(env, NULL, "Failed to allocate frame buffers");
+    return NULL;
+  }
+  NAPI_CALL(env, napi_create_threadsafe_function(env, args[1], NULL, resourceName, 2, 1,
+                                                 NULL, NULL, NULL, CallLiveFrameCallback,
+                                                 &wrap->liveSink.tsfn));
+
+  if (!wrap->live.Start(wrap->session, &wrap->liveSink)) {
+    napi_release_threadsafe_function(wrap->liveSink.tsfn, napi_tsfn_abort);
+    wrap->liveSink.tsfn = NULL;
+    napi_throw_error(env, NULL, wrap->session->LastError().c_str());
+    return NULL;
+  }
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+static napi_value SessionStopLive(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  StopLiveStream(wrap);
+  wrap->registry->allocator->DeleteReleased();
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+static napi_value SessionIsLive(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  napi_value result;
+  NAPI_CALL(env, napi_get_boolean(env, wrap->live.IsRunning(), &result));
+  return result;
+}
+
+// getLiveStats()：{ frames, dropped, fps }
+static napi_value SessionGetLiveStats(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  LiveStats stats = wrap->live.Stats();
+
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  napi_value v;
+  NAPI_CALL(env, napi_create_double(env, (double)stats.frames, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "frames", v));
+  NAPI_CALL(env, napi_create_double(env, (double)stats.dropped, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "dropped", v));
+  NAPI_CALL(env, napi_create_double(env, stats.fps, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "fps", v));
+  return result;
+}
+
+// setPreviewSize(maxWidth, maxHeight)：之后的帧附带不超过该尺寸的预览图（frame.preview），
+// 由原图按整数倍区域平均得到。两者都为 0 时不生成预览图。
+static napi_value SessionSetPreviewSize(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  uint32_t maxWidth = 0;
+  uint32_t maxHeight = 0;
+  if (argc >= 1) {
+    napi_get_value_uint32(env, args[0], &maxWidth);
+  }
+  if (argc >= 2) {
+    napi_get_value_uint32(env, args[1], &maxHeight);
+  }
+  wrap->registry->previewMaxWidth.store(maxWidth);
+  wrap->registry->previewMaxHeight.store(maxHeight);
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// setStarDetection({ threshold?, maxStars? } | null)：之后每帧（单帧与 Live）在取帧线程中检测星点并测量
+// HFR / FWHM / 偏心率，结果为帧对象的 stars；threshold 为背景噪声的倍数（默认 5），maxStars 默认 500。
+// 检测在校正与实时叠加之后进行。传 null 关闭。
+static napi_value SessionSetStarDetection(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    NAPI_CALL(env, napi_typeof(env, args[0], &type));
+  }
+  FrameRegistry* registry = wrap->registry.get();
+  if (type != napi_object) {
+    registry->starDetection.store(false);
+  } else {
+    napi_value v;
+    double threshold = 5.0;
+    double maxStars = kFrameStarLimit;
+    if (HasProperty(env, args[0], "threshold")) {
+      NAPI_CALL(env, napi_get_named_property(env, args[0], "threshold", &v));
+      NAPI_CALL(env, napi_get_value_double(env, v, &threshold));
+    }
+    if (HasProperty(env, args[0], "maxStars")) {
+      NAPI_CALL(env, napi_get_named_property(env, args[0], "maxStars", &v));
+      NAPI_CALL(env, napi_get_value_double(env, v, &maxStars));
+    }
+    if (!(threshold > 0.0) || !(maxStars >= 1.0)) {
+      napi_throw_range_error(env, NULL, "threshold 必须大于 0，maxStars 至少为 1");
+      return NULL;
+    }
+    registry->starThreshold.store((float)threshold);
+    registry->starLimit.store((uint32_t)std::min(maxStars, 100000.0));
+    registry->starDetection.store(true);
+  }
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// 读取 [{ x, y }, ...] 数组属性（测量图形的控制点），不存在或格式不符时返回 false
+template <typename Point>
+static bool ReadPointArray(napi_env env, napi_value obj, const char* name, std::vector<Point>* out) {
+  napi_value points;
+  bool isArray = false;
+  uint32_t length = 0;
+  if (!HasProperty(env, obj, name) || napi_get_named_property(env, obj, name, &points) != napi_ok ||
+      napi_is_array(env, points, &isArray) != napi_ok || !isArray ||
+      napi_get_array_length(env, points, &length) != napi_ok) {
+    return false;
+  }
+  out->resize(length);
+  for (uint32_t i = 0; i < length; i++) {
+    napi_value point;
+    napi_value x;
+    napi_value y;
+    Point& p = (*out)[i];
+    if (napi_get_element(env, points, i, &point) != napi_ok ||
+        napi_get_named_property(env, point, "x", &x) != napi_ok ||
+        napi_get_named_property(env, point, "y", &y) != napi_ok || napi_get_value_double(env, x, &p.x) != napi_ok ||
+        napi_get_value_double(env, y, &p.y) != napi_ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static const struct {
+  const char* name;
+  RegionShapeType type;
+} kRegionShapeNames[] = {
+    {"point", REGION_POINT}, {"rect", REGION_RECT},       {"circle", REGION_CIRCLE},
+    {"ellipse", REGION_ELLIPSE}, {"polygon", REGION_POLYGON},
+};
+
+// 读取一个图形 { id, type, points: [{ x, y }, ...] }，id 为字符串或数字。失败时抛出异常并返回 false
+static bool ReadRegionShape(napi_env env, napi_value obj, FrameRegion* region) {
+  napi_valuetype type = napi_undefined;
+  napi_typeof(env, obj, &type);
+  napi_value v;
+  napi_value idText;
+  size_t len = 0;
+  if (type != napi_object || !HasProperty(env, obj, "id") || napi_get_named_property(env, obj, "id", &v) != napi_ok ||
+      napi_coerce_to_string(env, v, &idText) != napi_ok ||
+      napi_get_value_string_utf8(env, idText, NULL, 0, &len) != napi_ok) {
+    napi_throw_type_error(env, NULL, "setRegions: 每个图形需要 { id, type, points }");
+    return false;
+  }
+  std::vector<char> text(len + 1);
+  napi_get_value_string_utf8(env, idText, text.data(), text.size(), &len);
+  region->id.assign(text.data(), len);
+
+  std::string name;
+  ReadStringProperty(env, obj, "type", &name);
+  bool known = false;
+  for (const auto& entry : kRegionShapeNames) {
+    if (name == entry.name) {
+      region->shape.type = entry.type;
+      known = true;
+    }
+  }
+  if (!known) {
+    napi_throw_range_error(env, NULL, "setRegions: type 只能是 'point'、'rect'、'circle'、'ellipse' 或 'polygon'");
+    return false;
+  }
+
+  if (!ReadPointArray(env, obj, "points", &region->shape.points)) {
+    napi_throw_type_error(env, NULL, "setRegions: points 必须是 [{ x, y }] 数组");
+    return false;
+  }
+  return true;
+}
+
+// setRegions([{ id, type, points }] | null)：之后每帧（单帧与 Live）在取帧线程中统计这些区域内的像素，
+// 结果为帧对象的 regions（见 measureRegions）。type 为 'point' | 'rect' | 'circle' | 'ellipse' | 'polygon'，
+// points 为整帧像素坐标（像素 (i, j) 占据 [i, i + 1) x [j, j + 1)），含义与测量工具相同。
+// 图形在这里光栅化为像素段；id 与图形都未变化的区域沿用上一次的结果，拖动一个控制点只重新光栅化一个图形。
+// 传 null 或空数组关闭。
+static napi_value SessionSetRegions(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  FrameRegistry* registry = wrap->registry.get();
+  bool isArray = false;
+  if (argc >= 1) {
+    NAPI_CALL(env, napi_is_array(env, args[0], &isArray));
+  }
+  std::shared_ptr<FrameRegionSet> next;
+  if (isArray) {
+    uint32_t length = 0;
+    NAPI_CALL(env, napi_get_array_length(env, args[0], &length));
+    std::shared_ptr<const FrameRegionSet> previous = registry->Regions();
+    next = std::make_shared<FrameRegionSet>(length);
+    for (uint32_t i = 0; i < length; i++) {
+      napi_value item;
+      NAPI_CALL(env, napi_get_element(env, args[0], i, &item));
+      FrameRegion& region = (*next)[i];
+      if (!ReadRegionShape(env, item, &region)) {
+        return NULL;
+      }
+      if (previous) {
+        for (const FrameRegion& old : *previous) {
+          if (old.id == region.id && old.shape == region.shape) {
+            region.mask = old.mask;
+            break;
+          }
+        }
+      }
+      if (!region.mask) {
+        std::shared_ptr<RegionMask> mask = std::make_shared<RegionMask>();
+        RasterizeRegion(region.shape, mask.get());
+        region.mask = mask;
+      }
+    }
+    if (next->empty()) {
+      next.reset();
+    }
+  }
+  registry->SetRegions(next);
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// measureRegions(frame)：在 JS 线程中按 setRegions 设置的区域统计一帧（如编辑图形之后重新统计最近一帧），
+// 返回 [{ id, count, sum, mean, median, stddev, min, max, snr }]。count 为落在图像内的像素数，
+// median 为下中位数，snr 为 mean / stddev。彩色相机的原始帧按 Bayer 像素原值统计。
+static napi_value SessionMeasureRegions(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  const uint16_t* pixels = NULL;
+  size_t count = 0;
+  uint32_t values[4] = {0, 0, 16, 1};  // width, height, bpp, channels
+  const char* names[4] = {"width", "height", "bpp", "channels"};
+  if (argc < 1 || !GetPixelSource16(env, args[0], &pixels, &count)) {
+    napi_throw_type_error(env, NULL, "measureRegions 需要 16bit 帧对象");
+    return NULL;
+  }
+  for (int i = 0; i < 4; i++) {
+    napi_value v;
+    if (HasProperty(env, args[0], names[i]) && napi_get_named_property(env, args[0], names[i], &v) == napi_ok) {
+      napi_get_value_uint32(env, v, &values[i]);
+    }
+  }
+  if (values[2] <= 8 || values[3] != 1) {
+    napi_throw_range_error(env, NULL, "measureRegions 只支持 16bit 单通道帧");
+    return NULL;
+  }
+  const uint32_t* size = values;
+  if (size[0] == 0 || size[1] == 0 || (size_t)size[0] * size[1] > count) {
+    napi_throw_range_error(env, NULL, "measureRegions: width / height 与像素数据长度不符");
+    return NULL;
+  }
+  std::shared_ptr<const FrameRegionSet> regions = wrap->registry->Regions();
+  if (!regions) {
+    napi_value empty;
+    NAPI_CALL(env, napi_create_array(env, &empty));
+    return empty;
+  }
+  std::vector<RegionStats> stats;
+  MeasureRegions(*regions, pixels, size[0], size[1], &stats);
+  return CreateRegionStatsArray(env, *regions, stats);
+}
+
+// startRecording(options)：之后拍到的每一帧（单帧与 Live）由原生录制器在后台写盘，帧数据不经过 JS。
+//   { format: 'fits', directory, prefix?, maxQueue? }  每帧保存为 directory/prefix_00001.fits ...，
+//       取帧线程只做一次内存拷贝，队列（默认 8 帧）满时才等待写盘。
+//   { format: 'ser', path, ringSize?, observer?, telescope? }  追加到单个 SER 文件（行星 / 幸运成像），
+//       环形缓冲（默认 16 帧）用尽时丢帧而不等待，stopRecording 后写入时间戳 trailer。
+// 同一时间只有一种格式在录制，开始新的录制会先停止之前的录制。
+static napi_value SessionStartRecording(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    NAPI_CALL(env, napi_typeof(env, args[0], &type));
+  }
+  if (type != napi_object) {
+    napi_throw_type_error(env, NULL, "startRecording(options) requires an options object");
+    return NULL;
+  }
+  std::string format = "fits";
+  ReadStringProperty(env, args[0], "format", &format);
+  if (format != "fits" && format != "ser") {
+    napi_throw_type_error(env, NULL, "format must be 'fits' or 'ser'");
+    return NULL;
+  }
+  const char* queueName = format == "ser" ? "ringSize" : "maxQueue";
+  uint32_t queueSize = 0;
+  napi_value v;
+  if (HasProperty(env, args[0], queueName) && napi_get_named_property(env, args[0], queueName, &v) == napi_ok) {
+    napi_get_value_uint32(env, v, &queueSize);
+  }
+
+  SessionRecorders& recorders = wrap->recorders;
+  recorders.fits.Stop();
+  recorders.ser.Stop();
+  if (format == "ser") {
+    std::string path;
+    if (!ReadStringProperty(env, args[0], "path", &path) || path.empty()) {
+      napi_throw_type_error(env, NULL, "startRecording({ format: 'ser', path }) requires a path");
+      return NULL;
+    }
+    std::string observer;
+    std::string telescope;
+    ReadStringProperty(env, args[0], "observer", &observer);
+    ReadStringProperty(env, args[0], "telescope", &telescope);
+    std::string error;
+    if (!recorders.ser.Start(path, queueSize > 0 ? queueSize : kSerDefaultRing, wrap->session->CameraId(),
+                             observer, telescope, &error)) {
+      napi_throw_error(env, NULL, error.c_str());
+      return NULL;
+    }
+  } else {
+    std::string directory;
+    if (!ReadStringProperty(env, args[0], "directory", &directory) || directory.empty()) {
+      napi_throw_type_error(env, NULL, "startRecording({ directory }) requires a directory");
+      return NULL;
+    }
+    std::string prefix = "frame";
+    ReadStringProperty(env, args[0], "prefix", &prefix);
+    recorders.fits.Start(directory, prefix, wrap->session->CameraId(), queueSize);
+  }
+  recorders.serActive = format == "ser";
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// stopRecording()：停止录制，已入队的帧仍在后台写完（SER 随后完成文件）
+static napi_value SessionStopRecording(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  wrap->recorders.fits.Stop();
+  wrap->recorders.ser.Stop();
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// getRecordingStats()：最近一次录制的计数
+//   共有字段 { format, recording, queued, maxQueue, written, bytesWritten, bytesPerSec, lastPath, lastError }，
+//   queued 为尚未写完的帧数，maxQueue 为队列（SER 为环形缓冲）容量；
+//   FITS 另有 { queuedBytes, failed, waits }，waits 为队列已满导致取帧等待的次数；
+//   SER 另有 { dropped, fps }，dropped 为环形缓冲用尽（或帧尺寸变化）而丢弃的帧数，速率为录制期间的平均值。
+static napi_value SessionGetRecordingStats(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  const bool ser = wrap->recorders.serActive;
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  napi_value v;
+  auto setNumber = [&](const char* name, double value) -> bool {
+    return napi_create_double(env, value, &v) == napi_ok && napi_set_named_property(env, result, name, v) == napi_ok;
+  };
+  bool recording = false;
+  std::string lastPath;
+  std::string lastError;
+  bool ok = true;
+  if (ser) {
+    SerWriterStats stats = wrap->recorders.ser.Stats();
+    recording = stats.recording;
+    lastPath = stats.path;
+    lastError = stats.lastError;
+    ok = setNumber("queued", (double)stats.queued) && setNumber("maxQueue", (double)stats.ringSize) &&
+         setNumber("written", (double)stats.frames) && setNumber("dropped", (double)stats.dropped) &&
+         setNumber("bytesWritten", (double)stats.bytesWritten) && setNumber("bytesPerSec", stats.bytesPerSec) &&
+         setNumber("fps", stats.fps);
+  } else {
+    FitsWriterStats stats = wrap->recorders.fits.Stats();
+    recording = stats.recording;
+    lastPath = stats.lastPath;
+    lastError = stats.lastError;
+    ok = setNumber("queued", (double)stats.queued) && setNumber("maxQueue", (double)stats.maxQueue) &&
+         setNumber("queuedBytes", (double)stats.queuedBytes) && setNumber("written", (double)stats.written) &&
+         setNumber("failed", (double)stats.failed) && setNumber("waits", (double)stats.waits) &&
+         setNumber("bytesWritten", (double)stats.bytesWritten) && setNumber("bytesPerSec", stats.bytesPerSec);
+  }
+  if (!ok) {
+    napi_throw_error(env, NULL, "failed to build recording stats");
+    return NULL;
+  }
+  NAPI_CALL(env, napi_create_string_utf8(env, ser ? "ser" : "fits", NAPI_AUTO_LENGTH, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "format", v));
+  NAPI_CALL(env, napi_get_boolean(env, recording, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "recording", v));
+  NAPI_CALL(env, napi_create_string_utf8(env, lastPath.c_str(), NAPI_AUTO_LENGTH, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "lastPath", v));
+  NAPI_CALL(env, napi_create_string_utf8(env, lastError.c_str(), NAPI_AUTO_LENGTH, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "lastError", v));
+  return result;
+}
+
+// ---- 实时叠加 ----
+
+// startStacking({ method?: 'mean' | 'sigma', sigma?, window?, maxResidual?, threshold? })：
+// 之后拍到的每一帧（单帧与 Live）检测星点并与第一帧配准，叠加后帧数据替换为叠加结果（录制器仍保存原始帧）。
+// window 为 0 时累计全部帧，否则为滑动窗口的帧数。重复调用会丢弃之前的叠加结果。
+static napi_value SessionStartStacking(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  StackOptions options;
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    NAPI_CALL(env, napi_typeof(env, args[0], &type));
+  }
+  if (type == napi_object) {
+    std::string method;
+    if (ReadStringProperty(env, args[0], "method", &method)) {
+      if (method == "sigma") {
+        options.method = STACK_SIGMA_CLIP;
+      } else if (method != "mean") {
+        napi_throw_range_error(env, NULL, "startStacking: method must be 'mean' or 'sigma'");
+        return NULL;
+      }
+    }
+    napi_value v;
+    double number = 0.0;
+    if (HasProperty(env, args[0], "sigma") && napi_get_named_property(env, args[0], "sigma", &v) == napi_ok &&
+        napi_get_value_double(env, v, &number) == napi_ok) {
+      options.sigma = (float)number;
+    }
+    if (HasProperty(env, args[0], "window") && napi_get_named_property(env, args[0], "window", &v) == napi_ok) {
+      napi_get_value_uint32(env, v, &options.window);
+    }
+    if (HasProperty(env, args[0], "maxResidual") &&
+        napi_get_named_property(env, args[0], "maxResidual", &v) == napi_ok &&
+        napi_get_value_double(env, v, &number) == napi_ok) {
+      options.maxResidual = (float)number;
+    }
+    if (HasProperty(env, args[0], "threshold") && napi_get_named_property(env, args[0], "threshold", &v) == napi_ok &&
+        napi_get_value_double(env, v, &number) == napi_ok) {
+      options.threshold = (float)number;
+    }
+  }
+  if (!(options.sigma > 0.0f) || !(options.maxResidual > 0.0f) || !(options.threshold > 0.0f)) {
+    napi_throw_range_error(env, NULL, "startStacking: sigma, maxResidual and threshold must be positive");
+    return NULL;
+  }
+  wrap->stacking.Set(std::make_shared<LiveStacker>(options));
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// stopStacking()：之后的帧不再叠加，累加器随之释放
+static napi_value SessionStopStacking(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  wrap->stacking.Set(nullptr);
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// resetStacking()：丢弃叠加结果，下一帧成为新的参考帧（例如换了目标）
+static napi_value SessionResetStacking(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  std::shared_ptr<LiveStacker> stacker = wrap->stacking.Get();
+  if (stacker) {
+    stacker->Reset();
+  }
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// getStackingStats()：{ method, width, height, frames, rejectedFrames, referenceStars }，未在叠加时为 null
+static napi_value SessionGetStackingStats(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  std::shared_ptr<LiveStacker> stacker = wrap->stacking.Get();
+  napi_value result;
+  if (!stacker) {
+    NAPI_CALL(env, napi_get_null(env, &result));
+    return result;
+  }
+  StackStats stats = stacker->Stats();
+  napi_value v;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  const char* method = stacker->Options().method == STACK_SIGMA_CLIP ? "sigma" : "mean";
+  NAPI_CALL(env, napi_create_string_utf8(env, method, NAPI_AUTO_LENGTH, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "method", v));
+  NAPI_CALL(env, napi_create_uint32(env, stats.width, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "width", v));
+  NAPI_CALL(env, napi_create_uint32(env, stats.height, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "height", v));
+  NAPI_CALL(env, napi_create_uint32(env, stats.frames, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "frames", v));
+  NAPI_CALL(env, napi_create_uint32(env, stats.rejectedFrames, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "rejectedFrames", v));
+  NAPI_CALL(env, napi_create_uint32(env, stats.referenceStars, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "referenceStars", v));
+  return result;
+}
+
+// ---- 暗场 / 平场校正 ----
+
+// 读取帧对象或主帧的 roi { x, y, bin }。没有 roi 时为默认区域（起点 0、bin 1）；
+// 格式错误或 roi.softwareBin 大于 1（软件 bin 后的像素不能用于校正）时返回 false
+static bool ReadCalibrationRegion(napi_env env, napi_value obj, CalibrationRegion* region) {
+  *region = CalibrationRegion();
+  napi_value roi;
+  napi_valuetype type = napi_undefined;
+  if (!HasProperty(env, obj, "roi") || napi_get_named_property(env, obj, "roi", &roi) != napi_ok ||
+      napi_typeof(env, roi, &type) != napi_ok || type == napi_undefined || type == napi_null) {
+    return true;
+  }
+  if (type != napi_object) {
+    return false;
+  }
+  uint32_t values[4] = {0, 0, 1, 1};  // x, y, bin, softwareBin
+  const char* names[4] = {"x", "y", "bin", "softwareBin"};
+  for (int i = 0; i < 4; i++) {
+    napi_value v;
+    if (HasProperty(env, roi, names[i]) && (napi_get_named_property(env, roi, names[i], &v) != napi_ok ||
+                                            napi_get_value_uint32(env, v, &values[i]) != napi_ok)) {
+      return false;
+    }
+  }
+  if (values[2] < 1 || values[3] != 1) {
+    return false;
+  }
+  region->x = values[0];
+  region->y = values[1];
+  region->binX = values[2];
+  region->binY = values[2];
+  return true;
+}
+
+static napi_value CreateCalibrationRegionObject(napi_env env, const CalibrationRegion& region) {
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  napi_value v;
+  const struct {
+    const char* name;
+    uint32_t value;
+  } fields[] = {{"x", region.x}, {"y", region.y}, {"bin", region.binX}};
+  for (const auto& field : fields) {
+    NAPI_CALL(env, napi_create_uint32(env, field.value, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, field.name, v));
+  }
+  return result;
+}
+
+// 读取主帧 { width, height, roi?, data: Float32Array | ArrayBuffer }，name 不存在或为 null 时 *present 为 false
+static bool ReadMasterProperty(napi_env env, napi_value obj, const char* name, const float** data,
+                               uint32_t* width, uint32_t* height, CalibrationRegion* region, bool* present) {
+  *present = false;
+  napi_value master;
+  napi_valuetype type = napi_undefined;
+  if (!HasProperty(env, obj, name) || napi_get_named_property(env, obj, name, &master) != napi_ok ||
+      napi_typeof(env, master, &type) != napi_ok || type == napi_undefined || type == napi_null) {
+    return true;
+  }
+  if (type != napi_object) {
+    return false;
+  }
+  napi_value v;
+  uint32_t size[2] = {0, 0};
+  const char* names[2] = {"width", "height"};
+  for (int i = 0; i < 2; i++) {
+    if (napi_get_named_property(env, master, names[i], &v) != napi_ok ||
+        napi_get_value_uint32(env, v, &size[i]) != napi_ok) {
+      return false;
+    }
+  }
+  if (napi_get_named_property(env, master, "data", &v) != napi_ok) {
+    return false;
+  }
+  void* bytes = NULL;
+  size_t length = 0;
+  bool isTypedArray = false;
+  bool isArrayBuffer = false;
+  napi_is_typedarray(env, v, &isTypedArray);
+  napi_is_arraybuffer(env, v, &isArrayBuffer);
+  if (isTypedArray) {
+    napi_typedarray_type arrayType;
+    size_t count = 0;
+    if (napi_get_typedarray_info(env, v, &arrayType, &count, &bytes, NULL, NULL) != napi_ok ||
+        arrayType != napi_float32_array) {
+      return false;
+    }
+    length = count * sizeof(float);
+  } else if (!isArrayBuffer || napi_get_arraybuffer_info(env, v, &bytes, &length) != napi_ok) {
+    return false;
+  }
+  if (size[0] == 0 || size[1] == 0 || length < (size_t)size[0] * size[1] * sizeof(float) ||
+      !ReadCalibrationRegion(env, master, region)) {
+    return false;
+  }
+  *data = static_cast<const float*>(bytes);
+  *width = size[0];
+  *height = size[1];
+  *present = true;
+  return true;
+}
+
+// 当前校正参数的描述 { width, height, roi, dark, flat, pedestal, flatMedian, mismatch }，未启用时为 null。
+// mismatch 为 true 表示最近一帧的尺寸、ROI 起点或 bin 与主帧不同，没有校正
+static napi_value CreateCalibrationInfo(napi_env env, const std::shared_ptr<const CalibrationSet>& calibration,
+                                        bool mismatch = false) {
+  napi_value result;
+  if (!calibration) {
+    NAPI_CALL(env, napi_get_null(env, &result));
+    return result;
+  }
+  napi_value v;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  NAPI_CALL(env, napi_create_uint32(env, calibration->width, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "width", v));
+  NAPI_CALL(env, napi_create_uint32(env, calibration->height, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "height", v));
+  v = CreateCalibrationRegionObject(env, calibration->region);
+  if (v == NULL) {
+    return NULL;
+  }
+  NAPI_CALL(env, napi_set_named_property(env, result, "roi", v));
+  NAPI_CALL(env, napi_get_boolean(env, !calibration->dark.empty(), &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "dark", v));
+  NAPI_CALL(env, napi_get_boolean(env, !calibration->gain.empty(), &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "flat", v));
+  NAPI_CALL(env, napi_create_double(env, calibration->pedestal, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "pedestal", v));
+  NAPI_CALL(env, napi_create_double(env, calibration->flatMedian, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "flatMedian", v));
+  NAPI_CALL(env, napi_get_boolean(env, mismatch, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "mismatch", v));
+  return result;
+}
+
+// setCalibration({ dark?, flat?, flatDark?, pedestal? } | null)：之后的每一帧在取帧线程中校正
+//   out = (light - dark) / (flat - flatDark 按中位数归一化) + pedestal
+// 主帧为 MasterFrameBuilder.build() 的结果 { width, height, roi, data: Float32Array }，dark 也可以只是偏置主帧。
+// 各主帧的尺寸与 roi 必须相同；只校正尺寸、ROI 起点与 bin 都与主帧相同的帧
+// （换到别处的 ROI 或改变 bin 后不再校正，帧对象的 calibration 为 null，getCalibration().mismatch 为 true）。
+// 传入 null 关闭校正。返回 getCalibration() 的结果。
+static napi_value SessionSetCalibration(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    NAPI_CALL(env, napi_typeof(env, args[0], &type));
+  }
+  if (type == napi_null || type == napi_undefined) {
+    wrap->session->SetCalibration(nullptr);
+    return CreateCalibrationInfo(env, nullptr);
+  }
+  if (type != napi_object) {
+    napi_throw_type_error(env, NULL, "setCalibration({ dark?, flat?, flatDark?, pedestal? }) requires an object or null");
+    return NULL;
+  }
+
+  const char* names[3] = {"dark", "flat", "flatDark"};
+  const float* data[3] = {NULL, NULL, NULL};
+  uint32_t width = 0;
+  uint32_t height = 0;
+  CalibrationRegion region;
+  for (int i = 0; i < 3; i++) {
+    uint32_t w = 0;
+    uint32_t h = 0;
+    CalibrationRegion r;
+    bool present = false;
+    if (!ReadMasterProperty(env, args[0], names[i], &data[i], &w, &h, &r, &present)) {
+      std::string msg =
+          std::string("setCalibration: ") + names[i] + " must be { width, height, roi?, data: Float32Array }";
+      napi_throw_type_error(env, NULL, msg.c_str());
+      return NULL;
+    }
+    if (!present) {
+      continue;
+    }
+    if (width != 0 && (w != width || h != height)) {
+      napi_throw_range_error(env, NULL, "setCalibration: masters differ in size");
+      return NULL;
+    }
+    if (width != 0 && r != region) {
+      napi_throw_range_error(env, NULL, "setCalibration: masters differ in ROI / bin");
+      return NULL;
+    }
+    width = w;
+    height = h;
+    region = r;
+  }
+  double pedestal = 0.0;
+  napi_value v;
+  if (HasProperty(env, args[0], "pedestal") && napi_get_named_property(env, args[0], "pedestal", &v) == napi_ok) {
+    napi_get_value_double(env, v, &pedestal);
+  }
+
+  std::shared_ptr<CalibrationSet> calibration = std::make_shared<CalibrationSet>();
+  std::string error;
+  if (!BuildCalibrationSet(data[0], data[1], data[2], width, height, region, (float)pedestal, calibration.get(),
+                           &error)) {
+    napi_throw_error(env, NULL, error.c_str());
+    return NULL;
+  }
+  wrap->session->SetCalibration(calibration);
+  return CreateCalibrationInfo(env, calibration);
+}
+
+// getCalibration()：{ width, height, roi, dark, flat, pedestal, flatMedian, mismatch }，未启用时为 null
+static napi_value SessionGetCalibration(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  return CreateCalibrationInfo(env, wrap->session->Calibration(), wrap->session->CalibrationMismatch());
+}
+
+// releaseFrame(frameOrArrayBuffer)：JS 用完一帧后把它的 ArrayBuffer 交还给缓冲池，
+// 之后 SDK 会把新的帧直接读进这块内存，调用方不应再访问它。返回是否归还成功。
+static napi_value SessionReleaseFrame(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, args);
+  if (wrap == NULL) {
+    return NULL;
+  }
+
+  bool released = false;
+  if (argc >= 1) {
+    napi_value buffer = args[0];
+    bool isArrayBuffer = false;
+    NAPI_CALL(env, napi_is_arraybuffer(env, buffer, &isArrayBuffer));
+    if (!isArrayBuffer) {
+      // 传入的是帧对象时取其 data 字段
+      napi_valuetype type;
+      NAPI_CALL(env, napi_typeof(env, buffer, &type));
+      if (type == napi_object && napi_get_named_property(env, args[0], "data", &buffer) == napi_ok) {
+        NAPI_CALL(env, napi_is_arraybuffer(env, buffer, &isArrayBuffer));
+      }
+    }
+
+    void* data = NULL;
+    size_t length = 0;
+    if (isArrayBuffer && napi_get_arraybuffer_info(env, buffer, &data, &length) == napi_ok) {
+      released = wrap->registry->Release(data);
+    }
+  }
+
+  napi_value result;
+  NAPI_CALL(env, napi_get_boolean(env, released, &result));
+  return result;
+}
+
+static napi_value SessionClose(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  StopLiveStream(wrap);
+  if (wrap->busy) {
+    // 后台任务仍在使用句柄，等任务结束后再关闭
+    wrap->closePending = true;
+  } else {
+    wrap->session->Close();
+  }
+
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+static napi_value SessionIsOpen(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  napi_value result;
+  NAPI_CALL(env, napi_get_boolean(env, wrap->session->IsOpen() && !wrap->closePending, &result));
+  return result;
+}
+
+static napi_value SessionIsBusy(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SessionWrap* wrap = UnwrapSession(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  napi_value result;
+  NAPI_CALL(env, napi_get_boolean(env, wrap->busy, &result));
+  return result;
+}
+
+// stretch(pixels16, { black?, white?, format?: 'gray' | 'rgba', channels?: 1 | 3, output? })：
+// 按黑 / 白电平把 16bit 像素拉伸为 8bit 灰度（默认）或 RGBA，返回 ArrayBuffer。
+// channels 为 3 时输入为交错的 RGB16（如彩色预览图），只能输出 RGBA。
+// 传入足够大的 output（ArrayBuffer）时直接写入并返回它，便于重复使用同一块内存。
+static napi_value Stretch(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  const uint16_t* pixels = NULL;
+  size_t count = 0;
+  if (argc < 1 || !GetPixelSource16(env, args[0], &pixels, &count)) {
+    napi_throw_type_error(env, NULL, "stretch: 需要 Uint16Array、ArrayBuffer 或帧对象");
+    return NULL;
+  }
+
+  uint16_t black = 0;
+  uint16_t white = 65535;
+  StretchFormat format = STRETCH_GRAY8;
+  uint32_t channels = 1;
+  napi_value output = NULL;
+  if (argc >= 2) {
+    napi_valuetype type;
+    NAPI_CALL(env, napi_typeof(env, args[1], &type));
+    if (type == napi_object) {
+      ReadLevel(env, args[1], "black", &black);
+      ReadLevel(env, args[1], "white", &white);
+
+      napi_value v;
+      if (HasProperty(env, args[1], "format") && napi_get_named_property(env, args[1], "format", &v) == napi_ok) {
+        char name[8] = {0};
+        size_t len = 0;
+        napi_get_value_string_utf8(env, v, name, sizeof(name), &len);
+        if (strcmp(name, "rgba") == 0) {
+          format = STRETCH_RGBA8;
+        } else if (strcmp(name, "gray") != 0) {
+          napi_throw_range_error(env, NULL, "stretch: format 只能是 'gray' 或 'rgba'");
+          return NULL;
+        }
+      }
+      if (HasProperty(env, args[1], "channels") &&
+          napi_get_named_property(env, args[1], "channels", &v) == napi_ok) {
+        napi_get_value_uint32(env, v, &channels);
+        if (channels != 1 && channels != 3) {
+          napi_throw_range_error(env, NULL, "stretch: channels 只能是 1 或 3");
+          return NULL;
+        }
+        if (channels == 3 && format != STRETCH_RGBA8) {
+          napi_throw_range_error(env, NULL, "stretch: channels 为 3 时 format 必须是 'rgba'");
+          return NULL;
+        }
+      }
+      if (HasProperty(env, args[1], "output")) {
+        NAPI_CALL(env, napi_get_named_property(env, args[1], "output", &output));
+      }
+    }
+  }
+
+  // channels 为 3 时 count 为像素数（每像素 3 个值）
+  count /= channels;
+  size_t bytes = count * StretchBytesPerPixel(format);
+  void* out = NULL;
+  bool reuse = false;
+  if (output != NULL) {
+    bool isArrayBuffer = false;
+    size_t length = 0;
+    NAPI_CALL(env, napi_is_arraybuffer(env, output, &isArrayBuffer));
+    reuse = isArrayBuffer && napi_get_arraybuffer_info(env, output, &out, &length) == napi_ok && length >= bytes;
+  }
+  if (!reuse) {
+    NAPI_CALL(env, napi_create_arraybuffer(env, bytes, &out, &output));
+  }
+
+  if (channels == 3) {
+    StretchLevelsRgb16(pixels, static_cast<uint8_t*>(out), count, black, white);
+  } else {
+    StretchLevels16(pixels, static_cast<uint8_t*>(out), count, black, white, format);
+  }
+  return output;
+}
+
+// downsample(source, { maxWidth, maxHeight, width?, height?, bayer? })：按整数倍区域平均把 16bit 图像缩小到
+// 不超过 maxWidth x maxHeight，返回 { width, height, factor, channels, data }。source 为帧对象时从中读取
+// 宽高与 bayer，为 ArrayBuffer / Uint16Array 时需在选项中给出 width / height。
+// 有 Bayer 阵列时先双线性去马赛克，返回交错的 RGB16（channels 为 3）。
+static napi_value Downsample(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  const uint16_t* pixels = NULL;
+  size_t count = 0;
+  if (argc < 2 || !GetPixelSource16(env, args[0], &pixels, &count)) {
+    napi_throw_type_error(env, NULL, "downsample(source, options) 需要 16bit 像素源与选项对象");
+    return NULL;
+  }
+
+  uint32_t values[4] = {0, 0, 0, 0};  // width, height, maxWidth, maxHeight
+  const char* names[4] = {"width", "height", "maxWidth", "maxHeight"};
+  for (int i = 0; i < 4; i++) {
+    napi_value v;
+    napi_value from = i < 2 && HasProperty(env, args[0], names[i]) ? args[0] : args[1];
+    if (HasProperty(env, from, names[i]) && napi_get_named_property(env, from, names[i], &v) == napi_ok) {
+      napi_get_value_uint32(env, v, &values[i]);
+    }
+  }
+  if (values[0] == 0 || values[1] == 0 || (size_t)values[0] * values[1] > count) {
+    napi_throw_range_error(env, NULL, "downsample: width / height 与像素数据长度不符");
+    return NULL;
+  }
+
+  BayerPattern pattern = BAYER_NONE;
+  if (!ReadBayerPattern(env, args[0], "bayer", &pattern) || !ReadBayerPattern(env, args[1], "bayer", &pattern)) {
+    napi_throw_range_error(env, NULL, "downsample: bayer 只能是 'RGGB' / 'GRBG' / 'GBRG' / 'BGGR'");
+    return NULL;
+  }
+
+  PreviewImage preview;
+  MakeColorPreview16(pixels, values[0], values[1], pattern, values[2], values[3], &preview);
+  return CreatePreviewObject(env, preview);
+}
+
+// debayer(source, { width?, height?, pattern?, method?: 'bilinear' | 'edge' })：把 Bayer 阵列插值为
+// 交错的 RGB16，返回 { width, height, channels: 3, data: ArrayBuffer }。source 为帧对象时从中读取宽高与
+// 阵列（frame.bayer），选项中的 pattern 优先。bilinear（默认）较快，用于预览；edge 为边缘自适应，用于保存。
+static napi_value Debayer(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  const uint16_t* pixels = NULL;
+  size_t count = 0;
+  if (argc < 1 || !GetPixelSource16(env, args[0], &pixels, &count)) {
+    napi_throw_type_error(env, NULL, "debayer: 需要 Uint16Array、ArrayBuffer 或帧对象");
+    return NULL;
+  }
+  napi_value options = args[0];
+  if (argc >= 2) {
+    napi_valuetype type;
+    NAPI_CALL(env, napi_typeof(env, args[1], &type));
+    if (type == napi_object) {
+      options = args[1];
+    }
+  }
+
+  uint32_t values[2] = {0, 0};  // width, height
+  const char* names[2] = {"width", "height"};
+  for (int i = 0; i < 2; i++) {
+    napi_value v;
+    napi_value from = HasProperty(env, args[0], names[i]) ? args[0] : options;
+    if (HasProperty(env, from, names[i]) && napi_get_named_property(env, from, names[i], &v) == napi_ok) {
+      napi_get_value_uint32(env, v, &values[i]);
+    }
+  }
+  if (values[0] == 0 || values[1] == 0 || (size_t)values[0] * values[1] > count) {
+    napi_throw_range_error(env, NULL, "debayer: width / height 与像素数据长度不符");
+    return NULL;
+  }
+
+  BayerPattern pattern = BAYER_NONE;
+  if (!ReadBayerPattern(env, args[0], "bayer", &pattern) || !ReadBayerPattern(env, options, "pattern", &pattern)) {
+    napi_throw_range_error(env, NULL, "debayer: pattern 只能是 'RGGB' / 'GRBG' / 'GBRG' / 'BGGR'");
+    return NULL;
+  }
+  if (pattern == BAYER_NONE) {
+    napi_throw_error(env, NULL, "debayer: 未指定 Bayer 阵列（黑白帧无需去马赛克）");
+    return NULL;
+  }
+
+  DebayerMethod method = DEBAYER_BILINEAR;
+  napi_value v;
+  if (HasProperty(env, options, "method") && napi_get_named_property(env, options, "method", &v) == napi_ok) {
+    char name[12] = {0};
+    size_t len = 0;
+    napi_get_value_string_utf8(env, v, name, sizeof(name), &len);
+    if (strcmp(name, "edge") == 0) {
+      method = DEBAYER_EDGE_AWARE;
+    } else if (strcmp(name, "bilinear") != 0) {
+      napi_throw_range_error(env, NULL, "debayer: method 只能是 'bilinear' 或 'edge'");
+      return NULL;
+    }
+  }
+
+  size_t bytes = (size_t)values[0] * values[1] * 3 * sizeof(uint16_t);
+  void* out = NULL;
+  napi_value data;
+  NAPI_CALL(env, napi_create_arraybuffer(env, bytes, &out, &data));
+  DebayerRgb16(pixels, values[0], values[1], pattern, method, static_cast<uint16_t*>(out));
+
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  NAPI_CALL(env, napi_create_uint32(env, values[0], &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "width", v));
+  NAPI_CALL(env, napi_create_uint32(env, values[1], &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "height", v));
+  NAPI_CALL(env, napi_create_uint32(env, 3, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "channels", v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "data", data));
+  return result;
+}
+
+// bin(source, { factor, mode?: 'average' | 'sum' | 'sum32', width?, height?, bayer? })：软件 bin，
+// 返回 { width, height, factor, data }。average / sum 输出 16bit（sum 饱和到 65535），sum32 输出 32bit
+// （Uint32Array 的底层 ArrayBuffer）。source 为帧对象时从中读取宽高与 bayer，有 Bayer 阵列时只合并同色像素。
+// 拍摄时在取帧线程中 bin 请使用拍摄参数 softwareBin / softwareBinMode。
+static napi_value Bin(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  const uint16_t* pixels = NULL;
+  size_t count = 0;
+  if (argc < 2 || !GetPixelSource16(env, args[0], &pixels, &count)) {
+    napi_throw_type_error(env, NULL, "bin(source, options) 需要 16bit 像素源与选项对象");
+    return NULL;
+  }
+
+  uint32_t values[3] = {0, 0, 0};  // width, height, factor
+  const char* names[3] = {"width", "height", "factor"};
+  for (int i = 0; i < 3; i++) {
+    napi_value v;
+    napi_value from = i < 2 && HasProperty(env, args[0], names[i]) ? args[0] : args[1];
+    if (HasProperty(env, from, names[i]) && napi_get_named_property(env, from, names[i], &v) == napi_ok) {
+      napi_get_value_uint32(env, v, &values[i]);
+    }
+  }
+  if (values[0] == 0 || values[1] == 0 || (size_t)values[0] * values[1] > count) {
+    napi_throw_range_error(env, NULL, "bin: width / height 与像素数据长度不符");
+    return NULL;
+  }
+  if (values[2] < 1 || values[2] > kSoftwareBinMaxFactor) {
+    napi_throw_range_error(env, NULL, "bin: factor 只能是 1 ~ 4");
+    return NULL;
+  }
+
+  BayerPattern pattern = BAYER_NONE;
+  if (!ReadBayerPattern(env, args[0], "bayer", &pattern) || !ReadBayerPattern(env, args[1], "bayer", &pattern)) {
+    napi_throw_range_error(env, NULL, "bin: bayer 只能是 'RGGB' / 'GRBG' / 'GBRG' / 'BGGR'");
+    return NULL;
+  }
+  const bool bayer = pattern != BAYER_NONE;
+
+  BinMode mode = BIN_AVERAGE;
+  bool sum32 = false;
+  napi_value v;
+  if (HasProperty(env, args[1], "mode") && napi_get_named_property(env, args[1], "mode", &v) == napi_ok) {
+    char name[12] = {0};
+    size_t len = 0;
+    napi_get_value_string_utf8(env, v, name, sizeof(name), &len);
+    if (strcmp(name, "sum") == 0) {
+      mode = BIN_SUM;
+    } else if (strcmp(name, "sum32") == 0) {
+      sum32 = true;
+    } else if (strcmp(name, "average") != 0) {
+      napi_throw_range_error(env, NULL, "bin: mode 只能是 'average'、'sum' 或 'sum32'");
+      return NULL;
+    }
+  }
+
+  uint32_t outWidth = 0;
+  uint32_t outHeight = 0;
+  SoftwareBinSize(values[0], values[1], values[2], bayer, &outWidth, &outHeight);
+  if (outWidth == 0 || outHeight == 0) {
+    napi_throw_range_error(env, NULL, "bin: 图像小于一个 bin 区域");
+    return NULL;
+  }
+
+  size_t bytes = (size_t)outWidth * outHeight * (sum32 ? sizeof(uint32_t) : sizeof(uint16_t));
+  void* out = NULL;
+  napi_value data;
+  NAPI_CALL(env, napi_create_arraybuffer(env, bytes, &out, &data));
+  if (sum32) {
+    SoftwareBinSum32(pixels, values[0], values[1], values[2], bayer, static_cast<uint32_t*>(out));
+  } else {
+    SoftwareBin16(pixels, values[0], values[1], values[2], mode, bayer, static_cast<uint16_t*>(out));
+  }
+
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  NAPI_CALL(env, napi_create_uint32(env, outWidth, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "width", v));
+  NAPI_CALL(env, napi_create_uint32(env, outHeight, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "height", v));
+  NAPI_CALL(env, napi_create_uint32(env, values[2], &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "factor", v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "data", data));
+  return result;
+}
+
+// profile(frame, { points, lineWidth?, interpolation?: 'bilinear' | 'bicubic', spacing? })：沿直线 / 折线
+// （points 至少 2 个，整帧像素坐标，与测量工具相同）按 spacing（默认 1 像素）取样，每个采样点在法线方向上
+// 取 lineWidth（默认 1，最多 101）个点求平均。返回 { length, spacing, lineWidth, values, vertices }：
+// values 为 Float32Array，第 i 个值距起点 i * spacing，全部在图像外时为 NaN；vertices 为各顶点距起点的路径长度。
+// 采样点超过 65536 个时自动放大 spacing。只访问路径附近的像素，可在拖动控制点时逐次调用。
+static napi_value Profile(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  const uint16_t* pixels = NULL;
+  size_t count = 0;
+  if (argc < 1 || !GetPixelSource16(env, args[0], &pixels, &count)) {
+    napi_throw_type_error(env, NULL, "profile: 需要 16bit 帧对象");
+    return NULL;
+  }
+  uint32_t values[4] = {0, 0, 16, 1};  // width, height, bpp, channels
+  const char* names[4] = {"width", "height", "bpp", "channels"};
+  for (int i = 0; i < 4; i++) {
+    napi_value v;
+    if (HasProperty(env, args[0], names[i]) && napi_get_named_property(env, args[0], names[i], &v) == napi_ok) {
+      napi_get_value_uint32(env, v, &values[i]);
+    }
+  }
+  if (values[2] <= 8 || values[3] != 1) {
+    napi_throw_range_error(env, NULL, "profile: 只支持 16bit 单通道帧");
+    return NULL;
+  }
+  if (values[0] < 4 || values[1] < 4 || (size_t)values[0] * values[1] > count) {
+    napi_throw_range_error(env, NULL, "profile: width / height 与像素数据长度不符");
+    return NULL;
+  }
+
+  napi_valuetype type = napi_undefined;
+  if (argc >= 2) {
+    NAPI_CALL(env, napi_typeof(env, args[1], &type));
+  }
+  std::vector<ProfilePoint> path;
+  if (type != napi_object || !ReadPointArray(env, args[1], "points", &path) || path.size() < 2) {
+    napi_throw_type_error(env, NULL, "profile: points 必须是至少 2 个 { x, y } 的数组");
+    return NULL;
+  }
+  ProfileOptions options;
+  napi_value v;
+  if (HasProperty(env, args[1], "lineWidth") && napi_get_named_property(env, args[1], "lineWidth", &v) == napi_ok) {
+    napi_get_value_uint32(env, v, &options.width);
+  }
+  if (HasProperty(env, args[1], "spacing") && napi_get_named_property(env, args[1], "spacing", &v) == napi_ok) {
+    napi_get_value_double(env, v, &options.spacing);
+  }
+  std::string name;
+  if (ReadStringProperty(env, args[1], "interpolation", &name)) {
+    if (name == "bicubic") {
+      options.interpolation = PROFILE_BICUBIC;
+    } else if (name != "bilinear") {
+      napi_throw_range_error(env, NULL, "profile: interpolation 只能是 'bilinear' 或 'bicubic'");
+      return NULL;
+    }
+  }
+  if (options.width < 1 || options.width > kProfileMaxWidth || !(options.spacing > 0.0)) {
+    napi_throw_range_error(env, NULL, "profile: lineWidth 必须在 1 ~ 101 之间，spacing 必须大于 0");
+    return NULL;
+  }
+
+  ProfileResult profile;
+  if (!SampleProfile16(pixels, values[0], values[1], path, options, &profile)) {
+    napi_throw_range_error(env, NULL, "profile: 路径长度为 0 或坐标无效");
+    return NULL;
+  }
+
+  napi_value result;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  const struct {
+    const char* name;
+    double value;
+  } numbers[] = {
+      {"length", profile.length},
+      {"spacing", profile.spacing},
+      {"lineWidth", (double)options.width},
+  };
+  for (const auto& number : numbers) {
+    NAPI_CALL(env, napi_create_double(env, number.value, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, number.name, v));
+  }
+  const struct {
+    const char* name;
+    const std::vector<float>* data;
+  } arrays[] = {
+      {"values", &profile.values},
+      {"vertices", &profile.vertices},
+  };
+  for (const auto& array : arrays) {
+    void* data = NULL;
+    napi_value arraybuffer;
+    size_t length = array.data->size();
+    NAPI_CALL(env, napi_create_arraybuffer(env, length * sizeof(float), &data, &arraybuffer));
+    std::copy(array.data->begin(), array.data->end(), static_cast<float*>(data));
+    NAPI_CALL(env, napi_create_typedarray(env, napi_float32_array, length, arraybuffer, 0, &v));
+    NAPI_CALL(env, napi_set_named_property(env, result, array.name, v));
+  }
+  return result;
+}
+
+// ---- MasterFrameBuilder JS 类 ----
+// const builder = new MasterFrameBuilder({ method?: 'median' | 'sigma', sigma? });
+// builder.add(frame);            // 拷贝一帧（16bit 帧对象，或带 { width, height, roi? } 的像素源），之后可立即 releaseFrame
+// builder.count();
+// const master = await builder.build();  // 在线程池中合成：{ width, height, roi, frames, data: Float32Array }
+// builder.clear();               // 释放已收集的帧
+
+struct MasterBuilderWrap {
+  std::shared_ptr<MasterFrameBuilder> builder;
+  bool building = false;
+};
+
+struct MasterBuildWork {
+  napi_async_work work;
+  napi_deferred deferred;
+  napi_ref builderRef;  // 任务期间保持 JS 对象存活
+  napi_ref dataRef;     // 输出的 ArrayBuffer，在 JS 线程中预先分配，工作线程直接写入
+  MasterBuilderWrap* wrap;
+  float* data;
+  uint32_t width;
+  uint32_t height;
+  CalibrationRegion region;
+  uint32_t frames;
+  bool ok;
+  std::string error;
+};
+
+static void MasterBuilderFinalize(napi_env env, void* data, void* hint) {
+  (void)env;
+  (void)hint;
+  delete static_cast<MasterBuilderWrap*>(data);
+}
+
+static MasterBuilderWrap* UnwrapMasterBuilder(napi_env env, napi_callback_info info, size_t* argc, napi_value* args,
+                                              napi_value* thisOut = NULL) {
+  napi_value thisArg;
+  MasterBuilderWrap* wrap = NULL;
+  if (napi_get_cb_info(env, info, argc, args, &thisArg, NULL) != napi_ok ||
+      napi_unwrap(env, thisArg, (void**)&wrap) != napi_ok || wrap == NULL) {
+    napi_throw_error(env, NULL, "Invalid MasterFrameBuilder object");
+    return NULL;
+  }
+  if (thisOut) {
+    *thisOut = thisArg;
+  }
+  return wrap;
+}
+
+static bool ThrowIfBuilding(napi_env env, MasterBuilderWrap* wrap) {
+  if (wrap->building) {
+    napi_throw_error(env, NULL, "MasterFrameBuilder is building a master");
+    return true;
+  }
+  return false;
+}
+
+static napi_value MasterBuilderConstructor(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisArg;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, &thisArg, NULL));
+
+  CombineMethod method = COMBINE_MEDIAN;
+  double sigma = kDefaultClipSigma;
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    NAPI_CALL(env, napi_typeof(env, args[0], &type));
+  }
+  if (type == napi_object) {
+    std::string name;
+    if (ReadStringProperty(env, args[0], "method", &name)) {
+      if (name == "sigma") {
+        method = COMBINE_SIGMA_CLIP;
+      } else if (name != "median") {
+        napi_throw_range_error(env, NULL, "MasterFrameBuilder: method 只能是 'median' 或 'sigma'");
+        return NULL;
+      }
+    }
+    napi_value v;
+    if (HasProperty(env, args[0], "sigma") && napi_get_named_property(env, args[0], "sigma", &v) == napi_ok) {
+      napi_get_value_double(env, v, &sigma);
+    }
+    if (!(sigma > 0.0)) {
+      napi_throw_range_error(env, NULL, "MasterFrameBuilder: sigma 必须大于 0");
+      return NULL;
+    }
+  }
+
+  MasterBuilderWrap* wrap = new MasterBuilderWrap();
+  wrap->builder = std::make_shared<MasterFrameBuilder>(method, (float)sigma);
+  napi_status status = napi_wrap(env, thisArg, wrap, MasterBuilderFinalize, NULL, NULL);
+  if (status != napi_ok) {
+    delete wrap;
+    napi_throw_error(env, NULL, "Failed to wrap MasterFrameBuilder");
+    return NULL;
+  }
+  return thisArg;
+}
+
+// add(source, { width?, height?, roi? })：加入一帧，返回已收集的帧数。
+// roi { x, y, bin } 取自帧对象（或第二个参数），同一主帧的各帧尺寸与 roi 必须相同；软件 bin 后的帧不能加入
+static napi_value MasterBuilderAdd(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  MasterBuilderWrap* wrap = UnwrapMasterBuilder(env, info, &argc, args);
+  if (wrap == NULL || ThrowIfBuilding(env, wrap)) {
+    return NULL;
+  }
+  const uint16_t* pixels = NULL;
+  size_t count = 0;
+  if (argc < 1 || !GetPixelSource16(env, args[0], &pixels, &count)) {
+    napi_throw_type_error(env, NULL, "add 需要 16bit 帧对象、ArrayBuffer 或 Uint16Array");
+    return NULL;
+  }
+  uint32_t values[2] = {0, 0};  // width, height
+  const char* names[2] = {"width", "height"};
+  for (int i = 0; i < 2; i++) {
+    napi_value v;
+    napi_value from = HasProperty(env, args[0], names[i]) ? args[0] : (argc >= 2 ? args[1] : NULL);
+    if (from != NULL && HasProperty(env, from, names[i]) &&
+        napi_get_named_property(env, from, names[i], &v) == napi_ok) {
+      napi_get_value_uint32(env, v, &values[i]);
+    }
+  }
+  if (values[0] == 0 || values[1] == 0 || (size_t)values[0] * values[1] > count) {
+    napi_throw_range_error(env, NULL, "add: width / height 与像素数据长度不符");
+    return NULL;
+  }
+  CalibrationRegion region;
+  napi_value regionFrom = HasProperty(env, args[0], "roi") || argc < 2 ? args[0] : args[1];
+  if (!ReadCalibrationRegion(env, regionFrom, &region)) {
+    napi_throw_range_error(env, NULL, "add: roi 必须是 { x, y, bin }，且不能是软件 bin 之后的帧");
+    return NULL;
+  }
+  std::string error;
+  if (!wrap->builder->Add(pixels, values[0], values[1], region, &error)) {
+    napi_throw_error(env, NULL, error.c_str());
+    return NULL;
+  }
+  napi_value result;
+  NAPI_CALL(env, napi_create_uint32(env, (uint32_t)wrap->builder->Count(), &result));
+  return result;
+}
+
+static napi_value MasterBuilderCount(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  MasterBuilderWrap* wrap = UnwrapMasterBuilder(env, info, &argc, NULL);
+  if (wrap == NULL) {
+    return NULL;
+  }
+  napi_value result;
+  NAPI_CALL(env, napi_create_uint32(env, (uint32_t)wrap->builder->Count(), &result));
+  return result;
+}
+
+static napi_value MasterBuilderClear(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  MasterBuilderWrap* wrap = UnwrapMasterBuilder(env, info, &argc, NULL);
+  if (wrap == NULL || ThrowIfBuilding(env, wrap)) {
+    return NULL;
+  }
+  wrap->builder->Clear();
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+// 在线程池中执行：逐像素合并，不允许调用任何 N-API
+static void MasterBuildExecute(napi_env env, void* data) {
+  (void)env;
+  MasterBuildWork* mw = static_cast<MasterBuildWork*>(data);
+  TraceScope trace("native.master-combine", 0);
+  mw->ok = mw->wrap->builder->Build(mw->data, &mw->error);
+}
+
+static void MasterBuildComplete(napi_env env, napi_status status, void* data) {
+  MasterBuildWork* mw = static_cast<MasterBuildWork*>(data);
+  mw->wrap->building = false;
+
+  napi_value result = NULL;
+  if (status == napi_ok && mw->ok) {
+    napi_value arraybuffer;
+    napi_value array;
+    napi_value v;
+    if (napi_get_reference_value(env, mw->dataRef, &arraybuffer) == napi_ok &&
+        napi_create_typedarray(env, napi_float32_array, (size_t)mw->width * mw->height, arraybuffer, 0, &array) ==
+            napi_ok &&
+        napi_create_object(env, &result) == napi_ok) {
+      napi_create_uint32(env, mw->width, &v);
+      napi_set_named_property(env, result, "width", v);
+      napi_create_uint32(env, mw->height, &v);
+      napi_set_named_property(env, result, "height", v);
+      v = CreateCalibrationRegionObject(env, mw->region);
+      if (v != NULL) {
+        napi_set_named_property(env, result, "roi", v);
+      }
+      napi_create_uint32(env, mw->frames, &v);
+      napi_set_named_property(env, result, "frames", v);
+      napi_set_named_property(env, result, "data", array);
+    } else {
+      result = NULL;
+    }
+  }
+  if (result != NULL) {
+    napi_resolve_deferred(env, mw->deferred, result);
+  } else {
+    const char* msg = status == napi_cancelled ? "Build cancelled"
+                      : mw->ok                 ? "Failed to create master frame object"
+                                               : mw->error.c_str();
+    napi_value msgValue;
+    napi_value err;
+    napi_create_string_utf8(env, msg, NAPI_AUTO_LENGTH, &msgValue);
+    napi_create_error(env, NULL, msgValue, &err);
+    napi_reject_deferred(env, mw->deferred, err);
+  }
+  napi_delete_reference(env, mw->dataRef);
+  napi_delete_reference(env, mw->builderRef);
+  napi_delete_async_work(env, mw->work);
+  delete mw;
+}
+
+// build()：返回 Promise<{ width, height, roi, frames, data: Float32Array }>，合成期间不阻塞 JS 线程
+static napi_value MasterBuilderBuild(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  napi_value thisArg;
+  MasterBuilderWrap* wrap = UnwrapMasterBuilder(env, info, &argc, NULL, &thisArg);
+  if (wrap == NULL || ThrowIfBuilding(env, wrap)) {
+    return NULL;
+  }
+  if (wrap->builder->Count() == 0) {
+    napi_throw_error(env, NULL, "MasterFrameBuilder has no frames");
+    return NULL;
+  }
+
+  MasterBuildWork* mw = new MasterBuildWork();
+  mw->wrap = wrap;
+  mw->width = wrap->builder->Width();
+  mw->height = wrap->builder->Height();
+  mw->region = wrap->builder->Region();
+  mw->frames = (uint32_t)wrap->builder->Count();
+  mw->ok = false;
+  void* data = NULL;
+  napi_value arraybuffer;
+  napi_value promise;
+  napi_value resourceName;
+  napi_status status =
+      napi_create_arraybuffer(env, (size_t)mw->width * mw->height * sizeof(float), &data, &arraybuffer);
+  if (status == napi_ok) {
+    mw->data = static_cast<float*>(data);
+    status = napi_create_reference(env, arraybuffer, 1, &mw->dataRef);
+  }
+  if (status != napi_ok) {
+    delete mw;
+    napi_throw_error(env, NULL, "Failed to allocate master frame");
+    return NULL;
+  }
+  status = napi_create_promise(env, &mw->deferred, &promise);
+  if (status == napi_ok) {
+    status = napi_create_string_utf8(env, "qhyccd:buildMaster", NAPI_AUTO_LENGTH, &resourceName);
+  }
+  if (status == napi_ok) {
+    status = napi_create_async_work(env, NULL, resourceName, MasterBuildExecute, MasterBuildComplete, mw, &mw->work);
+  }
+  if (status != napi_ok) {
+    napi_delete_reference(env, mw->dataRef);
+    delete mw;
+    napi_throw_error(env, NULL, "Failed to create build task");
+    return NULL;
+  }
+  NAPI_CALL(env, napi_create_reference(env, thisArg, 1, &mw->builderRef));
+  NAPI_CALL(env, napi_queue_async_work(env, mw->work));
+  wrap->building = true;
+  return promise;
+}
+
+// ---- 帧流水线计时 ----
+// traceNow()：当前时间（微秒，与 getTimings 中的时间同一时钟）
+// traceEvent(name, frameId, start, end, thread?)：记录 JS 侧的阶段
+// getTimings({ frameId?, clear? })：[{ name, frameId, thread, start, duration }]（微秒）
+// clearTimings(); setTraceEnabled(enabled)
+
+static napi_value TraceNow(napi_env env, napi_callback_info info) {
+  (void)info;
+  napi_value result;
+  NAPI_CALL(env, napi_create_double(env, (double)TraceNowUs(), &result));
+  return result;
+}
+
+static napi_value TraceEventJs(napi_env env, napi_callback_info info) {
+  size_t argc = 5;
+  napi_value args[5];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+  if (argc < 4) {
+    napi_throw_type_error(env, NULL, "traceEvent(name, frameId, start, end, thread?)");
+    return NULL;
+  }
+  char name[64] = {0};
+  size_t len = 0;
+  NAPI_CALL(env, napi_get_value_string_utf8(env, args[0], name, sizeof(name), &len));
+  double values[3] = {0, 0, 0};  // frameId, start, end
+  for (size_t i = 0; i < 3; i++) {
+    NAPI_CALL(env, napi_get_value_double(env, args[i + 1], &values[i]));
+  }
+  uint32_t thread = 0;
+  if (argc >= 5) {
+    napi_get_value_uint32(env, args[4], &thread);
+  }
+  RecordTrace(name, values[0] > 0 ? (uint64_t)values[0] : 0, (int64_t)values[1], (int64_t)values[2], thread);
+  return NULL;
+}
+
+static napi_value GetTimings(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  double frameId = 0;
+  bool clear = false;
+  if (argc >= 1) {
+    napi_valuetype type;
+    NAPI_CALL(env, napi_typeof(env, args[0], &type));
+    if (type == napi_object) {
+      napi_value v;
+      if (HasProperty(env, args[0], "frameId") && napi_get_named_property(env, args[0], "frameId", &v) == napi_ok) {
+        napi_get_value_double(env, v, &frameId);
+      }
+      if (HasProperty(env, args[0], "clear") && napi_get_named_property(env, args[0], "clear", &v) == napi_ok) {
+        napi_get_value_bool(env, v, &clear);
+      }
+    }
+  }
+
+  std::vector<TraceEvent> events = CollectTraces(frameId > 0 ? (uint64_t)frameId : 0, clear);
+  napi_value result;
+  NAPI_CALL(env, napi_create_array_with_length(env, events.size(), &result));
+  for (size_t i = 0; i < events.size(); i++) {
+    const TraceEvent& event = events[i];
+    napi_value item;
+    napi_value v;
+    NAPI_CALL(env, napi_create_object(env, &item));
+    NAPI_CALL(env, napi_create_string_utf8(env, event.name.c_str(), event.name.size(), &v));
+    NAPI_CALL(env, napi_set_named_property(env, item, "name", v));
+    NAPI_CALL(env, napi_create_double(env, (double)event.frameId, &v));
+    NAPI_CALL(env, napi_set_named_property(env, item, "frameId", v));
+    NAPI_CALL(env, napi_create_uint32(env, event.thread, &v));
+    NAPI_CALL(env, napi_set_named_property(env, item, "thread", v));
+    NAPI_CALL(env, napi_create_double(env, (double)event.startUs, &v));
+    NAPI_CALL(env, napi_set_named_property(env, item, "start", v));
+    NAPI_CALL(env, napi_create_double(env, (double)event.durationUs, &v));
+    NAPI_CALL(env, napi_set_named_property(env, item, "duration", v));
+    NAPI_CALL(env, napi_set_element(env, result, (uint32_t)i, item));
+  }
+  return result;
+}
+
+static napi_value ClearTimings(napi_env env, napi_callback_info info) {
+  (void)env;
+  (void)info;
+  ClearTraces();
+  return NULL;
+}
+
+static napi_value SetTraceEnabledJs(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+  bool enabled = true;
+  if (argc >= 1) {
+    NAPI_CALL(env, napi_get_value_bool(env, args[0], &enabled));
+  }
+  SetTraceEnabled(enabled);
+  return NULL;
+}
+
+// ---- SharedFrameRing JS 类 ----
+// 主进程与渲染进程之间的共享内存帧通道，帧数据只拷贝进共享内存一次，IPC 只发送很小的通知。
+// const ring = new SharedFrameRing({ slots?, slotBytes });  // 主进程：创建
+// ring.publish(source);            // source 为 16bit 帧对象 / ArrayBuffer / Uint16Array，返回 { sequence, byteLength }，
+//                                  // 超过槽大小时返回 null
+// const reader = new SharedFrameRing({ name });             // 渲染进程（preload）：按名称映射
+// reader.read(sequence, byteLength);  // 返回新的 ArrayBuffer；该帧已被覆盖时返回 null
+// ring.info();   // { name, slots, slotBytes, lastSequence }
+// ring.close();  // 立即解除映射（否则在垃圾回收时）
+
+static void SharedFrameRingFinalize(napi_env env, void* data, void* hint) {
+  (void)env;
+  (void)hint;
+  delete static_cast<SharedFrameRing*>(data);
+}
+
+static SharedFrameRing* UnwrapSharedFrameRing(napi_env env, napi_callback_info info, size_t* argc,
+                                              napi_value* args) {
+  napi_value thisArg;
+  SharedFrameRing* ring = NULL;
+  if (napi_get_cb_info(env, info, argc, args, &thisArg, NULL) != napi_ok ||
+      napi_unwrap(env, thisArg, (void**)&ring) != napi_ok || ring == NULL) {
+    napi_throw_error(env, NULL, "Invalid SharedFrameRing object");
+    return NULL;
+  }
+  return ring;
+}
+
+static napi_value SharedFrameRingConstructor(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisArg;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, &thisArg, NULL));
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    NAPI_CALL(env, napi_typeof(env, args[0], &type));
+  }
+  if (type != napi_object) {
+    napi_throw_type_error(env, NULL, "SharedFrameRing({ name } | { slots?, slotBytes }) requires an options object");
+    return NULL;
+  }
+
+  SharedFrameRing* ring = new SharedFrameRing();
+  std::string name;
+  std::string error;
+  bool ok = false;
+  if (ReadStringProperty(env, args[0], "name", &name)) {
+    ok = ring->Open(name, &error);
+  } else {
+    uint32_t slots = kSharedRingDefaultSlots;
+    double slotBytes = 0.0;
+    napi_value v;
+    if (HasProperty(env, args[0], "slots") && napi_get_named_property(env, args[0], "slots", &v) == napi_ok) {
+      napi_get_value_uint32(env, v, &slots);
+    }
+    if (HasProperty(env, args[0], "slotBytes") && napi_get_named_property(env, args[0], "slotBytes", &v) == napi_ok) {
+      napi_get_value_double(env, v, &slotBytes);
+    }
+    ok = slotBytes >= 1.0 && ring->Create(slots, (size_t)slotBytes, &error);
+    if (slotBytes < 1.0) {
+      error = "SharedFrameRing requires slotBytes > 0";
+    }
+  }
+  if (!ok) {
+    delete ring;
+    napi_throw_error(env, NULL, error.c_str());
+    return NULL;
+  }
+
+  napi_status status = napi_wrap(env, thisArg, ring, SharedFrameRingFinalize, NULL, NULL);
+  if (status != napi_ok) {
+    delete ring;
+    napi_throw_error(env, NULL, "Failed to wrap SharedFrameRing");
+    return NULL;
+  }
+  return thisArg;
+}
+
+// info()：{ name, slots, slotBytes, lastSequence }，已关闭时 name 为空
+static napi_value SharedFrameRingInfo(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SharedFrameRing* ring = UnwrapSharedFrameRing(env, info, &argc, NULL);
+  if (ring == NULL) {
+    return NULL;
+  }
+  napi_value result;
+  napi_value v;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  NAPI_CALL(env, napi_create_string_utf8(env, ring->Name().c_str(), NAPI_AUTO_LENGTH, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "name", v));
+  NAPI_CALL(env, napi_create_uint32(env, (uint32_t)ring->SlotCount(), &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "slots", v));
+  NAPI_CALL(env, napi_create_double(env, (double)ring->SlotBytes(), &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "slotBytes", v));
+  NAPI_CALL(env, napi_create_double(env, (double)ring->LastSequence(), &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "lastSequence", v));
+  return result;
+}
+
+// publish(source)：写入一帧，返回 { sequence, byteLength }；超过槽大小时返回 null，调用方改用普通 IPC 发送
+static napi_value SharedFrameRingPublish(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  SharedFrameRing* ring = UnwrapSharedFrameRing(env, info, &argc, args);
+  if (ring == NULL) {
+    return NULL;
+  }
+  const uint16_t* pixels = NULL;
+  size_t count = 0;
+  if (argc < 1 || !GetPixelSource16(env, args[0], &pixels, &count)) {
+    napi_throw_type_error(env, NULL, "publish 需要 16bit 帧对象、ArrayBuffer 或 Uint16Array");
+    return NULL;
+  }
+  const size_t bytes = count * sizeof(uint16_t);
+  const uint64_t sequence = ring->Publish(reinterpret_cast<const uint8_t*>(pixels), bytes);
+  napi_value result;
+  if (sequence == 0) {
+    NAPI_CALL(env, napi_get_null(env, &result));
+    return result;
+  }
+  napi_value v;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  NAPI_CALL(env, napi_create_double(env, (double)sequence, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "sequence", v));
+  NAPI_CALL(env, napi_create_double(env, (double)bytes, &v));
+  NAPI_CALL(env, napi_set_named_property(env, result, "byteLength", v));
+  return result;
+}
+
+// read(sequence, byteLength)：把该帧拷贝到新的 ArrayBuffer；已被后续帧覆盖时返回 null
+static napi_value SharedFrameRingRead(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  SharedFrameRing* ring = UnwrapSharedFrameRing(env, info, &argc, args);
+  if (ring == NULL) {
+    return NULL;
+  }
+  double values[2] = {0.0, 0.0};  // sequence, byteLength
+  for (size_t i = 0; i < 2; i++) {
+    if (i >= argc || napi_get_value_double(env, args[i], &values[i]) != napi_ok || values[i] < 0.0) {
+      napi_throw_type_error(env, NULL, "read(sequence, byteLength) 需要非负整数参数");
+      return NULL;
+    }
+  }
+  napi_value result;
+  const size_t capacity = (size_t)values[1];
+  if (capacity > ring->SlotBytes()) {
+    NAPI_CALL(env, napi_get_null(env, &result));
+    return result;
+  }
+  void* data = NULL;
+  NAPI_CALL(env, napi_create_arraybuffer(env, capacity, &data, &result));
+  size_t bytes = 0;
+  if (!ring->Read((uint64_t)values[0], static_cast<uint8_t*>(data), capacity, &bytes) || bytes != capacity) {
+    NAPI_CALL(env, napi_get_null(env, &result));
+  }
+  return result;
+}
+
+// close()：解除映射；创建方同时删除共享内存的名称
+static napi_value SharedFrameRingClose(napi_env env, napi_callback_info info) {
+  size_t argc = 0;
+  SharedFrameRing* ring = UnwrapSharedFrameRing(env, info, &argc, NULL);
+  if (ring == NULL) {
+    return NULL;
+  }
+  ring->Close();
+  napi_value undefined;
+  NAPI_CALL(env, napi_get_undefined(env, &undefined));
+  return undefined;
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+  napi_value fn;
+  NAPI_CALL(env,
+            napi_create_function(env,
+                                 "captureSingleFrame",
+                                 NAPI_AUTO_LENGTH,
                                  CaptureSingleFrame,
                                  NULL,
                                  &fn));
   NAPI_CALL(env, napi_set_named_property(env, exports, "captureSingleFrame", fn));
+
+  NAPI_CALL(env, napi_create_function(env, "stretch", NAPI_AUTO_LENGTH, Stretch, NULL, &fn));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "stretch", fn));
+
+  NAPI_CALL(env, napi_create_function(env, "downsample", NAPI_AUTO_LENGTH, Downsample, NULL, &fn));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "downsample", fn));
+
+  NAPI_CALL(env, napi_create_function(env, "debayer", NAPI_AUTO_LENGTH, Debayer, NULL, &fn));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "debayer", fn));
+
+  NAPI_CALL(env, napi_create_function(env, "bin", NAPI_AUTO_LENGTH, Bin, NULL, &fn));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "bin", fn));
+
+  NAPI_CALL(env, napi_create_function(env, "profile", NAPI_AUTO_LENGTH, Profile, NULL, &fn));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "profile", fn));
+
+  napi_property_descriptor traceFunctions[] = {
+    {"traceNow", NULL, TraceNow, NULL, NULL, NULL, napi_default, NULL},
+    {"traceEvent", NULL, TraceEventJs, NULL, NULL, NULL, napi_default, NULL},
+    {"getTimings", NULL, GetTimings, NULL, NULL, NULL, napi_default, NULL},
+    {"clearTimings", NULL, ClearTimings, NULL, NULL, NULL, napi_default, NULL},
+    {"setTraceEnabled", NULL, SetTraceEnabledJs, NULL, NULL, NULL, napi_default, NULL},
+  };
+  NAPI_CALL(env, napi_define_properties(env, exports, sizeof(traceFunctions) / sizeof(traceFunctions[0]),
+                                        traceFunctions));
+
+  // 图像内核实际使用的指令集，便于排查性能问题
+  napi_value simdLevel;
+  NAPI_CALL(env, napi_create_string_utf8(env, SimdLevelName(), NAPI_AUTO_LENGTH, &simdLevel));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "simdLevel", simdLevel));
+
+  napi_property_descriptor sessionMethods[] = {
+    {"open", NULL, SessionOpen, NULL, NULL, NULL, napi_default, NULL},
+    {"configure", NULL, SessionConfigure, NULL, NULL, NULL, napi_default, NULL},
+    {"capture", NULL, SessionCapture, NULL, NULL, NULL, napi_default, NULL},
+    {"captureAsync", NULL, SessionCaptureAsync, NULL, NULL, NULL, napi_default, NULL},
+    {"close", NULL, SessionClose, NULL, NULL, NULL, napi_default, NULL},
+    {"isOpen", NULL, SessionIsOpen, NULL, NULL, NULL, napi_default, NULL},
+    {"isBusy", NULL, SessionIsBusy, NULL, NULL, NULL, napi_default, NULL},
+    {"startLive", NULL, SessionStartLive, NULL, NULL, NULL, napi_default, NULL},
+    {"stopLive", NULL, SessionStopLive, NULL, NULL, NULL, napi_default, NULL},
+    {"isLive", NULL, SessionIsLive, NULL, NULL, NULL, napi_default, NULL},
+    {"getLiveStats", NULL, SessionGetLiveStats, NULL, NULL, NULL, napi_default, NULL},
+    {"releaseFrame", NULL, SessionReleaseFrame, NULL, NULL, NULL, napi_default, NULL},
+    {"setPreviewSize", NULL, SessionSetPreviewSize, NULL, NULL, NULL, napi_default, NULL},
+    {"setStarDetection", NULL, SessionSetStarDetection, NULL, NULL, NULL, napi_default, NULL},
+    {"setRegions", NULL, SessionSetRegions, NULL, NULL, NULL, napi_default, NULL},
+    {"measureRegions", NULL, SessionMeasureRegions, NULL, NULL, NULL, napi_default, NULL},
+    {"setRoi", NULL, SessionSetRoi, NULL, NULL, NULL, napi_default, NULL},
+    {"getSensorInfo", NULL, SessionGetSensorInfo, NULL, NULL, NULL, napi_default, NULL},
+    {"startRecording", NULL, SessionStartRecording, NULL, NULL, NULL, napi_default, NULL},
+    {"stopRecording", NULL, SessionStopRecording, NULL, NULL, NULL, napi_default, NULL},
+    {"getRecordingStats", NULL, SessionGetRecordingStats, NULL, NULL, NULL, napi_default, NULL},
+    {"setCalibration", NULL, SessionSetCalibration, NULL, NULL, NULL, napi_default, NULL},
+    {"getCalibration", NULL, SessionGetCalibration, NULL, NULL, NULL, napi_default, NULL},
+    {"startStacking", NULL, SessionStartStacking, NULL, NULL, NULL, napi_default, NULL},
+    {"stopStacking", NULL, SessionStopStacking, NULL, NULL, NULL, napi_default, NULL},
+    {"resetStacking", NULL, SessionResetStacking, NULL, NULL, NULL, napi_default, NULL},
+    {"getStackingStats", NULL, SessionGetStackingStats, NULL, NULL, NULL, napi_default, NULL},
+  };
+  napi_value sessionClass;
+  NAPI_CALL(env,
+            napi_define_class(env,
+                              "CameraSession",
+                              NAPI_AUTO_LENGTH,
+                              SessionConstructor,
+                              NULL,
+                              sizeof(sessionMethods) / sizeof(sessionMethods[0]),
+                              sessionMethods,
+                              &sessionClass));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "CameraSession", sessionClass));
+
+  napi_property_descriptor pyramidMethods[] = {
+    {"info", NULL, TilePyramidInfo, NULL, NULL, NULL, napi_default, NULL},
+    {"getTile", NULL, TilePyramidGetTile, NULL, NULL, NULL, napi_default, NULL},
+    {"dispose", NULL, TilePyramidDispose, NULL, NULL, NULL, napi_default, NULL},
+  };
+  napi_value pyramidClass;
+  NAPI_CALL(env,
+            napi_define_class(env,
+                              "TilePyramid",
+                              NAPI_AUTO_LENGTH,
+                              TilePyramidConstructor,
+                              NULL,
+                              sizeof(pyramidMethods) / sizeof(pyramidMethods[0]),
+                              pyramidMethods,
+                              &pyramidClass));
+  NAPI_CALL(env, napi_create_reference(env, pyramidClass, 1, &g_tilePyramidConstructor));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "TilePyramid", pyramidClass));
+
+  napi_property_descriptor builderMethods[] = {
+    {"add", NULL, MasterBuilderAdd, NULL, NULL, NULL, napi_default, NULL},
+    {"count", NULL, MasterBuilderCount, NULL, NULL, NULL, napi_default, NULL},
+    {"build", NULL, MasterBuilderBuild, NULL, NULL, NULL, napi_default, NULL},
+    {"clear", NULL, MasterBuilderClear, NULL, NULL, NULL, napi_default, NULL},
+  };
+  napi_value builderClass;
+  NAPI_CALL(env,
+            napi_define_class(env,
+                              "MasterFrameBuilder",
+                              NAPI_AUTO_LENGTH,
+                              MasterBuilderConstructor,
+                              NULL,
+                              sizeof(builderMethods) / sizeof(builderMethods[0]),
+                              builderMethods,
+                              &builderClass));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "MasterFrameBuilder", builderClass));
+
+  napi_property_descriptor ringMethods[] = {
+    {"info", NULL, SharedFrameRingInfo, NULL, NULL, NULL, napi_default, NULL},
+    {"publish", NULL, SharedFrameRingPublish, NULL, NULL, NULL, napi_default, NULL},
+    {"read", NULL, SharedFrameRingRead, NULL, NULL, NULL, napi_default, NULL},
+    {"close", NULL, SharedFrameRingClose, NULL, NULL, NULL, napi_default, NULL},
+  };
+  napi_value ringClass;
+  NAPI_CALL(env,
+            napi_define_class(env,
+                              "SharedFrameRing",
+                              NAPI_AUTO_LENGTH,
+                              SharedFrameRingConstructor,
+                              NULL,
+                              sizeof(ringMethods) / sizeof(ringMethods[0]),
+                              ringMethods,
+                              &ringClass));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "SharedFrameRing", ringClass));
   return exports;
 }
 
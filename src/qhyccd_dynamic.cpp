@@ -1,14 +1,18 @@
 #include "qhyccd_dynamic.h"
+#include "dynamic_library.h"
 
 #include <cstring>
+#include <type_traits>
 
-static bool LoadFunctionPointers(QHYCCDFunctions *fns) {
-  auto load = [dll = fns->dll](auto &fn, const char *name) -> bool {
-    FARPROC p = GetProcAddress(dll, name);
+// 解析失败时 missing 返回第一个找不到的函数名
+static bool LoadFunctionPointers(QHYCCDFunctions *fns, const char **missing) {
+  auto load = [library = fns->library, missing](auto &fn, const char *name) -> bool {
+    void *p = FindDynamicSymbol(library, name);
     if (!p) {
+      *missing = name;
       return false;
     }
-    fn = reinterpret_cast<decltype(fn)>(p);
+    fn = reinterpret_cast<typename std::remove_reference<decltype(fn)>::type>(p);
     return true;
   };
 
@@ -24,25 +28,40 @@ static bool LoadFunctionPointers(QHYCCDFunctions *fns) {
     load(fns->SetQHYCCDBinMode,     "SetQHYCCDBinMode")     &&
     load(fns->SetQHYCCDResolution,  "SetQHYCCDResolution")  &&
     load(fns->SetQHYCCDParam,       "SetQHYCCDParam")       &&
+    load(fns->GetQHYCCDParam,       "GetQHYCCDParam")       &&
     load(fns->ExpQHYCCDSingleFrame, "ExpQHYCCDSingleFrame") &&
     load(fns->GetQHYCCDMemLength,   "GetQHYCCDMemLength")   &&
-    load(fns->GetQHYCCDSingleFrame, "GetQHYCCDSingleFrame");
+    load(fns->GetQHYCCDSingleFrame, "GetQHYCCDSingleFrame") &&
+    load(fns->SetQHYCCDBitsMode,    "SetQHYCCDBitsMode")    &&
+    load(fns->IsQHYCCDControlAvailable, "IsQHYCCDControlAvailable") &&
+    load(fns->GetQHYCCDChipInfo,    "GetQHYCCDChipInfo")    &&
+    load(fns->BeginQHYCCDLive,      "BeginQHYCCDLive")      &&
+    load(fns->GetQHYCCDLiveFrame,   "GetQHYCCDLiveFrame")   &&
+    load(fns->StopQHYCCDLive,       "StopQHYCCDLive");
 }
 
-bool LoadQHYCCDLibrary(QHYCCDFunctions *fns, const wchar_t *dllPath) {
+bool LoadQHYCCDLibrary(QHYCCDFunctions *fns, const char *libraryPath, std::string *error) {
   if (!fns) {
     return false;
   }
   std::memset(fns, 0, sizeof(*fns));
 
-  HMODULE dll = LoadLibraryW(dllPath ? dllPath : L"qhyccd.dll");
-  if (!dll) {
+  const char *path = (libraryPath && libraryPath[0]) ? libraryPath : QHYCCD_LIBRARY_NAME;
+  void *library = OpenDynamicLibrary(path);
+  if (!library) {
+    if (error) {
+      *error = std::string("Failed to load ") + path + ": " + DynamicLibraryError();
+    }
     return false;
   }
 
-  fns->dll = dll;
-  if (!LoadFunctionPointers(fns)) {
-    FreeLibrary(dll);
+  fns->library = library;
+  const char *missing = "";
+  if (!LoadFunctionPointers(fns, &missing)) {
+    if (error) {
+      *error = std::string("Missing QHYCCD function ") + missing + " in " + path;
+    }
+    CloseDynamicLibrary(library);
     std::memset(fns, 0, sizeof(*fns));
     return false;
   }
@@ -54,9 +73,9 @@ void UnloadQHYCCDLibrary(QHYCCDFunctions *fns) {
   if (!fns) {
     return;
   }
-  if (fns->dll) {
-    FreeLibrary(fns->dll);
-    fns->dll = nullptr;
+  if (fns->library) {
+    CloseDynamicLibrary(fns->library);
+    fns->library = nullptr;
   }
   std::memset(fns, 0, sizeof(*fns));
 }
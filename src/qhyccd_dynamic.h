@@ -1,12 +1,19 @@
 // 动态加载 QHYCCD SDK 的最小封装，只暴露本项目需要的接口。
-// 通过 LoadLibrary/GetProcAddress 调用 qhyccd.dll，避免直接包含 qhyccd.h
+// 通过 dynamic_library.h 加载 qhyccd.dll（Windows）或 libqhyccd.so（Linux），避免直接包含 qhyccd.h
 // 从而绕开 SDK 头文件在 MSVC/C++ 下的各种编译兼容性问题。
 
 #ifndef QHYCCD_DYNAMIC_H
 #define QHYCCD_DYNAMIC_H
 
 #include <stdint.h>
-#include <windows.h>
+#include <string>
+
+// SDK 导出函数的调用约定，与 qhyccdstruct.h 中的 STDCALL 一致
+#ifdef _WIN32
+#define QHY_CALL __stdcall
+#else
+#define QHY_CALL
+#endif
 
 // 与 SDK 中的 typedef 保持一致：typedef void qhyccd_handle;
 typedef void qhyccd_handle;
@@ -15,40 +22,73 @@ typedef void qhyccd_handle;
 static const int QHYCCD_CONTROL_GAIN = 6;     // CONTROL_GAIN
 static const int QHYCCD_CONTROL_OFFSET = 7;   // CONTROL_OFFSET
 static const int QHYCCD_CONTROL_EXPOSURE = 8; // CONTROL_EXPOSURE
+static const int QHYCCD_CONTROL_CURTEMP = 14; // CONTROL_CURTEMP：传感器当前温度（摄氏度）
+static const int QHYCCD_CAM_COLOR = 20;       // CAM_COLOR：彩色相机时 IsQHYCCDControlAvailable 返回 BAYER_ID
 
 struct QHYCCDFunctions {
-  HMODULE dll;
-
-  uint32_t (__stdcall *InitQHYCCDResource)(void);
-  uint32_t (__stdcall *ReleaseQHYCCDResource)(void);
-  uint32_t (__stdcall *ScanQHYCCD)(void);
-  uint32_t (__stdcall *GetQHYCCDId)(uint32_t index, char *id);
-  qhyccd_handle * (__stdcall *OpenQHYCCD)(char *id);
-  uint32_t (__stdcall *CloseQHYCCD)(qhyccd_handle *handle);
-  uint32_t (__stdcall *SetQHYCCDStreamMode)(qhyccd_handle *handle, uint8_t mode);
-  uint32_t (__stdcall *InitQHYCCD)(qhyccd_handle *handle);
-  uint32_t (__stdcall *SetQHYCCDBinMode)(qhyccd_handle *handle, uint32_t wbin, uint32_t hbin);
-  uint32_t (__stdcall *SetQHYCCDResolution)(qhyccd_handle *handle,
+  void *library;
+
+  uint32_t (QHY_CALL *InitQHYCCDResource)(void);
+  uint32_t (QHY_CALL *ReleaseQHYCCDResource)(void);
+  uint32_t (QHY_CALL *ScanQHYCCD)(void);
+  uint32_t (QHY_CALL *GetQHYCCDId)(uint32_t index, char *id);
+  qhyccd_handle * (QHY_CALL *OpenQHYCCD)(char *id);
+  uint32_t (QHY_CALL *CloseQHYCCD)(qhyccd_handle *handle);
+  uint32_t (QHY_CALL *SetQHYCCDStreamMode)(qhyccd_handle *handle, uint8_t mode);
+  uint32_t (QHY_CALL *InitQHYCCD)(qhyccd_handle *handle);
+  uint32_t (QHY_CALL *SetQHYCCDBinMode)(qhyccd_handle *handle, uint32_t wbin, uint32_t hbin);
+  uint32_t (QHY_CALL *SetQHYCCDResolution)(qhyccd_handle *handle,
                                             uint32_t x,
                                             uint32_t y,
                                             uint32_t xsize,
                                             uint32_t ysize);
-  uint32_t (__stdcall *SetQHYCCDParam)(qhyccd_handle *handle, int controlId, double value);
-  uint32_t (__stdcall *ExpQHYCCDSingleFrame)(qhyccd_handle *handle);
-  uint32_t (__stdcall *GetQHYCCDMemLength)(qhyccd_handle *handle);
-  uint32_t (__stdcall *GetQHYCCDSingleFrame)(qhyccd_handle *handle,
+  uint32_t (QHY_CALL *SetQHYCCDParam)(qhyccd_handle *handle, int controlId, double value);
+  double (QHY_CALL *GetQHYCCDParam)(qhyccd_handle *handle, int controlId);
+  uint32_t (QHY_CALL *ExpQHYCCDSingleFrame)(qhyccd_handle *handle);
+  uint32_t (QHY_CALL *GetQHYCCDMemLength)(qhyccd_handle *handle);
+  uint32_t (QHY_CALL *GetQHYCCDSingleFrame)(qhyccd_handle *handle,
                                              uint32_t *w,
                                              uint32_t *h,
                                              uint32_t *bpp,
                                              uint32_t *channels,
                                              uint8_t *imgdata);
+  uint32_t (QHY_CALL *SetQHYCCDBitsMode)(qhyccd_handle *handle, uint32_t bits);
+  uint32_t (QHY_CALL *IsQHYCCDControlAvailable)(qhyccd_handle *handle, int controlId);
+  // 传感器尺寸（mm）、有效像素数与像元尺寸（um），用于确定 ROI 的范围
+  uint32_t (QHY_CALL *GetQHYCCDChipInfo)(qhyccd_handle *handle,
+                                          double *chipw,
+                                          double *chiph,
+                                          uint32_t *imagew,
+                                          uint32_t *imageh,
+                                          double *pixelw,
+                                          double *pixelh,
+                                          uint32_t *bpp);
+
+  // 连续（Live）模式，需先 SetQHYCCDStreamMode(handle, 1) 并重新 InitQHYCCD
+  uint32_t (QHY_CALL *BeginQHYCCDLive)(qhyccd_handle *handle);
+  uint32_t (QHY_CALL *GetQHYCCDLiveFrame)(qhyccd_handle *handle,
+                                           uint32_t *w,
+                                           uint32_t *h,
+                                           uint32_t *bpp,
+                                           uint32_t *channels,
+                                           uint8_t *imgdata);
+  uint32_t (QHY_CALL *StopQHYCCDLive)(qhyccd_handle *handle);
 };
 
-// 加载 qhyccd.dll，并解析本结构体中的全部函数指针。
-// dllPath 为空时默认从系统搜索路径中加载 "qhyccd.dll"。
-bool LoadQHYCCDLibrary(QHYCCDFunctions *fns, const wchar_t *dllPath = L"qhyccd.dll");
+// SDK 库的默认文件名，从系统搜索路径中加载
+#ifdef _WIN32
+#define QHYCCD_LIBRARY_NAME "qhyccd.dll"
+#else
+#define QHYCCD_LIBRARY_NAME "libqhyccd.so"
+#endif
+
+// 加载 SDK 动态库，并解析本结构体中的全部函数指针。
+// libraryPath 为 UTF-8 编码的路径，为空时使用 QHYCCD_LIBRARY_NAME。
+// 失败时 error（若非空）返回原因。
+bool LoadQHYCCDLibrary(QHYCCDFunctions *fns, const char *libraryPath = QHYCCD_LIBRARY_NAME,
+                       std::string *error = nullptr);
 
-// 卸载 DLL，并清空函数指针。
+// 卸载动态库，并清空函数指针。
 void UnloadQHYCCDLibrary(QHYCCDFunctions *fns);
 
 #endif // QHYCCD_DYNAMIC_H
@@ -0,0 +1,778 @@
+// QHYCCD SDK 模拟器：导出与 qhyccd.dll 同名的函数，可替代真实 SDK 被 LoadQHYCCDLibrary 加载，
+// 用于在没有相机的机器上测试 / 压测整条采集链路（帧率、延迟、内存）。
+//
+// 生成的图像为带噪声的模拟星场：天光背景 + 暗电流 + 热像素 + 高斯 PSF 星点，
+// 再叠加散粒噪声与读出噪声，按 ADC 位数量化后左移到 16bit（与 QHY 相机一致）。
+// 支持 ROI / bin、8 / 16bit 传输、单帧与 Live 模式，曝光与读出时间可缩放。
+//
+// 通过环境变量配置（均为可选）：
+//   QHYSIM_CAMERAS       模拟相机数量（默认 1）
+//   QHYSIM_WIDTH/HEIGHT  传感器尺寸（默认 4096 x 2160）
+//   QHYSIM_ADC_BITS      ADC 位数（默认 16，常见 12 / 14）
+//   QHYSIM_BAYER         彩色阵列 RGGB / GRBG / GBRG / BGGR（默认黑白）
+//   QHYSIM_STARS         星点数量（默认 300）
+//   QHYSIM_SEEING        星点 PSF 的 sigma，像素（默认 1.6）
+//   QHYSIM_STAR_FLUX     最亮星的流量，e-/s（默认 200000）
+//   QHYSIM_SKY           天光背景，e-/像素/s（默认 20）
+//   QHYSIM_DARK          暗电流，e-/像素/s（默认 0.05）
+//   QHYSIM_HOT_PIXELS    热像素比例（默认 0.0002）
+//   QHYSIM_READ_NOISE    读出噪声，e-（默认 3）
+//   QHYSIM_EGAIN         gain 为 0 时的系统增益，e-/ADU（默认 1）
+//   QHYSIM_DRIFT         星场漂移速度，像素/s（默认 0）
+//   QHYSIM_SEED          随机种子（默认 1）
+//   QHYSIM_TIME_SCALE    曝光等待时间的缩放系数，0 表示不等待（默认 1）
+//   QHYSIM_READOUT_MS    每帧读出时间，毫秒（默认按 QHYSIM_USB_MBPS 计算）
+//   QHYSIM_USB_MBPS      模拟的传输带宽，MB/s（默认 350）
+//   QHYSIM_TEMP          报告的传感器温度，摄氏度（默认 -10）
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define QHYSIM_EXPORT extern "C" __declspec(dllexport)
+#define QHYSIM_CALL __stdcall
+#else
+#define QHYSIM_EXPORT extern "C" __attribute__((visibility("default")))
+#define QHYSIM_CALL
+#endif
+
+typedef void qhyccd_handle;
+
+static const uint32_t QHYCCD_SUCCESS = 0;
+static const uint32_t QHYCCD_ERROR = 0xFFFFFFFF;
+
+// 控制 ID，值来自 sdk/include/qhyccdstruct.h
+static const int CONTROL_GAIN = 6;
+static const int CONTROL_OFFSET = 7;
+static const int CONTROL_EXPOSURE = 8;
+static const int CONTROL_TRANSFERBIT = 10;
+static const int CONTROL_CURTEMP = 14;
+static const int CAM_COLOR = 20;
+static const int CAM_BIN1X1MODE = 21;
+static const int CAM_BIN4X4MODE = 24;
+
+typedef std::chrono::steady_clock Clock;
+
+static const double kPi = 3.14159265358979323846;
+
+// ---- 配置 ----
+
+static double EnvDouble(const char *name, double def) {
+  const char *v = std::getenv(name);
+  if (v == nullptr || v[0] == '\0') {
+    return def;
+  }
+  char *end = nullptr;
+  double d = std::strtod(v, &end);
+  return end == v ? def : d;
+}
+
+// 与 SDK 的 BAYER_ID 一致：GB = 1, GR = 2, BG = 3, RG = 4；0 表示黑白
+static int EnvBayer() {
+  const char *v = std::getenv("QHYSIM_BAYER");
+  if (v == nullptr) return 0;
+  std::string s(v);
+  for (char &c : s) c = (char)std::toupper((unsigned char)c);
+  if (s == "GBRG") return 1;
+  if (s == "GRBG") return 2;
+  if (s == "BGGR") return 3;
+  if (s == "RGGB") return 4;
+  return 0;
+}
+
+struct SimConfig {
+  uint32_t cameras;
+  uint32_t width;
+  uint32_t height;
+  uint32_t adcBits;
+  int bayer;
+  uint32_t stars;
+  double seeing;
+  double starFlux;
+  double sky;
+  double dark;
+  double hotPixels;
+  double readNoise;
+  double egain;
+  double drift;
+  uint64_t seed;
+  double timeScale;
+  double readoutMs;  // < 0 表示按带宽计算
+  double usbMBps;
+  double temperature;
+
+  static SimConfig FromEnv() {
+    SimConfig c;
+    c.cameras = (uint32_t)std::max(0.0, EnvDouble("QHYSIM_CAMERAS", 1));
+    c.width = (uint32_t)std::max(16.0, EnvDouble("QHYSIM_WIDTH", 4096));
+    c.height = (uint32_t)std::max(16.0, EnvDouble("QHYSIM_HEIGHT", 2160));
+    c.adcBits = (uint32_t)std::min(16.0, std::max(8.0, EnvDouble("QHYSIM_ADC_BITS", 16)));
+    c.bayer = EnvBayer();
+    c.stars = (uint32_t)std::max(0.0, EnvDouble("QHYSIM_STARS", 300));
+    c.seeing = std::max(0.3, EnvDouble("QHYSIM_SEEING", 1.6));
+    c.starFlux = EnvDouble("QHYSIM_STAR_FLUX", 200000.0);
+    c.sky = EnvDouble("QHYSIM_SKY", 20.0);
+    c.dark = EnvDouble("QHYSIM_DARK", 0.05);
+    c.hotPixels = EnvDouble("QHYSIM_HOT_PIXELS", 0.0002);
+    c.readNoise = EnvDouble("QHYSIM_READ_NOISE", 3.0);
+    c.egain = std::max(0.01, EnvDouble("QHYSIM_EGAIN", 1.0));
+    c.drift = EnvDouble("QHYSIM_DRIFT", 0.0);
+    c.seed = (uint64_t)EnvDouble("QHYSIM_SEED", 1);
+    c.timeScale = std::max(0.0, EnvDouble("QHYSIM_TIME_SCALE", 1.0));
+    c.readoutMs = EnvDouble("QHYSIM_READOUT_MS", -1.0);
+    c.usbMBps = std::max(1.0, EnvDouble("QHYSIM_USB_MBPS", 350.0));
+    c.temperature = EnvDouble("QHYSIM_TEMP", -10.0);
+    return c;
+  }
+};
+
+// ---- 随机数 ----
+
+// splitmix64：速度快，足够生成逐像素噪声
+struct FastRng {
+  uint64_t state;
+  explicit FastRng(uint64_t seed) : state(seed) {}
+  uint64_t Next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+  double Uniform() { return (double)(Next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+// 预先生成的标准正态分布样本表，逐像素查表代替 Box-Muller
+static const size_t kGaussTableSize = 1 << 16;
+
+static const std::vector<float> &GaussTable() {
+  static std::vector<float> table = [] {
+    std::vector<float> t(kGaussTableSize);
+    std::mt19937_64 gen(12345);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    for (float &v : t) v = dist(gen);
+    return t;
+  }();
+  return table;
+}
+
+// ---- 星场 ----
+
+struct SimStar {
+  double x;      // 传感器坐标（未 bin）
+  double y;
+  double flux;   // e-/s
+  double color[3];  // R / G / B 相对响应
+};
+
+struct SimCamera {
+  std::mutex mutex;
+  SimConfig config;
+  std::string id;
+  uint32_t index = 0;
+  bool initialized = false;
+  int streamMode = 0;
+  uint32_t binX = 1;
+  uint32_t binY = 1;
+  uint32_t roiX = 0;  // bin 后的坐标，与 SDK 一致
+  uint32_t roiY = 0;
+  uint32_t roiW = 0;
+  uint32_t roiH = 0;
+  uint32_t transferBits = 16;
+  double exposureUs = 1000.0;
+  double gain = 0.0;
+  double offset = 0.0;
+  bool exposed = false;
+  bool live = false;
+  std::atomic<bool> cancel{false};
+  Clock::time_point opened;
+  Clock::time_point nextLiveFrame;
+  uint64_t frameCount = 0;
+
+  std::vector<SimStar> stars;
+  std::vector<uint32_t> hotPixels;  // 传感器像素下标
+  FastRng rng{1};
+
+  // 无噪声的期望信号（e-）与对应的噪声标准差（散粒 + 读出），参数与漂移量不变时复用
+  std::vector<float> signal;
+  std::vector<float> sigma;
+  std::string signalKey;
+};
+
+static std::mutex g_simMutex;
+static bool g_resourceReady = false;
+static SimConfig g_config;
+static std::vector<SimCamera *> g_openCameras;
+
+static bool IsOpenHandle(qhyccd_handle *handle) {
+  std::lock_guard<std::mutex> lock(g_simMutex);
+  return std::find(g_openCameras.begin(), g_openCameras.end(), handle) != g_openCameras.end();
+}
+
+static SimCamera *Cam(qhyccd_handle *handle) {
+  return IsOpenHandle(handle) ? static_cast<SimCamera *>(handle) : nullptr;
+}
+
+static void GenerateField(SimCamera *cam) {
+  const SimConfig &c = cam->config;
+  FastRng rng(c.seed * 1000003ull + cam->index);
+  cam->stars.resize(c.stars);
+  for (SimStar &s : cam->stars) {
+    s.x = rng.Uniform() * c.width;
+    s.y = rng.Uniform() * c.height;
+    // 星等取 0 ~ 8，暗星数量多于亮星
+    double mag = 8.0 * std::sqrt(rng.Uniform());
+    s.flux = c.starFlux * std::pow(10.0, -0.4 * mag);
+    double t = rng.Uniform();  // 色温：0 偏蓝，1 偏红
+    s.color[0] = 0.6 + 0.8 * t;
+    s.color[1] = 1.0;
+    s.color[2] = 1.4 - 0.8 * t;
+  }
+
+  size_t total = (size_t)c.width * c.height;
+  size_t hot = (size_t)(c.hotPixels * (double)total);
+  cam->hotPixels.resize(hot);
+  for (uint32_t &p : cam->hotPixels) {
+    p = (uint32_t)(rng.Next() % total);
+  }
+}
+
+// 彩色阵列中 (x, y) 处像素的颜色通道：0 = R，1 = G，2 = B
+static int BayerChannel(int bayer, uint32_t x, uint32_t y) {
+  static const int patterns[5][4] = {
+      {1, 1, 1, 1},  // 黑白
+      {1, 2, 0, 1},  // GBRG
+      {1, 0, 2, 1},  // GRBG
+      {2, 1, 1, 0},  // BGGR
+      {0, 1, 1, 2},  // RGGB
+  };
+  return patterns[bayer][((y & 1) << 1) | (x & 1)];
+}
+
+// 输出图像尺寸（bin 后）
+static void OutputSize(const SimCamera *cam, uint32_t *w, uint32_t *h) {
+  uint32_t maxW = cam->config.width / cam->binX;
+  uint32_t maxH = cam->config.height / cam->binY;
+  uint32_t x = std::min(cam->roiX, maxW - 1);
+  uint32_t y = std::min(cam->roiY, maxH - 1);
+  *w = std::min(cam->roiW == 0 ? maxW : cam->roiW, maxW - x);
+  *h = std::min(cam->roiH == 0 ? maxH : cam->roiH, maxH - y);
+}
+
+// 计算 ROI 内每个（bin 后）像素的期望电子数
+static void RenderSignal(SimCamera *cam, uint32_t w, uint32_t h) {
+  const SimConfig &c = cam->config;
+  double expSec = cam->exposureUs * 1e-6;
+  double elapsed = std::chrono::duration<double>(Clock::now() - cam->opened).count();
+  double dx = c.drift * elapsed;
+  double dy = c.drift * elapsed * 0.5;
+
+  char key[160];
+  std::snprintf(key, sizeof(key), "%u,%u,%u,%u,%u,%u,%.3f,%.2f,%.2f",
+                cam->roiX, cam->roiY, w, h, cam->binX, cam->binY, expSec, dx, dy);
+  if (cam->signalKey == key && cam->signal.size() == (size_t)w * h) {
+    return;
+  }
+  cam->signalKey = key;
+
+  uint32_t bx = cam->binX;
+  uint32_t by = cam->binY;
+  bool mosaic = c.bayer != 0 && bx == 1 && by == 1;
+  double binArea = (double)bx * by;
+  // 传感器坐标原点（未 bin）
+  double x0 = (double)cam->roiX * bx;
+  double y0 = (double)cam->roiY * by;
+
+  cam->signal.assign((size_t)w * h, (float)((c.sky + c.dark) * expSec * binArea));
+  float *sig = cam->signal.data();
+
+  if (mosaic) {
+    // 天光偏蓝，按通道略作区分
+    static const double skyColor[3] = {0.8, 1.0, 1.2};
+    for (uint32_t y = 0; y < h; y++) {
+      for (uint32_t x = 0; x < w; x++) {
+        int ch = BayerChannel(c.bayer, (uint32_t)x0 + x, (uint32_t)y0 + y);
+        sig[(size_t)y * w + x] = (float)((c.sky * skyColor[ch] + c.dark) * expSec);
+      }
+    }
+  }
+
+  // 星点：bin 后的高斯 PSF，x / y 方向可分离
+  double sx = c.seeing / bx;
+  double sy = c.seeing / by;
+  int rx = (int)std::ceil(4.0 * sx);
+  int ry = (int)std::ceil(4.0 * sy);
+  std::vector<double> gx(2 * rx + 1);
+  std::vector<double> gy(2 * ry + 1);
+  for (const SimStar &s : cam->stars) {
+    double px = (s.x + dx - x0) / bx - 0.5;
+    double py = (s.y + dy - y0) / by - 0.5;
+    int cx = (int)std::floor(px + 0.5);
+    int cy = (int)std::floor(py + 0.5);
+    if (cx + rx < 0 || cy + ry < 0 || cx - rx >= (int)w || cy - ry >= (int)h) {
+      continue;
+    }
+    for (int i = -rx; i <= rx; i++) {
+      double d = (cx + i - px) / sx;
+      gx[i + rx] = std::exp(-0.5 * d * d);
+    }
+    for (int j = -ry; j <= ry; j++) {
+      double d = (cy + j - py) / sy;
+      gy[j + ry] = std::exp(-0.5 * d * d);
+    }
+    double amp = s.flux * expSec / (2.0 * kPi * sx * sy);
+    for (int j = -ry; j <= ry; j++) {
+      int y = cy + j;
+      if (y < 0 || y >= (int)h) continue;
+      for (int i = -rx; i <= rx; i++) {
+        int x = cx + i;
+        if (x < 0 || x >= (int)w) continue;
+        double v = amp * gx[i + rx] * gy[j + ry];
+        if (mosaic) {
+          v *= s.color[BayerChannel(c.bayer, (uint32_t)x0 + x, (uint32_t)y0 + y)];
+        }
+        sig[(size_t)y * w + x] += (float)v;
+      }
+    }
+  }
+
+  // 热像素：暗电流约为普通像素的 2000 倍
+  for (uint32_t p : cam->hotPixels) {
+    double sxp = (double)(p % c.width) - x0;
+    double syp = (double)(p / c.width) - y0;
+    if (sxp < 0 || syp < 0) continue;
+    uint32_t x = (uint32_t)sxp / bx;
+    uint32_t y = (uint32_t)syp / by;
+    if (x < w && y < h) {
+      sig[(size_t)y * w + x] += (float)(c.dark * 2000.0 * expSec + 50.0);
+    }
+  }
+
+  // 散粒噪声用正态近似泊松分布，与读出噪声合成一个标准差
+  float readVar = (float)(c.readNoise * c.readNoise);
+  cam->sigma.resize(cam->signal.size());
+  for (size_t i = 0; i < cam->signal.size(); i++) {
+    cam->sigma[i] = std::sqrt(sig[i] + readVar);
+  }
+}
+
+// 期望信号加上噪声并量化为 ADU。ADU 先左移 16 - adcBits 位对齐到 16bit 的高位，
+// 再按输出像素类型 T 右移（8bit 输出取高 8 位）。
+template <typename T>
+static void AddNoise(const float *sig, const float *sigma, size_t n, float aduPerE, float bias,
+                     uint32_t adcBits, FastRng *rngState, T *out) {
+  const int adcMax = (int)((1u << adcBits) - 1u);
+  const uint32_t leftShift = 16 - adcBits;
+  const uint32_t rightShift = 16 - 8 * (uint32_t)sizeof(T);
+  // 所有状态都放在局部变量中，避免写输出缓冲区时与之别名而反复读内存
+  const float *gauss = GaussTable().data();
+  const size_t mask = kGaussTableSize - 1;
+  FastRng rng = *rngState;
+  uint64_t r = 0;
+  for (size_t i = 0; i < n; i++) {
+    // 一个 64 位随机数提供 4 个像素的噪声样本
+    if ((i & 3) == 0) {
+      r = rng.Next();
+    }
+    float g = gauss[(r >> ((i & 3) * 16)) & mask];
+    float adu = (sig[i] + sigma[i] * g) * aduPerE + bias;
+    // 先转成整数再截断：偏置为 0 时约一半像素为负，浮点比较会被编译成分支而频繁预测失败
+    int v = (int)(adu + 0.5f);
+    v = v < 0 ? 0 : v;
+    v = v > adcMax ? adcMax : v;
+    out[i] = (T)(((uint32_t)v << leftShift) >> rightShift);
+  }
+  *rngState = rng;
+}
+
+// 期望信号 + 散粒噪声 + 读出噪声 -> ADU，写入输出缓冲区
+static void RenderFrame(SimCamera *cam, uint8_t *out, uint32_t *w, uint32_t *h,
+                        uint32_t *bpp, uint32_t *channels) {
+  const SimConfig &c = cam->config;
+  uint32_t fw = 0;
+  uint32_t fh = 0;
+  OutputSize(cam, &fw, &fh);
+  RenderSignal(cam, fw, fh);
+
+  const float *sig = cam->signal.data();
+  const float *sigma = cam->sigma.data();
+  // gain 每增加 100，系统增益放大 10 倍
+  float aduPerE = (float)(std::pow(10.0, cam->gain / 100.0) / c.egain);
+  float bias = (float)cam->offset;
+  size_t n = (size_t)fw * fh;
+  bool eightBit = cam->transferBits == 8;
+  if (eightBit) {
+    AddNoise(sig, sigma, n, aduPerE, bias, c.adcBits, &cam->rng, out);
+  } else {
+    AddNoise(sig, sigma, n, aduPerE, bias, c.adcBits, &cam->rng, reinterpret_cast<uint16_t *>(out));
+  }
+
+  *w = fw;
+  *h = fh;
+  *bpp = eightBit ? 8 : 16;
+  *channels = 1;
+  cam->frameCount++;
+}
+
+static double ReadoutSeconds(const SimCamera *cam) {
+  if (cam->config.readoutMs >= 0.0) {
+    return cam->config.readoutMs * 1e-3;
+  }
+  uint32_t w = 0;
+  uint32_t h = 0;
+  OutputSize(cam, &w, &h);
+  double bytes = (double)w * h * (cam->transferBits == 8 ? 1 : 2);
+  return bytes / (cam->config.usbMBps * 1e6);
+}
+
+static double ExposureSeconds(const SimCamera *cam) {
+  return cam->exposureUs * 1e-6 * cam->config.timeScale;
+}
+
+// Live 模式的帧周期：曝光与读出取较长者
+static Clock::duration LivePeriod(const SimCamera *cam) {
+  double period = std::max(ExposureSeconds(cam), ReadoutSeconds(cam));
+  return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+}
+
+// 分段等待，期间可被 CancelQHYCCDExposingAndReadout 打断；被打断时返回 false
+static bool SleepCancellable(SimCamera *cam, double seconds) {
+  Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double>(seconds));
+  while (Clock::now() < end) {
+    if (cam->cancel.load()) {
+      return false;
+    }
+    auto remaining = end - Clock::now();
+    std::this_thread::sleep_for(std::min<Clock::duration>(remaining, std::chrono::milliseconds(10)));
+  }
+  return !cam->cancel.load();
+}
+
+// ---- 导出函数 ----
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL InitQHYCCDResource(void) {
+  std::lock_guard<std::mutex> lock(g_simMutex);
+  g_config = SimConfig::FromEnv();
+  g_resourceReady = true;
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL ReleaseQHYCCDResource(void) {
+  std::lock_guard<std::mutex> lock(g_simMutex);
+  g_resourceReady = false;
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL ScanQHYCCD(void) {
+  std::lock_guard<std::mutex> lock(g_simMutex);
+  return g_resourceReady ? g_config.cameras : 0;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL GetQHYCCDId(uint32_t index, char *id) {
+  std::lock_guard<std::mutex> lock(g_simMutex);
+  if (!g_resourceReady || index >= g_config.cameras || id == nullptr) {
+    return QHYCCD_ERROR;
+  }
+  std::snprintf(id, 32, "QHYSIM-%u", index);
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT qhyccd_handle *QHYSIM_CALL OpenQHYCCD(char *id) {
+  std::lock_guard<std::mutex> lock(g_simMutex);
+  unsigned index = 0;
+  if (!g_resourceReady || id == nullptr || std::sscanf(id, "QHYSIM-%u", &index) != 1 ||
+      index >= g_config.cameras) {
+    return nullptr;
+  }
+  for (SimCamera *open : g_openCameras) {
+    if (open->index == index) {
+      return nullptr;  // 与真实 SDK 一致，同一台相机不能重复打开
+    }
+  }
+
+  SimCamera *cam = new SimCamera();
+  cam->config = g_config;
+  cam->id = id;
+  cam->index = index;
+  cam->opened = Clock::now();
+  cam->rng = FastRng(g_config.seed ^ ((uint64_t)index << 32) ^ 0x5DEECE66Dull);
+  GenerateField(cam);
+  g_openCameras.push_back(cam);
+  return cam;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL CloseQHYCCD(qhyccd_handle *handle) {
+  SimCamera *cam = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(g_simMutex);
+    auto it = std::find(g_openCameras.begin(), g_openCameras.end(), handle);
+    if (it == g_openCameras.end()) {
+      return QHYCCD_ERROR;
+    }
+    cam = *it;
+    g_openCameras.erase(it);
+  }
+  cam->cancel = true;
+  { std::lock_guard<std::mutex> lock(cam->mutex); }
+  delete cam;
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL SetQHYCCDStreamMode(qhyccd_handle *handle, uint8_t mode) {
+  SimCamera *cam = Cam(handle);
+  if (!cam || mode > 1) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  cam->streamMode = mode;
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL InitQHYCCD(qhyccd_handle *handle) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  // 与真实 SDK 一致：InitQHYCCD 恢复默认参数
+  cam->initialized = true;
+  cam->binX = 1;
+  cam->binY = 1;
+  cam->roiX = 0;
+  cam->roiY = 0;
+  cam->roiW = cam->config.width;
+  cam->roiH = cam->config.height;
+  cam->transferBits = cam->streamMode == 1 ? 8 : 16;
+  cam->exposed = false;
+  cam->live = false;
+  cam->signalKey.clear();
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL SetQHYCCDBinMode(qhyccd_handle *handle, uint32_t wbin, uint32_t hbin) {
+  SimCamera *cam = Cam(handle);
+  if (!cam || wbin < 1 || hbin < 1 || wbin > 4 || hbin > 4) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  cam->binX = wbin;
+  cam->binY = hbin;
+  cam->roiX = 0;
+  cam->roiY = 0;
+  cam->roiW = cam->config.width / wbin;
+  cam->roiH = cam->config.height / hbin;
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL SetQHYCCDResolution(qhyccd_handle *handle, uint32_t x, uint32_t y,
+                                                       uint32_t xsize, uint32_t ysize) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  uint32_t maxW = cam->config.width / cam->binX;
+  uint32_t maxH = cam->config.height / cam->binY;
+  if (xsize == 0 || ysize == 0 || x >= maxW || y >= maxH) {
+    return QHYCCD_ERROR;
+  }
+  // 超出传感器范围的部分被裁掉
+  cam->roiX = x;
+  cam->roiY = y;
+  cam->roiW = std::min(xsize, maxW - x);
+  cam->roiH = std::min(ysize, maxH - y);
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL SetQHYCCDParam(qhyccd_handle *handle, int controlId, double value) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  switch (controlId) {
+    case CONTROL_EXPOSURE:
+      cam->exposureUs = std::max(1.0, value);
+      return QHYCCD_SUCCESS;
+    case CONTROL_GAIN:
+      cam->gain = std::min(100.0, std::max(0.0, value));
+      return QHYCCD_SUCCESS;
+    case CONTROL_OFFSET:
+      cam->offset = std::min(255.0, std::max(0.0, value));
+      return QHYCCD_SUCCESS;
+    case CONTROL_TRANSFERBIT:
+      if (value != 8.0 && value != 16.0) return QHYCCD_ERROR;
+      cam->transferBits = (uint32_t)value;
+      return QHYCCD_SUCCESS;
+    default:
+      return QHYCCD_ERROR;
+  }
+}
+
+QHYSIM_EXPORT double QHYSIM_CALL GetQHYCCDParam(qhyccd_handle *handle, int controlId) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return (double)QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  switch (controlId) {
+    case CONTROL_EXPOSURE: return cam->exposureUs;
+    case CONTROL_GAIN: return cam->gain;
+    case CONTROL_OFFSET: return cam->offset;
+    case CONTROL_TRANSFERBIT: return (double)cam->transferBits;
+    case CONTROL_CURTEMP: return cam->config.temperature;
+    default: return (double)QHYCCD_ERROR;
+  }
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL GetQHYCCDParamMinMaxStep(qhyccd_handle *handle, int controlId,
+                                                            double *min, double *max, double *step) {
+  SimCamera *cam = Cam(handle);
+  if (!cam || !min || !max || !step) return QHYCCD_ERROR;
+  switch (controlId) {
+    case CONTROL_EXPOSURE: *min = 1.0; *max = 3600.0 * 1e6; *step = 1.0; return QHYCCD_SUCCESS;
+    case CONTROL_GAIN: *min = 0.0; *max = 100.0; *step = 1.0; return QHYCCD_SUCCESS;
+    case CONTROL_OFFSET: *min = 0.0; *max = 255.0; *step = 1.0; return QHYCCD_SUCCESS;
+    case CONTROL_TRANSFERBIT: *min = 8.0; *max = 16.0; *step = 8.0; return QHYCCD_SUCCESS;
+    default: return QHYCCD_ERROR;
+  }
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL IsQHYCCDControlAvailable(qhyccd_handle *handle, int controlId) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  switch (controlId) {
+    case CONTROL_EXPOSURE:
+    case CONTROL_GAIN:
+    case CONTROL_OFFSET:
+    case CONTROL_TRANSFERBIT:
+    case CONTROL_CURTEMP:
+      return QHYCCD_SUCCESS;
+    case CAM_COLOR:
+      // 彩色相机返回 BAYER_ID
+      return cam->config.bayer != 0 ? (uint32_t)cam->config.bayer : QHYCCD_ERROR;
+    default:
+      if (controlId >= CAM_BIN1X1MODE && controlId <= CAM_BIN4X4MODE) {
+        return QHYCCD_SUCCESS;
+      }
+      return QHYCCD_ERROR;
+  }
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL GetQHYCCDChipInfo(qhyccd_handle *handle, double *chipw, double *chiph,
+                                                     uint32_t *imagew, uint32_t *imageh,
+                                                     double *pixelw, double *pixelh, uint32_t *bpp) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  const double pixelUm = 3.76;
+  if (chipw) *chipw = cam->config.width * pixelUm / 1000.0;
+  if (chiph) *chiph = cam->config.height * pixelUm / 1000.0;
+  if (imagew) *imagew = cam->config.width;
+  if (imageh) *imageh = cam->config.height;
+  if (pixelw) *pixelw = pixelUm;
+  if (pixelh) *pixelh = pixelUm;
+  if (bpp) *bpp = 16;
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL GetQHYCCDEffectiveArea(qhyccd_handle *handle, uint32_t *startX,
+                                                          uint32_t *startY, uint32_t *sizeX,
+                                                          uint32_t *sizeY) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  if (startX) *startX = 0;
+  if (startY) *startY = 0;
+  if (sizeX) *sizeX = cam->config.width;
+  if (sizeY) *sizeY = cam->config.height;
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL GetQHYCCDMemLength(qhyccd_handle *handle) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return 0;
+  // 与真实 SDK 一样按全幅 16bit 计算，与当前 ROI 无关
+  return cam->config.width * cam->config.height * 2;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL SetQHYCCDBitsMode(qhyccd_handle *handle, uint32_t bits) {
+  return SetQHYCCDParam(handle, CONTROL_TRANSFERBIT, (double)bits);
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL ExpQHYCCDSingleFrame(qhyccd_handle *handle) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  if (!cam->initialized || cam->streamMode != 0) return QHYCCD_ERROR;
+  cam->cancel = false;
+  // 真实 SDK 在曝光结束前阻塞
+  if (!SleepCancellable(cam, ExposureSeconds(cam))) {
+    return QHYCCD_ERROR;
+  }
+  cam->exposed = true;
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL GetQHYCCDSingleFrame(qhyccd_handle *handle, uint32_t *w, uint32_t *h,
+                                                        uint32_t *bpp, uint32_t *channels,
+                                                        uint8_t *imgdata) {
+  SimCamera *cam = Cam(handle);
+  if (!cam || !imgdata) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  if (!cam->exposed) return QHYCCD_ERROR;
+  cam->exposed = false;
+  // 生成图像的耗时计入读出时间
+  Clock::time_point start = Clock::now();
+  RenderFrame(cam, imgdata, w, h, bpp, channels);
+  double rendered = std::chrono::duration<double>(Clock::now() - start).count();
+  if (!SleepCancellable(cam, ReadoutSeconds(cam) - rendered)) {
+    return QHYCCD_ERROR;
+  }
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL CancelQHYCCDExposingAndReadout(qhyccd_handle *handle) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  // 不加锁：曝光 / 读出期间 mutex 被占用
+  cam->cancel = true;
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL BeginQHYCCDLive(qhyccd_handle *handle) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  if (!cam->initialized || cam->streamMode != 1) return QHYCCD_ERROR;
+  cam->live = true;
+  cam->nextLiveFrame = Clock::now() + LivePeriod(cam);
+  return QHYCCD_SUCCESS;
+}
+
+// 非阻塞：距离上一帧不足一个帧周期时返回 QHYCCD_ERROR
+QHYSIM_EXPORT uint32_t QHYSIM_CALL GetQHYCCDLiveFrame(qhyccd_handle *handle, uint32_t *w, uint32_t *h,
+                                                      uint32_t *bpp, uint32_t *channels,
+                                                      uint8_t *imgdata) {
+  SimCamera *cam = Cam(handle);
+  if (!cam || !imgdata) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  if (!cam->live) return QHYCCD_ERROR;
+
+  Clock::duration periodDur = LivePeriod(cam);
+  Clock::time_point now = Clock::now();
+  if (now < cam->nextLiveFrame) {
+    return QHYCCD_ERROR;
+  }
+  // 调用方取帧过慢时相机只保留最新一帧，中间的帧被丢弃
+  cam->nextLiveFrame = now - cam->nextLiveFrame > periodDur ? now + periodDur
+                                                            : cam->nextLiveFrame + periodDur;
+  RenderFrame(cam, imgdata, w, h, bpp, channels);
+  return QHYCCD_SUCCESS;
+}
+
+QHYSIM_EXPORT uint32_t QHYSIM_CALL StopQHYCCDLive(qhyccd_handle *handle) {
+  SimCamera *cam = Cam(handle);
+  if (!cam) return QHYCCD_ERROR;
+  std::lock_guard<std::mutex> lock(cam->mutex);
+  cam->live = false;
+  return QHYCCD_SUCCESS;
+}
@@ -0,0 +1,422 @@
+#include "ser_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#include "frame_trace.h"
+#include "image_debayer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// SER 的 ColorID
+const uint32_t kSerMono = 0;
+const uint32_t kSerBayerRggb = 8;
+const uint32_t kSerBayerGrbg = 9;
+const uint32_t kSerBayerGbrg = 10;
+const uint32_t kSerBayerBggr = 11;
+
+// SER 的时间为公元 1 年 1 月 1 日起的 100ns 数，这是 Unix 纪元对应的值
+const int64_t kSerUnixEpochTicks = 621355968000000000LL;
+
+uint32_t SerColorId(uint32_t bayer) {
+  switch ((BayerPattern)bayer) {
+    case BAYER_RGGB: return kSerBayerRggb;
+    case BAYER_GRBG: return kSerBayerGrbg;
+    case BAYER_GBRG: return kSerBayerGbrg;
+    case BAYER_BGGR: return kSerBayerBggr;
+    default: return kSerMono;
+  }
+}
+
+int64_t SerTicks(int64_t utcUs) {
+  return kSerUnixEpochTicks + utcUs * 10;
+}
+
+// 本地时间相对 UTC 的偏移（微秒），用于文件头的 DateTime 字段
+int64_t LocalOffsetUs(int64_t utcUs) {
+  std::time_t t = (std::time_t)(utcUs / 1000000);
+  std::tm g;
+#ifdef _WIN32
+  gmtime_s(&g, &t);
+#else
+  gmtime_r(&t, &g);
+#endif
+  g.tm_isdst = -1;
+  return (int64_t)(t - std::mktime(&g)) * 1000000;
+}
+
+void PutU32(uint8_t *p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+void PutI64(uint8_t *p, int64_t v) {
+  for (int i = 0; i < 8; i++) p[i] = (uint8_t)((uint64_t)v >> (8 * i));
+}
+
+void PutText(uint8_t *p, const std::string &text, size_t size) {
+  std::memset(p, 0, size);
+  std::memcpy(p, text.data(), std::min(text.size(), size));
+}
+
+}  // namespace
+
+// 按偏移写入、预分配与截断的最小文件封装
+class SerWriter::File {
+ public:
+  ~File() { Close(); }
+
+  bool Open(const char *path) {
+#ifdef _WIN32
+    // 宽字符版本，支持中文等非 ASCII 路径
+    int len = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+    if (len <= 0) {
+      return false;
+    }
+    std::vector<wchar_t> wide(len);
+    MultiByteToWideChar(CP_UTF8, 0, path, -1, wide.data(), len);
+    handle_ = CreateFileW(wide.data(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    return handle_ != INVALID_HANDLE_VALUE;
+#else
+    fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    return fd_ >= 0;
+#endif
+  }
+
+  bool WriteAt(uint64_t offset, const uint8_t *data, size_t size) {
+#ifdef _WIN32
+    while (size > 0) {
+      OVERLAPPED ov = {};
+      ov.Offset = (DWORD)offset;
+      ov.OffsetHigh = (DWORD)(offset >> 32);
+      DWORD chunk = (DWORD)std::min<size_t>(size, 1u << 30);
+      DWORD written = 0;
+      if (!WriteFile(handle_, data, chunk, &written, &ov) || written == 0) {
+        return false;
+      }
+      data += written;
+      offset += written;
+      size -= written;
+    }
+    return true;
+#else
+    while (size > 0) {
+      ssize_t n = ::pwrite(fd_, data, size, (off_t)offset);
+      if (n <= 0) {
+        return false;
+      }
+      data += n;
+      offset += (uint64_t)n;
+      size -= (size_t)n;
+    }
+    return true;
+#endif
+  }
+
+  // 把文件扩展到 size 字节并尽量让文件系统一次分配好空间
+  bool Preallocate(uint64_t size) {
+#ifdef _WIN32
+    LARGE_INTEGER pos;
+    pos.QuadPart = (LONGLONG)size;
+    return SetFilePointerEx(handle_, pos, NULL, FILE_BEGIN) && SetEndOfFile(handle_);
+#elif defined(__linux__)
+    return ::posix_fallocate(fd_, 0, (off_t)size) == 0 || ::ftruncate(fd_, (off_t)size) == 0;
+#else
+    return ::ftruncate(fd_, (off_t)size) == 0;
+#endif
+  }
+
+  bool Truncate(uint64_t size) {
+#ifdef _WIN32
+    return Preallocate(size);
+#else
+    return ::ftruncate(fd_, (off_t)size) == 0;
+#endif
+  }
+
+  bool Close() {
+    bool ok = true;
+#ifdef _WIN32
+    if (handle_ != INVALID_HANDLE_VALUE) {
+      ok = CloseHandle(handle_) != 0;
+      handle_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fd_ >= 0) {
+      ok = ::close(fd_) == 0;
+      fd_ = -1;
+    }
+#endif
+    return ok;
+  }
+
+ private:
+#ifdef _WIN32
+  HANDLE handle_ = INVALID_HANDLE_VALUE;
+#else
+  int fd_ = -1;
+#endif
+};
+
+SerWriter::SerWriter() {
+  thread_ = std::thread(&SerWriter::Run, this);
+}
+
+SerWriter::~SerWriter() {
+  Stop();
+  Flush();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  jobReady_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool SerWriter::Start(const std::string &path, size_t ringSize, const std::string &instrument,
+                      const std::string &observer, const std::string &telescope, std::string *error) {
+  Stop();
+  Flush();
+
+  File *file = new File();
+  if (!file->Open(path.c_str())) {
+    delete file;
+    *error = "Failed to create " + path;
+    return false;
+  }
+  file->Preallocate(kSerPreallocateBytes);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  file_ = file;
+  fileOffset_ = kSerHeaderSize;
+  allocated_ = kSerPreallocateBytes;
+  timestamps_.clear();
+  firstUtcUs_ = 0;
+  path_ = path;
+  instrument_ = instrument;
+  observer_ = observer;
+  telescope_ = telescope;
+  ringSize_ = std::max<size_t>(ringSize, 2);
+  formatKnown_ = false;
+  frames_ = 0;
+  dropped_ = 0;
+  bytesWritten_ = 0;
+  startUs_ = TraceNowUs();
+  stopUs_ = 0;
+  lastError_.clear();
+  recording_ = true;
+  return true;
+}
+
+void SerWriter::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!recording_) {
+      return;
+    }
+    recording_ = false;
+    finishPending_ = true;
+    stopUs_ = TraceNowUs();
+  }
+  jobReady_.notify_one();
+}
+
+bool SerWriter::IsRecording() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return recording_;
+}
+
+bool SerWriter::Enqueue(const FrameInfo &frame, const uint8_t *data) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!recording_) {
+    return false;
+  }
+  const uint32_t bytesPerPixel = frame.bpp > 8 ? 2 : 1;
+  const size_t bytes = (size_t)frame.width * frame.height * bytesPerPixel;
+  if (frame.channels > 1 || bytes == 0 || frame.bytes < bytes) {
+    dropped_++;
+    return false;
+  }
+  if (!formatKnown_) {
+    width_ = frame.width;
+    height_ = frame.height;
+    bytesPerPixel_ = bytesPerPixel;
+    colorId_ = SerColorId(frame.bayer);
+    formatKnown_ = true;
+    // 首帧时一次性分配整个环，之后取帧线程中不再分配内存
+    buffers_.SetMaxSlots(ringSize_);
+    if (!buffers_.Reserve(bytes, ringSize_)) {
+      lastError_ = "Failed to allocate SER ring buffers";
+    }
+  } else if (frame.width != width_ || frame.height != height_ || bytesPerPixel != bytesPerPixel_) {
+    // SER 要求所有帧尺寸相同，录制中改变 ROI / bin 后的帧只能丢弃
+    dropped_++;
+    lastError_ = "Frame size changed during SER recording";
+    return false;
+  }
+
+  FrameLease pixels = buffers_.TryAcquire();
+  if (!pixels) {
+    dropped_++;
+    return false;
+  }
+  copying_++;
+  lock.unlock();
+
+  {
+    TraceScope trace("native.ser-enqueue", frame.frameId);
+    std::memcpy(pixels->data, data, bytes);
+  }
+
+  lock.lock();
+  queue_.push_back(Job{pixels, bytes, frame.startUtcUs, frame.frameId});
+  copying_--;
+  lock.unlock();
+  jobReady_.notify_one();
+  return true;
+}
+
+void SerWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  finished_.wait(lock, [this] { return !finishPending_ && queue_.empty(); });
+}
+
+SerWriterStats SerWriter::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SerWriterStats stats;
+  stats.recording = recording_;
+  stats.queued = queue_.size();
+  stats.ringSize = ringSize_;
+  stats.frames = frames_;
+  stats.dropped = dropped_;
+  stats.bytesWritten = bytesWritten_;
+  const double seconds = ((recording_ ? TraceNowUs() : stopUs_) - startUs_) / 1e6;
+  if (startUs_ > 0 && seconds > 0.0) {
+    stats.bytesPerSec = bytesWritten_ / seconds;
+    stats.fps = frames_ / seconds;
+  }
+  stats.path = path_;
+  stats.lastError = lastError_;
+  return stats;
+}
+
+bool SerWriter::WriteFrame(const Job &job) {
+  if (!file_) {
+    return false;
+  }
+  // 写到预分配区域的末尾时再扩展一段
+  if (fileOffset_ + job.bytes > allocated_) {
+    allocated_ = std::max(allocated_ + kSerPreallocateBytes, fileOffset_ + job.bytes);
+    file_->Preallocate(allocated_);
+  }
+  if (!file_->WriteAt(fileOffset_, job.pixels->data, job.bytes)) {
+    return false;
+  }
+  fileOffset_ += job.bytes;
+  if (timestamps_.empty()) {
+    firstUtcUs_ = job.utcUs;
+  }
+  timestamps_.push_back(SerTicks(job.utcUs));
+  return true;
+}
+
+// 写入帧数、时间戳 trailer，截去多余的预分配空间并关闭文件
+bool SerWriter::Finish() {
+  if (!file_) {
+    return true;
+  }
+  std::string instrument, observer, telescope;
+  uint32_t width, height, bytesPerPixel, colorId;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    instrument = instrument_;
+    observer = observer_;
+    telescope = telescope_;
+    width = width_;
+    height = height_;
+    bytesPerPixel = bytesPerPixel_;
+    colorId = colorId_;
+  }
+
+  uint8_t header[kSerHeaderSize];
+  std::memset(header, 0, sizeof(header));
+  std::memcpy(header, "LUCAM-RECORDER", 14);
+  PutU32(header + 14, 0);  // LuID
+  PutU32(header + 18, colorId);
+  PutU32(header + 22, 0);  // LittleEndian：见文件头说明
+  PutU32(header + 26, width);
+  PutU32(header + 30, height);
+  PutU32(header + 34, bytesPerPixel * 8);
+  PutU32(header + 38, (uint32_t)timestamps_.size());
+  PutText(header + 42, observer, 40);
+  PutText(header + 82, instrument, 40);
+  PutText(header + 122, telescope, 40);
+  const int64_t utcUs = timestamps_.empty() ? 0 : firstUtcUs_;
+  PutI64(header + 162, timestamps_.empty() ? 0 : SerTicks(utcUs + LocalOffsetUs(utcUs)));
+  PutI64(header + 170, timestamps_.empty() ? 0 : SerTicks(utcUs));
+
+  std::vector<uint8_t> trailer(timestamps_.size() * 8);
+  for (size_t i = 0; i < timestamps_.size(); i++) {
+    PutI64(trailer.data() + 8 * i, timestamps_[i]);
+  }
+
+  bool ok = file_->WriteAt(0, header, sizeof(header)) &&
+            (trailer.empty() || file_->WriteAt(fileOffset_, trailer.data(), trailer.size())) &&
+            file_->Truncate(fileOffset_ + trailer.size());
+  ok = file_->Close() && ok;
+  delete file_;
+  file_ = nullptr;
+  timestamps_.clear();
+  return ok;
+}
+
+void SerWriter::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    // 正在拷贝的帧入队之后才能完成文件
+    jobReady_.wait(lock, [this] { return !queue_.empty() || (finishPending_ && copying_ == 0) || stopping_; });
+    if (!queue_.empty()) {
+      Job job = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      const int64_t start = TraceNowUs();
+      bool ok = WriteFrame(job);
+      RecordTrace("native.ser-write", job.frameId, start, TraceNowUs());
+      job.pixels.reset();
+      lock.lock();
+      if (ok) {
+        frames_++;
+        bytesWritten_ += job.bytes;
+      } else {
+        dropped_++;
+        lastError_ = "Failed to write " + path_;
+      }
+      continue;
+    }
+    if (finishPending_ && copying_ == 0) {
+      lock.unlock();
+      bool ok = Finish();
+      lock.lock();
+      if (!ok) {
+        lastError_ = "Failed to finalize " + path_;
+      }
+      finishPending_ = false;
+      finished_.notify_all();
+      continue;
+    }
+    if (stopping_) {
+      break;
+    }
+  }
+}
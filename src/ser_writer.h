@@ -0,0 +1,122 @@
+// SER 序列录制：行星 / 幸运成像时把 Live 帧连续追加到同一个 .ser 文件中，
+// 末尾的 trailer 保存每一帧的 UTC 时间戳。小 ROI 的 Live 可以超过 100 fps，逐帧一个文件跟不上。
+//
+// 取帧线程只把像素拷贝进环形缓冲池（FramePool，首帧时按帧大小一次性分配 ringSize 块），
+// 由写盘线程按顺序追加到文件。缓冲区都在排队时直接丢弃该帧并计数——高帧率录制宁可丢帧
+// 也不拖慢取帧（与 FitsWriter 队列满时等待不同）。文件按 kSerPreallocateBytes 分段预分配，
+// 结束时写入帧数与时间戳 trailer 并截去多余的预分配空间。
+//
+// 16bit 数据按小端写出（与内存中一致，无需转换），文件头的 LittleEndian 字段按 FireCapture /
+// SharpCap / AutoStakkert 等软件的事实约定写 0。本文件不包含任何 N-API 代码。
+
+#ifndef SER_WRITER_H
+#define SER_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera_session.h"
+#include "frame_pool.h"
+
+static const size_t kSerHeaderSize = 178;
+static const size_t kSerDefaultRing = 16;
+// 每次扩展文件时预分配的字节数
+static const uint64_t kSerPreallocateBytes = 256ull << 20;
+
+struct SerWriterStats {
+  bool recording = false;
+  size_t queued = 0;         // 环形缓冲中等待写盘的帧数
+  size_t ringSize = 0;
+  uint64_t frames = 0;       // 已写入文件的帧数
+  uint64_t dropped = 0;      // 缓冲区用尽或尺寸变化而丢弃的帧数
+  uint64_t bytesWritten = 0;
+  double bytesPerSec = 0.0;  // 录制开始以来的平均写盘速率
+  double fps = 0.0;          // 录制开始以来的平均写入帧率
+  std::string path;
+  std::string lastError;
+};
+
+class SerWriter {
+ public:
+  SerWriter();
+  // 写完队列中剩余的帧并完成文件后结束写盘线程
+  ~SerWriter();
+
+  SerWriter(const SerWriter &) = delete;
+  SerWriter &operator=(const SerWriter &) = delete;
+
+  // 创建 path 并开始录制。上一段录制尚未完成时先等待其写完。
+  // 帧尺寸与格式以第一帧为准，之后尺寸不同的帧被丢弃。失败时 error 返回原因。
+  bool Start(const std::string &path, size_t ringSize, const std::string &instrument,
+             const std::string &observer, const std::string &telescope, std::string *error);
+  // 停止接收新帧，写盘线程写完剩余的帧后完成文件（不等待）
+  void Stop();
+  bool IsRecording() const;
+
+  // 录制中时把一帧放入环形缓冲，可在任意线程中调用，从不等待写盘。
+  // 返回 false 表示未在录制，或该帧被丢弃。
+  bool Enqueue(const FrameInfo &frame, const uint8_t *data);
+
+  // 等待当前录制写完并完成文件
+  void Flush();
+
+  SerWriterStats Stats() const;
+
+ private:
+  struct Job {
+    FrameLease pixels;
+    size_t bytes;
+    int64_t utcUs;
+    uint64_t frameId;
+  };
+  class File;
+
+  void Run();
+  bool WriteFrame(const Job &job);
+  bool Finish();
+
+  mutable std::mutex mutex_;
+  std::condition_variable jobReady_;
+  std::condition_variable finished_;
+  std::deque<Job> queue_;
+  bool stopping_ = false;
+  bool finishPending_ = false;  // Stop 之后、文件完成之前
+  size_t copying_ = 0;          // 已取得缓冲区、正在拷贝尚未入队的帧
+  std::thread thread_;
+  FramePool buffers_;
+
+  bool recording_ = false;
+  size_t ringSize_ = kSerDefaultRing;
+  std::string path_;
+  std::string instrument_;
+  std::string observer_;
+  std::string telescope_;
+  // 首帧决定的格式，之后的帧必须一致
+  bool formatKnown_ = false;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  uint32_t bytesPerPixel_ = 0;
+  uint32_t colorId_ = 0;
+
+  // 以下只在写盘线程中访问（Start 时线程空闲）
+  File *file_ = nullptr;
+  uint64_t fileOffset_ = kSerHeaderSize;
+  uint64_t allocated_ = 0;
+  std::vector<int64_t> timestamps_;
+  int64_t firstUtcUs_ = 0;
+
+  uint64_t frames_ = 0;
+  uint64_t dropped_ = 0;
+  uint64_t bytesWritten_ = 0;
+  int64_t startUs_ = 0;
+  int64_t stopUs_ = 0;
+  std::string lastError_;
+};
+
+#endif // SER_WRITER_H
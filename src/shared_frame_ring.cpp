@@ -0,0 +1,284 @@
+#include "shared_frame_ring.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 共享内存中的原子变量必须是无锁的，否则两个进程各自的锁互不可见
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "64-bit atomics must be lock-free");
+
+namespace {
+
+const uint32_t kRingMagic = 0x52464851;  // "QHFR"
+const uint32_t kRingVersion = 1;
+// 槽数据按页对齐
+const size_t kRingPageSize = 4096;
+
+size_t RoundUpToPage(size_t size) {
+  return (size + kRingPageSize - 1) / kRingPageSize * kRingPageSize;
+}
+
+std::atomic<uint32_t> g_ringCounter(0);
+
+#ifdef _WIN32
+std::wstring RingWideName(const std::string &name) {
+  return std::wstring(name.begin(), name.end());
+}
+#endif
+
+}  // namespace
+
+// 映射起始处的描述信息，读取方据此校验并得到槽的布局
+struct SharedFrameRing::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t reserved;
+  uint64_t slotBytes;
+  std::atomic<uint64_t> lastSequence;
+  uint8_t padding[32];
+};
+
+// 每个槽的 seqlock 状态：sequence 为 0 表示正在写入或尚未写入
+struct SharedFrameRing::Slot {
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> bytes;
+  uint8_t padding[48];
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == 8, "unexpected atomic size");
+
+SharedFrameRing::SharedFrameRing() {}
+
+SharedFrameRing::~SharedFrameRing() {
+  Close();
+}
+
+SharedFrameRing::Slot *SharedFrameRing::SlotAt(size_t index) const {
+  return reinterpret_cast<Slot *>(base_ + sizeof(Header) + index * sizeof(Slot));
+}
+
+uint8_t *SharedFrameRing::SlotData(size_t index) const {
+  size_t dataOffset = RoundUpToPage(sizeof(Header) + slotCount_ * sizeof(Slot));
+  return base_ + dataOffset + index * slotBytes_;
+}
+
+bool SharedFrameRing::Map(size_t size, bool create, std::string *error) {
+  char msg[160];
+#ifdef _WIN32
+  std::wstring wide = RingWideName(name_);
+  HANDLE mapping = NULL;
+  if (create) {
+    mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32),
+                                 (DWORD)size, wide.c_str());
+    if (mapping != NULL && GetLastError() == ERROR_ALREADY_EXISTS) {
+      CloseHandle(mapping);
+      mapping = NULL;
+      SetLastError(ERROR_ALREADY_EXISTS);
+    }
+  } else {
+    mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, wide.c_str());
+  }
+  if (mapping == NULL) {
+    snprintf(msg, sizeof(msg), "%s %s failed (error %lu)", create ? "CreateFileMapping" : "OpenFileMapping",
+             name_.c_str(), (unsigned long)GetLastError());
+    *error = msg;
+    return false;
+  }
+  void *view = MapViewOfFile(mapping, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, create ? size : 0);
+  if (view == NULL) {
+    snprintf(msg, sizeof(msg), "MapViewOfFile %s failed (error %lu)", name_.c_str(), (unsigned long)GetLastError());
+    *error = msg;
+    CloseHandle(mapping);
+    return false;
+  }
+  if (!create) {
+    MEMORY_BASIC_INFORMATION info;
+    size = VirtualQuery(view, &info, sizeof(info)) ? (size_t)info.RegionSize : 0;
+  }
+  mapping_ = mapping;
+  base_ = static_cast<uint8_t *>(view);
+  size_ = size;
+  return true;
+#else
+  // 读取方只读映射
+  int fd = create ? ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600)
+                  : ::shm_open(name_.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    snprintf(msg, sizeof(msg), "shm_open %s failed (%s)", name_.c_str(), strerror(errno));
+    *error = msg;
+    return false;
+  }
+  bool ok = true;
+  if (create) {
+    ok = ::ftruncate(fd, (off_t)size) == 0;
+  } else {
+    struct stat st;
+    ok = ::fstat(fd, &st) == 0;
+    size = ok ? (size_t)st.st_size : 0;
+  }
+  void *view = ok && size > 0 ? ::mmap(NULL, size, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0)
+                              : MAP_FAILED;
+  if (view == MAP_FAILED) {
+    snprintf(msg, sizeof(msg), "mapping %s failed (%s)", name_.c_str(), strerror(errno));
+    *error = msg;
+    ::close(fd);
+    if (create) {
+      ::shm_unlink(name_.c_str());
+    }
+    return false;
+  }
+  // 映射建立后不再需要文件描述符
+  ::close(fd);
+  base_ = static_cast<uint8_t *>(view);
+  size_ = size;
+  return true;
+#endif
+}
+
+bool SharedFrameRing::Create(size_t slotCount, size_t slotBytes, std::string *error) {
+  Close();
+  if (slotCount < 1 || slotCount > kSharedRingMaxSlots || slotBytes == 0) {
+    *error = "invalid shared ring size";
+    return false;
+  }
+  char name[64];
+#ifdef _WIN32
+  snprintf(name, sizeof(name), "Local\\webezcap-%lu-%u", (unsigned long)GetCurrentProcessId(),
+           (unsigned)g_ringCounter.fetch_add(1));
+#else
+  snprintf(name, sizeof(name), "/webezcap-%ld-%u", (long)getpid(), (unsigned)g_ringCounter.fetch_add(1));
+#endif
+  name_ = name;
+  slotCount_ = slotCount;
+  slotBytes_ = RoundUpToPage(slotBytes);
+  size_t total = RoundUpToPage(sizeof(Header) + slotCount_ * sizeof(Slot)) + slotCount_ * slotBytes_;
+  if (!Map(total, true, error)) {
+    name_.clear();
+    slotCount_ = 0;
+    slotBytes_ = 0;
+    return false;
+  }
+  owner_ = true;
+
+  Header *header = new (base_) Header();
+  header->magic = kRingMagic;
+  header->version = kRingVersion;
+  header->slotCount = (uint32_t)slotCount_;
+  header->slotBytes = slotBytes_;
+  header->lastSequence.store(0, std::memory_order_relaxed);
+  for (size_t i = 0; i < slotCount_; i++) {
+    Slot *slot = new (SlotAt(i)) Slot();
+    slot->sequence.store(0, std::memory_order_relaxed);
+    slot->bytes.store(0, std::memory_order_relaxed);
+  }
+  sequence_ = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+  return true;
+}
+
+bool SharedFrameRing::Open(const std::string &name, std::string *error) {
+  Close();
+  name_ = name;
+  if (!Map(0, false, error)) {
+    name_.clear();
+    return false;
+  }
+  const Header *header = reinterpret_cast<const Header *>(base_);
+  if (size_ < sizeof(Header) || header->magic != kRingMagic || header->version != kRingVersion ||
+      header->slotCount < 1 || header->slotCount > kSharedRingMaxSlots) {
+    *error = "not a frame ring: " + name;
+    Close();
+    return false;
+  }
+  slotCount_ = header->slotCount;
+  slotBytes_ = (size_t)header->slotBytes;
+  // Windows 下映射大小按页取整，只要求不小于布局所需
+  if (size_ < RoundUpToPage(sizeof(Header) + slotCount_ * sizeof(Slot)) + slotCount_ * slotBytes_) {
+    *error = "truncated frame ring: " + name;
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void SharedFrameRing::Close() {
+  if (base_ != nullptr) {
+#ifdef _WIN32
+    UnmapViewOfFile(base_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+    mapping_ = nullptr;
+#else
+    ::munmap(base_, size_);
+    if (owner_) {
+      ::shm_unlink(name_.c_str());
+    }
+#endif
+  }
+  base_ = nullptr;
+  size_ = 0;
+  owner_ = false;
+  name_.clear();
+  slotCount_ = 0;
+  slotBytes_ = 0;
+  sequence_ = 0;
+}
+
+uint64_t SharedFrameRing::LastSequence() const {
+  if (base_ == nullptr) {
+    return 0;
+  }
+  return reinterpret_cast<const Header *>(base_)->lastSequence.load(std::memory_order_acquire);
+}
+
+uint64_t SharedFrameRing::Publish(const uint8_t *data, size_t bytes) {
+  if (!owner_ || bytes > slotBytes_) {
+    return 0;
+  }
+  const uint64_t sequence = ++sequence_;
+  const size_t index = (size_t)((sequence - 1) % slotCount_);
+  Slot *slot = SlotAt(index);
+  // 先把槽标记为写入中，之后的数据写入不会被重排到这之前
+  slot->sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(SlotData(index), data, bytes);
+  slot->bytes.store(bytes, std::memory_order_relaxed);
+  slot->sequence.store(sequence, std::memory_order_release);
+  reinterpret_cast<Header *>(base_)->lastSequence.store(sequence, std::memory_order_release);
+  return sequence;
+}
+
+bool SharedFrameRing::Read(uint64_t sequence, uint8_t *dst, size_t capacity, size_t *bytes) const {
+  if (base_ == nullptr || sequence == 0) {
+    return false;
+  }
+  const size_t index = (size_t)((sequence - 1) % slotCount_);
+  const Slot *slot = SlotAt(index);
+  if (slot->sequence.load(std::memory_order_acquire) != sequence) {
+    return false;
+  }
+  const size_t length = (size_t)slot->bytes.load(std::memory_order_relaxed);
+  if (length > capacity || length > slotBytes_) {
+    return false;
+  }
+  std::memcpy(dst, SlotData(index), length);
+  // 拷贝期间写入方开始覆盖该槽时序号会变化，拷贝到的数据不可用
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot->sequence.load(std::memory_order_relaxed) != sequence) {
+    return false;
+  }
+  *bytes = length;
+  return true;
+}
@@ -0,0 +1,70 @@
+// 跨进程共享的帧环形缓冲：主进程把要显示的帧写入一块命名共享内存（Windows 为 CreateFileMapping，
+// 其它平台为 shm_open + mmap），只通过 IPC 发送很小的通知（名称、序号、长度），渲染进程的 preload
+// 按序号从同一块内存中读出。大帧不再经过 IPC 的结构化拷贝，IPC 消息大小与帧尺寸无关。
+//
+// 共有 slotCount 个槽，第 n 帧（序号从 1 开始）写入槽 (n - 1) % slotCount。每个槽是一个 seqlock：
+// 写入前把槽的序号清零，写完后再写入本帧序号；读取方在拷贝前后各检查一次序号，不一致说明该槽已被
+// 后续帧覆盖（渲染进程落后超过 slotCount - 1 帧），这一帧直接放弃。写入方从不等待读取方。
+//
+// 共享内存不能直接包装为 JS 的 ArrayBuffer（Electron 的 V8 内存隔离禁止外部 ArrayBuffer），
+// 读取方仍要拷贝一次到自己的缓冲区。本文件不包含任何 N-API 代码。
+
+#ifndef SHARED_FRAME_RING_H
+#define SHARED_FRAME_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+static const size_t kSharedRingDefaultSlots = 3;
+static const size_t kSharedRingMaxSlots = 16;
+
+class SharedFrameRing {
+ public:
+  SharedFrameRing();
+  // 创建者关闭时同时删除共享内存的名称，已映射的读取方不受影响
+  ~SharedFrameRing();
+
+  SharedFrameRing(const SharedFrameRing &) = delete;
+  SharedFrameRing &operator=(const SharedFrameRing &) = delete;
+
+  // 创建一块新的共享内存（名称自动生成，含进程号），每个槽至少 slotBytes 字节。
+  bool Create(size_t slotCount, size_t slotBytes, std::string *error);
+  // 按名称映射另一个进程创建的共享内存
+  bool Open(const std::string &name, std::string *error);
+  void Close();
+
+  bool IsOpen() const { return base_ != nullptr; }
+  const std::string &Name() const { return name_; }
+  size_t SlotCount() const { return slotCount_; }
+  size_t SlotBytes() const { return slotBytes_; }
+  // 最近写入的一帧的序号，尚未写入时为 0
+  uint64_t LastSequence() const;
+
+  // 写入一帧，返回它的序号；bytes 超过槽大小或未创建时返回 0。只能在创建者的一个线程中调用。
+  uint64_t Publish(const uint8_t *data, size_t bytes);
+
+  // 读出序号为 sequence 的帧（dst 至少 capacity 字节）。该帧已被覆盖、长度不符或尚未写入时返回 false。
+  bool Read(uint64_t sequence, uint8_t *dst, size_t capacity, size_t *bytes) const;
+
+ private:
+  struct Header;
+  struct Slot;
+
+  bool Map(size_t size, bool create, std::string *error);
+  Slot *SlotAt(size_t index) const;
+  uint8_t *SlotData(size_t index) const;
+
+  std::string name_;
+  bool owner_ = false;
+  uint8_t *base_ = nullptr;
+  size_t size_ = 0;
+  size_t slotCount_ = 0;
+  size_t slotBytes_ = 0;
+  uint64_t sequence_ = 0;
+#ifdef _WIN32
+  void *mapping_ = nullptr;
+#endif
+};
+
+#endif // SHARED_FRAME_RING_H
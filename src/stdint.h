@@ -59,7 +59,12 @@ typedef  uint64_t uintmax_t;
 /* 为了兼容性，此处不强制定义所有 LIMIT 宏，QHYCCD SDK 只依赖类型本身。 */
 
 #else  /* 非 MSVC：直接退回系统自带的实现 */
+/* src 在头文件搜索路径中时 <stdint.h> 会再次找到本文件，GCC/Clang 需要用 include_next 跳过 */
+#if defined(__GNUC__) || defined(__clang__)
+#include_next <stdint.h>
+#else
 #include <stdint.h>
+#endif
 #endif /* _MSC_VER */
 
 #endif /* LOCAL_STDINT_H */
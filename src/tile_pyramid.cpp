@@ -0,0 +1,96 @@
+#include "tile_pyramid.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "image_preview.h"
+
+static PyramidLevel MakeLevel(uint32_t width, uint32_t height, uint32_t scale, uint32_t tileSize) {
+  PyramidLevel level;
+  level.width = width;
+  level.height = height;
+  level.scale = scale;
+  level.columns = (width + tileSize - 1) / tileSize;
+  level.rows = (height + tileSize - 1) / tileSize;
+  return level;
+}
+
+void TilePyramid::Build(const uint16_t *src, uint32_t width, uint32_t height, uint32_t tileSize,
+                        std::shared_ptr<const void> owner) {
+  Reset();
+  if (src == nullptr || width == 0 || height == 0) {
+    return;
+  }
+  tileSize_ = std::max<uint32_t>(tileSize, 16);
+  base_ = src;
+  owner_ = std::move(owner);
+  levels_.push_back(MakeLevel(width, height, 1, tileSize_));
+
+  // 每级由上一级 2x2 平均得到，直到整幅图放得进一个图块
+  const uint16_t *prev = src;
+  while (width > tileSize_ || height > tileSize_) {
+    uint32_t nextWidth = (width + 1) / 2;
+    uint32_t nextHeight = (height + 1) / 2;
+    std::vector<uint16_t> pixels((size_t)nextWidth * nextHeight);
+    DownsampleBox16(prev, width, height, 2, pixels.data());
+    data_.push_back(std::move(pixels));
+    prev = data_.back().data();
+    width = nextWidth;
+    height = nextHeight;
+    levels_.push_back(MakeLevel(width, height, levels_.back().scale * 2, tileSize_));
+  }
+}
+
+void TilePyramid::Reset() {
+  levels_.clear();
+  data_.clear();
+  base_ = nullptr;
+  owner_.reset();
+}
+
+const uint16_t *TilePyramid::LevelPixels(size_t level) const {
+  return level == 0 ? base_ : data_[level - 1].data();
+}
+
+bool TilePyramid::TileExtent(size_t level, uint32_t x, uint32_t y, uint32_t *width, uint32_t *height) const {
+  if (level >= levels_.size()) {
+    return false;
+  }
+  const PyramidLevel &l = levels_[level];
+  if (x >= l.columns || y >= l.rows) {
+    return false;
+  }
+  *width = std::min(tileSize_, l.width - x * tileSize_);
+  *height = std::min(tileSize_, l.height - y * tileSize_);
+  return true;
+}
+
+bool TilePyramid::StretchTile(size_t level, uint32_t x, uint32_t y, uint16_t black, uint16_t white,
+                              StretchFormat format, uint8_t *dst) const {
+  uint32_t w = 0;
+  uint32_t h = 0;
+  if (!TileExtent(level, x, y, &w, &h)) {
+    return false;
+  }
+  const PyramidLevel &l = levels_[level];
+  const uint16_t *src = LevelPixels(level) + (size_t)y * tileSize_ * l.width + (size_t)x * tileSize_;
+  const size_t rowBytes = (size_t)w * StretchBytesPerPixel(format);
+  for (uint32_t row = 0; row < h; row++) {
+    StretchLevels16(src + (size_t)row * l.width, dst + row * rowBytes, w, black, white, format);
+  }
+  return true;
+}
+
+bool TilePyramid::CopyTile(size_t level, uint32_t x, uint32_t y, uint16_t *dst) const {
+  uint32_t w = 0;
+  uint32_t h = 0;
+  if (!TileExtent(level, x, y, &w, &h)) {
+    return false;
+  }
+  const PyramidLevel &l = levels_[level];
+  const uint16_t *src = LevelPixels(level) + (size_t)y * tileSize_ * l.width + (size_t)x * tileSize_;
+  for (uint32_t row = 0; row < h; row++) {
+    memcpy(dst + (size_t)row * w, src + (size_t)row * l.width, w * sizeof(uint16_t));
+  }
+  return true;
+}
@@ -0,0 +1,66 @@
+// 多分辨率图块金字塔：第 0 级为原图，之后每级宽高减半（2x2 区域平均），直到整幅图不超过一个图块。
+// 界面只按当前缩放与可视区域请求需要的图块，任何尺寸的传感器都不需要把整帧作为一张纹理上传。
+//
+// 第 0 级不拷贝，直接读取原图；构建时传入的 owner 会一直持有到金字塔释放，用于保证原图内存有效
+// （例如持有帧缓冲池的租约，避免缓冲区被后续帧覆盖）。
+
+#ifndef TILE_PYRAMID_H
+#define TILE_PYRAMID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "image_stretch.h"
+
+static const uint32_t kDefaultTileSize = 512;
+
+struct PyramidLevel {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t scale = 1;  // 本级 1 像素对应原图的像素数（2 的 level 次方）
+  uint32_t columns = 0;
+  uint32_t rows = 0;
+};
+
+class TilePyramid {
+ public:
+  TilePyramid() {}
+
+  TilePyramid(const TilePyramid &) = delete;
+  TilePyramid &operator=(const TilePyramid &) = delete;
+
+  // 从 width x height 的 16bit 单通道图像构建金字塔，src 在本对象或 owner 的生命周期内必须有效。
+  void Build(const uint16_t *src, uint32_t width, uint32_t height, uint32_t tileSize,
+             std::shared_ptr<const void> owner);
+
+  // 释放各级数据与 owner，之后 LevelCount() 为 0。
+  void Reset();
+
+  uint32_t TileSize() const { return tileSize_; }
+  size_t LevelCount() const { return levels_.size(); }
+  const PyramidLevel &Level(size_t level) const { return levels_[level]; }
+
+  // 图块 (x, y) 在本级中的实际宽高（右侧 / 底部的图块可能不满 tileSize），越界返回 false。
+  bool TileExtent(size_t level, uint32_t x, uint32_t y, uint32_t *width, uint32_t *height) const;
+
+  // 把图块按黑 / 白电平拉伸后写入 dst（至少 width * height * StretchBytesPerPixel(format) 字节，
+  // 按图块实际宽度紧密排列），越界返回 false。
+  bool StretchTile(size_t level, uint32_t x, uint32_t y, uint16_t black, uint16_t white,
+                   StretchFormat format, uint8_t *dst) const;
+
+  // 把图块的 16bit 原始数据写入 dst（width * height 个像素），越界返回 false。
+  bool CopyTile(size_t level, uint32_t x, uint32_t y, uint16_t *dst) const;
+
+ private:
+  const uint16_t *LevelPixels(size_t level) const;
+
+  uint32_t tileSize_ = kDefaultTileSize;
+  std::vector<PyramidLevel> levels_;
+  std::vector<std::vector<uint16_t>> data_;  // 第 1 级起的像素，data_[level - 1]
+  const uint16_t *base_ = nullptr;
+  std::shared_ptr<const void> owner_;
+};
+
+#endif // TILE_PYRAMID_H
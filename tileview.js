@@ -0,0 +1,243 @@
+/**
+ * 图块视图模块
+ * 按当前缩放与可视区域，只向主进程请求可见的图块（来自原生图块金字塔），
+ * 以若干 512x512 的小纹理拼出图像，任意尺寸的传感器都不需要把整帧作为一张纹理上传。
+ */
+
+class TileView {
+  /**
+   * @param {Object} options
+   * @param {(request: { seq:number, tiles:Array<{ level:number, x:number, y:number }> }) => Promise<Array<{ level:number, x:number, y:number, width:number, height:number, buffer:ArrayBuffer }> | null>} options.requestTiles
+   * @param {() => string} options.getScaleMode 返回 'linear' 或 'nearest'
+   * @param {GpuLevels|null} [options.gpuLevels] 提供时图块为 16bit 原始数据，由 GPU 按电平拉伸；否则为 RGBA
+   */
+  constructor(options) {
+    this.requestTiles = options.requestTiles;
+    this.getScaleMode = options.getScaleMode;
+    this.gpuLevels = options.gpuLevels || null;
+
+    // 所有图块精灵的容器，坐标为原图像素坐标
+    this.container = new PIXI.Container();
+
+    this.seq = null;
+    this.pyramid = null; // { tileSize, levels: [{ width, height, scale, columns, rows }] }
+    // 黑/白电平变化后递增，旧版本的图块继续显示，直到被新图块替换
+    this.version = 0;
+    // key => { sprite, version, lastUsed }
+    this.tiles = new Map();
+    // 同一时间只有一个请求在途，期间的视图变化合并为一次后续请求
+    this.busy = false;
+    this.pending = false;
+    this.lastView = null;
+    this.useCounter = 0;
+
+    // 最多保留的图块数，超出时先释放不可见的图块
+    this.maxTiles = 96;
+    // 每次请求的图块数上限，避免单次 IPC 过大
+    this.batchSize = 8;
+  }
+
+  /**
+   * 是否有可用的金字塔
+   */
+  isActive() {
+    return this.pyramid !== null && this.pyramid.levels.length > 0;
+  }
+
+  /**
+   * 切换到新的一帧（pyramid 为空时清空图块视图）
+   * @param {number|null} seq
+   * @param {{ tileSize:number, levels:Array }|null} pyramid
+   */
+  setPyramid(seq, pyramid) {
+    this.clear();
+    this.seq = pyramid ? seq : null;
+    this.pyramid = pyramid || null;
+  }
+
+  /**
+   * 黑/白电平变化后重新请求可见图块
+   */
+  invalidate() {
+    // GPU 拉伸时图块共享电平 uniform，无需重新请求
+    if (this.gpuLevels) return;
+    this.version += 1;
+    if (this.lastView) {
+      this.update(this.lastView);
+    }
+  }
+
+  /**
+   * 插值模式变化后更新已有图块的缩放模式
+   */
+  applyScaleMode() {
+    if (this.gpuLevels) return;
+    const scaleMode = this.getScaleMode();
+    for (const tile of this.tiles.values()) {
+      tile.sprite.texture.source.scaleMode = scaleMode;
+    }
+  }
+
+  /**
+   * 释放所有图块
+   */
+  clear() {
+    for (const tile of this.tiles.values()) {
+      this.destroyTile(tile);
+    }
+    this.tiles.clear();
+  }
+
+  destroyTile(tile) {
+    this.container.removeChild(tile.sprite);
+    if (this.gpuLevels) {
+      this.gpuLevels.destroyImage(tile.sprite);
+    } else {
+      tile.sprite.destroy({ texture: true, textureSource: true });
+    }
+  }
+
+  /**
+   * 选择金字塔级别：本级 1 像素在屏幕上不小于 1 个物理像素
+   * @param {number} pixelsPerImagePixel 原图 1 像素对应的屏幕物理像素数
+   */
+  chooseLevel(pixelsPerImagePixel) {
+    const levels = this.pyramid.levels;
+    let level = 0;
+    while (level + 1 < levels.length && levels[level + 1].scale * pixelsPerImagePixel <= 1) {
+      level += 1;
+    }
+    return level;
+  }
+
+  /**
+   * 根据可视区域更新图块
+   * @param {{ x:number, y:number, width:number, height:number, pixelsPerImagePixel:number }} view
+   *   可视区域（原图像素坐标）与当前显示比例
+   */
+  update(view) {
+    this.lastView = view;
+    if (!this.isActive()) return;
+
+    const level = this.chooseLevel(view.pixelsPerImagePixel);
+    const info = this.pyramid.levels[level];
+    const span = this.pyramid.tileSize * info.scale; // 一个图块覆盖的原图像素数
+    const x0 = Math.max(0, Math.floor(view.x / span));
+    const y0 = Math.max(0, Math.floor(view.y / span));
+    const x1 = Math.min(info.columns - 1, Math.floor((view.x + view.width) / span));
+    const y1 = Math.min(info.rows - 1, Math.floor((view.y + view.height) / span));
+
+    this.useCounter += 1;
+    const visible = new Set();
+    const missing = [];
+    for (let y = y0; y <= y1; y++) {
+      for (let x = x0; x <= x1; x++) {
+        const key = `${level}:${x}:${y}`;
+        visible.add(key);
+        const tile = this.tiles.get(key);
+        if (tile) {
+          tile.lastUsed = this.useCounter;
+        }
+        if (!tile || tile.version !== this.version) {
+          missing.push({ level, x, y });
+        }
+      }
+    }
+
+    // 只显示当前级别的可见图块，其余隐藏（下层的预览图仍然可见）
+    for (const [key, tile] of this.tiles) {
+      tile.sprite.visible = visible.has(key);
+    }
+    this.evict(visible);
+
+    if (missing.length > 0) {
+      this.fetch(missing);
+    }
+  }
+
+  /**
+   * 图块过多时释放最久未使用且不可见的图块
+   */
+  evict(visible) {
+    if (this.tiles.size <= this.maxTiles) return;
+    const candidates = [...this.tiles.entries()]
+      .filter(([key]) => !visible.has(key))
+      .sort((a, b) => a[1].lastUsed - b[1].lastUsed);
+    for (const [key, tile] of candidates) {
+      if (this.tiles.size <= this.maxTiles) break;
+      this.destroyTile(tile);
+      this.tiles.delete(key);
+    }
+  }
+
+  async fetch(missing) {
+    if (this.busy) {
+      this.pending = true;
+      return;
+    }
+    this.busy = true;
+    const seq = this.seq;
+    const version = this.version;
+    try {
+      const results = await this.requestTiles({ seq, tiles: missing.slice(0, this.batchSize) });
+      if (results && seq === this.seq) {
+        for (const result of results) {
+          this.addTile(result, version);
+        }
+      }
+    } catch (e) {
+      console.error('请求图块失败:', e);
+    } finally {
+      this.busy = false;
+    }
+    // 还有未取到的图块或期间视图发生了变化
+    if (seq === this.seq && (this.pending || missing.length > this.batchSize || version !== this.version)) {
+      this.pending = false;
+      if (this.lastView) {
+        this.update(this.lastView);
+      }
+    }
+  }
+
+  addTile({ level, x, y, width, height, buffer }, version) {
+    const key = `${level}:${x}:${y}`;
+    const info = this.pyramid.levels[level];
+    const span = this.pyramid.tileSize * info.scale;
+
+    const old = this.tiles.get(key);
+    if (old) {
+      this.destroyTile(old);
+    }
+    const sprite = this.gpuLevels
+      ? this.gpuLevels.createImage(new Uint16Array(buffer), width, height)
+      : new PIXI.Sprite(
+          new PIXI.Texture({
+            source: new PIXI.BufferImageSource({
+              resource: new Uint8Array(buffer),
+              width,
+              height,
+              format: 'rgba8unorm',
+              scaleMode: this.getScaleMode(),
+            }),
+          }),
+        );
+    sprite.position.set(x * span, y * span);
+    sprite.scale.set(info.scale);
+    sprite.visible = this.isVisibleNow(level, x, y);
+    this.container.addChild(sprite);
+    this.tiles.set(key, { sprite, version, lastUsed: this.useCounter });
+  }
+
+  isVisibleNow(level, x, y) {
+    if (!this.lastView) return false;
+    const view = this.lastView;
+    if (this.chooseLevel(view.pixelsPerImagePixel) !== level) return false;
+    const span = this.pyramid.tileSize * this.pyramid.levels[level].scale;
+    return (
+      (x + 1) * span > view.x &&
+      x * span < view.x + view.width &&
+      (y + 1) * span > view.y &&
+      y * span < view.y + view.height
+    );
+  }
+}